@@ -0,0 +1,109 @@
+//! Generated records of production sizes
+//!
+//! The samples come from a fixed pseudo-random sequence, so every run
+//! benchmarks the same bytes.
+
+use citi::{Constant, DataArray, Device, Record, Var, WriteOptions};
+
+/// Shape of a generated record
+#[derive(Clone, Copy, Debug)]
+pub struct Shape {
+    /// Points in the independent variable and in every data array
+    pub points: usize,
+    pub arrays: usize,
+    /// Number of constants, and also of comments, in the header
+    pub header_lines: usize,
+    /// Write the independent variable as a `SEG_LIST` instead of a `VAR_LIST`
+    pub segments: bool,
+}
+
+impl Shape {
+    pub fn new(points: usize, arrays: usize) -> Shape {
+        Shape {
+            points,
+            arrays,
+            header_lines: 10,
+            segments: false,
+        }
+    }
+
+    /// Samples in all data arrays together
+    pub fn samples(&self) -> u64 {
+        (self.points * self.arrays) as u64
+    }
+}
+
+/// Point counts to sweep
+///
+/// Set `CITI_BENCH_LARGE` to also run 10M points, which takes minutes.
+pub fn point_counts() -> Vec<usize> {
+    let mut counts = vec![1_000, 10_000, 100_000, 1_000_000];
+    if std::env::var_os("CITI_BENCH_LARGE").is_some() {
+        counts.push(10_000_000);
+    }
+    counts
+}
+
+/// Xorshift, which is plenty for filling in samples
+struct Samples(u64);
+
+impl Samples {
+    /// Uniform in `[-100, 100)` with all 53 bits of mantissa in use
+    fn next(&mut self) -> f64 {
+        self.0 ^= self.0 << 13;
+        self.0 ^= self.0 >> 7;
+        self.0 ^= self.0 << 17;
+        (self.0 >> 11) as f64 / (1u64 << 53) as f64 * 200. - 100.
+    }
+}
+
+pub fn record(shape: &Shape) -> Record {
+    let mut record = Record::new("A.01.00", "BENCH");
+
+    for i in 0..shape.header_lines {
+        record
+            .header
+            .constants
+            .push(Constant::new(&format!("CONSTANT_{}", i), "1.5E0"));
+        record.header.comments.push(format!("Comment number {}", i));
+    }
+    let mut device = Device::new("NA");
+    device.entries.push(String::from("VERSION HP8510B.05.00"));
+    device.entries.push(String::from("REGISTER 1"));
+    record.header.devices.push(device);
+
+    let mut independent_variable = Var::new("FREQ", "MAG");
+    if shape.segments {
+        independent_variable.seq(1E9, 1E10, shape.points);
+    } else {
+        let step = 9E9 / shape.points as f64;
+        for i in 0..shape.points {
+            independent_variable.push(1E9 + i as f64 * step);
+        }
+    }
+    record.header.independent_variable = independent_variable;
+
+    let mut samples = Samples(0x9E37_79B9_7F4A_7C15);
+    for i in 0..shape.arrays {
+        let mut array = DataArray::new(&format!("S[{},{}]", i / 8 + 1, i % 8 + 1), "RI");
+        array.samples.reserve(shape.points);
+        for _ in 0..shape.points {
+            let real = samples.next();
+            array.add_sample(real, samples.next());
+        }
+        record.data.push(array);
+    }
+
+    record
+}
+
+/// Record as it would be read from a file
+pub fn text(record: &Record) -> Vec<u8> {
+    text_with_options(record, &WriteOptions::default())
+}
+
+pub fn text_with_options(record: &Record, options: &WriteOptions) -> Vec<u8> {
+    let mut bytes = vec![];
+    record.to_writer_with_options(&mut bytes, options).unwrap();
+    bytes
+}
@@ -1,5 +1,6 @@
 use criterion::criterion_main;
 
+pub mod generate;
 pub mod read;
 pub mod write;
 
@@ -1,7 +1,10 @@
+use crate::generate::{self, Shape};
 use citi;
-use criterion::{black_box, criterion_group, Criterion};
+use criterion::{black_box, criterion_group, BenchmarkId, Criterion, Throughput};
 use std::fs::File;
+use std::io::Write;
 use std::path::PathBuf;
+use tempfile::NamedTempFile;
 
 fn read_record(filename: &str) {
     let mut path_buf = base_directory();
@@ -31,4 +34,111 @@ read_benchmark!(display_memory, "display_memory.cti");
 read_benchmark!(list_cal_set, "list_cal_set.cti");
 read_benchmark!(wvi_file, "wvi_file.cti");
 
-criterion_group!(read, data_file, display_memory, list_cal_set, wvi_file,);
+fn temporary_file(bytes: &[u8]) -> NamedTempFile {
+    let mut file = NamedTempFile::new().unwrap();
+    file.write_all(bytes).unwrap();
+    file
+}
+
+/// Every way of reading a whole record, in samples per second
+fn read_points(c: &mut Criterion) {
+    let mut group = c.benchmark_group("read points");
+    group.sample_size(10);
+    for points in generate::point_counts() {
+        let shape = Shape::new(points, 1);
+        let bytes = generate::text(&generate::record(&shape));
+        let file = temporary_file(&bytes);
+        group.throughput(Throughput::Elements(shape.samples()));
+
+        group.bench_with_input(
+            BenchmarkId::new("from_reader", points),
+            &bytes,
+            |b, bytes| b.iter(|| citi::Record::from_reader(&mut bytes.as_slice()).unwrap()),
+        );
+        group.bench_with_input(
+            BenchmarkId::new("from_path_mmap", points),
+            file.path(),
+            |b, path| b.iter(|| citi::Record::from_path_mmap(path).unwrap()),
+        );
+    }
+    group.finish();
+}
+
+/// Sequential against parallel parsing of many data arrays
+fn read_arrays(c: &mut Criterion) {
+    let mut group = c.benchmark_group("read arrays");
+    group.sample_size(10);
+    for &arrays in &[1, 4, 16, 64] {
+        let shape = Shape::new(10_000, arrays);
+        let bytes = generate::text(&generate::record(&shape));
+        group.throughput(Throughput::Elements(shape.samples()));
+
+        group.bench_with_input(
+            BenchmarkId::new("from_reader", arrays),
+            &bytes,
+            |b, bytes| b.iter(|| citi::Record::from_reader(&mut bytes.as_slice()).unwrap()),
+        );
+        group.bench_with_input(
+            BenchmarkId::new("from_slice_parallel", arrays),
+            &bytes,
+            |b, bytes| b.iter(|| citi::Record::from_slice_parallel(bytes, 0).unwrap()),
+        );
+    }
+    group.finish();
+}
+
+/// Header keywords, in bytes per second
+fn read_header(c: &mut Criterion) {
+    let mut group = c.benchmark_group("read header");
+    for &header_lines in &[0, 100, 10_000] {
+        let shape = Shape {
+            header_lines,
+            ..Shape::new(1_000, 1)
+        };
+        let bytes = generate::text(&generate::record(&shape));
+        group.throughput(Throughput::Bytes(bytes.len() as u64));
+
+        group.bench_with_input(
+            BenchmarkId::new("from_reader", header_lines),
+            &bytes,
+            |b, bytes| b.iter(|| citi::Record::from_reader(&mut bytes.as_slice()).unwrap()),
+        );
+    }
+    group.finish();
+}
+
+/// `SEG_LIST` against `VAR_LIST`, in bytes per second
+fn read_independent_variable(c: &mut Criterion) {
+    let mut group = c.benchmark_group("read independent variable");
+    for &(label, segments) in &[("VAR_LIST", false), ("SEG_LIST", true)] {
+        let shape = Shape {
+            segments,
+            ..Shape::new(100_000, 1)
+        };
+        let options = citi::WriteOptions {
+            segments,
+            ..citi::WriteOptions::default()
+        };
+        let bytes = generate::text_with_options(&generate::record(&shape), &options);
+        group.throughput(Throughput::Bytes(bytes.len() as u64));
+
+        group.bench_with_input(
+            BenchmarkId::new("from_reader", label),
+            &bytes,
+            |b, bytes| b.iter(|| citi::Record::from_reader(&mut bytes.as_slice()).unwrap()),
+        );
+    }
+    group.finish();
+}
+
+criterion_group!(
+    read,
+    data_file,
+    display_memory,
+    list_cal_set,
+    wvi_file,
+    read_points,
+    read_arrays,
+    read_header,
+    read_independent_variable,
+);
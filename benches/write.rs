@@ -1,81 +1,175 @@
+use crate::generate::{self, Shape};
 use citi;
-use criterion::{black_box, criterion_group, Criterion};
-use num_complex::Complex;
-use rand::Rng;
+use criterion::{black_box, criterion_group, BenchmarkId, Criterion, Throughput};
 use std::fs::File;
 use tempfile::tempdir;
 
-fn create_record(n: usize) -> citi::Record {
-    let mut rng = rand::thread_rng();
-
-    let mut record = citi::Record::default();
-    record.header.constants.push(citi::Constant {
-        name: String::from("Const Name"),
-        value: String::from("Value"),
-    });
-    record.header.independent_variable = citi::Var {
-        name: String::from("Var Name"),
-        format: String::from("Format"),
-        data: vec![1.],
+/// Write into a buffer that already has room, leaving only the formatting
+fn write_to_memory(record: &citi::Record, options: &citi::WriteOptions, buffer: &mut Vec<u8>) {
+    buffer.clear();
+    record.to_writer_with_options(buffer, options).unwrap();
+}
+
+/// Both float formats, in samples per second
+fn write_points(c: &mut Criterion) {
+    let round_trip = citi::WriteOptions::default();
+    let significant_digits = citi::WriteOptions {
+        data_format: citi::FloatFormat::SignificantDigits(6),
+        ..citi::WriteOptions::default()
+    };
+
+    let mut group = c.benchmark_group("write points");
+    group.sample_size(10);
+    for points in generate::point_counts() {
+        let shape = Shape::new(points, 1);
+        let record = generate::record(&shape);
+        let mut buffer = Vec::with_capacity(generate::text(&record).len());
+        group.throughput(Throughput::Elements(shape.samples()));
+
+        group.bench_with_input(
+            BenchmarkId::new("round trip", points),
+            &record,
+            |b, record| b.iter(|| write_to_memory(record, &round_trip, &mut buffer)),
+        );
+        group.bench_with_input(
+            BenchmarkId::new("significant digits", points),
+            &record,
+            |b, record| b.iter(|| write_to_memory(record, &significant_digits, &mut buffer)),
+        );
+    }
+    group.finish();
+}
+
+/// Writing through the file system, in bytes per second
+fn write_file(c: &mut Criterion) {
+    let directory = tempdir().unwrap();
+    let path = directory.path().join("file.cti");
+
+    let mut group = c.benchmark_group("write file");
+    group.sample_size(10);
+    for &points in &[1_000, 100_000] {
+        let record = generate::record(&Shape::new(points, 1));
+        group.throughput(Throughput::Bytes(generate::text(&record).len() as u64));
+
+        group.bench_with_input(
+            BenchmarkId::new("to_writer", points),
+            &record,
+            |b, record| {
+                b.iter(|| {
+                    record
+                        .to_writer(black_box(&mut File::create(&path).unwrap()))
+                        .unwrap()
+                })
+            },
+        );
+    }
+    group.finish();
+}
+
+fn write_arrays(c: &mut Criterion) {
+    let options = citi::WriteOptions::default();
+
+    let mut group = c.benchmark_group("write arrays");
+    group.sample_size(10);
+    for &arrays in &[1, 4, 16, 64] {
+        let shape = Shape::new(10_000, arrays);
+        let record = generate::record(&shape);
+        let mut buffer = Vec::with_capacity(generate::text(&record).len());
+        group.throughput(Throughput::Elements(shape.samples()));
+
+        group.bench_with_input(
+            BenchmarkId::new("to_writer", arrays),
+            &record,
+            |b, record| b.iter(|| write_to_memory(record, &options, &mut buffer)),
+        );
+    }
+    group.finish();
+}
+
+/// Formatting on one thread against one per core, in samples per second
+fn write_parallel(c: &mut Criterion) {
+    let sequential = citi::WriteOptions::default();
+    let parallel = citi::WriteOptions {
+        threads: 0,
+        ..citi::WriteOptions::default()
     };
-    record.header.devices.push(citi::Device {
-        name: String::from("Name A"),
-        entries: vec![String::from("entry 1"), String::from("entry 2")],
-    });
-    record.header.comments.push(String::from("A Comment"));
-    record.header.name = String::from("Name");
-    record.header.version = String::from("A.01.00");
-    record.data.push(citi::DataArray {
-        name: String::from("Data Name A"),
-        format: String::from("Format A"),
-        samples: (0..n)
-            .map(|_| Complex {
-                re: rng.gen_range(-100.0..100.0),
-                im: rng.gen_range(-100.0..100.0),
-            })
-            .collect(),
-    });
-
-    record
+
+    let mut group = c.benchmark_group("write parallel");
+    group.sample_size(10);
+    for &arrays in &[1, 16] {
+        let shape = Shape::new(100_000, arrays);
+        let record = generate::record(&shape);
+        let mut buffer = Vec::with_capacity(generate::text(&record).len());
+        group.throughput(Throughput::Elements(shape.samples()));
+
+        group.bench_with_input(
+            BenchmarkId::new("sequential", arrays),
+            &record,
+            |b, record| b.iter(|| write_to_memory(record, &sequential, &mut buffer)),
+        );
+        group.bench_with_input(
+            BenchmarkId::new("all cores", arrays),
+            &record,
+            |b, record| b.iter(|| write_to_memory(record, &parallel, &mut buffer)),
+        );
+    }
+    group.finish();
 }
 
-fn write_record<W: std::io::Write>(record: &citi::Record, writer: &mut W) {
-    record.to_writer(writer).unwrap();
+fn write_header(c: &mut Criterion) {
+    let options = citi::WriteOptions::default();
+
+    let mut group = c.benchmark_group("write header");
+    for &header_lines in &[0, 100, 10_000] {
+        let shape = Shape {
+            header_lines,
+            ..Shape::new(1_000, 1)
+        };
+        let record = generate::record(&shape);
+        let length = generate::text(&record).len();
+        let mut buffer = Vec::with_capacity(length);
+        group.throughput(Throughput::Bytes(length as u64));
+
+        group.bench_with_input(
+            BenchmarkId::new("to_writer", header_lines),
+            &record,
+            |b, record| b.iter(|| write_to_memory(record, &options, &mut buffer)),
+        );
+    }
+    group.finish();
 }
 
-fn write_benchmark(c: &mut Criterion) {
-    c.bench_function("write    10 samples", |b| {
-        b.iter(|| {
-            write_record(
-                black_box(&create_record(10)),
-                black_box(&mut File::create(tempdir().unwrap().path().join("file.cti")).unwrap()),
-            )
-        })
-    });
-    c.bench_function("write   100 samples", |b| {
-        b.iter(|| {
-            write_record(
-                black_box(&create_record(100)),
-                black_box(&mut File::create(tempdir().unwrap().path().join("file.cti")).unwrap()),
-            )
-        })
-    });
-    c.bench_function("write  1000 samples", |b| {
-        b.iter(|| {
-            write_record(
-                black_box(&create_record(1000)),
-                black_box(&mut File::create(tempdir().unwrap().path().join("file.cti")).unwrap()),
-            )
-        })
-    });
-    c.bench_function("write 10000 samples", |b| {
-        b.iter(|| {
-            write_record(
-                black_box(&create_record(10000)),
-                black_box(&mut File::create(tempdir().unwrap().path().join("file.cti")).unwrap()),
-            )
-        })
-    });
+fn write_independent_variable(c: &mut Criterion) {
+    let mut group = c.benchmark_group("write independent variable");
+    for &(label, segments) in &[("VAR_LIST", false), ("SEG_LIST", true)] {
+        let shape = Shape {
+            segments,
+            ..Shape::new(100_000, 1)
+        };
+        let options = citi::WriteOptions {
+            segments,
+            ..citi::WriteOptions::default()
+        };
+        let record = generate::record(&shape);
+        let length = generate::text_with_options(&record, &options).len();
+        let mut buffer = Vec::with_capacity(length);
+        group.throughput(Throughput::Bytes(length as u64));
+
+        group.bench_with_input(
+            BenchmarkId::new("to_writer", label),
+            &record,
+            |b, record| b.iter(|| write_to_memory(record, &options, &mut buffer)),
+        );
+    }
+    group.finish();
 }
 
-criterion_group!(write, write_benchmark);
+criterion_group!(
+    write,
+    write_points,
+    write_file,
+    write_arrays,
+    write_parallel,
+    write_header,
+    write_independent_variable,
+);
@@ -0,0 +1,132 @@
+#include <chrono>
+#include <complex>
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <string>
+#include <utility>
+
+#include <benchmark/benchmark.h>
+#include <citi/citi.hpp>
+
+namespace fs = std::filesystem;
+using namespace citi;
+
+namespace {
+    /// Array of `points` samples from a fixed pseudo-random sequence
+    Record::DataArray generate_data_array(const std::string& name, std::int64_t points, std::uint64_t& state) {
+        Record::DataArray data_array { name, "RI", {} };
+        data_array.samples.reserve(points);
+        const auto next = [&state]() {
+            state ^= state << 13;
+            state ^= state >> 7;
+            state ^= state << 17;
+            return static_cast<double>(state >> 11) / static_cast<double>(1ull << 53) * 200.0 - 100.0;
+        };
+        for (std::int64_t i = 0; i < points; ++i) {
+            const auto real = next();
+            data_array.samples.emplace_back(real, next());
+        }
+        return data_array;
+    }
+
+    Record generate_record(std::int64_t points, std::int64_t arrays) {
+        Record record {};
+        record.set_version("A.01.00");
+        record.set_name("BENCH");
+        for (auto i = 0; i < 10; ++i) {
+            record.append_comment("Comment number " + std::to_string(i));
+        }
+
+        Record::IndependentVariable independent_variable { "FREQ", "MAG", {} };
+        independent_variable.values.reserve(points);
+        for (std::int64_t i = 0; i < points; ++i) {
+            independent_variable.values.push_back(1e9 + i * 9e9 / points);
+        }
+        record.set_independent_variable(independent_variable);
+
+        std::uint64_t state = 0x9E3779B97F4A7C15ull;
+        for (std::int64_t i = 0; i < arrays; ++i) {
+            record.append_data_array(generate_data_array("S" + std::to_string(i), points, state));
+        }
+        return record;
+    }
+
+    /// Generated once per shape and reused by every benchmark
+    const fs::path& generated_file(std::int64_t points, std::int64_t arrays) {
+        static std::map<std::pair<std::int64_t, std::int64_t>, fs::path> files;
+
+        const auto key = std::make_pair(points, arrays);
+        auto file = files.find(key);
+        if (file == files.end()) {
+            const auto path = fs::temp_directory_path() / (
+                "citi_benchmark_" + std::to_string(points) + "_" + std::to_string(arrays) + ".cti");
+            generate_record(points, arrays).write_to_file(path);
+            file = files.emplace(key, path).first;
+        }
+        return file->second;
+    }
+
+    void set_throughput(benchmark::State& state, const fs::path& path) {
+        state.SetBytesProcessed(state.iterations() * static_cast<std::int64_t>(fs::file_size(path)));
+        state.SetItemsProcessed(state.iterations() * state.range(0) * state.range(1));
+    }
+
+    void record_shapes(benchmark::internal::Benchmark* benchmark) {
+        benchmark->ArgNames({"points", "arrays"});
+        benchmark->ArgsProduct({{1000, 100000, 1000000}, {1, 16}});
+        benchmark->Unit(benchmark::kMillisecond);
+    }
+}
+
+static void BM_ReadRecord(benchmark::State& state) {
+    const auto& path = generated_file(state.range(0), state.range(1));
+    for (auto _ : state) {
+        Record record { path };
+        benchmark::DoNotOptimize(record);
+    }
+    set_throughput(state, path);
+}
+BENCHMARK(BM_ReadRecord)->Apply(record_shapes);
+
+static void BM_ReadRecordMemoryMapped(benchmark::State& state) {
+    const auto& path = generated_file(state.range(0), state.range(1));
+    for (auto _ : state) {
+        Record record { path, Record::ReadMode::MemoryMapped };
+        benchmark::DoNotOptimize(record);
+    }
+    set_throughput(state, path);
+}
+BENCHMARK(BM_ReadRecordMemoryMapped)->Apply(record_shapes);
+
+/// Copying the data arrays out of a freshly read record
+///
+/// `data()` is cached, so every iteration reads the file again and only
+/// the first call is timed.
+static void BM_Data(benchmark::State& state) {
+    const auto& path = generated_file(state.range(0), state.range(1));
+    for (auto _ : state) {
+        Record record { path };
+
+        const auto start = std::chrono::steady_clock::now();
+        benchmark::DoNotOptimize(record.data());
+        const auto end = std::chrono::steady_clock::now();
+        state.SetIterationTime(std::chrono::duration<double>(end - start).count());
+    }
+    set_throughput(state, path);
+}
+BENCHMARK(BM_Data)->Apply(record_shapes)->UseManualTime();
+
+static void BM_AppendDataArray(benchmark::State& state) {
+    std::uint64_t seed = 0x9E3779B97F4A7C15ull;
+    const auto data_array = generate_data_array("S", state.range(0), seed);
+    for (auto _ : state) {
+        Record record {};
+        for (std::int64_t i = 0; i < state.range(1); ++i) {
+            record.append_data_array(data_array);
+        }
+        benchmark::DoNotOptimize(record);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0) * state.range(1));
+}
+BENCHMARK(BM_AppendDataArray)->Apply(record_shapes);
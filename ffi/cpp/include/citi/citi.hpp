@@ -1,8 +1,12 @@
 #ifndef CITI_H
 #define CITI_H
 
+#include <cstdint>
 #include <filesystem>
+#include <memory>
+#include <optional>
 #include <string>
+#include <unordered_map>
 #include <vector>
 #include <complex>
 
@@ -15,11 +19,21 @@ namespace fs = std::filesystem;
 /// that due how data ownership must be maintained, there are some inefficiencies
 /// due to extra required data copies.
 ///
+/// A `Record` owns its Rust record and is move-only. The accessors return
+/// references to copies that are made on first use and kept until a mutating
+/// call could change them, so a `Record` must not be read from several
+/// threads at once. A `SharedRecord` can, and its copies share one record.
+///
 /// Note also that ErrorCodes must be maintained and kept the same on both the Rust and C++ side
 /// 
 namespace citi {
 
     typedef void RustRecord;
+    typedef void RustRecordParser;
+    typedef void RustRecordWriter;
+    typedef void RustSharedRecord;
+    struct ReadResult;
+
     class Record {
         public:
 
@@ -84,7 +98,38 @@ namespace citi {
             // CString::new
             NullByte = -40,
 
-            IndexOutOfBounds = -41
+            IndexOutOfBounds = -41,
+
+            // IndexedRecord
+            RecordReadErrorStaleIndex = -42,
+
+            // Record::from_binary_reader
+            RecordReadErrorInvalidBinary = -43,
+
+            // RecordParser
+            RecordReadErrorParserFailed = -44,
+            RecordWriteErrorOutOfOrder = -45,
+            RecordWriteErrorUndeclaredDataArray = -46,
+            RecordWriteErrorMissingDataArray = -47,
+            RecordConvertErrorUnsupportedFormat = -48,
+            NameNotFound = -49,
+
+            // Compression
+            RecordReadErrorUnsupportedCompression = -50,
+            RecordWriteErrorUnsupportedCompression = -51,
+
+            // Parquet export
+            RecordColumnarErrorUnsupported = -52,
+            RecordColumnarErrorNoRecords = -53,
+            RecordColumnarErrorSchemaMismatch = -54,
+            RecordColumnarErrorRaggedDataArray = -55,
+            RecordColumnarErrorArrow = -56,
+
+            // RecordParser
+            RecordReadErrorLineTooLong = -57,
+
+            // SEG lines
+            RecordReadErrorSegmentsTooLong = -58
         };
 
         class RuntimeException : public std::runtime_error {
@@ -102,6 +147,11 @@ namespace citi {
             std::vector<std::string> entries;
         };
 
+        struct Constant {
+            std::string name;
+            std::string value;
+        };
+
         struct IndependentVariable {
             std::string name;
             std::string format;
@@ -114,29 +164,332 @@ namespace citi {
             std::vector<std::complex<double>> samples;
         };
 
+        /// Borrowed, read-only view of the samples of a data array
+        ///
+        /// Points straight into the record; it is invalidated when the
+        /// record is destroyed or its data arrays are modified.
+        struct DataView {
+            const std::complex<double>* samples;
+            std::size_t length;
+
+            const std::complex<double>* data() const { return samples; }
+            std::size_t size() const { return length; }
+            bool empty() const { return length == 0; }
+            const std::complex<double>* begin() const { return samples; }
+            const std::complex<double>* end() const { return samples + length; }
+            const std::complex<double>& operator[](std::size_t i) const { return samples[i]; }
+        };
+
+        /// How a record file is read from disk
+        ///
+        /// `MemoryMapped` parses straight from a memory mapping of the file
+        /// and falls back to `Buffered` for files that cannot be mapped.
+        /// `Parallel` also maps the file and parses the data arrays on
+        /// several threads. `Binary` reads a file written by
+        /// `write_binary_to_file`. `Cached` reads a text file through a
+        /// binary copy kept next to it, with `.bin` appended to its name,
+        /// that is replaced whenever the size or modification time of the
+        /// file changes.
+        enum class ReadMode {
+            Buffered,
+            MemoryMapped,
+            Parallel,
+            Binary,
+            Cached
+        };
+
+        /// Options for `write_to_file`
+        ///
+        /// A `significant_digits` of 0 writes the shortest digits that read
+        /// back to the same value, otherwise the data pairs are written in
+        /// E notation with that many digits.
+        ///
+        /// The data pairs are formatted by `threads` workers, where 0 uses one
+        /// per available core. The file is the same whatever the number of
+        /// workers. `RecordWriter` always formats on the calling thread.
+        ///
+        /// With `segments`, an independent variable that is one linear sweep
+        /// is written as a `SEG_LIST` instead of a `VAR_LIST`. A `SEG_LIST`
+        /// read from a file is written back as it was either way.
+        struct WriteOptions {
+            std::size_t significant_digits = 0;
+            std::size_t threads = 1;
+            bool segments = false;
+        };
+
+        /// Options for reading part of a record file
+        ///
+        /// `header_only` stops at the first data block and leaves every data
+        /// array without samples. A non-empty `data_arrays` reads only the
+        /// data arrays with those names; the others are left out. An empty
+        /// one reads all of them.
+        struct ReadOptions {
+            bool header_only;
+            std::vector<std::string> data_arrays;
+        };
+
+        /// Number of keywords of each kind in `ReadStats` and `WriteStats`
+        ///
+        /// Data pairs are counted as `samples` instead.
+        struct KeywordCounts {
+            std::uint64_t citifile;
+            std::uint64_t name;
+            std::uint64_t var;
+            std::uint64_t constant;
+            std::uint64_t device;
+            std::uint64_t comment;
+            std::uint64_t data;
+            std::uint64_t seg_list_begin;
+            std::uint64_t seg_item;
+            std::uint64_t seg_list_end;
+            std::uint64_t var_list_begin;
+            std::uint64_t var_list_item;
+            std::uint64_t var_list_end;
+            std::uint64_t begin;
+            std::uint64_t end;
+        };
+
+        /// Counts and wall clock times added to when reading with stats
+        ///
+        /// Every read adds to the values already there, so one `ReadStats`
+        /// can sum up a batch of files. Times are in nanoseconds.
+        struct ReadStats {
+            std::uint64_t bytes;
+            std::uint64_t lines;
+            KeywordCounts keywords;
+            std::uint64_t samples;
+            std::uint64_t read_nanoseconds;
+            std::uint64_t lex_nanoseconds;
+            std::uint64_t process_nanoseconds;
+            std::uint64_t validate_nanoseconds;
+            std::uint64_t total_nanoseconds;
+        };
+
+        /// Counts and wall clock times added to when writing with stats
+        struct WriteStats {
+            std::uint64_t bytes;
+            std::uint64_t lines;
+            KeywordCounts keywords;
+            std::uint64_t samples;
+            std::uint64_t format_nanoseconds;
+            std::uint64_t write_nanoseconds;
+            std::uint64_t total_nanoseconds;
+        };
+
         static ErrorCode error_code_from_int(int error_code_int);
 
         explicit Record();  
+        /// Gzip and zstd compressed files are read as they are, when the
+        /// Rust library is built with the `compression` feature
         explicit Record(const fs::path& filename);
-        ~Record();
+        /// `threads` is only used by `ReadMode::Parallel`, where 0 uses
+        /// one thread per available core.
+        explicit Record(const fs::path& filename, ReadMode mode, std::size_t threads = 0);
+        explicit Record(const fs::path& filename, const ReadOptions& options);
+        /// Reads the whole file like `Record(filename)` and adds to `stats`,
+        /// also when the read fails
+        explicit Record(const fs::path& filename, ReadStats& stats);
+        Record(Record&& other) noexcept;
+        Record& operator=(Record&& other) noexcept;
+        Record(const Record&) = delete;
+        Record& operator=(const Record&) = delete;
+        ~Record() noexcept;
 
-        std::string version();
+        const std::string& version() const;
         void set_version(const std::string& version);
-        std::string name();
+        const std::string& name() const;
         void set_name(const std::string& name);
-        std::vector<std::string> comments();
+        const std::vector<std::string>& comments() const;
         void append_comment(const std::string& comment);
-        std::vector<Device> devices();
+        const std::vector<Device>& devices() const;
         void append_device(const Device& device);
-        IndependentVariable independent_variable();
+        const std::vector<Constant>& constants() const;
+        const IndependentVariable& independent_variable() const;
         void set_independent_variable(const IndependentVariable& var);
-        std::vector<DataArray> data();
+        /// Keeps `var` as the cached copy instead of copying it back later
+        void set_independent_variable(IndependentVariable&& var);
+        const std::vector<DataArray>& data() const;
+        DataView data_view(std::size_t idx) const;
+        /// Index of the first data array called `name`
+        std::size_t find_data_array(const std::string& name) const;
+        /// View of the first data array called `name`, without copying
+        DataView data_array(const std::string& name) const;
         void append_data_array(const DataArray& data_arr);
-        void write_to_file(const fs::path& filename);
+        /// Moves `data_arr` into the cached copies when they have been made
+        void append_data_array(DataArray&& data_arr);
+        /// Converts the samples in place to `format`, one of `RI`, `MA` or
+        /// `DB` with angles in degrees, and sets the format to match
+        void convert_data_array(std::size_t idx, const std::string& format);
+        /// Converts every data array or none, on up to `threads` threads
+        /// where 0 uses one thread per available core
+        void convert_data(const std::string& format, std::size_t threads = 0);
+        /// Reads `filename` in place of the current contents, reusing their
+        /// buffers; the record is left blank when this throws
+        void reload(const fs::path& filename);
+        /// Compresses filenames ending in `.gz` or `.zst`
+        void write_to_file(const fs::path& filename) const;
+        void write_to_file(const fs::path& filename, const WriteOptions& options) const;
+        /// Adds to `stats`, also when the write fails
+        void write_to_file(const fs::path& filename, const WriteOptions& options, WriteStats& stats) const;
+        /// Any record can be written, see `ReadMode::Binary`
+        void write_binary_to_file(const fs::path& filename) const;
 
         private:
+        /// Everything read from a header snapshot except for the
+        /// independent variable and data arrays
+        struct Header {
+            std::string version;
+            std::string name;
+            std::vector<std::string> comments;
+            std::vector<Device> devices;
+            std::vector<Constant> constants;
+        };
+
+        const Header& header() const;
+
+        /// Takes ownership of a record handed out by the Rust ffi
+        explicit Record(RustRecord* rust_record) noexcept;
+
+        friend std::vector<ReadResult> read_many(const std::vector<fs::path>& filenames, std::size_t threads);
+        friend class RecordParser;
+        friend class RecordWriter;
+        friend class SharedRecord;
+
         RustRecord* rust_record;
+
+        // Filled on first use and reset by the mutating calls
+        mutable std::optional<Header> header_cache;
+        mutable std::optional<IndependentVariable> independent_variable_cache;
+        mutable std::optional<std::vector<DataArray>> data_cache;
+        /// Index of the first data array with each name
+        mutable std::optional<std::unordered_map<std::string, std::size_t>> data_index_cache;
+    };
+
+    /// Parses a record that arrives in pieces, such as from a socket
+    ///
+    /// `feed` takes chunks of any size and parses every line they complete,
+    /// holding back a line split across chunks. Each data array can be
+    /// copied out with `data_array` as soon as its `END` has been parsed.
+    /// `finish` is called once the stream has ended and leaves the parser
+    /// empty. Like `Record`, a parser is move-only.
+    class RecordParser {
+        public:
+        explicit RecordParser();
+        RecordParser(RecordParser&& other) noexcept;
+        RecordParser& operator=(RecordParser&& other) noexcept;
+        RecordParser(const RecordParser&) = delete;
+        RecordParser& operator=(const RecordParser&) = delete;
+        ~RecordParser() noexcept;
+
+        /// Throws on the first invalid line, after which every call throws
+        void feed(const char* bytes, std::size_t length);
+        void feed(const std::string& bytes);
+        std::size_t finished_data_arrays() const;
+        /// Only the first `finished_data_arrays()` can be copied out
+        Record::DataArray data_array(std::size_t idx) const;
+        Record finish();
+
+        private:
+        RustRecordParser* rust_parser;
+    };
+
+    /// Writes a record file as its samples arrive, such as from an acquisition
+    ///
+    /// `begin` writes the header of a record and declares its data arrays,
+    /// whose samples are not written. Each declared array is then written in
+    /// order between `begin_array` and `end_array`, with `push_samples` called
+    /// as often as needed. `finish` flushes the file once every array has
+    /// been written and leaves the writer empty. A call out of order throws
+    /// and writes nothing, as does every call after a write to the file
+    /// failed. Like `Record`, a writer is move-only.
+    class RecordWriter {
+        public:
+        explicit RecordWriter(const fs::path& filename, const Record::WriteOptions& options = { 0 });
+        RecordWriter(RecordWriter&& other) noexcept;
+        RecordWriter& operator=(RecordWriter&& other) noexcept;
+        RecordWriter(const RecordWriter&) = delete;
+        RecordWriter& operator=(const RecordWriter&) = delete;
+        ~RecordWriter() noexcept;
+
+        void begin(const Record& header);
+        void begin_array(const std::string& name, const std::string& format);
+        void push_samples(const std::complex<double>* samples, std::size_t length);
+        void push_samples(const std::vector<std::complex<double>>& samples);
+        void end_array();
+        void finish();
+
+        private:
+        RustRecordWriter* rust_writer;
+    };
+
+    /// Read-only record that any number of threads can read at once
+    ///
+    /// A `Record` is moved in and can no longer be changed. Copies are cheap
+    /// handles to the same record, which is freed with the last of them, and
+    /// views into it stay valid for as long as a handle is held. The header
+    /// is copied out once when the record is shared, so its accessors do not
+    /// cross the FFI. A moved from handle can only be assigned to or
+    /// destroyed.
+    class SharedRecord {
+        public:
+        explicit SharedRecord(Record&& record);
+        SharedRecord(const SharedRecord& other) noexcept;
+        SharedRecord(SharedRecord&& other) noexcept;
+        SharedRecord& operator=(const SharedRecord& other) noexcept;
+        SharedRecord& operator=(SharedRecord&& other) noexcept;
+        ~SharedRecord() noexcept;
+
+        const std::string& version() const;
+        const std::string& name() const;
+        const std::vector<std::string>& comments() const;
+        const std::vector<Record::Device>& devices() const;
+        const std::vector<Record::Constant>& constants() const;
+        const Record::IndependentVariable& independent_variable() const;
+        std::size_t number_of_data_arrays() const;
+        const std::string& data_array_name(std::size_t idx) const;
+        const std::string& data_array_format(std::size_t idx) const;
+        Record::DataView data_view(std::size_t idx) const;
+        /// Index of the first data array called `name`
+        std::size_t find_data_array(const std::string& name) const;
+        /// View of the first data array called `name`, without copying
+        Record::DataView data_array(const std::string& name) const;
+        /// A record of its own that can be changed
+        Record copy() const;
+
+        private:
+        /// Everything but the samples, filled once by the constructor
+        struct Header;
+
+        const RustSharedRecord* rust_record;
+        std::shared_ptr<const Header> header;
     };
+
+    /// Outcome of reading one of the files passed to `read_many`
+    ///
+    /// `record` is empty exactly when `error_code` is not `NoError`.
+    struct ReadResult {
+        std::optional<Record> record;
+        Record::ErrorCode error_code;
+    };
+
+    /// Read many record files on a pool of threads
+    ///
+    /// Each file is read as with `Record::ReadMode::MemoryMapped` by one of
+    /// up to `threads` workers, where 0 uses one thread per available core.
+    /// The results are in the same order as `filenames`, and a file that
+    /// cannot be read does not stop the others from being read, so nothing
+    /// is thrown for them.
+    std::vector<ReadResult> read_many(const std::vector<fs::path>& filenames, std::size_t threads = 0);
+
+    /// Export many record files into a single Parquet file
+    ///
+    /// The files are read one at a time, so memory does not grow with their
+    /// number, and written to `output` with a row per value of the independent
+    /// variable of each file. The samples of each data array are written as
+    /// `_re` and `_im` columns, or as structs when `struct_samples` is set.
+    /// Throws `RecordColumnarErrorUnsupported` unless the library is built
+    /// with `CITI_COLUMNAR`.
+    void export_parquet(const std::vector<fs::path>& filenames, const fs::path& output, bool struct_samples = false);
 }
 
 #endif
@@ -1,5 +1,9 @@
 #include <citi/citi.hpp>
 
+#include <cstdint>
+#include <cstring>
+#include <utility>
+
 extern "C" {
     #include "citi_c_interface.h"
 }
@@ -26,6 +30,123 @@ namespace {
             throw record_runtime_exception(error_code_int);
         } 
     }
+
+    // The stats are handed across as is, so both sides must agree on the layout
+    static_assert(sizeof(citi::Record::ReadStats) == sizeof(::ReadStats), "ReadStats layout");
+    static_assert(sizeof(citi::Record::WriteStats) == sizeof(::WriteStats), "WriteStats layout");
+
+    /// Walks the table filled in by `record_get_header_snapshot`
+    class SnapshotReader {
+        public:
+        explicit SnapshotReader(const char* table) : cursor(table) {}
+
+        std::size_t count() {
+            std::uint64_t count;
+            std::memcpy(&count, cursor, sizeof(count));
+            cursor += sizeof(count);
+            return static_cast<std::size_t>(count);
+        }
+
+        std::string string() {
+            const auto length = count();
+            std::string string { cursor, length };
+            cursor += length;
+            return string;
+        }
+
+        std::vector<std::string> strings() {
+            std::vector<std::string> strings(count());
+            for (auto& string : strings) {
+                string = this->string();
+            }
+            return strings;
+        }
+
+        private:
+        const char* cursor;
+    };
+
+    /// Everything in a header snapshot, in order
+    struct HeaderSnapshot {
+        std::string version;
+        std::string name;
+        std::vector<std::string> comments;
+        std::vector<citi::Record::Device> devices;
+        std::vector<citi::Record::Constant> constants;
+        std::string independent_variable_name;
+        std::string independent_variable_format;
+        std::size_t independent_variable_length;
+        std::vector<citi::Record::DataArray> data_arrays;
+    };
+
+    /// The samples are left empty
+    HeaderSnapshot read_header_snapshot(const char* table) {
+        SnapshotReader reader { table };
+
+        HeaderSnapshot snapshot;
+        snapshot.version = reader.string();
+        snapshot.name = reader.string();
+        snapshot.comments = reader.strings();
+
+        snapshot.devices.resize(reader.count());
+        for (auto& device : snapshot.devices) {
+            device.name = reader.string();
+            device.entries = reader.strings();
+        }
+
+        snapshot.constants.resize(reader.count());
+        for (auto& constant : snapshot.constants) {
+            constant.name = reader.string();
+            constant.value = reader.string();
+        }
+
+        snapshot.independent_variable_name = reader.string();
+        snapshot.independent_variable_format = reader.string();
+        snapshot.independent_variable_length = reader.count();
+
+        snapshot.data_arrays.resize(reader.count());
+        for (auto& data_array : snapshot.data_arrays) {
+            data_array.name = reader.string();
+            data_array.format = reader.string();
+            reader.count();
+        }
+
+        return snapshot;
+    }
+
+    /// One FFI call for the whole header; the samples are left empty
+    HeaderSnapshot header_snapshot(citi::RustRecord* rust_record) {
+        std::size_t length = 0;
+        return read_header_snapshot(check_ptr(record_get_header_snapshot(rust_record, &length)));
+    }
+
+    /// Index of the first data array with each name, for lookups by name
+    /// that do not scan the names
+    std::unordered_map<std::string, std::size_t> data_array_index(
+        const std::vector<citi::Record::DataArray>& data_arrays) {
+        std::unordered_map<std::string, std::size_t> index;
+        index.reserve(data_arrays.size());
+        for (std::size_t i = 0; i < data_arrays.size(); ++i) {
+            // Keeps the first of repeated names
+            index.emplace(data_arrays[i].name, i);
+        }
+        return index;
+    }
+
+    std::size_t find_in_index(
+        const std::unordered_map<std::string, std::size_t>& index, const std::string& name) {
+        const auto found = index.find(name);
+        if (found == index.end()) {
+            throw record_runtime_exception(static_cast<int>(citi::Record::ErrorCode::NameNotFound));
+        }
+        return found->second;
+    }
+
+    void check_index(std::size_t idx, std::size_t length) {
+        if (idx >= length) {
+            throw record_runtime_exception(static_cast<int>(citi::Record::ErrorCode::IndexOutOfBounds));
+        }
+    }
 }
 
 namespace citi {
@@ -54,90 +175,144 @@ namespace citi {
         check_ptr(rust_record);
     }
 
-    Record::~Record() {
-        auto error_code_int = record_destroy(rust_record);
-        check_int_error_code(error_code_int);
+    Record::Record(const fs::path& filename, ReadMode mode, std::size_t threads) {
+        switch (mode) {
+            case ReadMode::MemoryMapped:
+                rust_record = record_read_mmap(filename.string().c_str());
+                break;
+            case ReadMode::Parallel:
+                rust_record = record_read_parallel(filename.string().c_str(), threads);
+                break;
+            case ReadMode::Binary:
+                rust_record = record_read_binary(filename.string().c_str());
+                break;
+            case ReadMode::Cached:
+                rust_record = record_read_cached(filename.string().c_str());
+                break;
+            case ReadMode::Buffered:
+            default:
+                rust_record = record_read(filename.string().c_str());
+                break;
+        }
+        check_ptr(rust_record);
+    }
+
+    Record::Record(const fs::path& filename, const ReadOptions& options) {
+        std::vector<const char*> names;
+        names.reserve(options.data_arrays.size());
+        for (const auto& name : options.data_arrays) {
+            names.push_back(name.c_str());
+        }
+
+        rust_record = record_read_with_options(
+            filename.string().c_str(),
+            options.header_only ? 1 : 0,
+            names.empty() ? nullptr : names.data(),
+            names.size());
+        check_ptr(rust_record);
+    }
+
+    Record::Record(const fs::path& filename, ReadStats& stats) {
+        ::ReadStats c_stats;
+        std::memcpy(&c_stats, &stats, sizeof(c_stats));
+        rust_record = record_read_with_stats(filename.string().c_str(), &c_stats);
+        std::memcpy(&stats, &c_stats, sizeof(c_stats));
+        check_ptr(rust_record);
+    }
+
+    Record::Record(RustRecord* rust_record) noexcept : rust_record(rust_record) {}
+
+    Record::Record(Record&& other) noexcept :
+        rust_record(std::exchange(other.rust_record, nullptr)),
+        header_cache(std::move(other.header_cache)),
+        independent_variable_cache(std::move(other.independent_variable_cache)),
+        data_cache(std::move(other.data_cache)),
+        data_index_cache(std::move(other.data_index_cache)) {
+        other.header_cache.reset();
+        other.independent_variable_cache.reset();
+        other.data_cache.reset();
+        other.data_index_cache.reset();
+    }
+
+    Record& Record::operator=(Record&& other) noexcept {
+        if (this != &other) {
+            if (rust_record) {
+                record_destroy(rust_record);
+            }
+            rust_record = std::exchange(other.rust_record, nullptr);
+            header_cache = std::move(other.header_cache);
+            independent_variable_cache = std::move(other.independent_variable_cache);
+            data_cache = std::move(other.data_cache);
+            data_index_cache = std::move(other.data_index_cache);
+            other.header_cache.reset();
+            other.independent_variable_cache.reset();
+            other.data_cache.reset();
+            other.data_index_cache.reset();
+        }
+        return *this;
+    }
+
+    /// Moved-from records hold null and are skipped; `record_destroy`
+    /// cannot fail otherwise.
+    Record::~Record() noexcept {
+        if (rust_record) {
+            record_destroy(rust_record);
+        }
     }
 
-    std::string Record::version() {
-        auto version = check_ptr(record_get_version(rust_record));
-        return std::string { version };
+    const Record::Header& Record::header() const {
+        if (!header_cache) {
+            auto snapshot = header_snapshot(rust_record);
+            header_cache = Header {
+                std::move(snapshot.version),
+                std::move(snapshot.name),
+                std::move(snapshot.comments),
+                std::move(snapshot.devices),
+                std::move(snapshot.constants)
+            };
+        }
+        return *header_cache;
+    }
+
+    const std::string& Record::version() const {
+        return header().version;
     }
 
     void Record::set_version(const std::string& version) {
         auto error_code_int = record_set_version(rust_record, version.c_str());
         check_int_error_code(error_code_int);
+        header_cache.reset();
     }
 
-    std::string Record::name() {
-        auto name = check_ptr(record_get_name(rust_record));
-        return std::string { name };
+    const std::string& Record::name() const {
+        return header().name;
     }
 
     void Record::set_name(const std::string& name) {
         auto error_code_int = record_set_name(rust_record, name.c_str());
         check_int_error_code(error_code_int);
+        header_cache.reset();
     }
 
-    std::vector<std::string> Record::comments() {
-        const auto num_comments = record_get_number_of_comments(rust_record);
-        // Throws in case of errors
-        if (num_comments < 0) {
-            check_int_error_code(num_comments);
-        }
-        std::vector<std::string> comments;
-        comments.reserve(num_comments);
-
-        for (auto i = 0; i < num_comments; ++i) {
-            const auto comment = check_ptr(record_get_comment(rust_record, i));
-            comments.push_back(std::string { comment });
-        }
-        
-        return comments;
+    const std::vector<std::string>& Record::comments() const {
+        return header().comments;
     }
 
     void Record::append_comment(const std::string& comment) {
         const auto error_code_int = record_append_comment(rust_record, comment.c_str());
         check_int_error_code(error_code_int);
+        header_cache.reset();
     }
 
-    std::vector<Record::Device> Record::devices() {
-
-        const auto num_devices = record_get_number_of_devices(rust_record);
-        // Throws in case of errors
-        if (num_devices < 0) {
-            check_int_error_code(num_devices);
-        }
-        std::vector<Record::Device> devices;
-        devices.reserve(num_devices);
-
-        for (auto i = 0; i < num_devices; ++i) {
-            const auto name = std::string { check_ptr(record_get_device_name(rust_record, i)) };
-
-            const auto num_entries = record_get_device_number_of_entries(rust_record, i );
-
-            // Throws in case of errors
-            if (num_entries < 0) {
-                check_int_error_code(num_entries);
-            }
-            std::vector<std::string> entries;
-            entries.reserve(num_entries);
-
-            for (auto j = 0; j < num_entries; ++j) {
-                const auto entry = std::string { check_ptr(record_get_device_entry(rust_record, i, j)) };
-                entries.push_back(std::move(entry));
-            }
-
-            devices.push_back({
-                std::move(name),
-                std::move(entries)
-            });
-        }
-
-        return devices;
+    const std::vector<Record::Device>& Record::devices() const {
+        return header().devices;
     }
 
     void Record::append_device(const Device& device) {
+        // Reset first so that a failure part way through does not leave
+        // the cache stale
+        header_cache.reset();
+
         const auto last_device_index = record_get_number_of_devices(rust_record);
         // Throws in case of errors
         if (last_device_index < 0) {
@@ -147,35 +322,30 @@ namespace citi {
         const auto device_error_code_int = record_append_device(rust_record, device.name.c_str());
         check_int_error_code(device_error_code_int);
 
-        for (const auto entry : device.entries) {
+        for (const auto& entry : device.entries) {
             const auto entry_error_code_int =
                 record_append_entry_to_device(rust_record, last_device_index, entry.c_str());
             check_int_error_code(entry_error_code_int);
         }
     }
 
-    Record::IndependentVariable Record::independent_variable() {
-        const std::string name { check_ptr(record_get_independent_variable_name(rust_record)) };
-        const std::string format { check_ptr(record_get_independent_variable_format(rust_record)) };
-        
-        const auto num_vals = record_get_independent_variable_length(rust_record);
-        // Throws in case of errors
-        if (num_vals < 0) {
-            check_int_error_code(num_vals);
-        } 
-        const auto array = check_ptr(record_get_independent_variable_array(rust_record));
+    const std::vector<Record::Constant>& Record::constants() const {
+        return header().constants;
+    }
 
-        std::vector<double> values;
-        values.reserve(num_vals);
-        for (auto i = 0; i < num_vals; ++i) {
-            values.push_back(array[i]);
+    const Record::IndependentVariable& Record::independent_variable() const {
+        if (!independent_variable_cache) {
+            auto snapshot = header_snapshot(rust_record);
+            const auto num_vals = snapshot.independent_variable_length;
+            const auto array = check_ptr(record_get_independent_variable_array(rust_record));
+
+            independent_variable_cache = IndependentVariable {
+                std::move(snapshot.independent_variable_name),
+                std::move(snapshot.independent_variable_format),
+                std::vector<double>(array, array + num_vals)
+            };
         }
-        
-        return {
-            std::move(name),
-            std::move(format),
-            std::move(values)
-        };
+        return *independent_variable_cache;
     }
 
     void Record::set_independent_variable(const IndependentVariable& var) {
@@ -185,67 +355,440 @@ namespace citi {
             var.values.data(), var.values.size());
 
         check_int_error_code(error_code_int);
+        independent_variable_cache.reset();
+    }
+
+    void Record::set_independent_variable(IndependentVariable&& var) {
+        const auto error_code_int = record_set_independent_variable(
+            rust_record,
+            var.name.c_str(), var.format.c_str(),
+            var.values.data(), var.values.size());
+
+        check_int_error_code(error_code_int);
+        // The Rust record now holds the same values, so the copy is valid
+        independent_variable_cache = std::move(var);
     }
         
-    std::vector<Record::DataArray> Record::data() {
-        const auto num_data_arrays = record_get_number_of_data_arrays(rust_record);
-        // Throws in case of errors
-        if (num_data_arrays < 0) {
-            check_int_error_code(num_data_arrays);
-        }
-        
-        std::vector<Record::DataArray> data_arrays;
-        data_arrays.reserve(num_data_arrays);
-        for (auto i = 0; i < num_data_arrays; ++i) {
-            const std::string name { check_ptr(record_get_data_array_name(rust_record, i)) };
-            const std::string format { check_ptr(record_get_data_array_format(rust_record, i)) };
-
-            const auto data_array_length = record_get_data_array_length(rust_record, i);
-            // Throws in case of errors
-            if (data_array_length < 0) {
-                check_int_error_code(data_array_length);
+    const std::vector<Record::DataArray>& Record::data() const {
+        if (!data_cache) {
+            auto data_arrays = header_snapshot(rust_record).data_arrays;
+            for (std::size_t i = 0; i < data_arrays.size(); ++i) {
+                const auto view = data_view(i);
+                data_arrays[i].samples.assign(view.begin(), view.end());
             }
-            
-            std::vector<double> reals(data_array_length);
-            std::vector<double> imags(data_array_length);
-            const auto error_code_int = record_get_data_array(rust_record, i, reals.data(), imags.data());
-            check_int_error_code(error_code_int);
+            data_cache = std::move(data_arrays);
+        }
+        return *data_cache;
+    }
 
-            std::vector<std::complex<double>> samples(data_array_length);
-            std::transform(reals.begin(), reals.end(), imags.begin(), samples.begin(),
-                [](double re, double im) {
+    Record::DataView Record::data_view(std::size_t idx) const {
+        const auto data_array_length = record_get_data_array_length(rust_record, idx);
+        // Throws in case of errors
+        if (data_array_length < 0) {
+            check_int_error_code(data_array_length);
+        }
 
-                return std::complex<double>(re, im);
-            });
+        // `Complex<f64>` and `std::complex<double>` share the layout `re, im`
+        const auto samples = check_ptr(record_get_data_array_ptr(rust_record, idx));
+        return {
+            reinterpret_cast<const std::complex<double>*>(samples),
+            static_cast<std::size_t>(data_array_length)
+        };
+    }
 
-            data_arrays.push_back({
-                std::move(name),
-                std::move(format),
-                std::move(samples)
-            });
+    std::size_t Record::find_data_array(const std::string& name) const {
+        if (!data_index_cache) {
+            data_index_cache = data_array_index(header_snapshot(rust_record).data_arrays);
         }
+        return find_in_index(*data_index_cache, name);
+    }
 
-        return data_arrays;
+    Record::DataView Record::data_array(const std::string& name) const {
+        return data_view(find_data_array(name));
     }
 
     void Record::append_data_array(const DataArray& data_arr) {
-        std::vector<double> reals;
-        reals.reserve(data_arr.samples.size());
-        std::vector<double> imags;
-        imags.reserve(data_arr.samples.size());
-        for (auto i = 0; i < data_arr.samples.size(); ++i) {
-            reals.push_back(data_arr.samples[i].real());
-            imags.push_back(data_arr.samples[i].imag());
-        }
-        const auto error_code_int = record_append_data_array(
+        // `std::complex<double>` is laid out as the real then imaginary part
+        const auto error_code_int = record_append_data_array_interleaved(
+            rust_record, data_arr.name.c_str(), data_arr.format.c_str(),
+            reinterpret_cast<const double*>(data_arr.samples.data()), data_arr.samples.size());
+
+        check_int_error_code(error_code_int);
+        data_cache.reset();
+        data_index_cache.reset();
+    }
+
+    void Record::append_data_array(DataArray&& data_arr) {
+        const auto error_code_int = record_append_data_array_interleaved(
             rust_record, data_arr.name.c_str(), data_arr.format.c_str(),
-            reals.data(), imags.data(), imags.size());
+            reinterpret_cast<const double*>(data_arr.samples.data()), data_arr.samples.size());
+
+        check_int_error_code(error_code_int);
+        // The Rust record now holds the same array, so the copies stay valid
+        data_index_cache.reset();
+        if (data_cache) {
+            data_cache->push_back(std::move(data_arr));
+        }
+    }
 
+    void Record::convert_data_array(std::size_t idx, const std::string& format) {
+        const auto error_code_int = record_convert_data_array(rust_record, idx, format.c_str());
         check_int_error_code(error_code_int);
+        data_cache.reset();
     }
 
-    void Record::write_to_file(const fs::path& filename) {
+    void Record::convert_data(const std::string& format, std::size_t threads) {
+        const auto error_code_int = record_convert_data_arrays(rust_record, format.c_str(), threads);
+        check_int_error_code(error_code_int);
+        data_cache.reset();
+    }
+
+    void Record::reload(const fs::path& filename) {
+        const auto error_code_int = record_read_into(rust_record, filename.string().c_str());
+        header_cache.reset();
+        independent_variable_cache.reset();
+        data_cache.reset();
+        data_index_cache.reset();
+        check_int_error_code(error_code_int);
+    }
+
+    void Record::write_to_file(const fs::path& filename) const {
         const auto error_code_int = record_write(rust_record, filename.string().c_str());  
         check_int_error_code(error_code_int);
     }
+
+    void Record::write_to_file(const fs::path& filename, const WriteOptions& options) const {
+        const auto error_code_int = record_write_with_options(
+            rust_record, filename.string().c_str(), options.significant_digits, options.threads,
+            options.segments ? 1 : 0);
+        check_int_error_code(error_code_int);
+    }
+
+    void Record::write_to_file(const fs::path& filename, const WriteOptions& options, WriteStats& stats) const {
+        ::WriteStats c_stats;
+        std::memcpy(&c_stats, &stats, sizeof(c_stats));
+        const auto error_code_int = record_write_with_stats(
+            rust_record, filename.string().c_str(), options.significant_digits, options.threads,
+            options.segments ? 1 : 0, &c_stats);
+        std::memcpy(&stats, &c_stats, sizeof(c_stats));
+        check_int_error_code(error_code_int);
+    }
+
+    void Record::write_binary_to_file(const fs::path& filename) const {
+        const auto error_code_int = record_write_binary(rust_record, filename.string().c_str());
+        check_int_error_code(error_code_int);
+    }
+
+    RecordParser::RecordParser() {
+        rust_parser = record_parser_new();
+    }
+
+    RecordParser::RecordParser(RecordParser&& other) noexcept :
+        rust_parser(std::exchange(other.rust_parser, nullptr)) {}
+
+    RecordParser& RecordParser::operator=(RecordParser&& other) noexcept {
+        if (this != &other) {
+            if (rust_parser) {
+                record_parser_destroy(rust_parser);
+            }
+            rust_parser = std::exchange(other.rust_parser, nullptr);
+        }
+        return *this;
+    }
+
+    /// Moved-from and finished parsers hold null and are skipped
+    RecordParser::~RecordParser() noexcept {
+        if (rust_parser) {
+            record_parser_destroy(rust_parser);
+        }
+    }
+
+    void RecordParser::feed(const char* bytes, std::size_t length) {
+        check_int_error_code(record_parser_feed(rust_parser, bytes, length));
+    }
+
+    void RecordParser::feed(const std::string& bytes) {
+        feed(bytes.data(), bytes.size());
+    }
+
+    std::size_t RecordParser::finished_data_arrays() const {
+        const auto count = record_parser_get_number_of_finished_data_arrays(rust_parser);
+        if (count < 0) {
+            check_int_error_code(count);
+        }
+        return static_cast<std::size_t>(count);
+    }
+
+    Record::DataArray RecordParser::data_array(std::size_t idx) const {
+        if (idx >= finished_data_arrays()) {
+            throw record_runtime_exception(static_cast<int>(Record::ErrorCode::IndexOutOfBounds));
+        }
+
+        const auto rust_record = check_ptr(record_parser_get_record(rust_parser));
+        const auto length = record_get_data_array_length(rust_record, idx);
+        if (length < 0) {
+            check_int_error_code(length);
+        }
+        const auto samples = reinterpret_cast<const std::complex<double>*>(
+            check_ptr(record_get_data_array_ptr(rust_record, idx)));
+
+        return {
+            std::string { check_ptr(record_get_data_array_name(rust_record, idx)) },
+            std::string { check_ptr(record_get_data_array_format(rust_record, idx)) },
+            std::vector<std::complex<double>>(samples, samples + length)
+        };
+    }
+
+    Record RecordParser::finish() {
+        // The parser is freed even when the record is invalid
+        const auto rust_record = record_parser_finish(std::exchange(rust_parser, nullptr));
+        return Record { check_ptr(rust_record) };
+    }
+
+    RecordWriter::RecordWriter(const fs::path& filename, const Record::WriteOptions& options) {
+        rust_writer = check_ptr(record_writer_new(filename.string().c_str(), options.significant_digits));
+    }
+
+    RecordWriter::RecordWriter(RecordWriter&& other) noexcept :
+        rust_writer(std::exchange(other.rust_writer, nullptr)) {}
+
+    RecordWriter& RecordWriter::operator=(RecordWriter&& other) noexcept {
+        if (this != &other) {
+            if (rust_writer) {
+                record_writer_destroy(rust_writer);
+            }
+            rust_writer = std::exchange(other.rust_writer, nullptr);
+        }
+        return *this;
+    }
+
+    /// Moved-from and finished writers hold null and are skipped
+    RecordWriter::~RecordWriter() noexcept {
+        if (rust_writer) {
+            record_writer_destroy(rust_writer);
+        }
+    }
+
+    void RecordWriter::begin(const Record& header) {
+        check_int_error_code(record_writer_begin(rust_writer, header.rust_record));
+    }
+
+    void RecordWriter::begin_array(const std::string& name, const std::string& format) {
+        check_int_error_code(record_writer_begin_array(rust_writer, name.c_str(), format.c_str()));
+    }
+
+    void RecordWriter::push_samples(const std::complex<double>* samples, std::size_t length) {
+        // `std::complex<double>` is laid out as the real then imaginary part
+        check_int_error_code(record_writer_push_samples(
+            rust_writer, reinterpret_cast<const double*>(samples), length));
+    }
+
+    void RecordWriter::push_samples(const std::vector<std::complex<double>>& samples) {
+        push_samples(samples.data(), samples.size());
+    }
+
+    void RecordWriter::end_array() {
+        check_int_error_code(record_writer_end_array(rust_writer));
+    }
+
+    void RecordWriter::finish() {
+        // The writer is freed even when some array is missing
+        check_int_error_code(record_writer_finish(std::exchange(rust_writer, nullptr)));
+    }
+
+    struct SharedRecord::Header {
+        std::string version;
+        std::string name;
+        std::vector<std::string> comments;
+        std::vector<Record::Device> devices;
+        std::vector<Record::Constant> constants;
+        Record::IndependentVariable independent_variable;
+        /// Names and formats only, the samples are read in place
+        std::vector<Record::DataArray> data_arrays;
+        std::unordered_map<std::string, std::size_t> data_index;
+    };
+
+    SharedRecord::SharedRecord(Record&& record) :
+        rust_record(check_ptr(record_share(std::exchange(record.rust_record, nullptr)))) {
+        record.header_cache.reset();
+        record.independent_variable_cache.reset();
+        record.data_cache.reset();
+        record.data_index_cache.reset();
+
+        // The destructor does not run if the constructor throws
+        try {
+            std::size_t length = 0;
+            auto snapshot = read_header_snapshot(
+                check_ptr(shared_record_get_header_snapshot(rust_record, &length)));
+            const auto array = shared_record_get_independent_variable_array(rust_record);
+            const auto num_vals = snapshot.independent_variable_length;
+            auto data_index = data_array_index(snapshot.data_arrays);
+
+            header = std::make_shared<const Header>(Header {
+                std::move(snapshot.version),
+                std::move(snapshot.name),
+                std::move(snapshot.comments),
+                std::move(snapshot.devices),
+                std::move(snapshot.constants),
+                Record::IndependentVariable {
+                    std::move(snapshot.independent_variable_name),
+                    std::move(snapshot.independent_variable_format),
+                    std::vector<double>(array, array + num_vals)
+                },
+                std::move(snapshot.data_arrays),
+                std::move(data_index)
+            });
+        } catch (...) {
+            record_release(rust_record);
+            throw;
+        }
+    }
+
+    SharedRecord::SharedRecord(const SharedRecord& other) noexcept :
+        rust_record(record_retain(other.rust_record)),
+        header(other.header) {}
+
+    SharedRecord::SharedRecord(SharedRecord&& other) noexcept :
+        rust_record(std::exchange(other.rust_record, nullptr)),
+        header(std::move(other.header)) {}
+
+    SharedRecord& SharedRecord::operator=(const SharedRecord& other) noexcept {
+        if (this != &other) {
+            *this = SharedRecord { other };
+        }
+        return *this;
+    }
+
+    SharedRecord& SharedRecord::operator=(SharedRecord&& other) noexcept {
+        if (this != &other) {
+            if (rust_record) {
+                record_release(rust_record);
+            }
+            rust_record = std::exchange(other.rust_record, nullptr);
+            header = std::move(other.header);
+        }
+        return *this;
+    }
+
+    /// Only the last handle frees the record
+    SharedRecord::~SharedRecord() noexcept {
+        if (rust_record) {
+            record_release(rust_record);
+        }
+    }
+
+    const std::string& SharedRecord::version() const {
+        return header->version;
+    }
+
+    const std::string& SharedRecord::name() const {
+        return header->name;
+    }
+
+    const std::vector<std::string>& SharedRecord::comments() const {
+        return header->comments;
+    }
+
+    const std::vector<Record::Device>& SharedRecord::devices() const {
+        return header->devices;
+    }
+
+    const std::vector<Record::Constant>& SharedRecord::constants() const {
+        return header->constants;
+    }
+
+    const Record::IndependentVariable& SharedRecord::independent_variable() const {
+        return header->independent_variable;
+    }
+
+    std::size_t SharedRecord::number_of_data_arrays() const {
+        return header->data_arrays.size();
+    }
+
+    const std::string& SharedRecord::data_array_name(std::size_t idx) const {
+        check_index(idx, number_of_data_arrays());
+        return header->data_arrays[idx].name;
+    }
+
+    const std::string& SharedRecord::data_array_format(std::size_t idx) const {
+        check_index(idx, number_of_data_arrays());
+        return header->data_arrays[idx].format;
+    }
+
+    Record::DataView SharedRecord::data_view(std::size_t idx) const {
+        const auto data_array_length = shared_record_get_data_array_length(rust_record, idx);
+        // Throws in case of errors
+        if (data_array_length < 0) {
+            check_int_error_code(data_array_length);
+        }
+
+        // `Complex<f64>` and `std::complex<double>` share the layout `re, im`
+        const auto samples = shared_record_get_data_array_ptr(rust_record, idx);
+        return {
+            reinterpret_cast<const std::complex<double>*>(samples),
+            static_cast<std::size_t>(data_array_length)
+        };
+    }
+
+    std::size_t SharedRecord::find_data_array(const std::string& name) const {
+        return find_in_index(header->data_index, name);
+    }
+
+    Record::DataView SharedRecord::data_array(const std::string& name) const {
+        return data_view(find_data_array(name));
+    }
+
+    Record SharedRecord::copy() const {
+        // Only a moved-from handle has nothing to copy
+        const auto rust_copy = shared_record_copy(rust_record);
+        if (!rust_copy) {
+            throw record_runtime_exception(static_cast<int>(Record::ErrorCode::NullArgument));
+        }
+        return Record { rust_copy };
+    }
+
+    std::vector<ReadResult> read_many(const std::vector<fs::path>& filenames, std::size_t threads) {
+        if (filenames.empty()) {
+            return {};
+        }
+
+        std::vector<std::string> strings;
+        std::vector<const char*> names;
+        strings.reserve(filenames.size());
+        names.reserve(filenames.size());
+        for (const auto& filename : filenames) {
+            strings.push_back(filename.string());
+            names.push_back(strings.back().c_str());
+        }
+
+        std::vector<RustRecord*> rust_records(filenames.size(), nullptr);
+        std::vector<int> error_codes(filenames.size(), 0);
+        // Every file has its own error code, so the one returned is not needed
+        record_read_many(names.data(), names.size(), threads, rust_records.data(), error_codes.data());
+
+        std::vector<ReadResult> results;
+        results.reserve(filenames.size());
+        for (std::size_t i = 0; i < filenames.size(); ++i) {
+            ReadResult result { std::nullopt, Record::error_code_from_int(error_codes[i]) };
+            if (rust_records[i]) {
+                result.record.emplace(Record { rust_records[i] });
+            }
+            results.push_back(std::move(result));
+        }
+        return results;
+    }
+
+    void export_parquet(const std::vector<fs::path>& filenames, const fs::path& output, bool struct_samples) {
+        std::vector<std::string> strings;
+        std::vector<const char*> names;
+        strings.reserve(filenames.size());
+        names.reserve(filenames.size());
+        for (const auto& filename : filenames) {
+            strings.push_back(filename.string());
+            names.push_back(strings.back().c_str());
+        }
+
+        check_int_error_code(record_export_parquet(
+            names.data(), names.size(), output.string().c_str(), struct_samples ? 1 : 0));
+    }
 }
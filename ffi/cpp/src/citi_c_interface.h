@@ -1,13 +1,70 @@
 /// This C header file is a mirror of the C interface from the Rust
 /// side. Note that this file will need to be inluded with
 /// `extern "C"`.
+///
+/// Strings returned by the getters are owned by the record and must not
+/// be freed. Each one is converted to a C string once and cached, so calling
+/// a getter again returns the same pointer without allocating. A pointer stays
+/// valid until the record is destroyed or the string it was built from is
+/// changed and fetched again.
 
 #ifndef CITI_C_H
 #define CITI_C_H
 
+#include <stdint.h>
 #include <stdlib.h>
 
 typedef void Record;
+typedef void RecordParser;
+typedef void RecordWriter;
+typedef void SharedRecord;
+
+/// Number of keywords of each kind in `ReadStats` and `WriteStats`
+///
+/// Data pairs are counted as samples instead.
+typedef struct KeywordCounts {
+    uint64_t citifile;
+    uint64_t name;
+    uint64_t var;
+    uint64_t constant;
+    uint64_t device;
+    uint64_t comment;
+    uint64_t data;
+    uint64_t seg_list_begin;
+    uint64_t seg_item;
+    uint64_t seg_list_end;
+    uint64_t var_list_begin;
+    uint64_t var_list_item;
+    uint64_t var_list_end;
+    uint64_t begin;
+    uint64_t end;
+} KeywordCounts;
+
+/// Counts and wall clock times added to by `record_read_with_stats`
+///
+/// Every read adds to the values already there. Times are in nanoseconds.
+typedef struct ReadStats {
+    uint64_t bytes;
+    uint64_t lines;
+    KeywordCounts keywords;
+    uint64_t samples;
+    uint64_t read_nanoseconds;
+    uint64_t lex_nanoseconds;
+    uint64_t process_nanoseconds;
+    uint64_t validate_nanoseconds;
+    uint64_t total_nanoseconds;
+} ReadStats;
+
+/// Counts and wall clock times added to by `record_write_with_stats`
+typedef struct WriteStats {
+    uint64_t bytes;
+    uint64_t lines;
+    KeywordCounts keywords;
+    uint64_t samples;
+    uint64_t format_nanoseconds;
+    uint64_t write_nanoseconds;
+    uint64_t total_nanoseconds;
+} WriteStats;
 
 /// Get the last occured error code
 ///
@@ -20,7 +77,7 @@ int get_last_error_code();
 /// Get string description for error code
 ///
 /// This function should be called with the return value of
-/// `get_last_error_code`.
+/// `get_last_error_code`. The description is static and must not be freed.
 const char* get_error_description(int error_code);
 
 /// Free a pointer to `Record`
@@ -39,18 +96,257 @@ Record* record_default();
 
 /// Read record from file
 /// 
+/// Gzip and zstd compressed files are detected from their first bytes and
+/// decompressed while they are parsed.
+///
 /// This allocates memory and must be destroyed by the caller
 /// (see [`record_destroy`]).
 /// - A null pointer is returned if the filename is null, a file corresponding
 /// to the filename does not exist, or the file cannot be read
 Record* record_read(const char* filename);
 
+/// Read record from file by memory mapping it
+///
+/// This is the same as [`record_read`] except that regular files are
+/// memory mapped and parsed directly from the mapped bytes. Files that
+/// cannot be mapped, such as pipes, are read through a buffer instead.
+///
+/// This allocates memory and must be destroyed by the caller
+/// (see [`record_destroy`]).
+/// - A null pointer is returned if the filename is null, a file corresponding
+/// to the filename does not exist, or the file cannot be read
+Record* record_read_mmap(const char* filename);
+
+/// Read record from file, parsing the data arrays on several threads
+///
+/// This is the same as [`record_read`] except that the `BEGIN`/`END`
+/// blocks are parsed on up to `threads` threads. A `threads` of 0 uses
+/// one thread per available core.
+///
+/// This allocates memory and must be destroyed by the caller
+/// (see [`record_destroy`]).
+/// - A null pointer is returned if the filename is null, a file corresponding
+/// to the filename does not exist, or the file cannot be read
+Record* record_read_parallel(const char* filename, size_t threads);
+
+/// Read record from file into an existing record
+///
+/// This is the same as [`record_read`] except that the file is read into
+/// `record`, whose strings and arrays are reused instead of allocating new
+/// ones. Reading many files of the same shape through one record therefore
+/// allocates next to nothing after the first.
+///
+/// Pointers previously returned for `record`, such as those of
+/// [`record_get_data_array_ptr`], are invalidated.
+/// - If the file cannot be read, `record` is left blank
+int record_read_into(Record* record, const char* filename);
+
+/// Read record from file, skipping what is not needed
+///
+/// This is the same as [`record_read`] except that only part of the file
+/// may be parsed:
+/// - A non-zero `header_only` stops reading at the first `BEGIN`, leaving
+/// every data array without samples
+/// - `data_arrays` holds the `number_of_data_arrays` names of the data arrays
+/// to read; the others are skipped and left out of the record. A null
+/// `data_arrays` or a zero `number_of_data_arrays` reads all of them.
+///
+/// This allocates memory and must be destroyed by the caller
+/// (see [`record_destroy`]).
+/// - A null pointer is returned if the filename or one of the names is null,
+/// a file corresponding to the filename does not exist, or the file cannot be read
+Record* record_read_with_options(const char* filename, int header_only, const char* const* data_arrays, size_t number_of_data_arrays);
+
+/// Read record from file while counting and timing the read
+///
+/// This is the same as [`record_read`] except that the counts and times
+/// of the read are added to `stats`, which is also done for a read that
+/// fails.
+///
+/// This allocates memory and must be destroyed by the caller
+/// (see [`record_destroy`]).
+/// - A null pointer is returned if the filename or `stats` is null, a file
+/// corresponding to the filename does not exist, or the file cannot be read
+Record* record_read_with_stats(const char* filename, ReadStats* stats);
+
+/// Read record from a file written by [`record_write_binary`]
+///
+/// Nothing is parsed: the floats are copied straight out of the file, which
+/// is memory mapped when possible.
+///
+/// This allocates memory and must be destroyed by the caller
+/// (see [`record_destroy`]).
+/// - A null pointer is returned if the filename is null, a file corresponding
+/// to the filename does not exist, or the file is not a valid binary record
+Record* record_read_binary(const char* filename);
+
+/// Read record from file through a binary copy kept next to it
+///
+/// This is the same as [`record_read`] except that a binary copy of the
+/// record is kept at the filename with `.bin` appended and read instead
+/// while the file keeps the same size and modification time.
+///
+/// This allocates memory and must be destroyed by the caller
+/// (see [`record_destroy`]).
+/// - A null pointer is returned if the filename is null, a file corresponding
+/// to the filename does not exist, or the file cannot be read
+Record* record_read_cached(const char* filename);
+
+/// Read many records on a pool of threads
+///
+/// Each of the `number_of_files` filenames is read as with [`record_read_mmap`]
+/// by one of up to `threads` workers. A `threads` of 0 uses one thread per
+/// available core.
+///
+/// The caller provides `records` and `error_codes`, each with room for
+/// `number_of_files` values. For every file, either a record is stored in
+/// `records` and `NoError` in `error_codes`, or a null pointer is stored in
+/// `records` and the reason the file could not be read in `error_codes`.
+/// The records that are returned must be destroyed by the caller
+/// (see [`record_destroy`]).
+///
+/// The workers never touch the last error code. It is only updated on the
+/// calling thread, with the value that is returned.
+/// - `NullArgument` is returned, and nothing is read, if `filenames`,
+/// `records` or `error_codes` is null
+/// - Otherwise, the error code of the first file that could not be read is
+/// returned, or `NoError` if every file was read
+int record_read_many(const char* const* filenames, size_t number_of_files, size_t threads, Record** records, int* error_codes);
+
+/// Export many record files into a single Parquet file
+///
+/// The `number_of_files` filenames are read one at a time and written to
+/// `output` with a row per value of the independent variable of each file.
+/// The samples of each data array are split into `_re` and `_im` columns, or
+/// kept together as structs when `struct_samples` is not 0.
+///
+/// The error code is returned, and is `RecordColumnarErrorUnsupported` when
+/// the library was built without the `columnar` feature.
+int record_export_parquet(const char* const* filenames, size_t number_of_files, const char* output, int struct_samples);
+
+/// Create a push parser for a record that arrives in pieces
+///
+/// This allocates memory and must be released by the caller, either with
+/// [`record_parser_finish`] or [`record_parser_destroy`].
+RecordParser* record_parser_new();
+
+/// Free a pointer to `RecordParser` without finishing it
+///
+/// This can be called on `null`, like [`record_destroy`]. The record
+/// returned by [`record_parser_get_record`] is freed with it.
+int record_parser_destroy(RecordParser* parser);
+
+/// Parse the `length` bytes at `bytes`
+///
+/// Every line completed by the bytes is parsed; a line split across calls
+/// is held back until the rest of it arrives. A line longer than 1 MiB
+/// returns `RecordReadErrorLineTooLong`. Once an error has been returned,
+/// every later call returns `RecordReadErrorParserFailed`.
+int record_parser_feed(RecordParser* parser, const char* bytes, size_t length);
+
+/// Get the number of data arrays whose `END` has been parsed
+///
+/// Those data arrays are complete and can be read from the record returned
+/// by [`record_parser_get_record`] while later ones are still arriving.
+int record_parser_get_number_of_finished_data_arrays(RecordParser* parser);
+
+/// Get the record parsed so far
+///
+/// The record is owned by the parser and must not be destroyed or modified.
+/// Its header and finished data arrays (see
+/// [`record_parser_get_number_of_finished_data_arrays`]) can be read with
+/// the usual getters until the next call that takes the parser.
+/// - If the parser pointer is null, return null pointer.
+Record* record_parser_get_record(RecordParser* parser);
+
+/// Finish parsing once the stream has ended
+///
+/// Any last line without a line ending is parsed and the record is
+/// validated. The parser is freed whether or not the record is valid, so
+/// it must not be used again.
+///
+/// This allocates memory and must be destroyed by the caller
+/// (see [`record_destroy`]).
+/// - A null pointer is returned if the parser is null or the record is invalid
+Record* record_parser_finish(RecordParser* parser);
+
 /// Write record to file
 ///
 /// This function will write to a filepath the from the contents
-/// of the given Record.
+/// of the given Record. Filenames ending in `.gz` or `.zst` are
+/// compressed; reading them back with [`record_read`] and the other
+/// readers needs no extra step.
 int record_write(Record* record, const char* filename);
 
+/// Write record to file with a fixed number of significant digits
+///
+/// This is the same as [`record_write`] except that the data pairs are
+/// written in E notation with `significant_digits` digits. A value of 0
+/// writes the shortest digits that read back to the same value, which is
+/// what [`record_write`] does.
+///
+/// The data pairs are formatted by `threads` workers, where 0 uses one per
+/// available core and 1 formats them on the calling thread, as
+/// [`record_write`] does. The file is the same whatever the number of workers.
+///
+/// A non-zero `segments` writes an independent variable that is one linear
+/// sweep as a `SEG_LIST`. A `SEG_LIST` read from a file is written back as
+/// it was either way.
+int record_write_with_options(Record* record, const char* filename, size_t significant_digits, size_t threads, int segments);
+
+/// Write record to file while counting and timing the write
+///
+/// This is the same as [`record_write_with_options`] except that the counts
+/// and times of the write are added to `stats`, which is also done for a
+/// write that fails.
+int record_write_with_stats(Record* record, const char* filename, size_t significant_digits, size_t threads, int segments, WriteStats* stats);
+
+/// Create a streaming writer to the file at `filename`
+///
+/// A `significant_digits` of 0 writes the shortest round trip digits, as in
+/// [`record_write_with_options`]. The file is created straight away. This
+/// allocates memory and must be released by the caller, either with
+/// [`record_writer_finish`] or [`record_writer_destroy`].
+/// - A null pointer is returned if the file cannot be created
+RecordWriter* record_writer_new(const char* filename, size_t significant_digits);
+
+/// Free a pointer to `RecordWriter` without finishing it
+///
+/// Whatever is still buffered is written to the file, which is left
+/// incomplete unless every array was written.
+int record_writer_destroy(RecordWriter* writer);
+
+/// Write the header of `record`
+///
+/// Every data array of `record` is declared by its name and format; its
+/// samples are not written. The arrays must then be written in that order.
+/// Once a write to the file fails, every later call fails as out of order.
+int record_writer_begin(RecordWriter* writer, const Record* record);
+
+/// Start the next declared data array
+int record_writer_begin_array(RecordWriter* writer, const char* name, const char* format);
+
+/// Append `length` samples to the current data array
+///
+/// The samples are interleaved as `real, imag` pairs, so `samples` points
+/// to `2 * length` values, as returned by [`record_get_data_array_ptr`].
+int record_writer_push_samples(RecordWriter* writer, const double* samples, size_t length);
+
+/// Close the current data array
+int record_writer_end_array(RecordWriter* writer);
+
+/// Flush the file once every declared array has been written
+///
+/// The writer is freed whether or not this succeeds, so it must not be
+/// used again.
+int record_writer_finish(RecordWriter* writer);
+
+/// Write record to file in the binary format
+///
+/// The file is read back with [`record_read_binary`]. Unlike [`record_write`],
+/// any record can be written.
+int record_write_binary(Record* record, const char* filename);
+
 /// Get the record version
 /// 
 /// - If the [`Record`] pointer is null, null is returned.
@@ -158,6 +454,16 @@ int record_set_independent_variable(Record* record, const char* name, const char
 /// - If the [`Record`] pointer is null, return zero.
 int record_get_number_of_data_arrays(Record* record);
 
+/// Find data array by name
+///
+/// Returns the index of the first data array called `name`, which can be
+/// passed to the other data array functions. Only the names are compared;
+/// no samples are touched. Each call scans the names, so a caller looking up
+/// many names keeps the indices, as the C++ `Record` does.
+/// - If the [`Record`] pointer or name is null, return the error code.
+/// - If there is no such data array, return the name not found error code.
+int record_find_data_array(Record* record, const char* name);
+
 /// Get data array name
 /// 
 /// - If the [`Record`] pointer is null, return null pointer.
@@ -182,6 +488,16 @@ int record_get_data_array_length(Record* record, size_t idx);
 /// - Caller is responsible for allocation of the appropriate size and deallocation.
 int record_get_data_array(Record* record, size_t idx, double* real, double* imag);
 
+/// Get a borrowed pointer to a data array
+/// 
+/// - The samples are laid out as interleaved `re, im` pairs, which matches
+///   `std::complex<double>[]`. Nothing is copied.
+/// - If the [`Record`] pointer is null, null is returned.
+/// - If the index is out of bounds, null is returned.
+/// - The pointer is owned by the record; it stays valid until the record is
+///   destroyed or its data arrays are modified, and must not be freed.
+const double* record_get_data_array_ptr(Record* record, size_t idx);
+
 
 /// Append data array
 /// 
@@ -190,4 +506,112 @@ int record_append_data_array(
     Record* record, const char* name, const char* format,
     const double* reals, const double* imags, size_t len);
 
+/// Append data array from interleaved samples
+///
+/// - The samples are laid out as `re, im` pairs, which matches
+///   `std::complex<double>[]`, so `samples` points to `2 * len` values.
+///   They are copied in one go.
+/// - If the [`Record`] pointer is null, a corresponding error code is returned
+/// - `samples` may only be null when `len` is zero
+int record_append_data_array_interleaved(
+    Record* record, const char* name, const char* format,
+    const double* samples, size_t len);
+
+/// Convert the samples of a data array to `format` in place
+///
+/// - `format` is one of `RI`, `MA` or `DB`, as is the current format of
+///   the array, which is changed to match. Angles are in degrees.
+/// - If the [`Record`] pointer is null, a corresponding error code is returned
+/// - If the index is out of bounds, a corresponding error code is returned
+int record_convert_data_array(Record* record, size_t idx, const char* format);
+
+/// Convert the samples of every data array to `format` in place
+///
+/// - This is `record_convert_data_array` for each array, spread over up to
+///   `threads` workers where 0 uses one thread per available core.
+/// - Either all arrays are converted or none is.
+/// - If the [`Record`] pointer is null, a corresponding error code is returned
+int record_convert_data_arrays(Record* record, const char* format, size_t threads);
+
+/// Get the whole header in a single call
+///
+/// The header is packed into a table of native-endian `uint64_t` counts
+/// and strings, where each string is a `uint64_t` byte length followed by
+/// that many UTF-8 bytes without a null terminator. In order:
+/// - version, name
+/// - number of comments, then each comment
+/// - number of devices, then for each: name, number of entries, entries
+/// - number of constants, then for each: name, value
+/// - independent variable name, format, length
+/// - number of data arrays, then for each: name, format, length
+///
+/// The size of the table in bytes is written to `length`.
+/// - If the [`Record`] or `length` pointer is null, null is returned.
+/// - The table is owned by the record; it stays valid until the record is
+///   destroyed or this function is called again, and must not be freed.
+const char* record_get_header_snapshot(Record* record, size_t* length);
+
+/// Share a record between threads
+///
+/// The record is moved into a reference counted, immutable handle, so
+/// `record` must not be used or destroyed afterwards. The handle can be read
+/// from any number of threads at once through the `shared_record_*`
+/// functions, which never change the last error code; they return it
+/// instead, or null for pointers. Each thread that keeps the record should
+/// take its own handle with [`record_retain`].
+///
+/// The handle must be released by the caller (see [`record_release`]).
+/// - A null pointer is returned if the record is null
+const SharedRecord* record_share(Record* record);
+
+/// Take another handle to a shared record
+///
+/// The same pointer is returned, and must be released separately. This can
+/// be called on `null`, which is returned.
+const SharedRecord* record_retain(const SharedRecord* shared);
+
+/// Release a handle to a shared record
+///
+/// The record is freed with its last handle. This can be called on `null`.
+int record_release(const SharedRecord* shared);
+
+/// Copy a shared record into a record of its own
+///
+/// This allocates memory and must be destroyed by the caller
+/// (see [`record_destroy`]).
+/// - A null pointer is returned if the handle is null
+Record* shared_record_copy(const SharedRecord* shared);
+
+/// Get the whole header of a shared record in a single call
+///
+/// The table is laid out as for [`record_get_header_snapshot`] and stays
+/// valid for as long as the handle is held.
+/// - If the handle or `length` pointer is null, null is returned.
+const char* shared_record_get_header_snapshot(const SharedRecord* shared, size_t* length);
+
+/// Get a borrowed pointer to the independent variable of a shared record
+///
+/// There are as many values as the length in the header snapshot.
+/// - If the handle is null, null is returned.
+const double* shared_record_get_independent_variable_array(const SharedRecord* shared);
+
+/// Find data array of a shared record by name
+///
+/// This is the same as [`record_find_data_array`] except that the error
+/// code is only returned.
+int shared_record_find_data_array(const SharedRecord* shared, const char* name);
+
+/// Get data array length of a shared record
+///
+/// - If the handle is null or the index is out of bounds, the error code is
+///   returned.
+int shared_record_get_data_array_length(const SharedRecord* shared, size_t idx);
+
+/// Get a borrowed pointer to a data array of a shared record
+///
+/// The samples are laid out as for [`record_get_data_array_ptr`] and stay
+/// valid for as long as the handle is held.
+/// - If the handle is null or the index is out of bounds, null is returned.
+const double* shared_record_get_data_array_ptr(const SharedRecord* shared, size_t idx);
+
 #endif
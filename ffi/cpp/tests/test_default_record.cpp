@@ -25,6 +25,32 @@ SCENARIO("Creating a default record produces a valid empty Record type.", "[Reco
                 REQUIRE(name == "");
             }
         }
+
+        WHEN("the header lists are checked") {
+            THEN("they are empty") {
+                REQUIRE(record.comments().empty());
+                REQUIRE(record.devices().empty());
+                REQUIRE(record.constants().empty());
+                REQUIRE(record.data().empty());
+            }
+        }
+
+        WHEN("a device and comment are appended") {
+            record.append_comment("A comment");
+            record.append_device({ "NA", { "VERSION HP8510B.05.00", "REGISTER 1" } });
+            record.append_device({ "WVI", {} });
+
+            THEN("they are read back") {
+                REQUIRE(record.comments() == std::vector<std::string> { "A comment" });
+
+                const auto devices = record.devices();
+                REQUIRE(devices.size() == 2);
+                REQUIRE(devices[0].name == "NA");
+                REQUIRE(devices[0].entries == std::vector<std::string> { "VERSION HP8510B.05.00", "REGISTER 1" });
+                REQUIRE(devices[1].name == "WVI");
+                REQUIRE(devices[1].entries.empty());
+            }
+        }
     }
 }
 
@@ -1,7 +1,11 @@
+#include <algorithm>
+#include <cmath>
 #include <cstring>
 #include <iostream>
 #include <future>
 #include <filesystem>
+#include <fstream>
+#include <iterator>
 
 #include <catch2/catch.hpp>
 #include <citi/citi.hpp>
@@ -182,6 +186,81 @@ SCENARIO("Reading a valid file into a record produces the correct values.", "[Re
             }
         }
 
+        WHEN("an independent variable is moved in") {
+            Record::IndependentVariable new_ivar {
+                "FREQ", "PHASE",
+                { 0.5, 0.6, 0.7, 0.8, 1.0 }
+            };
+            record.set_independent_variable(std::move(new_ivar));
+
+            THEN("the same indepedent variable data is retrieved") {
+                const auto& ivar = record.independent_variable();
+
+                REQUIRE(ivar.name == "FREQ");
+                REQUIRE(ivar.format == "PHASE");
+                REQUIRE(ivar.values == std::vector<double> { 0.5, 0.6, 0.7, 0.8, 1.0 });
+            }
+        }
+
+        WHEN("a data array is moved in after the data arrays were retrieved") {
+            REQUIRE(record.data().size() == 1);
+            Record::DataArray new_data_array {
+                "S[2, 2]", "RI",
+                {
+                    { 0.86303E-1, -8.98651E-1 },
+                    { 8.97491E-1, 3.06915E-1 },
+                }
+            };
+            record.append_data_array(std::move(new_data_array));
+
+            THEN("the appended data array can be retrieved") {
+                const auto& data_arrays = record.data();
+
+                REQUIRE(data_arrays.size() == 2);
+                REQUIRE(data_arrays[1].name == "S[2, 2]");
+                REQUIRE(data_arrays[1].format == "RI");
+                REQUIRE(data_arrays[1].samples == std::vector<std::complex<double>> {
+                    { 0.86303E-1, -8.98651E-1 },
+                    { 8.97491E-1, 3.06915E-1 },
+                });
+                REQUIRE(record.data_view(1).size() == 2);
+                REQUIRE(record.data_view(1)[1] == data_arrays[1].samples[1]);
+            }
+        }
+
+        WHEN("the data arrays are converted to magnitude and angle") {
+            const auto samples = record.data()[0].samples;
+            record.convert_data("MA");
+
+            THEN("the samples and format are converted") {
+                const auto& converted = record.data()[0];
+                REQUIRE(converted.format == "MA");
+                REQUIRE(converted.samples.size() == samples.size());
+                for (std::size_t i = 0; i < samples.size(); ++i) {
+                    REQUIRE(converted.samples[i].real() == Approx(std::abs(samples[i])));
+                    REQUIRE(converted.samples[i].imag() == Approx(std::arg(samples[i]) * 180. / std::acos(-1.)));
+                }
+            }
+
+            THEN("converting back gives the original samples") {
+                record.convert_data_array(0, "RI");
+                const auto& converted = record.data()[0];
+                REQUIRE(converted.format == "RI");
+                for (std::size_t i = 0; i < samples.size(); ++i) {
+                    REQUIRE(converted.samples[i].real() == Approx(samples[i].real()));
+                    REQUIRE(converted.samples[i].imag() == Approx(samples[i].imag()));
+                }
+            }
+        }
+
+        WHEN("a data array is converted to an unsupported format") {
+            THEN("an exception is thrown") {
+                REQUIRE_THROWS_AS(record.convert_data_array(0, "XY"), Record::RuntimeException);
+                REQUIRE_THROWS_AS(record.convert_data_array(1, "MA"), Record::RuntimeException);
+                REQUIRE(record.data()[0].format == "RI");
+            }
+        }
+
         /*
         WHEN("the record is written to a file") {
             const auto citi_write_file_path = fs::current_path() / "tests" / "regression_files" / "temp_test_file.cti";
@@ -222,3 +301,349 @@ SCENARIO("Reading a valid file into a record produces the correct values.", "[Re
 }
 
 
+
+SCENARIO("Reading a file through a memory map matches a buffered read.", "[Record]") {
+    GIVEN("a file read both buffered and memory mapped") {
+
+        const auto citi_file_path = fs::current_path() / "tests" / "regression_files" / "data_file.cti";
+        Record buffered { citi_file_path, Record::ReadMode::Buffered };
+        Record mapped { citi_file_path, Record::ReadMode::MemoryMapped };
+
+        WHEN("the headers are compared") {
+            THEN("they are the same") {
+                REQUIRE(mapped.version() == buffered.version());
+                REQUIRE(mapped.name() == buffered.name());
+                REQUIRE(mapped.comments() == buffered.comments());
+                REQUIRE(mapped.independent_variable().values == buffered.independent_variable().values);
+            }
+        }
+
+        WHEN("the data arrays are compared") {
+            const auto mapped_data = mapped.data();
+            const auto buffered_data = buffered.data();
+
+            THEN("they are the same") {
+                REQUIRE(mapped_data.size() == buffered_data.size());
+                for (std::size_t i = 0; i < mapped_data.size(); i++) {
+                    REQUIRE(mapped_data[i].name == buffered_data[i].name);
+                    REQUIRE(mapped_data[i].samples == buffered_data[i].samples);
+                }
+            }
+        }
+    }
+
+    GIVEN("a file that does not exist") {
+        const auto citi_file_path = fs::current_path() / "tests" / "regression_files" / "does_not_exist.cti";
+
+        WHEN("it is memory mapped") {
+            THEN("an exception is thrown") {
+                REQUIRE_THROWS_AS(Record(citi_file_path, Record::ReadMode::MemoryMapped), Record::RuntimeException);
+            }
+        }
+    }
+}
+
+SCENARIO("Reading a file in parallel matches a buffered read.", "[Record]") {
+    GIVEN("a file with several data arrays read both buffered and in parallel") {
+
+        const auto citi_file_path = fs::current_path() / "tests" / "regression_files" / "list_cal_set.cti";
+        Record buffered { citi_file_path, Record::ReadMode::Buffered };
+        Record parallel { citi_file_path, Record::ReadMode::Parallel, 2 };
+
+        WHEN("the data arrays are compared") {
+            const auto parallel_data = parallel.data();
+            const auto buffered_data = buffered.data();
+
+            THEN("they are the same") {
+                REQUIRE(parallel_data.size() == 3);
+                REQUIRE(parallel_data.size() == buffered_data.size());
+                for (std::size_t i = 0; i < parallel_data.size(); i++) {
+                    REQUIRE(parallel_data[i].name == buffered_data[i].name);
+                    REQUIRE(parallel_data[i].samples == buffered_data[i].samples);
+                }
+            }
+        }
+    }
+}
+
+SCENARIO("Reloading a record matches reading the file afresh.", "[Record]") {
+    GIVEN("a record read from one file") {
+
+        const auto directory = fs::current_path() / "tests" / "regression_files";
+        Record record { directory / "list_cal_set.cti" };
+        REQUIRE(record.data().size() == 3);
+
+        WHEN("another file is reloaded into it") {
+            const auto data_file_path = directory / "data_file.cti";
+            record.reload(data_file_path);
+            const Record expected { data_file_path };
+
+            THEN("it holds the other file") {
+                REQUIRE(record.name() == expected.name());
+                REQUIRE(record.independent_variable().values == expected.independent_variable().values);
+                REQUIRE(record.data().size() == expected.data().size());
+                for (std::size_t i = 0; i < record.data().size(); i++) {
+                    REQUIRE(record.data()[i].name == expected.data()[i].name);
+                    REQUIRE(record.data()[i].samples == expected.data()[i].samples);
+                }
+            }
+        }
+
+        WHEN("a file that does not exist is reloaded into it") {
+            REQUIRE_THROWS_AS(record.reload(directory / "does_not_exist.cti"), Record::RuntimeException);
+
+            THEN("it is left blank") {
+                REQUIRE(record.name().empty());
+                REQUIRE(record.data().empty());
+            }
+        }
+    }
+}
+
+SCENARIO("Reading many files at once matches reading them one by one.", "[Record]") {
+    GIVEN("several files, one of which does not exist") {
+
+        const auto directory = fs::current_path() / "tests" / "regression_files";
+        const std::vector<fs::path> filenames {
+            directory / "list_cal_set.cti",
+            directory / "does_not_exist.cti",
+            directory / "data_file.cti"
+        };
+
+        WHEN("they are read together") {
+            const auto results = read_many(filenames, 2);
+
+            THEN("every file has a result in order") {
+                REQUIRE(results.size() == 3);
+
+                REQUIRE(results[0].error_code == Record::ErrorCode::NoError);
+                REQUIRE(results[0].record);
+                REQUIRE(results[0].record->data().size() == Record { filenames[0] }.data().size());
+
+                REQUIRE(results[1].error_code == Record::ErrorCode::FileNotFound);
+                REQUIRE_FALSE(results[1].record);
+
+                REQUIRE(results[2].error_code == Record::ErrorCode::NoError);
+                REQUIRE(results[2].record);
+                REQUIRE(results[2].record->independent_variable().values == Record { filenames[2] }.independent_variable().values);
+            }
+        }
+
+        WHEN("no files are read") {
+            THEN("there are no results") {
+                REQUIRE(read_many({}).empty());
+            }
+        }
+    }
+}
+
+SCENARIO("Parsing a file in pieces matches reading it.", "[RecordParser]") {
+    GIVEN("the contents of a file with several data arrays") {
+
+        const auto citi_file_path = fs::current_path() / "tests" / "regression_files" / "list_cal_set.cti";
+        std::ifstream stream { citi_file_path, std::ios::binary };
+        const std::string contents { std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>() };
+        Record expected { citi_file_path };
+        RecordParser parser;
+
+        WHEN("the contents are fed in small chunks") {
+            const auto second = contents.find("\nBEGIN", contents.find("\nEND")) + 1;
+            for (std::size_t i = 0; i < second; i += 7) {
+                parser.feed(contents.data() + i, std::min<std::size_t>(7, second - i));
+            }
+
+            THEN("the first data array is available before the rest arrives") {
+                REQUIRE(parser.finished_data_arrays() == 1);
+                REQUIRE(parser.data_array(0).name == expected.data()[0].name);
+                REQUIRE(parser.data_array(0).samples == expected.data()[0].samples);
+                REQUIRE_THROWS_AS(parser.data_array(1), Record::RuntimeException);
+            }
+
+            THEN("finishing gives the same record") {
+                parser.feed(contents.substr(second));
+                REQUIRE(parser.finished_data_arrays() == expected.data().size());
+                const auto record = parser.finish();
+                REQUIRE(record.name() == expected.name());
+                REQUIRE(record.independent_variable().values == expected.independent_variable().values);
+                REQUIRE(record.data().size() == expected.data().size());
+                for (std::size_t i = 0; i < record.data().size(); i++) {
+                    REQUIRE(record.data()[i].samples == expected.data()[i].samples);
+                }
+            }
+        }
+
+        WHEN("an invalid line is fed") {
+            THEN("an exception is thrown, and again for any later call") {
+                REQUIRE_THROWS_AS(parser.feed("NOT A KEYWORD\n"), Record::RuntimeException);
+                REQUIRE_THROWS_AS(parser.feed(contents), Record::RuntimeException);
+                REQUIRE_THROWS_AS(parser.finish(), Record::RuntimeException);
+            }
+        }
+    }
+}
+
+SCENARIO("Reading part of a file matches a full read.", "[Record]") {
+    GIVEN("a file with several data arrays") {
+
+        const auto citi_file_path = fs::current_path() / "tests" / "regression_files" / "list_cal_set.cti";
+        Record full { citi_file_path };
+
+        WHEN("only the header is read") {
+            Record record { citi_file_path, Record::ReadOptions { true, {} } };
+
+            THEN("the data arrays have no samples") {
+                REQUIRE(record.name() == full.name());
+                REQUIRE(record.independent_variable().values == full.independent_variable().values);
+                REQUIRE(record.data().size() == full.data().size());
+                for (const auto& data_array : record.data()) {
+                    REQUIRE(data_array.samples.empty());
+                }
+            }
+        }
+
+        WHEN("one data array is selected") {
+            Record record { citi_file_path, Record::ReadOptions { false, { "E[2]" } } };
+
+            THEN("only that data array is read") {
+                REQUIRE(record.data().size() == 1);
+                REQUIRE(record.data()[0].name == "E[2]");
+                REQUIRE(record.data()[0].samples == full.data()[1].samples);
+            }
+        }
+
+        WHEN("no data array is selected") {
+            Record record { citi_file_path, Record::ReadOptions { false, {} } };
+
+            THEN("every data array is read") {
+                REQUIRE(record.data().size() == full.data().size());
+                for (std::size_t i = 0; i < full.data().size(); i++) {
+                    REQUIRE(record.data()[i].samples == full.data()[i].samples);
+                }
+            }
+        }
+    }
+}
+
+SCENARIO("Viewing a data array does not copy it.", "[Record]") {
+    GIVEN("a record read from a file") {
+
+        const auto citi_file_path = fs::current_path() / "tests" / "regression_files" / "list_cal_set.cti";
+        Record record { citi_file_path };
+
+        WHEN("each data array is viewed") {
+            const auto data = record.data();
+
+            THEN("the views match the copies") {
+                for (std::size_t i = 0; i < data.size(); i++) {
+                    const auto view = record.data_view(i);
+                    REQUIRE(view.size() == data[i].samples.size());
+                    REQUIRE(std::equal(view.begin(), view.end(), data[i].samples.begin()));
+                }
+            }
+
+            THEN("viewing twice gives the same pointer") {
+                REQUIRE(record.data_view(0).data() == record.data_view(0).data());
+            }
+        }
+
+        WHEN("a data array past the end is viewed") {
+            THEN("an exception is thrown") {
+                REQUIRE_THROWS_AS(record.data_view(3), Record::RuntimeException);
+            }
+        }
+
+        WHEN("each data array is looked up by name") {
+            const auto data = record.data();
+
+            THEN("the index and view match the position of the name") {
+                for (std::size_t i = 0; i < data.size(); i++) {
+                    REQUIRE(record.find_data_array(data[i].name) == i);
+                    REQUIRE(record.data_array(data[i].name).data() == record.data_view(i).data());
+                }
+            }
+        }
+
+        WHEN("a data array that does not exist is looked up by name") {
+            THEN("an exception is thrown") {
+                REQUIRE_THROWS_AS(record.data_array("NOT A NAME"), Record::RuntimeException);
+            }
+        }
+
+        WHEN("data arrays are appended after a lookup by name") {
+            const auto first = record.find_data_array(record.data()[0].name);
+            const auto count = record.data().size();
+            record.append_data_array(Record::DataArray { "APPENDED", "RI", { { 1., 2. } } });
+            record.append_data_array(Record::DataArray { record.data()[0].name, "RI", { { 3., 4. } } });
+
+            THEN("the appended names are found and repeated names give the first") {
+                REQUIRE(record.find_data_array("APPENDED") == count);
+                REQUIRE(record.find_data_array(record.data()[0].name) == first);
+                REQUIRE(record.data_array("APPENDED")[0] == std::complex<double>(1., 2.));
+            }
+        }
+    }
+}
+
+SCENARIO("Sharing a record lets many threads read it at once.", "[SharedRecord]") {
+    GIVEN("a shared record and the same record read from a file") {
+
+        const auto citi_file_path = fs::current_path() / "tests" / "regression_files" / "list_cal_set.cti";
+        const Record record { citi_file_path };
+        const SharedRecord shared { Record { citi_file_path } };
+
+        THEN("the header matches") {
+            REQUIRE(shared.version() == record.version());
+            REQUIRE(shared.name() == record.name());
+            REQUIRE(shared.comments() == record.comments());
+            REQUIRE(shared.devices().size() == record.devices().size());
+            REQUIRE(shared.constants().size() == record.constants().size());
+            REQUIRE(shared.independent_variable().name == record.independent_variable().name);
+            REQUIRE(shared.independent_variable().values == record.independent_variable().values);
+            REQUIRE(shared.number_of_data_arrays() == record.data().size());
+            REQUIRE(shared.data_array_name(1) == record.data()[1].name);
+            REQUIRE(shared.data_array_format(1) == record.data()[1].format);
+        }
+
+        WHEN("each data array is read from its own thread and handle") {
+            std::vector<std::future<std::vector<std::complex<double>>>> futures;
+            for (std::size_t i = 0; i < shared.number_of_data_arrays(); i++) {
+                futures.push_back(std::async(std::launch::async, [handle = shared, i] {
+                    const auto view = handle.data_view(i);
+                    return std::vector<std::complex<double>>(view.begin(), view.end());
+                }));
+            }
+
+            THEN("every thread sees the samples of the record") {
+                for (std::size_t i = 0; i < futures.size(); i++) {
+                    REQUIRE(futures[i].get() == record.data()[i].samples);
+                }
+            }
+        }
+
+        WHEN("a data array is looked up by name") {
+            THEN("the index and view match the position of the name") {
+                REQUIRE(shared.find_data_array("E[2]") == 1);
+                REQUIRE(shared.data_array("E[2]").data() == shared.data_view(1).data());
+            }
+        }
+
+        WHEN("a data array that does not exist is looked up") {
+            THEN("an exception is thrown") {
+                REQUIRE_THROWS_AS(shared.data_array("NOT A NAME"), Record::RuntimeException);
+                REQUIRE_THROWS_AS(shared.data_view(3), Record::RuntimeException);
+                REQUIRE_THROWS_AS(shared.data_array_name(3), Record::RuntimeException);
+            }
+        }
+
+        WHEN("the shared record is copied into a record of its own") {
+            auto copy = shared.copy();
+            copy.set_name("COPY");
+
+            THEN("the shared record is unchanged") {
+                REQUIRE(copy.name() == "COPY");
+                REQUIRE(shared.name() == record.name());
+                REQUIRE(copy.data()[0].samples == record.data()[0].samples);
+            }
+        }
+    }
+}
@@ -0,0 +1,109 @@
+#include <filesystem>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <catch2/catch.hpp>
+#include <citi/citi.hpp>
+
+namespace fs = std::filesystem;
+using namespace citi;
+
+static_assert(std::is_nothrow_move_constructible_v<Record>);
+static_assert(std::is_nothrow_move_assignable_v<Record>);
+static_assert(std::is_nothrow_destructible_v<Record>);
+static_assert(!std::is_copy_constructible_v<Record>);
+static_assert(!std::is_copy_assignable_v<Record>);
+
+SCENARIO("Records can be moved without copying the Rust record.", "[Record]") {
+    GIVEN("a record read from a file") {
+
+        const auto citi_file_path = fs::current_path() / "tests" / "regression_files" / "data_file.cti";
+        Record record { citi_file_path };
+
+        WHEN("it is moved into a vector") {
+            std::vector<Record> records;
+            records.push_back(std::move(record));
+            records.emplace_back();
+
+            THEN("the moved record keeps its contents") {
+                REQUIRE(records[0].name() == "DATA");
+                REQUIRE(records[0].data().size() == 1);
+                REQUIRE(records[1].name() == "");
+            }
+
+            THEN("the moved from record throws instead of crashing") {
+                REQUIRE_THROWS_AS(record.data_view(0), Record::RuntimeException);
+            }
+        }
+
+        WHEN("it is moved after its accessors were called") {
+            REQUIRE(record.name() == "DATA");
+            REQUIRE(record.data().size() == 1);
+            REQUIRE(record.independent_variable().values.size() == 10);
+            Record moved { std::move(record) };
+
+            THEN("the moved from record keeps no cached values") {
+                REQUIRE_THROWS_AS(record.name(), Record::RuntimeException);
+                REQUIRE_THROWS_AS(record.data(), Record::RuntimeException);
+                REQUIRE_THROWS_AS(record.independent_variable(), Record::RuntimeException);
+            }
+        }
+
+        WHEN("it is move assigned after its accessors were called") {
+            REQUIRE(record.name() == "DATA");
+            Record other;
+            other = std::move(record);
+
+            THEN("the moved from record keeps no cached values") {
+                REQUIRE(other.name() == "DATA");
+                REQUIRE_THROWS_AS(record.name(), Record::RuntimeException);
+            }
+        }
+
+        WHEN("it is move assigned over another record") {
+            Record other;
+            other = std::move(record);
+
+            THEN("the other record has the contents") {
+                REQUIRE(other.name() == "DATA");
+                REQUIRE(other.independent_variable().values.size() == 10);
+            }
+        }
+    }
+}
+
+SCENARIO("Accessors return cached values until the record is changed.", "[Record]") {
+    GIVEN("a default record") {
+
+        Record record;
+
+        WHEN("an accessor is called twice") {
+            THEN("the same object is returned") {
+                REQUIRE(&record.comments() == &record.comments());
+                REQUIRE(&record.data() == &record.data());
+                REQUIRE(&record.independent_variable() == &record.independent_variable());
+            }
+        }
+
+        WHEN("the record is changed after being read") {
+            REQUIRE(record.name() == "");
+            REQUIRE(record.comments().empty());
+            REQUIRE(record.independent_variable().values.empty());
+            REQUIRE(record.data().empty());
+
+            record.set_name("CAL_SET");
+            record.append_comment("A comment");
+            record.set_independent_variable({ "FREQ", "MAG", { 1., 2. } });
+            record.append_data_array({ "S[1,1]", "RI", { { 1., 2. }, { 3., 4. } } });
+
+            THEN("the accessors see the changes") {
+                REQUIRE(record.name() == "CAL_SET");
+                REQUIRE(record.comments() == std::vector<std::string> { "A comment" });
+                REQUIRE(record.independent_variable().values == std::vector<double> { 1., 2. });
+                REQUIRE(record.data().size() == 1);
+                REQUIRE(record.data()[0].samples[1] == std::complex<double>(3., 4.));
+            }
+        }
+    }
+}
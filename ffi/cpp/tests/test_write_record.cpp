@@ -2,6 +2,7 @@
 #include <iostream>
 #include <future>
 #include <filesystem>
+#include <fstream>
 
 #include <catch2/catch.hpp>
 #include <citi/citi.hpp>
@@ -44,6 +45,210 @@ SCENARIO("Writing a record to the file system correctly writes the data to the f
             fs::remove(citi_write_file_path);
         }
 
+        WHEN("the record is written with a fixed number of significant digits") {
+            const auto citi_write_file_path = fs::current_path() / "tests" / "temp_test_file_digits.cti";
+            record.write_to_file(citi_write_file_path, Record::WriteOptions { 6 });
+
+            THEN("the data pairs are written in instrument style") {
+                std::ifstream file { citi_write_file_path };
+                const std::string contents {
+                    std::istreambuf_iterator<char>(file),
+                    std::istreambuf_iterator<char>()
+                };
+                REQUIRE(contents.find("\nBEGIN\n8.63030E-2,-8.98651E-1\n8.97491E-1,3.06915E-1\n") != std::string::npos);
+            }
+
+            fs::remove(citi_write_file_path);
+        }
+
+        WHEN("the record is written with its independent variable as segments") {
+            const auto citi_write_file_path = fs::current_path() / "tests" / "temp_test_file_segments.cti";
+            Record::WriteOptions options { 0 };
+            options.segments = true;
+            record.write_to_file(citi_write_file_path, options);
+
+            THEN("the sweep is written as one segment") {
+                std::ifstream file { citi_write_file_path };
+                const std::string contents {
+                    std::istreambuf_iterator<char>(file),
+                    std::istreambuf_iterator<char>()
+                };
+                REQUIRE(contents.find("\nSEG_LIST_BEGIN\nSEG 1E9 4E9 10\nSEG_LIST_END\n") != std::string::npos);
+                REQUIRE(contents.find("VAR_LIST_BEGIN") == std::string::npos);
+            }
+
+            fs::remove(citi_write_file_path);
+        }
+
+        WHEN("the record is written on one thread and on every core") {
+            const auto sequential_path = fs::current_path() / "tests" / "temp_test_file_sequential.cti";
+            const auto parallel_path = fs::current_path() / "tests" / "temp_test_file_parallel.cti";
+            record.write_to_file(sequential_path, Record::WriteOptions { 0, 1 });
+            record.write_to_file(parallel_path, Record::WriteOptions { 0, 0 });
+
+            THEN("the files are the same") {
+                std::ifstream sequential_file { sequential_path };
+                std::ifstream parallel_file { parallel_path };
+                const std::string sequential {
+                    std::istreambuf_iterator<char>(sequential_file),
+                    std::istreambuf_iterator<char>()
+                };
+                const std::string parallel {
+                    std::istreambuf_iterator<char>(parallel_file),
+                    std::istreambuf_iterator<char>()
+                };
+                REQUIRE(!sequential.empty());
+                REQUIRE(parallel == sequential);
+            }
+
+            fs::remove(sequential_path);
+            fs::remove(parallel_path);
+        }
+
+        WHEN("the record is written with default constructed options") {
+            const auto default_path = fs::current_path() / "tests" / "temp_test_file_default.cti";
+            const auto options_path = fs::current_path() / "tests" / "temp_test_file_default_options.cti";
+            record.write_to_file(default_path);
+            Record::WriteOptions options;
+            options.threads = 4;
+            record.write_to_file(options_path, options);
+
+            THEN("the data pairs are written with the shortest digits") {
+                std::ifstream default_file { default_path };
+                std::ifstream options_file { options_path };
+                const std::string expected {
+                    std::istreambuf_iterator<char>(default_file),
+                    std::istreambuf_iterator<char>()
+                };
+                const std::string contents {
+                    std::istreambuf_iterator<char>(options_file),
+                    std::istreambuf_iterator<char>()
+                };
+                REQUIRE(!expected.empty());
+                REQUIRE(contents == expected);
+            }
+
+            fs::remove(default_path);
+            fs::remove(options_path);
+        }
+
+        WHEN("the record is written and read back with stats") {
+            const auto citi_write_file_path = fs::current_path() / "tests" / "temp_test_file_stats.cti";
+            Record::WriteStats write_stats {};
+            record.write_to_file(citi_write_file_path, Record::WriteOptions { 0 }, write_stats);
+            Record::ReadStats read_stats {};
+            Record record_from_file { citi_write_file_path, read_stats };
+
+            THEN("both count the same bytes and samples") {
+                REQUIRE(write_stats.bytes == fs::file_size(citi_write_file_path));
+                REQUIRE(read_stats.bytes == write_stats.bytes);
+                REQUIRE(read_stats.lines == write_stats.lines);
+                REQUIRE(read_stats.samples == 10);
+                REQUIRE(write_stats.samples == 10);
+                REQUIRE(read_stats.keywords.data == 1);
+                REQUIRE(read_stats.total_nanoseconds >= read_stats.lex_nanoseconds);
+                REQUIRE(record_from_file.data()[0].samples == record.data()[0].samples);
+            }
+
+            fs::remove(citi_write_file_path);
+        }
+
+        WHEN("the record is written in the binary format") {
+            const auto binary_file_path = fs::current_path() / "tests" / "temp_test_file.bin";
+            record.write_binary_to_file(binary_file_path);
+
+            THEN("the same record is read back") {
+                Record record_from_file { binary_file_path, Record::ReadMode::Binary };
+                REQUIRE(record_from_file.name() == record.name());
+                REQUIRE(record_from_file.devices().size() == record.devices().size());
+                REQUIRE(record_from_file.independent_variable().values == record.independent_variable().values);
+                REQUIRE(record_from_file.data().size() == record.data().size());
+                for (std::size_t i = 0; i < record.data().size(); i++) {
+                    REQUIRE(record_from_file.data()[i].samples == record.data()[i].samples);
+                }
+            }
+
+            fs::remove(binary_file_path);
+        }
+
+        WHEN("the record is read through a binary cache") {
+            const auto citi_write_file_path = fs::current_path() / "tests" / "temp_test_file_cached.cti";
+            record.write_to_file(citi_write_file_path);
+            const Record text { citi_write_file_path };
+            const Record first { citi_write_file_path, Record::ReadMode::Cached };
+            const Record second { citi_write_file_path, Record::ReadMode::Cached };
+
+            THEN("the cache is kept next to the file and gives the same record") {
+                auto cache_path = citi_write_file_path;
+                cache_path += ".bin";
+                REQUIRE(fs::exists(cache_path));
+                REQUIRE(second.name() == text.name());
+                REQUIRE(second.data().size() == text.data().size());
+                for (std::size_t i = 0; i < text.data().size(); i++) {
+                    REQUIRE(first.data()[i].samples == text.data()[i].samples);
+                    REQUIRE(second.data()[i].samples == text.data()[i].samples);
+                }
+                fs::remove(cache_path);
+            }
+
+            fs::remove(citi_write_file_path);
+        }
+
+        WHEN("a text file is read as a binary record") {
+            THEN("an exception is thrown") {
+                const auto citi_file_path = fs::current_path() / "tests" / "regression_files" / "data_file.cti";
+                REQUIRE_THROWS_AS(Record(citi_file_path, Record::ReadMode::Binary), Record::RuntimeException);
+            }
+        }
+
+        WHEN("the record is streamed with a record writer") {
+            const auto citi_write_file_path = fs::current_path() / "tests" / "temp_test_file_streamed.cti";
+            const auto expected_file_path = fs::current_path() / "tests" / "temp_test_file_expected.cti";
+            record.write_to_file(expected_file_path);
+
+            RecordWriter writer { citi_write_file_path };
+            writer.begin(record);
+            for (const auto& data_array : record.data()) {
+                writer.begin_array(data_array.name, data_array.format);
+                const auto half = data_array.samples.size() / 2;
+                writer.push_samples(data_array.samples.data(), half);
+                writer.push_samples(data_array.samples.data() + half, data_array.samples.size() - half);
+                writer.end_array();
+            }
+            writer.finish();
+
+            THEN("the file is the same as the one written in one go") {
+                std::ifstream file { citi_write_file_path };
+                const std::string contents {
+                    std::istreambuf_iterator<char>(file),
+                    std::istreambuf_iterator<char>()
+                };
+                std::ifstream expected_file { expected_file_path };
+                const std::string expected {
+                    std::istreambuf_iterator<char>(expected_file),
+                    std::istreambuf_iterator<char>()
+                };
+                REQUIRE(contents == expected);
+            }
+
+            fs::remove(citi_write_file_path);
+            fs::remove(expected_file_path);
+        }
+
+        WHEN("a record writer is called out of order") {
+            const auto citi_write_file_path = fs::current_path() / "tests" / "temp_test_file_out_of_order.cti";
+            RecordWriter writer { citi_write_file_path };
+
+            THEN("the calls throw") {
+                REQUIRE_THROWS_AS(writer.end_array(), Record::RuntimeException);
+                writer.begin(record);
+                REQUIRE_THROWS_AS(writer.begin_array("not declared", "RI"), Record::RuntimeException);
+                REQUIRE_THROWS_AS(writer.finish(), Record::RuntimeException);
+            }
+
+            fs::remove(citi_write_file_path);
+        }
+
         WHEN("the record is written to a file in an async manner") {
             const auto citi_write_file_path1 = fs::current_path() / "tests" / "temp_test_file_acync1.cti";
             std::future<void> f1 = std::async(std::launch::async, [&]{
@@ -71,5 +276,32 @@ SCENARIO("Writing a record to the file system correctly writes the data to the f
     }
 }
 
+SCENARIO("Exporting files to Parquet writes a single file when the build supports it", "[export_parquet]") {
+    GIVEN("two record files") {
+        const auto citi_file_path = fs::current_path() / "tests" / "regression_files" / "list_cal_set.cti";
+        const std::vector<fs::path> filenames { citi_file_path, citi_file_path };
+        const auto parquet_file_path = fs::current_path() / "tests" / "temp_test_file.parquet";
+
+        WHEN("the files are exported") {
+            bool supported = true;
+            try {
+                export_parquet(filenames, parquet_file_path);
+            } catch (const Record::RuntimeException& e) {
+                supported = false;
+                REQUIRE(std::string { e.what() }.find("columnar support") != std::string::npos);
+            }
 
+            THEN("a Parquet file is written, or nothing without the columnar feature") {
+                REQUIRE(fs::exists(parquet_file_path) == supported);
+                if (supported) {
+                    std::ifstream file { parquet_file_path, std::ios::binary };
+                    char magic[4] = {};
+                    file.read(magic, 4);
+                    REQUIRE(std::string(magic, 4) == "PAR1");
+                }
+            }
 
+            fs::remove(parquet_file_path);
+        }
+    }
+}
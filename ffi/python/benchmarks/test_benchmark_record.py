@@ -0,0 +1,93 @@
+'''Benchmarks of the Python binding on generated records
+
+Run with `pytest ffi/python/benchmarks`. Each benchmark also reports its
+throughput in MB/s and samples/s as extra info.
+'''
+import os
+
+import numpy as np
+import pytest
+from citi import Record
+
+
+POINTS = (1_000, 100_000, 1_000_000)
+ARRAYS = (1, 16)
+
+
+def generate_record(points: int, arrays: int) -> Record:
+    '''Record with samples from a fixed pseudo-random sequence'''
+    generator = np.random.default_rng(0)
+    record = Record()
+    record.version = 'A.01.00'
+    record.name = 'BENCH'
+    record.set_independent_variable(
+        'FREQ', 'MAG', np.linspace(1e9, 1e10, points)
+    )
+    for i in range(arrays):
+        samples = generator.uniform(-100, 100, (points, 2)) @ [1, 1j]
+        record.append_data_array(f'S{i}', 'RI', samples)
+    return record
+
+
+def report_throughput(benchmark, size: int, samples: int):
+    benchmark.extra_info['bytes'] = size
+    benchmark.extra_info['samples'] = samples
+    # Nothing is timed with --benchmark-disable
+    if benchmark.stats:
+        mean = benchmark.stats.stats.mean
+        benchmark.extra_info['MB/s'] = size / mean / 1e6
+        benchmark.extra_info['samples/s'] = samples / mean
+
+
+@pytest.fixture(scope='module', params=[
+    (points, arrays) for points in POINTS for arrays in ARRAYS
+], ids=lambda shape: f'{shape[0]}x{shape[1]}')
+def generated_file(request, tmp_path_factory):
+    points, arrays = request.param
+    filename = str(tmp_path_factory.mktemp('citi') / 'record.cti')
+    generate_record(points, arrays).write(filename)
+    return filename, points, arrays
+
+
+def test_read(benchmark, generated_file):
+    filename, points, arrays = generated_file
+    benchmark(Record, filename)
+    report_throughput(benchmark, os.path.getsize(filename), points * arrays)
+
+
+def test_read_mmap(benchmark, generated_file):
+    filename, points, arrays = generated_file
+    benchmark(Record, filename, mmap=True)
+    report_throughput(benchmark, os.path.getsize(filename), points * arrays)
+
+
+def test_data(benchmark, generated_file):
+    '''Samples copied out as lists of `complex`'''
+    filename, points, arrays = generated_file
+    record = Record(filename)
+    benchmark(lambda: record.data)
+    report_throughput(benchmark, os.path.getsize(filename), points * arrays)
+
+
+def test_data_array(benchmark, generated_file):
+    '''Samples borrowed as NumPy arrays'''
+    filename, points, arrays = generated_file
+    record = Record(filename)
+    benchmark(lambda: [record.data_array(i) for i in range(arrays)])
+    report_throughput(benchmark, os.path.getsize(filename), points * arrays)
+
+
+@pytest.mark.parametrize('points', POINTS)
+def test_append_data_array(benchmark, points):
+    generator = np.random.default_rng(0)
+    samples = generator.uniform(-100, 100, (points, 2)) @ [1, 1j]
+    benchmark(lambda: Record().append_data_array('S', 'RI', samples))
+    report_throughput(benchmark, samples.nbytes, points)
+
+
+@pytest.mark.parametrize('points', POINTS)
+def test_write(benchmark, points, tmp_path):
+    record = generate_record(points, 1)
+    filename = str(tmp_path / 'record.cti')
+    benchmark(record.write, filename)
+    report_throughput(benchmark, os.path.getsize(filename), points)
@@ -8,15 +8,23 @@ and access that data through functions defined in Rust.
 The dynamic library is automatically loaded upon import. A
 ModuleNotFoundError is thrown if the dynamic library cannot
 be found.
+
+Sample data is handed out as NumPy arrays that borrow the Rust buffers
+directly, see `Record.data_array` and `Record.independent_variable_array`.
 '''
 
 import ctypes
 import glob
 import os
+import struct
 import sys
-from ctypes import c_char_p, Structure, POINTER, c_size_t, c_double, c_int
+import weakref
+from ctypes import c_char_p, c_void_p, Structure, POINTER, c_size_t, \
+    c_double, c_int
 from pathlib import Path
-from typing import List, Union, Optional
+from typing import List, NamedTuple, Tuple, Union, Optional
+
+import numpy as np
 
 
 def __get_library_name() -> str:
@@ -84,6 +92,50 @@ CITI_LIB.record_default.restype = POINTER(FFIRecord)
 CITI_LIB.record_read.argtypes = (c_char_p,)
 CITI_LIB.record_read.restype = POINTER(FFIRecord)
 
+# record_read_mmap
+CITI_LIB.record_read_mmap.argtypes = (c_char_p,)
+CITI_LIB.record_read_mmap.restype = POINTER(FFIRecord)
+
+# record_read_with_options
+CITI_LIB.record_read_with_options.argtypes = (
+    c_char_p, c_int, POINTER(c_char_p), c_size_t
+)
+CITI_LIB.record_read_with_options.restype = POINTER(FFIRecord)
+
+# record_read_binary
+CITI_LIB.record_read_binary.argtypes = (c_char_p,)
+CITI_LIB.record_read_binary.restype = POINTER(FFIRecord)
+
+# record_read_cached
+CITI_LIB.record_read_cached.argtypes = (c_char_p,)
+CITI_LIB.record_read_cached.restype = POINTER(FFIRecord)
+
+# record_read_many
+CITI_LIB.record_read_many.argtypes = (
+    POINTER(c_char_p), c_size_t, c_size_t, POINTER(POINTER(FFIRecord)),
+    POINTER(c_int)
+)
+CITI_LIB.record_read_many.restype = c_int
+
+# record_export_parquet
+CITI_LIB.record_export_parquet.argtypes = (
+    POINTER(c_char_p), c_size_t, c_char_p, c_int
+)
+CITI_LIB.record_export_parquet.restype = c_int
+
+# record_write
+CITI_LIB.record_write.argtypes = (POINTER(FFIRecord), c_char_p)
+CITI_LIB.record_write.restype = c_int
+
+# record_write_with_options
+CITI_LIB.record_write_with_options.argtypes = \
+    (POINTER(FFIRecord), c_char_p, c_size_t, c_size_t, c_int)
+CITI_LIB.record_write_with_options.restype = c_int
+
+# record_write_binary
+CITI_LIB.record_write_binary.argtypes = (POINTER(FFIRecord), c_char_p)
+CITI_LIB.record_write_binary.restype = c_int
+
 # record_destroy
 CITI_LIB.record_destroy.argtypes = (POINTER(FFIRecord),)
 CITI_LIB.record_destroy.restype = None
@@ -164,11 +216,132 @@ CITI_LIB.record_get_data_array_format.restype = c_char_p
 CITI_LIB.record_get_data_array_length.argtypes = (POINTER(FFIRecord), c_size_t)
 CITI_LIB.record_get_data_array_length.restype = c_size_t
 
+# record_set_independent_variable
+CITI_LIB.record_set_independent_variable.argtypes = \
+    (POINTER(FFIRecord), c_char_p, c_char_p, POINTER(c_double), c_size_t)
+CITI_LIB.record_set_independent_variable.restype = c_int
+
 # record_get_data_array
 CITI_LIB.record_get_data_array.argtypes = \
     (POINTER(FFIRecord), c_size_t, POINTER(c_double), POINTER(c_double))
 CITI_LIB.record_get_data_array.restype = None
 
+# record_get_data_array_ptr
+CITI_LIB.record_get_data_array_ptr.argtypes = (POINTER(FFIRecord), c_size_t)
+CITI_LIB.record_get_data_array_ptr.restype = c_void_p
+
+# record_append_data_array
+CITI_LIB.record_append_data_array.argtypes = (
+    POINTER(FFIRecord), c_char_p, c_char_p,
+    POINTER(c_double), POINTER(c_double), c_size_t
+)
+CITI_LIB.record_append_data_array.restype = c_int
+
+# record_append_data_array_interleaved
+CITI_LIB.record_append_data_array_interleaved.argtypes = (
+    POINTER(FFIRecord), c_char_p, c_char_p, POINTER(c_double), c_size_t
+)
+CITI_LIB.record_append_data_array_interleaved.restype = c_int
+
+# record_convert_data_array
+CITI_LIB.record_convert_data_array.argtypes = \
+    (POINTER(FFIRecord), c_size_t, c_char_p)
+CITI_LIB.record_convert_data_array.restype = c_int
+
+# record_convert_data_arrays
+CITI_LIB.record_convert_data_arrays.argtypes = \
+    (POINTER(FFIRecord), c_char_p, c_size_t)
+CITI_LIB.record_convert_data_arrays.restype = c_int
+
+# record_get_header_snapshot
+CITI_LIB.record_get_header_snapshot.argtypes = \
+    (POINTER(FFIRecord), POINTER(c_size_t))
+CITI_LIB.record_get_header_snapshot.restype = c_void_p
+
+
+class _SnapshotReader():
+    '''Walks the table filled in by `record_get_header_snapshot`
+
+    Counts and lengths are native-endian 64-bit unsigned integers and
+    each string is its byte length followed by that many UTF-8 bytes.
+    '''
+
+    def __init__(self, table: bytes):
+        self.__table = table
+        self.__offset = 0
+
+    def count(self) -> int:
+        (count,) = struct.unpack_from('=Q', self.__table, self.__offset)
+        self.__offset += 8
+        return count
+
+    def string(self) -> str:
+        length = self.count()
+        start = self.__offset
+        self.__offset += length
+        return self.__table[start:self.__offset].decode('utf-8')
+
+    def strings(self) -> List[str]:
+        return [self.string() for _ in range(self.count())]
+
+
+class _HeaderSnapshot(NamedTuple):
+    '''Everything in a header snapshot, in order'''
+    version: str
+    name: str
+    comments: List[str]
+    devices: List[Tuple[str, List[str]]]
+    constants: List[Tuple[str, str]]
+    independent_variable_name: str
+    independent_variable_format: str
+    independent_variable_length: int
+    data_arrays: List[Tuple[str, str, int]]
+
+    @staticmethod
+    def read(table: bytes) -> '_HeaderSnapshot':
+        reader = _SnapshotReader(table)
+        version = reader.string()
+        name = reader.string()
+        comments = reader.strings()
+        devices = [
+            (reader.string(), reader.strings())
+            for _ in range(reader.count())
+        ]
+        constants = [
+            (reader.string(), reader.string())
+            for _ in range(reader.count())
+        ]
+        var_name = reader.string()
+        var_format = reader.string()
+        var_length = reader.count()
+        data_arrays = [
+            (reader.string(), reader.string(), reader.count())
+            for _ in range(reader.count())
+        ]
+        return _HeaderSnapshot(
+            version, name, comments, devices, constants,
+            var_name, var_format, var_length, data_arrays
+        )
+
+
+class _BorrowedArray():
+    '''Memory owned by a record, exposed through `__array_interface__`
+
+    NumPy keeps this object as the `base` of the array made from it, and
+    this object keeps the record alive, so the memory outlives the array.
+    The memory is read-only from Python.
+    '''
+
+    def __init__(self, record: 'Record', address: int, length: int,
+                 dtype: np.dtype):
+        self.__record = record
+        self.__array_interface__ = {
+            'version': 3,
+            'shape': (length,),
+            'typestr': dtype.str,
+            'data': (address, True),
+        }
+
 
 class Record():
     """Representation of a CITI file
@@ -176,10 +349,56 @@ class Record():
     This is a C ABI FFI into an implementation written in Rust.
     """
 
-    def __init__(self, filename: Optional[str] = None):
+    def __init__(self, filename: Optional[str] = None, mmap: bool = False,
+                 header_only: bool = False,
+                 data_arrays: Optional[List[str]] = None,
+                 binary: bool = False, cached: bool = False):
+        """Create a default record or read one from `filename`
+
+        With `mmap` set, the file is memory mapped and parsed directly
+        from the mapped bytes instead of being read through a buffer.
+
+        With `header_only` set, reading stops at the first data block and
+        every data array is left without samples. When `data_arrays` is
+        not empty, only the data arrays with those names are read and the
+        others are left out.
+
+        With `binary` set, the file is one written by `write_binary`. With
+        `cached` set, a binary copy of the record is kept next to the file,
+        with `.bin` appended to its name, and read instead while the size
+        and modification time of the file do not change.
+
+        Only one way of reading can be chosen.
+        """
+        partial = header_only or data_arrays is not None
+        if sum((mmap, partial, binary, cached)) > 1:
+            raise ValueError(
+                'Only one of mmap, header_only or data_arrays, binary and '
+                'cached can be used'
+            )
+
+        self.__independent_variable_arrays = weakref.WeakSet()
+
         # Get pointer to object
         if filename is None:
             self.__obj = CITI_LIB.record_default()
+        elif partial:
+            if not data_arrays:
+                names = None
+            else:
+                names = (c_char_p * len(data_arrays))(
+                    *[name.encode('utf-8') for name in data_arrays]
+                )
+            self.__obj = CITI_LIB.record_read_with_options(
+                filename.encode('utf-8'), int(header_only), names,
+                len(data_arrays) if data_arrays else 0
+            )
+        elif binary:
+            self.__obj = CITI_LIB.record_read_binary(filename.encode('utf-8'))
+        elif cached:
+            self.__obj = CITI_LIB.record_read_cached(filename.encode('utf-8'))
+        elif mmap:
+            self.__obj = CITI_LIB.record_read_mmap(filename.encode('utf-8'))
         else:
             self.__obj = CITI_LIB.record_read(filename.encode('utf-8'))
 
@@ -192,6 +411,67 @@ class Record():
             else:
                 raise NotImplementedError('A null pointer was returned')
 
+    @staticmethod
+    def read_many(filenames: List[str], threads: int = 0) \
+            -> List[Union['Record', NotImplementedError]]:
+        """Read many files on a pool of threads
+
+        Each file is read as with `mmap` set by one of up to `threads`
+        workers, where 0 uses one thread per available core.
+
+        The results are in the same order as `filenames`. A file that
+        cannot be read does not stop the others from being read, and its
+        result is the exception that reading it alone would have raised.
+        """
+        count = len(filenames)
+        names = (c_char_p * count)(
+            *[filename.encode('utf-8') for filename in filenames]
+        )
+        pointers = (POINTER(FFIRecord) * count)()
+        error_codes = (c_int * count)()
+        CITI_LIB.record_read_many(
+            names, count, threads, pointers, error_codes
+        )
+
+        results: List[Union[Record, NotImplementedError]] = []
+        for pointer, error_code in zip(pointers, error_codes):
+            if pointer:
+                record = Record.__new__(Record)
+                record.__obj = pointer
+                record.__independent_variable_arrays = weakref.WeakSet()
+                results.append(record)
+            else:
+                results.append(NotImplementedError(
+                    CITI_LIB.get_error_description(error_code).decode('utf-8')
+                ))
+        return results
+
+    @staticmethod
+    def export_parquet(filenames: List[str], output: str,
+                       struct_samples: bool = False):
+        """Export many files into a single Parquet file
+
+        The files are read one at a time, so memory does not grow with
+        their number, and written to `output` with a row per value of the
+        independent variable of each file. Header values are columns of
+        their own, and the samples of each data array are `_re` and `_im`
+        columns, or structs of `re` and `im` when `struct_samples` is set.
+
+        The library must be built with the `columnar` cargo feature, see
+        `CITI_FEATURES`.
+        """
+        count = len(filenames)
+        names = (c_char_p * count)(
+            *[filename.encode('utf-8') for filename in filenames]
+        )
+        error_code = CITI_LIB.record_export_parquet(
+            names, count, output.encode('utf-8'), int(struct_samples)
+        )
+        if error_code != 0:
+            raise NotImplementedError(
+                CITI_LIB.get_error_description(error_code).decode('utf-8')
+            )
+
     def __del__(self):
         # Can free null
         CITI_LIB.record_destroy(self.__obj)
@@ -202,6 +482,68 @@ class Record():
     def get_error_description(self, error_code: int) -> str:
         return CITI_LIB.get_error_description(error_code).decode("utf-8")
 
+    def write(self, filename: str, significant_digits: int = 0,
+              threads: int = 1, segments: bool = False):
+        '''Write the record to a file
+
+        A `significant_digits` of 0 writes the shortest digits that read
+        back to the same value, otherwise the data pairs are written in
+        E notation with that many digits.
+
+        The data pairs are formatted by `threads` workers, where 0 uses one
+        per available core. The file is the same whatever the number of
+        workers.
+
+        With `segments` set, an independent variable that is one linear sweep
+        is written as a `SEG_LIST` instead of a `VAR_LIST`. A `SEG_LIST` read
+        from a file is written back as it was either way.
+        '''
+        error_code = CITI_LIB.record_write_with_options(
+            self.__obj, filename.encode('utf-8'),
+            ctypes.c_size_t(significant_digits), ctypes.c_size_t(threads),
+            int(segments)
+        )
+        if error_code != 0:
+            raise NotImplementedError(self.get_error_description(error_code))
+
+    def write_binary(self, filename: str):
+        '''Write the record to a file in the binary format
+
+        The file is read back with `Record(filename, binary=True)`, which
+        copies the floats out without parsing them. Unlike `write`, any
+        record can be written.
+        '''
+        error_code = CITI_LIB.record_write_binary(
+            self.__obj, filename.encode('utf-8')
+        )
+        if error_code != 0:
+            raise NotImplementedError(self.get_error_description(error_code))
+
+    def __raise_last_error(self):
+        raise NotImplementedError(
+            self.get_error_description(self.last_error_code())
+        )
+
+    def __borrow(self, address: Optional[int], length: int,
+                 dtype: np.dtype) -> np.ndarray:
+        '''Wrap memory owned by the record without copying it'''
+        if length == 0:
+            # Rust hands out a dangling, non-null pointer for empty arrays
+            return np.empty(0, dtype=dtype)
+        return np.asarray(_BorrowedArray(self, address, length, dtype))
+
+    def __header_snapshot(self) -> _HeaderSnapshot:
+        '''Get the whole header in a single FFI call'''
+        length = c_size_t(0)
+        table = CITI_LIB.record_get_header_snapshot(
+            self.__obj, ctypes.byref(length)
+        )
+        if not table:
+            raise NotImplementedError(
+                self.get_error_description(self.last_error_code())
+            )
+        return _HeaderSnapshot.read(ctypes.string_at(table, length.value))
+
     @property
     def version(self) -> str:
         '''Get the version string'''
@@ -225,39 +567,21 @@ class Record():
     @property
     def comments(self) -> List[str]:
         '''Get the comments'''
-        comments = []
-
-        for i in range(CITI_LIB.record_get_number_of_comments(self.__obj)):
-            comments.append(
-                CITI_LIB.record_get_comment(
-                    self.__obj, ctypes.c_size_t(i)
-                ).decode('utf-8')
-            )
-
-        return comments
+        return self.__header_snapshot().comments
 
     @property
     def devices(self) -> List[Union[str, List[str]]]:
         '''Get the devices'''
-        devices = []
-
-        for d in range(CITI_LIB.record_get_number_of_devices(self.__obj)):
-            name = CITI_LIB.record_get_device_name(
-                self.__obj, ctypes.c_size_t(d)
-            ).decode('utf-8')
-
-            entries = []
-            for e in range(CITI_LIB.record_get_device_number_of_entries(
-                    self.__obj, ctypes.c_size_t(d))):
-                entries.append(
-                    CITI_LIB.record_get_device_entry(
-                        self.__obj, ctypes.c_size_t(d), ctypes.c_size_t(e)
-                    ).decode('utf-8')
-                )
+        return self.__header_snapshot().devices
 
-            devices.append((name, entries))
+    @property
+    def constants(self) -> List[Tuple[str, str]]:
+        '''Get the constants
 
-        return devices
+        A list of tuples is returned that are formatted:
+            [(Name: str, Value: str)]
+        '''
+        return self.__header_snapshot().constants
 
     @property
     def independent_variable(self) -> Union[str, str, List[float]]:
@@ -266,18 +590,52 @@ class Record():
         A tuple is returned that is formatted:
             (Name: str, Format: str, independent_variable: List[float])
         '''
-        name = CITI_LIB.record_get_independent_variable_name(self.__obj)\
-            .decode('utf-8')
-        format = CITI_LIB.record_get_independent_variable_format(self.__obj)\
-            .decode('utf-8')
-        len = CITI_LIB.record_get_independent_variable_length(self.__obj)
+        snapshot = self.__header_snapshot()
+        return (
+            snapshot.independent_variable_name,
+            snapshot.independent_variable_format,
+            self.independent_variable_array().tolist()
+        )
+
+    def independent_variable_array(self) -> np.ndarray:
+        '''Get the independent variable values without copying them
+
+        The `float64` array borrows the record's buffer and keeps the record
+        alive. `set_independent_variable` replaces that buffer, so it raises
+        while any such array, or a view of one, is still alive.
+        '''
+        length = CITI_LIB.record_get_independent_variable_length(self.__obj)
         array = CITI_LIB.record_get_independent_variable_array(self.__obj)
-
-        iv = []
-        for i in range(len):
-            iv.append(array[i])
-
-        return (name, format, iv)
+        if not array:
+            self.__raise_last_error()
+        if length == 0:
+            return np.empty(0, dtype=np.float64)
+        borrowed = _BorrowedArray(
+            self, ctypes.cast(array, c_void_p).value, length,
+            np.dtype(np.float64)
+        )
+        self.__independent_variable_arrays.add(borrowed)
+        return np.asarray(borrowed)
+
+    def set_independent_variable(self, name: str, format: str,
+                                 values: Union[np.ndarray, List[float]]):
+        '''Set the independent variable from any `float64` array-like
+
+        A `ValueError` is raised while an array from
+        `independent_variable_array` is alive, as it borrows the buffer
+        that is replaced.
+        '''
+        if len(self.__independent_variable_arrays) > 0:
+            raise ValueError(
+                'The independent variable is borrowed by a live array'
+            )
+        values = np.ascontiguousarray(values, dtype=np.float64)
+        error_code = CITI_LIB.record_set_independent_variable(
+            self.__obj, name.encode('utf-8'), format.encode('utf-8'),
+            values.ctypes.data_as(POINTER(c_double)), len(values)
+        )
+        if error_code != 0:
+            raise NotImplementedError(self.get_error_description(error_code))
 
     @property
     def data(self) -> List[Union[str, str, List[complex]]]:
@@ -286,30 +644,61 @@ class Record():
         A list of tuples is returned that are formatted:
             [(Name: str, Format: str, independent_variable: List[Complex])]
         '''
-        data = []
-        for i in range(CITI_LIB.record_get_number_of_data_arrays(self.__obj)):
-            # Read names
-            name = CITI_LIB.record_get_data_array_name(
-                self.__obj, ctypes.c_size_t(i)
-            ).decode('utf-8')
-
-            format = CITI_LIB.record_get_data_array_format(
-                self.__obj, ctypes.c_size_t(i)
-            ).decode('utf-8')
-
-            # Read arrays
-            data_length = CITI_LIB.record_get_data_array_length(
-                self.__obj, ctypes.c_size_t(i)
-            )
-            array = []
-            real_ptr = (c_double * data_length)()
-            imag_ptr = (c_double * data_length)()
-            CITI_LIB.record_get_data_array(
-                self.__obj, ctypes.c_size_t(i), real_ptr, imag_ptr
-            )
-            for d in range(data_length):
-                array.append(complex(real_ptr[d], imag_ptr[d]))
+        data_arrays = self.__header_snapshot().data_arrays
+        return [
+            (name, format, self.data_array(i).tolist())
+            for i, (name, format, _) in enumerate(data_arrays)
+        ]
 
-            data.append((name, format, array))
+    def data_array(self, idx: int) -> np.ndarray:
+        '''Get the samples of a data array without copying them
 
-        return data
+        The `complex128` array borrows the record's buffer and keeps the
+        record alive.
+        '''
+        address = CITI_LIB.record_get_data_array_ptr(
+            self.__obj, ctypes.c_size_t(idx)
+        )
+        if not address:
+            self.__raise_last_error()
+        length = CITI_LIB.record_get_data_array_length(
+            self.__obj, ctypes.c_size_t(idx)
+        )
+        return self.__borrow(address, length, np.dtype(np.complex128))
+
+    def append_data_array(self, name: str, format: str,
+                          samples: Union[np.ndarray, List[complex]]):
+        '''Append a data array from any `complex128` array-like'''
+        # `complex128` is laid out as interleaved real and imaginary parts
+        samples = np.ascontiguousarray(samples, dtype=np.complex128)
+        error_code = CITI_LIB.record_append_data_array_interleaved(
+            self.__obj, name.encode('utf-8'), format.encode('utf-8'),
+            samples.ctypes.data_as(POINTER(c_double)), len(samples)
+        )
+        if error_code != 0:
+            raise NotImplementedError(self.get_error_description(error_code))
+
+    def convert_data_array(self, idx: int, format: str):
+        '''Convert the samples of a data array to `format` in place
+
+        `format` is one of `RI`, `MA` or `DB`, as is the current format of
+        the data array, which is changed to match. Angles are in degrees.
+        '''
+        error_code = CITI_LIB.record_convert_data_array(
+            self.__obj, ctypes.c_size_t(idx), format.encode('utf-8')
+        )
+        if error_code != 0:
+            raise NotImplementedError(self.get_error_description(error_code))
+
+    def convert_data(self, format: str, threads: int = 0):
+        '''Convert every data array to `format` in place
+
+        The data arrays are spread over up to `threads` threads, where 0
+        uses one thread per available core. Either all of them are
+        converted or none is.
+        '''
+        error_code = CITI_LIB.record_convert_data_arrays(
+            self.__obj, format.encode('utf-8'), threads
+        )
+        if error_code != 0:
+            raise NotImplementedError(self.get_error_description(error_code))
@@ -0,0 +1,55 @@
+import unittest
+import os
+import tempfile
+from pathlib import Path
+from citi import Record
+
+
+class TestBinaryRecord(unittest.TestCase):
+
+    @staticmethod
+    def __get_data_filename() -> str:
+        relative_path = os.path.join('.', '..', '..', '..')
+        this_dir = os.path.dirname(Path(__file__).absolute())
+        absolute_path = os.path.join('tests', 'regression_files')
+        filename = 'data_file.cti'
+        return os.path.join(
+            this_dir, relative_path, absolute_path, filename
+        )
+
+    def setUp(self):
+        self.record = Record(self.__get_data_filename())
+        self.directory = tempfile.TemporaryDirectory()
+        self.filename = os.path.join(self.directory.name, 'temp.cti')
+
+    def tearDown(self):
+        self.directory.cleanup()
+
+    def test_round_trip(self):
+        self.record.write_binary(self.filename)
+        record = Record(self.filename, binary=True)
+        self.assertEqual(record.name, self.record.name)
+        self.assertEqual(record.independent_variable,
+                         self.record.independent_variable)
+        self.assertEqual(record.data, self.record.data)
+
+    def test_cached(self):
+        self.record.write(self.filename)
+        first = Record(self.filename, cached=True)
+        self.assertTrue(os.path.exists(self.filename + '.bin'))
+        second = Record(self.filename, cached=True)
+        self.assertEqual(first.data, self.record.data)
+        self.assertEqual(second.data, self.record.data)
+
+    def test_text_file_is_invalid(self):
+        with self.assertRaises(NotImplementedError) as e:
+            Record(self.__get_data_filename(), binary=True)
+
+        self.assertEqual(
+            str(e.exception),
+            'Record read error due to an invalid binary record'
+        )
+
+    def test_one_way_of_reading(self):
+        with self.assertRaises(ValueError):
+            Record(self.__get_data_filename(), mmap=True, cached=True)
@@ -17,7 +17,7 @@ class TestErrorCodes(unittest.TestCase):
         self.runner(1, 'Invalid error code')
 
     def test_non_existant_last_error_code(self):
-        self.runner(-42, 'Invalid error code')
+        self.runner(-57, 'Invalid error code')
 
     def test_no_error(self):
         self.runner(0, 'No error')
@@ -169,3 +169,111 @@ class TestErrorCodes(unittest.TestCase):
 
     def test_index_out_of_bounds(self):
         self.runner(-41, 'Index is outside of acceptable bounds')
+
+    def test_record_read_error_stale_index(self):
+        self.runner(
+            -42,
+            'Record read error due to a block index that does not match '
+            'its file'
+        )
+
+    def test_record_read_error_invalid_binary(self):
+        self.runner(
+            -43,
+            'Record read error due to an invalid binary record'
+        )
+
+    def test_record_read_error_parser_failed(self):
+        self.runner(
+            -44,
+            'Record read error due to a parser that already failed'
+        )
+
+    def test_record_write_error_out_of_order(self):
+        self.runner(-45, 'Record write error due to a call out of order')
+
+    def test_record_write_error_undeclared_data_array(self):
+        self.runner(
+            -46,
+            'Record write error due to a data array that does not match '
+            'its declaration'
+        )
+
+    def test_record_write_error_missing_data_array(self):
+        self.runner(
+            -47,
+            'Record write error due to a declared data array that was not '
+            'written'
+        )
+
+    def test_record_convert_error_unsupported_format(self):
+        self.runner(
+            -48,
+            'Data conversion error due to an unsupported format'
+        )
+
+    def test_name_not_found(self):
+        self.runner(
+            -49,
+            'No entry with the given name was found'
+        )
+
+    def test_record_read_error_unsupported_compression(self):
+        self.runner(
+            -50,
+            'Record read error due to a compression this build does not '
+            'support'
+        )
+
+    def test_record_write_error_unsupported_compression(self):
+        self.runner(
+            -51,
+            'Record write error due to a compression this build does not '
+            'support'
+        )
+
+    def test_record_columnar_error_unsupported(self):
+        self.runner(
+            -52,
+            'Record export error due to a build without columnar support'
+        )
+
+    def test_record_columnar_error_no_records(self):
+        self.runner(
+            -53,
+            'Record export error due to no records to export'
+        )
+
+    def test_record_columnar_error_schema_mismatch(self):
+        self.runner(
+            -54,
+            'Record export error due to a record without the columns of '
+            'the first record'
+        )
+
+    def test_record_columnar_error_ragged_data_array(self):
+        self.runner(
+            -55,
+            'Record export error due to a data array without one sample '
+            'per independent variable value'
+        )
+
+    def test_record_columnar_error_arrow(self):
+        self.runner(
+            -56,
+            'Record export error from Arrow or Parquet'
+        )
+
+    def test_record_read_error_line_too_long(self):
+        self.runner(
+            -57,
+            'Record read error due to a line longer than the parser holds '
+            'back'
+        )
+
+    def test_record_read_error_segments_too_long(self):
+        self.runner(
+            -58,
+            'Record read error due to segments with more values than '
+            'accepted'
+        )
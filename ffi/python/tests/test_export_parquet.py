@@ -0,0 +1,53 @@
+import unittest
+import os
+import tempfile
+from pathlib import Path
+from citi import Record
+
+
+UNSUPPORTED = 'Record export error due to a build without columnar support'
+
+
+class TestExportParquet(unittest.TestCase):
+
+    @staticmethod
+    def __get_filename(filename: str) -> str:
+        relative_path = os.path.join('.', '..', '..', '..')
+        this_dir = os.path.dirname(Path(__file__).absolute())
+        absolute_path = os.path.join('tests', 'regression_files')
+        return os.path.join(
+            this_dir, relative_path, absolute_path, filename
+        )
+
+    def setUp(self):
+        self.directory = tempfile.TemporaryDirectory()
+        self.output = os.path.join(self.directory.name, 'records.parquet')
+        self.filenames = [
+            self.__get_filename('list_cal_set.cti'),
+            self.__get_filename('list_cal_set.cti'),
+        ]
+
+    def tearDown(self):
+        self.directory.cleanup()
+
+    def export(self, filenames, **kwargs):
+        try:
+            Record.export_parquet(filenames, self.output, **kwargs)
+        except NotImplementedError as error:
+            if str(error) != UNSUPPORTED:
+                raise
+            self.assertFalse(os.path.exists(self.output))
+            self.skipTest('built without the columnar feature')
+
+    def test_export(self):
+        self.export(self.filenames)
+        with open(self.output, 'rb') as file:
+            self.assertEqual(file.read(4), b'PAR1')
+
+    def test_struct_samples(self):
+        self.export(self.filenames, struct_samples=True)
+        self.assertTrue(os.path.exists(self.output))
+
+    def test_missing_file(self):
+        with self.assertRaises(NotImplementedError):
+            self.export([self.__get_filename('does_not_exist.cti')])
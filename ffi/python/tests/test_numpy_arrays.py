@@ -0,0 +1,112 @@
+import gc
+import unittest
+import os
+from pathlib import Path
+from citi import Record
+import numpy.testing as npt
+import numpy as np
+
+
+class TestNumpyArrays(unittest.TestCase):
+
+    @staticmethod
+    def __get_data_filename() -> str:
+        relative_path = os.path.join('.', '..', '..', '..')
+        this_dir = os.path.dirname(Path(__file__).absolute())
+        absolute_path = os.path.join('tests', 'regression_files')
+        filename = 'data_file.cti'
+        return os.path.join(
+            this_dir, relative_path, absolute_path, filename
+        )
+
+    def setUp(self):
+        self.record = Record(self.__get_data_filename())
+
+    def test_data_array(self):
+        array = self.record.data_array(0)
+        self.assertEqual(array.dtype, np.complex128)
+        self.assertEqual(len(array), 10)
+        npt.assert_array_almost_equal(array, self.record.data[0][2])
+
+    def test_data_array_is_read_only(self):
+        self.assertFalse(self.record.data_array(0).flags.writeable)
+
+    def test_data_array_keeps_record_alive(self):
+        array = self.record.data_array(0)
+        expected = array.tolist()
+        del self.record
+        gc.collect()
+        npt.assert_array_almost_equal(array, expected)
+
+    def test_data_array_out_of_bounds(self):
+        with self.assertRaises(NotImplementedError) as e:
+            self.record.data_array(1)
+
+        self.assertEqual(
+            str(e.exception), 'Index is outside of acceptable bounds'
+        )
+
+    def test_independent_variable_array(self):
+        array = self.record.independent_variable_array()
+        self.assertEqual(array.dtype, np.float64)
+        npt.assert_array_almost_equal(
+            array, np.linspace(1000000000., 4000000000., 10)
+        )
+
+    def test_empty_independent_variable_array(self):
+        self.assertEqual(len(Record().independent_variable_array()), 0)
+
+    def test_set_independent_variable(self):
+        record = Record()
+        record.set_independent_variable(
+            'FREQ', 'MAG', np.asarray([1., 2., 3.], dtype=np.float64)
+        )
+        self.assertEqual(record.independent_variable, (
+            'FREQ', 'MAG', [1., 2., 3.]
+        ))
+
+    def test_set_independent_variable_while_borrowed(self):
+        array = self.record.independent_variable_array()
+        view = array[2:]
+        del array
+        gc.collect()
+        with self.assertRaises(ValueError):
+            self.record.set_independent_variable('FREQ', 'MAG', [1., 2.])
+        npt.assert_array_almost_equal(
+            view, np.linspace(1000000000., 4000000000., 10)[2:]
+        )
+
+        del view
+        gc.collect()
+        self.record.set_independent_variable('FREQ', 'MAG', [1., 2.])
+        npt.assert_array_almost_equal(
+            self.record.independent_variable_array(), [1., 2.]
+        )
+
+    def test_append_data_array(self):
+        record = Record()
+        samples = np.asarray([1 + 2j, 3 - 4j], dtype=np.complex128)
+        record.append_data_array('S[1,1]', 'RI', samples)
+        self.assertEqual(record.data, [('S[1,1]', 'RI', [1 + 2j, 3 - 4j])])
+        npt.assert_array_almost_equal(record.data_array(0), samples)
+
+    def test_convert_data(self):
+        record = Record()
+        record.append_data_array('S[1,1]', 'RI', [3 + 4j, 10j])
+        record.convert_data('DB')
+        name, format, samples = record.data[0]
+        self.assertEqual(format, 'DB')
+        self.assertAlmostEqual(samples[0].real, 13.979400086720377)
+        self.assertAlmostEqual(samples[1], 20 + 90j)
+
+        record.convert_data_array(0, 'RI')
+        npt.assert_array_almost_equal(record.data_array(0), [3 + 4j, 10j])
+
+    def test_convert_data_unsupported_format(self):
+        with self.assertRaises(NotImplementedError) as e:
+            self.record.convert_data_array(0, 'XY')
+
+        self.assertEqual(
+            str(e.exception),
+            'Data conversion error due to an unsupported format'
+        )
@@ -33,6 +33,9 @@ class TestReadDataRecord(unittest.TestCase):
     def test_comments(self):
         self.assertEqual(len(self.record.comments), 0)
 
+    def test_constants(self):
+        self.assertEqual(self.record.constants, [])
+
     def test_devices(self):
         self.assertEqual(len(self.record.devices), 1)
         self.assertEqual(self.record.devices, [(
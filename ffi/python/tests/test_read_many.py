@@ -0,0 +1,41 @@
+import unittest
+import os
+from pathlib import Path
+from citi import Record
+
+
+class TestReadMany(unittest.TestCase):
+
+    @staticmethod
+    def __get_filename(filename: str) -> str:
+        relative_path = os.path.join('.', '..', '..', '..')
+        this_dir = os.path.dirname(Path(__file__).absolute())
+        absolute_path = os.path.join('tests', 'regression_files')
+        return os.path.join(
+            this_dir, relative_path, absolute_path, filename
+        )
+
+    def setUp(self):
+        self.filenames = [
+            self.__get_filename('data_file.cti'),
+            self.__get_filename('does_not_exist.cti'),
+            self.__get_filename('list_cal_set.cti'),
+        ]
+        self.results = Record.read_many(self.filenames, threads=2)
+
+    def test_in_order(self):
+        self.assertEqual(len(self.results), 3)
+        for i in (0, 2):
+            record = Record(self.filenames[i])
+            self.assertEqual(self.results[i].name, record.name)
+            self.assertEqual(self.results[i].data, record.data)
+
+    def test_missing_file(self):
+        self.assertIsInstance(self.results[1], NotImplementedError)
+        self.assertEqual(
+            str(self.results[1]),
+            'File not found for reading'
+        )
+
+    def test_empty(self):
+        self.assertEqual(Record.read_many([]), [])
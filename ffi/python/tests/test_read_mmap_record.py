@@ -0,0 +1,47 @@
+import unittest
+import os
+from pathlib import Path
+from citi import Record
+import numpy.testing as npt
+
+
+class TestReadMmapRecord(unittest.TestCase):
+
+    @staticmethod
+    def __get_data_filename() -> str:
+        relative_path = os.path.join('.', '..', '..', '..')
+        this_dir = os.path.dirname(Path(__file__).absolute())
+        absolute_path = os.path.join('tests', 'regression_files')
+        filename = 'data_file.cti'
+        return os.path.join(
+            this_dir, relative_path, absolute_path, filename
+        )
+
+    def setUp(self):
+        self.buffered = Record(self.__get_data_filename())
+        self.mapped = Record(self.__get_data_filename(), mmap=True)
+
+    def test_header(self):
+        self.assertEqual(self.mapped.version, self.buffered.version)
+        self.assertEqual(self.mapped.name, self.buffered.name)
+        self.assertEqual(self.mapped.comments, self.buffered.comments)
+        self.assertEqual(self.mapped.devices, self.buffered.devices)
+
+    def test_independent_variable(self):
+        npt.assert_array_equal(
+            self.mapped.independent_variable[2],
+            self.buffered.independent_variable[2]
+        )
+
+    def test_data(self):
+        self.assertEqual(len(self.mapped.data), len(self.buffered.data))
+        for mapped, buffered in zip(self.mapped.data, self.buffered.data):
+            self.assertEqual(mapped[0], buffered[0])
+            self.assertEqual(mapped[1], buffered[1])
+            npt.assert_array_equal(mapped[2], buffered[2])
+
+    def test_cannot_find_file(self):
+        with self.assertRaises(NotImplementedError) as e:
+            Record("filename that does not exist", mmap=True)
+
+        self.assertEqual(str(e.exception), 'File not found for reading')
@@ -0,0 +1,45 @@
+import unittest
+import os
+from pathlib import Path
+from citi import Record
+import numpy.testing as npt
+
+
+class TestReadWithOptions(unittest.TestCase):
+
+    @staticmethod
+    def __get_data_filename() -> str:
+        relative_path = os.path.join('.', '..', '..', '..')
+        this_dir = os.path.dirname(Path(__file__).absolute())
+        absolute_path = os.path.join('tests', 'regression_files')
+        filename = 'list_cal_set.cti'
+        return os.path.join(
+            this_dir, relative_path, absolute_path, filename
+        )
+
+    def setUp(self):
+        self.full = Record(self.__get_data_filename())
+
+    def test_header_only(self):
+        record = Record(self.__get_data_filename(), header_only=True)
+        self.assertEqual(record.name, self.full.name)
+        self.assertEqual(record.devices, self.full.devices)
+        self.assertEqual(len(record.data), len(self.full.data))
+        for data_array in record.data:
+            self.assertEqual(len(data_array[2]), 0)
+
+    def test_selected_data_array(self):
+        record = Record(self.__get_data_filename(), data_arrays=['E[2]'])
+        self.assertEqual(len(record.data), 1)
+        self.assertEqual(record.data[0][0], 'E[2]')
+        npt.assert_array_equal(record.data[0][2], self.full.data[1][2])
+
+    def test_no_data_arrays_selected(self):
+        record = Record(self.__get_data_filename(), data_arrays=[])
+        self.assertEqual(len(record.data), len(self.full.data))
+        for data_array, full_array in zip(record.data, self.full.data):
+            npt.assert_array_equal(data_array[2], full_array[2])
+
+    def test_mmap_is_rejected(self):
+        with self.assertRaises(ValueError):
+            Record(self.__get_data_filename(), mmap=True, header_only=True)
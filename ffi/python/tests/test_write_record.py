@@ -0,0 +1,59 @@
+import unittest
+import os
+import tempfile
+from pathlib import Path
+from citi import Record
+
+
+class TestWriteRecord(unittest.TestCase):
+
+    @staticmethod
+    def __get_data_filename() -> str:
+        relative_path = os.path.join('.', '..', '..', '..')
+        this_dir = os.path.dirname(Path(__file__).absolute())
+        absolute_path = os.path.join('tests', 'regression_files')
+        filename = 'data_file.cti'
+        return os.path.join(
+            this_dir, relative_path, absolute_path, filename
+        )
+
+    def setUp(self):
+        self.record = Record(self.__get_data_filename())
+        self.directory = tempfile.TemporaryDirectory()
+        self.filename = os.path.join(self.directory.name, 'temp.cti')
+
+    def tearDown(self):
+        self.directory.cleanup()
+
+    def test_round_trip(self):
+        self.record.write(self.filename)
+        record = Record(self.filename)
+        self.assertEqual(record.name, self.record.name)
+        self.assertEqual(record.data, self.record.data)
+
+    def test_significant_digits(self):
+        self.record.write(self.filename, significant_digits=6)
+        with open(self.filename) as f:
+            contents = f.read()
+        self.assertIn('\nBEGIN\n8.63030E-2,-8.98651E-1\n', contents)
+
+    def test_threads(self):
+        self.record.write(self.filename)
+        with open(self.filename, 'rb') as f:
+            sequential = f.read()
+        self.record.write(self.filename, threads=0)
+        with open(self.filename, 'rb') as f:
+            self.assertEqual(f.read(), sequential)
+
+    def test_segments(self):
+        self.record.write(self.filename, segments=True)
+        with open(self.filename) as f:
+            contents = f.read()
+        self.assertIn('\nSEG_LIST_BEGIN\nSEG 1E9 4E9 10\nSEG_LIST_END\n', contents)
+        self.assertNotIn('VAR_LIST_BEGIN', contents)
+
+    def test_invalid_record(self):
+        with self.assertRaises(NotImplementedError) as e:
+            Record().write(self.filename)
+
+        self.assertEqual(str(e.exception), 'Record write error due to undefined name')
@@ -9,10 +9,13 @@ setup(
     rust_extensions=[
         RustExtension(
             "citi.citi",
-            binding=Binding.NoBinding
+            binding=Binding.NoBinding,
+            # e.g. `CITI_FEATURES=compression` for gzip and zstd files
+            features=os.environ.get("CITI_FEATURES", "").split(),
         )
     ],
     packages=["citi"],
+    install_requires=["numpy"],
     package_dir={'': os.path.join('ffi', 'python')},
     zip_safe=False,
 )
@@ -0,0 +1,488 @@
+//! Binary encoding of records
+//!
+//! Every integer is a little-endian `u64` unless noted, and every string is
+//! its length followed by its UTF-8 bytes. A record is laid out as:
+//!
+//! | Field                | Contents                                                 |
+//! |----------------------|----------------------------------------------------------|
+//! | Magic                | `CITIBIN\0`                                              |
+//! | Format               | [`VERSION`] as a `u32`, then a zero `u32`                |
+//! | Source               | Length, seconds, `u32` nanoseconds and `u32` flags of the [`Source`] |
+//! | Version, name        | Strings                                                  |
+//! | Comments             | Count, then strings                                      |
+//! | Devices              | Count, then name, entry count and entries for each       |
+//! | Constants            | Count, then name and value for each                      |
+//! | Independent variable | Name, format, count, padding, `f64` values               |
+//! | Data arrays          | Count, then name, format, count, padding and interleaved `f64` real and imaginary parts for each |
+//! | Checksum             | Padding, then [`checksum`] of everything before it       |
+//!
+//! Padding is zeros up to the next multiple of 8 bytes, so the floats of a
+//! buffer that is aligned to 8 bytes, such as a memory map, can be borrowed
+//! in place.
+
+use crate::{Constant, DataArray, Device, Header, Record, Var};
+use num_complex::Complex;
+use std::convert::TryInto;
+use std::time::{Duration, SystemTime};
+
+const MAGIC: &[u8; 8] = b"CITIBIN\0";
+
+/// Format version, bumped on any change to the layout
+pub const VERSION: u32 = 1;
+
+/// Bytes before the version string
+const PREAMBLE_LENGTH: usize = 40;
+
+/// Size and modification time of the file a record was read from
+pub type Source = (u64, Option<SystemTime>);
+
+const SOURCE_KNOWN: u32 = 1;
+const SOURCE_MODIFIED_KNOWN: u32 = 2;
+
+type DecodeResult<T> = std::result::Result<T, &'static str>;
+
+/// FNV-1a over little-endian 64-bit words
+///
+/// Hashing words instead of bytes keeps the checksum to a fraction of the cost
+/// of copying the floats. `bytes` must be a multiple of 8 bytes long.
+pub fn checksum(bytes: &[u8]) -> u64 {
+    bytes
+        .chunks_exact(8)
+        .fold(0xcbf2_9ce4_8422_2325, |hash, word| {
+            (hash ^ u64::from_le_bytes(word.try_into().unwrap())).wrapping_mul(0x0100_0000_01b3)
+        })
+}
+
+fn push_u64(value: u64, bytes: &mut Vec<u8>) {
+    bytes.extend_from_slice(&value.to_le_bytes());
+}
+
+fn push_str(value: &str, bytes: &mut Vec<u8>) {
+    push_u64(value.len() as u64, bytes);
+    bytes.extend_from_slice(value.as_bytes());
+}
+
+fn pad(bytes: &mut Vec<u8>) {
+    let length = (bytes.len() + 7) & !7;
+    bytes.resize(length, 0);
+}
+
+fn push_f64s(values: impl Iterator<Item = f64>, bytes: &mut Vec<u8>) {
+    pad(bytes);
+    for value in values {
+        bytes.extend_from_slice(&value.to_le_bytes());
+    }
+}
+
+fn push_complex(samples: &[Complex<f64>], bytes: &mut Vec<u8>) {
+    pad(bytes);
+    bytes.reserve(samples.len() * 16);
+    for sample in samples {
+        bytes.extend_from_slice(&sample.re.to_le_bytes());
+        bytes.extend_from_slice(&sample.im.to_le_bytes());
+    }
+}
+
+/// Encode `record`, recording the file it was read from
+pub fn encode(record: &Record, source: Option<Source>) -> Vec<u8> {
+    let header = &record.header;
+    let mut bytes = Vec::with_capacity(
+        PREAMBLE_LENGTH
+            + 8 * header.independent_variable.len()
+            + 16 * record.data.iter().map(|d| d.samples.len()).sum::<usize>()
+            + 4096,
+    );
+
+    bytes.extend_from_slice(MAGIC);
+    bytes.extend_from_slice(&VERSION.to_le_bytes());
+    bytes.extend_from_slice(&0u32.to_le_bytes());
+
+    let (length, modified, flags) = match source {
+        Some((length, modified)) => {
+            match modified.and_then(|m| m.duration_since(SystemTime::UNIX_EPOCH).ok()) {
+                Some(time) => (length, time, SOURCE_KNOWN | SOURCE_MODIFIED_KNOWN),
+                None => (length, Duration::default(), SOURCE_KNOWN),
+            }
+        }
+        None => (0, Duration::default(), 0),
+    };
+    push_u64(length, &mut bytes);
+    push_u64(modified.as_secs(), &mut bytes);
+    bytes.extend_from_slice(&modified.subsec_nanos().to_le_bytes());
+    bytes.extend_from_slice(&flags.to_le_bytes());
+
+    push_str(&header.version, &mut bytes);
+    push_str(&header.name, &mut bytes);
+
+    push_u64(header.comments.len() as u64, &mut bytes);
+    for comment in &header.comments {
+        push_str(comment, &mut bytes);
+    }
+
+    push_u64(header.devices.len() as u64, &mut bytes);
+    for device in &header.devices {
+        push_str(&device.name, &mut bytes);
+        push_u64(device.entries.len() as u64, &mut bytes);
+        for entry in &device.entries {
+            push_str(entry, &mut bytes);
+        }
+    }
+
+    push_u64(header.constants.len() as u64, &mut bytes);
+    for constant in &header.constants {
+        push_str(&constant.name, &mut bytes);
+        push_str(&constant.value, &mut bytes);
+    }
+
+    let var = &header.independent_variable;
+    push_str(&var.name, &mut bytes);
+    push_str(&var.format, &mut bytes);
+    push_u64(var.len() as u64, &mut bytes);
+    push_f64s(var.iter(), &mut bytes);
+
+    push_u64(record.data.len() as u64, &mut bytes);
+    for data_array in &record.data {
+        push_str(&data_array.name, &mut bytes);
+        push_str(&data_array.format, &mut bytes);
+        push_u64(data_array.samples.len() as u64, &mut bytes);
+        push_complex(&data_array.samples, &mut bytes);
+    }
+
+    pad(&mut bytes);
+    let sum = checksum(&bytes);
+    push_u64(sum, &mut bytes);
+    bytes
+}
+
+/// Record decoded without copying its floats
+pub struct Decoded<'a> {
+    pub source: Option<Source>,
+    /// Header, with the independent variable left without values
+    pub header: Header,
+    /// Little-endian values of the independent variable
+    pub independent_variable: &'a [u8],
+    /// Name, format and little-endian interleaved samples of each data array
+    pub data: Vec<(&'a str, &'a str, &'a [u8])>,
+}
+
+impl Decoded<'_> {
+    pub fn to_record(&self) -> Record {
+        let mut header = self.header.clone();
+        header.independent_variable.data = to_f64s(self.independent_variable);
+        Record {
+            header,
+            data: self
+                .data
+                .iter()
+                .map(|&(name, format, samples)| DataArray {
+                    samples: to_complex(samples),
+                    ..DataArray::new(name, format)
+                })
+                .collect(),
+        }
+    }
+}
+
+/// Decode a record, checking its checksum first
+pub fn decode(bytes: &[u8]) -> DecodeResult<Decoded<'_>> {
+    if bytes.len() < PREAMBLE_LENGTH + 8 || bytes.len() % 8 != 0 {
+        return Err("truncated");
+    }
+    if &bytes[..8] != MAGIC {
+        return Err("not a binary record");
+    }
+    if bytes[8..12] != VERSION.to_le_bytes() {
+        return Err("unsupported format version");
+    }
+
+    let (body, sum) = bytes.split_at(bytes.len() - 8);
+    if checksum(body) != u64::from_le_bytes(sum.try_into().unwrap()) {
+        return Err("checksum mismatch");
+    }
+
+    let mut cursor = Cursor {
+        bytes: body,
+        position: 16,
+    };
+
+    let length = cursor.u64()?;
+    let seconds = cursor.u64()?;
+    let nanoseconds = u32::from_le_bytes(cursor.take(4)?.try_into().unwrap());
+    let flags = u32::from_le_bytes(cursor.take(4)?.try_into().unwrap());
+    let modified = match flags & SOURCE_MODIFIED_KNOWN {
+        0 => None,
+        // `Duration::new` panics if the carry overflows the seconds
+        _ if nanoseconds >= 1_000_000_000 => return Err("invalid modification time"),
+        _ => SystemTime::UNIX_EPOCH.checked_add(Duration::new(seconds, nanoseconds)),
+    };
+    let source = match flags & SOURCE_KNOWN {
+        0 => None,
+        _ => Some((length, modified)),
+    };
+
+    let mut header = Header::new(cursor.str()?, cursor.str()?);
+
+    for _ in 0..cursor.count()? {
+        header.comments.push(String::from(cursor.str()?));
+    }
+
+    for _ in 0..cursor.count()? {
+        let mut device = Device::new(cursor.str()?);
+        for _ in 0..cursor.count()? {
+            device.entries.push(String::from(cursor.str()?));
+        }
+        header.devices.push(device);
+    }
+
+    for _ in 0..cursor.count()? {
+        header
+            .constants
+            .push(Constant::new(cursor.str()?, cursor.str()?));
+    }
+
+    header.independent_variable = Var::new(cursor.str()?, cursor.str()?);
+    let independent_variable = cursor.floats(1)?;
+
+    let mut data = vec![];
+    for _ in 0..cursor.count()? {
+        let name = cursor.str()?;
+        let format = cursor.str()?;
+        data.push((name, format, cursor.floats(2)?));
+    }
+
+    cursor.align();
+    match cursor.position == body.len() {
+        true => Ok(Decoded {
+            source,
+            header,
+            independent_variable,
+            data,
+        }),
+        false => Err("trailing bytes"),
+    }
+}
+
+/// Reads the fields of [`encode`] in order
+struct Cursor<'a> {
+    bytes: &'a [u8],
+    position: usize,
+}
+
+impl<'a> Cursor<'a> {
+    fn take(&mut self, length: usize) -> DecodeResult<&'a [u8]> {
+        let rest = &self.bytes[self.position..];
+        if length > rest.len() {
+            return Err("truncated");
+        }
+        self.position += length;
+        Ok(&rest[..length])
+    }
+
+    fn u64(&mut self) -> DecodeResult<u64> {
+        Ok(u64::from_le_bytes(self.take(8)?.try_into().unwrap()))
+    }
+
+    /// A count, which cannot be more than the bytes left since every item
+    /// takes at least one
+    fn count(&mut self) -> DecodeResult<usize> {
+        let count = self.u64()?;
+        match count <= (self.bytes.len() - self.position) as u64 {
+            true => Ok(count as usize),
+            false => Err("truncated"),
+        }
+    }
+
+    fn str(&mut self) -> DecodeResult<&'a str> {
+        let length = self.count()?;
+        std::str::from_utf8(self.take(length)?).map_err(|_| "invalid UTF-8 string")
+    }
+
+    fn align(&mut self) {
+        self.position = ((self.position + 7) & !7).min(self.bytes.len());
+    }
+
+    /// A count followed by `parts` floats per item
+    fn floats(&mut self, parts: usize) -> DecodeResult<&'a [u8]> {
+        let count = self.count()?;
+        self.align();
+        self.take(count * parts * 8)
+    }
+}
+
+fn to_f64s(bytes: &[u8]) -> Vec<f64> {
+    bytes
+        .chunks_exact(8)
+        .map(|value| f64::from_le_bytes(value.try_into().unwrap()))
+        .collect()
+}
+
+fn to_complex(bytes: &[u8]) -> Vec<Complex<f64>> {
+    bytes
+        .chunks_exact(16)
+        .map(|sample| {
+            Complex::new(
+                f64::from_le_bytes(sample[..8].try_into().unwrap()),
+                f64::from_le_bytes(sample[8..].try_into().unwrap()),
+            )
+        })
+        .collect()
+}
+
+/// Borrow little-endian floats in place
+///
+/// `None` on big-endian targets or when `bytes` is not aligned for `T`.
+/// `T` must be made of `f64` only, such as `f64` or [`Complex<f64>`].
+fn borrow<T>(bytes: &[u8]) -> Option<&[T]> {
+    if cfg!(target_endian = "big") {
+        return None;
+    }
+    // Safety: every bit pattern is a valid `f64`, and `T` is only ever
+    // `f64` or the `repr(C)` `Complex<f64>`
+    match unsafe { bytes.align_to::<T>() } {
+        (&[], values, &[]) => Some(values),
+        _ => None,
+    }
+}
+
+pub fn borrow_f64s(bytes: &[u8]) -> Option<&[f64]> {
+    borrow(bytes)
+}
+
+pub fn borrow_complex(bytes: &[u8]) -> Option<&[Complex<f64>]> {
+    borrow(bytes)
+}
+
+#[cfg(test)]
+mod test_binary {
+    use super::*;
+
+    fn record() -> Record {
+        let mut record = Record::new("A.01.00", "CAL_SET");
+        record.header.comments.push(String::from("A comment"));
+        record.header.add_device("NA", "VERSION HP8510B.05.00");
+        record.header.add_device("NA", "REGISTER 1");
+        record.header.constants.push(Constant::new("TIME", "12:00"));
+        record.header.independent_variable = Var::new("FREQ", "MAG");
+        record.header.independent_variable.data = vec![1e9, 2e9, 3e9];
+        for name in &["E[1]", "E[2]"] {
+            let mut data_array = DataArray::new(name, "RI");
+            data_array.add_sample(0.5, -0.25);
+            data_array.add_sample(f64::MIN_POSITIVE, f64::MAX);
+            data_array.add_sample(-0., f64::INFINITY);
+            record.data.push(data_array);
+        }
+        record
+    }
+
+    #[test]
+    fn round_trip() {
+        let record = record();
+        assert_eq!(decode(&encode(&record, None)).unwrap().to_record(), record);
+    }
+
+    #[test]
+    fn empty_record() {
+        let record = Record::default();
+        assert_eq!(decode(&encode(&record, None)).unwrap().to_record(), record);
+    }
+
+    #[test]
+    fn source() {
+        let modified = SystemTime::UNIX_EPOCH + Duration::new(1_700_000_000, 123_456_789);
+        for &source in &[None, Some((10, None)), Some((10, Some(modified)))] {
+            let bytes = encode(&record(), source);
+            assert_eq!(decode(&bytes).unwrap().source, source);
+        }
+    }
+
+    #[test]
+    fn invalid_modification_time() {
+        let modified = SystemTime::UNIX_EPOCH + Duration::new(1_700_000_000, 0);
+        let mut bytes = encode(&record(), Some((10, Some(modified))));
+        bytes[24..32].copy_from_slice(&u64::MAX.to_le_bytes());
+        bytes[32..36].copy_from_slice(&u32::MAX.to_le_bytes());
+        let length = bytes.len() - 8;
+        let sum = checksum(&bytes[..length]);
+        bytes[length..].copy_from_slice(&sum.to_le_bytes());
+        assert_eq!(decode(&bytes).err(), Some("invalid modification time"));
+    }
+
+    #[test]
+    fn floats_are_aligned() {
+        let bytes = encode(&record(), None);
+        let decoded = decode(&bytes).unwrap();
+        let start = bytes.as_ptr() as usize;
+        assert_eq!(
+            (decoded.independent_variable.as_ptr() as usize - start) % 8,
+            0
+        );
+        for &(_, _, samples) in &decoded.data {
+            assert_eq!((samples.as_ptr() as usize - start) % 8, 0);
+        }
+    }
+
+    #[test]
+    fn borrows() {
+        let record = record();
+        let bytes = encode(&record, None);
+        let decoded = decode(&bytes).unwrap();
+        if bytes.as_ptr() as usize % 8 == 0 && cfg!(target_endian = "little") {
+            assert_eq!(
+                borrow_f64s(decoded.independent_variable).unwrap(),
+                &record.header.independent_variable.data[..]
+            );
+            assert_eq!(
+                borrow_complex(decoded.data[1].2).unwrap(),
+                &record.data[1].samples[..]
+            );
+        }
+    }
+
+    #[test]
+    fn unaligned_is_not_borrowed() {
+        let bytes = [0u8; 17];
+        let offset = match bytes.as_ptr() as usize % 8 {
+            0 => 1,
+            _ => 0,
+        };
+        assert_eq!(borrow_f64s(&bytes[offset..offset + 8]), None);
+    }
+
+    #[test]
+    fn any_change_is_detected() {
+        let bytes = encode(&record(), None);
+        for i in 0..bytes.len() {
+            let mut changed = bytes.clone();
+            changed[i] ^= 0x10;
+            assert!(decode(&changed).is_err(), "{}", i);
+        }
+    }
+
+    #[test]
+    fn truncated() {
+        let bytes = encode(&record(), None);
+        for length in 0..bytes.len() {
+            assert!(decode(&bytes[..length]).is_err(), "{}", length);
+        }
+    }
+
+    #[test]
+    fn bad_magic() {
+        let mut bytes = encode(&record(), None);
+        bytes[0] = b'X';
+        assert_eq!(decode(&bytes).err(), Some("not a binary record"));
+    }
+
+    #[test]
+    fn bad_version() {
+        let mut bytes = encode(&record(), None);
+        bytes[8] = 2;
+        assert_eq!(decode(&bytes).err(), Some("unsupported format version"));
+    }
+
+    #[test]
+    fn checksum_of_words() {
+        assert_eq!(checksum(&[]), 0xcbf2_9ce4_8422_2325);
+        assert_ne!(checksum(&[0; 8]), checksum(&[0; 16]));
+    }
+}
@@ -0,0 +1,540 @@
+//! Columnar export of records to Apache Arrow and Parquet
+//!
+//! Each record becomes one Arrow record batch with a row per value of the
+//! independent variable. The columns are laid out from the first record:
+//!
+//! - `record`, the position of the record in the export
+//! - `version`, `name`, `comments` and `devices`, dictionary encoded so that
+//!   each batch holds them once. Comments are one per line, and devices one
+//!   `NAME entry` line per entry.
+//! - `constant_<NAME>` for each constant of the first record, null in the
+//!   records that do not define it
+//! - the independent variable, under its own name
+//! - each data array, as [`SampleColumns`] of the two numbers of its pairs
+//!
+//! The format of the independent variable and of each data array is kept in
+//! the `format` metadata of its fields, and the samples are exported as they
+//! are stored. Every record must have the independent variable and data
+//! arrays of the first one, in the same order. Constants that the first
+//! record does not define are left out.
+//!
+//! Everything but the options needs the `columnar` cargo feature. Without
+//! it, [`write_parquet_files`] reports the export as unsupported.
+
+use crate::{ColumnarError, Result};
+use std::path::Path;
+
+#[cfg(feature = "columnar")]
+pub use self::arrow_export::{BatchBuilder, ParquetWriter};
+
+/// Columns holding the samples of a data array
+#[derive(Debug, PartialEq, Eq, Clone, Copy)]
+pub enum SampleColumns {
+    /// `<NAME>_re` and `<NAME>_im` of `Float64`
+    Split,
+    /// `<NAME>` of structs with `re` and `im` fields of `Float64`
+    Struct,
+}
+
+/// Options for `BatchBuilder` and [`write_parquet_files`]
+#[derive(Debug, PartialEq, Clone, Copy)]
+pub struct ColumnarOptions {
+    pub samples: SampleColumns,
+}
+
+impl Default for ColumnarOptions {
+    fn default() -> Self {
+        ColumnarOptions {
+            samples: SampleColumns::Split,
+        }
+    }
+}
+
+/// Export the record files at `paths` into a single Parquet file
+///
+/// The files are read one after the other into the same record, as with
+/// [`crate::Record::read_into`], so memory is bounded by one record and one
+/// row group whatever the number of files. The number of records written is
+/// returned. Nothing is created when `paths` is empty, and the output is
+/// removed again when a file cannot be read or exported.
+#[allow(unused_variables)]
+pub fn write_parquet_files<P: AsRef<Path>, Q: AsRef<Path>>(
+    paths: &[P],
+    output: Q,
+    options: ColumnarOptions,
+) -> Result<usize> {
+    #[cfg(feature = "columnar")]
+    {
+        use crate::{ReadError, Record, WriteError};
+        use std::fs::File;
+        use std::io::Write;
+
+        if paths.is_empty() {
+            return Err(ColumnarError::NoRecords.into());
+        }
+
+        let output = output.as_ref();
+        let file = File::create(output).map_err(WriteError::WrittingError)?;
+        let written = {
+            let mut writer = ParquetWriter::new(std::io::BufWriter::new(file), options);
+            let mut record = Record::default();
+            paths
+                .iter()
+                .try_for_each(|path| {
+                    let mut file = File::open(path).map_err(ReadError::ReadingError)?;
+                    record.read_into(&mut file)?;
+                    writer.write(&record)
+                })
+                .and_then(|_| {
+                    let records = writer.records();
+                    writer
+                        .finish()?
+                        .flush()
+                        .map_err(WriteError::WrittingError)?;
+                    Ok(records)
+                })
+        };
+
+        // The writer is dropped, so the file can be removed on any platform
+        if written.is_err() {
+            let _ = std::fs::remove_file(output);
+        }
+        written
+    }
+    #[cfg(not(feature = "columnar"))]
+    Err(ColumnarError::Unsupported.into())
+}
+
+#[cfg(feature = "columnar")]
+mod arrow_export {
+    use super::{ColumnarOptions, SampleColumns};
+    use crate::{ColumnarError, Record, Result};
+    use arrow::array::{
+        ArrayRef, DictionaryArray, Float64Array, Int32Array, StringArray, StructArray, UInt64Array,
+    };
+    use arrow::datatypes::{DataType, Field, Fields, Int32Type, Schema, SchemaRef};
+    use arrow::record_batch::RecordBatch;
+    use num_complex::Complex;
+    use parquet::arrow::ArrowWriter;
+    use std::collections::HashMap;
+    use std::io::Write;
+    use std::sync::Arc;
+
+    fn dictionary_field(name: &str, nullable: bool) -> Field {
+        let data_type = DataType::Dictionary(Box::new(DataType::Int32), Box::new(DataType::Utf8));
+        Field::new(name, data_type, nullable)
+    }
+
+    fn with_format(field: Field, format: &str) -> Field {
+        let metadata = HashMap::from([(String::from("format"), String::from(format))]);
+        field.with_metadata(metadata)
+    }
+
+    fn pair_fields() -> Fields {
+        Fields::from(vec![
+            Field::new("re", DataType::Float64, false),
+            Field::new("im", DataType::Float64, false),
+        ])
+    }
+
+    /// `value` on every row, or null on every row
+    fn repeated(value: Option<&str>, rows: usize) -> Result<ArrayRef> {
+        let keys = Int32Array::from(vec![value.map(|_| 0); rows]);
+        let values = StringArray::from(vec![value.unwrap_or_default()]);
+        let array = DictionaryArray::<Int32Type>::try_new(keys, Arc::new(values))
+            .map_err(ColumnarError::Arrow)?;
+        Ok(Arc::new(array))
+    }
+
+    fn part<F: Fn(&Complex<f64>) -> f64>(samples: &[Complex<f64>], f: F) -> ArrayRef {
+        Arc::new(Float64Array::from_iter_values(samples.iter().map(f)))
+    }
+
+    /// Turns records into Arrow record batches of the same schema
+    ///
+    /// The schema is laid out from the record passed to [`BatchBuilder::new`],
+    /// as described in [`crate::columnar`], and each call to
+    /// [`BatchBuilder::batch`] numbers the next record.
+    #[derive(Debug)]
+    pub struct BatchBuilder {
+        schema: SchemaRef,
+        options: ColumnarOptions,
+        independent_variable: String,
+        data_arrays: Vec<(String, String)>,
+        constants: Vec<String>,
+        records: usize,
+    }
+
+    impl BatchBuilder {
+        pub fn new(first: &Record, options: ColumnarOptions) -> BatchBuilder {
+            let var = &first.header.independent_variable;
+            let mut fields = vec![
+                Field::new("record", DataType::UInt64, false),
+                dictionary_field("version", false),
+                dictionary_field("name", false),
+                dictionary_field("comments", false),
+                dictionary_field("devices", false),
+            ];
+            for constant in first.header.constants.iter() {
+                fields.push(dictionary_field(
+                    &format!("constant_{}", constant.name),
+                    true,
+                ));
+            }
+            fields.push(with_format(
+                Field::new(&var.name, DataType::Float64, false),
+                &var.format,
+            ));
+            for array in first.data.iter() {
+                match options.samples {
+                    SampleColumns::Split => {
+                        for suffix in ["re", "im"].iter() {
+                            fields.push(with_format(
+                                Field::new(
+                                    format!("{}_{}", array.name, suffix),
+                                    DataType::Float64,
+                                    false,
+                                ),
+                                &array.format,
+                            ));
+                        }
+                    }
+                    SampleColumns::Struct => fields.push(with_format(
+                        Field::new(&array.name, DataType::Struct(pair_fields()), false),
+                        &array.format,
+                    )),
+                }
+            }
+
+            BatchBuilder {
+                schema: Arc::new(Schema::new(fields)),
+                options,
+                independent_variable: var.name.clone(),
+                data_arrays: first
+                    .data
+                    .iter()
+                    .map(|array| (array.name.clone(), array.format.clone()))
+                    .collect(),
+                constants: first
+                    .header
+                    .constants
+                    .iter()
+                    .map(|constant| constant.name.clone())
+                    .collect(),
+                records: 0,
+            }
+        }
+
+        pub fn schema(&self) -> SchemaRef {
+            self.schema.clone()
+        }
+
+        /// Number of records turned into batches so far
+        pub fn records(&self) -> usize {
+            self.records
+        }
+
+        /// The batch of the next record
+        ///
+        /// A record that does not fit the schema is not counted.
+        pub fn batch(&mut self, record: &Record) -> Result<RecordBatch> {
+            let index = self.records;
+            let var = &record.header.independent_variable;
+            let same_arrays =
+                record.data.len() == self.data_arrays.len()
+                    && record.data.iter().zip(self.data_arrays.iter()).all(
+                        |(array, (name, format))| array.name == *name && array.format == *format,
+                    );
+            if var.name != self.independent_variable || !same_arrays {
+                return Err(ColumnarError::SchemaMismatch(index).into());
+            }
+
+            let rows = var.len();
+            if let Some(i) = record
+                .data
+                .iter()
+                .position(|array| array.samples.len() != rows)
+            {
+                return Err(ColumnarError::RaggedDataArray(index, i).into());
+            }
+
+            let header = &record.header;
+            let comments = header.comments.join("\n");
+            let devices = header
+                .devices
+                .iter()
+                .flat_map(|device| {
+                    device
+                        .entries
+                        .iter()
+                        .map(move |entry| format!("{} {}", device.name, entry))
+                })
+                .collect::<Vec<String>>()
+                .join("\n");
+
+            let mut columns: Vec<ArrayRef> = vec![
+                Arc::new(UInt64Array::from(vec![index as u64; rows])),
+                repeated(Some(&header.version), rows)?,
+                repeated(Some(&header.name), rows)?,
+                repeated(Some(&comments), rows)?,
+                repeated(Some(&devices), rows)?,
+            ];
+            for name in self.constants.iter() {
+                let value = header.get_constant_by_name(name).map(|c| c.value.as_str());
+                columns.push(repeated(value, rows)?);
+            }
+            columns.push(Arc::new(Float64Array::from_iter_values(var.iter())));
+            for array in record.data.iter() {
+                let re = part(&array.samples, |sample| sample.re);
+                let im = part(&array.samples, |sample| sample.im);
+                match self.options.samples {
+                    SampleColumns::Split => columns.extend([re, im].iter().cloned()),
+                    SampleColumns::Struct => {
+                        let pairs = StructArray::try_new(pair_fields(), vec![re, im], None)
+                            .map_err(ColumnarError::Arrow)?;
+                        columns.push(Arc::new(pairs));
+                    }
+                }
+            }
+
+            let batch =
+                RecordBatch::try_new(self.schema(), columns).map_err(ColumnarError::Arrow)?;
+            self.records += 1;
+            Ok(batch)
+        }
+    }
+
+    /// Streams records into a Parquet file, one record batch at a time
+    ///
+    /// The schema is taken from the first record written. Rows are buffered
+    /// up to the row group size of the Parquet writer, so memory does not
+    /// grow with the number of records. `finish` writes the footer and
+    /// hands back the output, and fails if no record was written.
+    pub struct ParquetWriter<W: Write + Send> {
+        options: ColumnarOptions,
+        output: Option<W>,
+        writer: Option<(BatchBuilder, ArrowWriter<W>)>,
+    }
+
+    impl<W: Write + Send> ParquetWriter<W> {
+        pub fn new(output: W, options: ColumnarOptions) -> ParquetWriter<W> {
+            ParquetWriter {
+                options,
+                output: Some(output),
+                writer: None,
+            }
+        }
+
+        /// Number of records written so far
+        pub fn records(&self) -> usize {
+            match &self.writer {
+                Some((builder, _)) => builder.records(),
+                None => 0,
+            }
+        }
+
+        pub fn write(&mut self, record: &Record) -> Result<()> {
+            if let Some(output) = self.output.take() {
+                let builder = BatchBuilder::new(record, self.options);
+                let writer = ArrowWriter::try_new(output, builder.schema(), None)
+                    .map_err(ColumnarError::Parquet)?;
+                self.writer = Some((builder, writer));
+            }
+
+            if let Some((builder, writer)) = self.writer.as_mut() {
+                let batch = builder.batch(record)?;
+                writer.write(&batch).map_err(ColumnarError::Parquet)?;
+            }
+            Ok(())
+        }
+
+        pub fn finish(self) -> Result<W> {
+            match self.writer {
+                Some((_, writer)) => Ok(writer.into_inner().map_err(ColumnarError::Parquet)?),
+                None => Err(ColumnarError::NoRecords.into()),
+            }
+        }
+    }
+}
+
+#[cfg(test)]
+mod test_columnar {
+    use super::*;
+
+    #[test]
+    fn default_options() {
+        assert_eq!(ColumnarOptions::default().samples, SampleColumns::Split);
+    }
+
+    #[cfg(not(feature = "columnar"))]
+    #[test]
+    fn unsupported() {
+        match write_parquet_files(
+            &["tests/regression_files/data_file.cti"],
+            "out.parquet",
+            ColumnarOptions::default(),
+        ) {
+            Err(crate::Error::ColumnarError(ColumnarError::Unsupported)) => (),
+            e => panic!("{:?}", e),
+        }
+        assert!(!Path::new("out.parquet").exists());
+    }
+
+    #[cfg(feature = "columnar")]
+    mod test_batch_builder {
+        use super::*;
+        use crate::{Constant, DataArray, Record};
+        use arrow::array::{Array, AsArray};
+        use arrow::datatypes::Float64Type;
+        use num_complex::Complex;
+
+        fn record(name: &str) -> Record {
+            let mut record = Record::new("A.01.00", name);
+            record.header.comments.push(String::from("A comment"));
+            record
+                .header
+                .constants
+                .push(Constant::new("A_CONSTANT", "1"));
+            record.header.independent_variable.name = String::from("FREQ");
+            record.header.independent_variable.format = String::from("MAG");
+            record.header.independent_variable.push(1.);
+            record.header.independent_variable.push(2.);
+            let mut array = DataArray::new("S[1,1]", "RI");
+            array.samples = vec![Complex::new(1., 2.), Complex::new(3., 4.)];
+            record.data.push(array);
+            record
+        }
+
+        #[test]
+        fn split_columns() {
+            let mut builder = BatchBuilder::new(&record("A"), ColumnarOptions::default());
+            let names: Vec<String> = builder
+                .schema()
+                .fields()
+                .iter()
+                .map(|field| field.name().clone())
+                .collect();
+            assert_eq!(
+                names,
+                [
+                    "record",
+                    "version",
+                    "name",
+                    "comments",
+                    "devices",
+                    "constant_A_CONSTANT",
+                    "FREQ",
+                    "S[1,1]_re",
+                    "S[1,1]_im"
+                ]
+            );
+
+            let batch = builder.batch(&record("A")).unwrap();
+            assert_eq!(batch.num_rows(), 2);
+            let im = batch.column_by_name("S[1,1]_im").unwrap();
+            assert_eq!(&im.as_primitive::<Float64Type>().values()[..], &[2., 4.]);
+            let format =
+                builder.schema().field_with_name("FREQ").unwrap().metadata()["format"].clone();
+            assert_eq!(format, "MAG");
+        }
+
+        #[test]
+        fn struct_columns() {
+            let options = ColumnarOptions {
+                samples: SampleColumns::Struct,
+            };
+            let mut builder = BatchBuilder::new(&record("A"), options);
+            let batch = builder.batch(&record("A")).unwrap();
+            let pairs = batch.column_by_name("S[1,1]").unwrap().as_struct();
+            assert_eq!(
+                &pairs.column(0).as_primitive::<Float64Type>().values()[..],
+                &[1., 3.]
+            );
+        }
+
+        #[test]
+        fn records_are_numbered() {
+            let mut builder = BatchBuilder::new(&record("A"), ColumnarOptions::default());
+            builder.batch(&record("A")).unwrap();
+            let batch = builder.batch(&record("B")).unwrap();
+            let record_column = batch
+                .column(0)
+                .as_primitive::<arrow::datatypes::UInt64Type>();
+            assert_eq!(&record_column.values()[..], &[1, 1]);
+            assert_eq!(builder.records(), 2);
+        }
+
+        #[test]
+        fn missing_constant_is_null() {
+            let mut builder = BatchBuilder::new(&record("A"), ColumnarOptions::default());
+            let mut other = record("B");
+            other.header.constants.clear();
+            let batch = builder.batch(&other).unwrap();
+            assert_eq!(
+                batch
+                    .column_by_name("constant_A_CONSTANT")
+                    .unwrap()
+                    .null_count(),
+                2
+            );
+        }
+
+        #[test]
+        fn other_data_arrays() {
+            let mut builder = BatchBuilder::new(&record("A"), ColumnarOptions::default());
+            let mut other = record("B");
+            other.data[0].name = String::from("S[2,1]");
+            match builder.batch(&other) {
+                Err(crate::Error::ColumnarError(ColumnarError::SchemaMismatch(0))) => (),
+                e => panic!("{:?}", e),
+            }
+            assert_eq!(builder.records(), 0);
+        }
+
+        #[test]
+        fn ragged_data_array() {
+            let mut builder = BatchBuilder::new(&record("A"), ColumnarOptions::default());
+            let mut other = record("B");
+            other.data[0].samples.pop();
+            match builder.batch(&other) {
+                Err(crate::Error::ColumnarError(ColumnarError::RaggedDataArray(0, 0))) => (),
+                e => panic!("{:?}", e),
+            }
+        }
+
+        #[test]
+        fn parquet() {
+            let mut writer = ParquetWriter::new(vec![], ColumnarOptions::default());
+            writer.write(&record("A")).unwrap();
+            writer.write(&record("B")).unwrap();
+            assert_eq!(writer.records(), 2);
+            let bytes = writer.finish().unwrap();
+            assert_eq!(&bytes[..4], b"PAR1");
+            assert_eq!(&bytes[bytes.len() - 4..], b"PAR1");
+        }
+
+        #[test]
+        fn missing_file_leaves_no_output() {
+            let tmp = tempfile::tempdir().unwrap();
+            let output = tmp.path().join("out.parquet");
+            let missing = tmp.path().join("missing.cti");
+            let paths = [
+                Path::new("tests/regression_files/data_file.cti"),
+                missing.as_path(),
+            ];
+            match write_parquet_files(&paths, &output, ColumnarOptions::default()) {
+                Err(crate::Error::ReadError(crate::ReadError::ReadingError(_))) => (),
+                e => panic!("{:?}", e),
+            }
+            assert!(!output.exists());
+        }
+
+        #[test]
+        fn parquet_without_records() {
+            match ParquetWriter::new(vec![], ColumnarOptions::default()).finish() {
+                Err(crate::Error::ColumnarError(ColumnarError::NoRecords)) => (),
+                e => panic!("{:?}", e),
+            }
+        }
+    }
+}
@@ -0,0 +1,142 @@
+//! Gzip and zstd streams around the text reader and writer
+//!
+//! Each codec is only built with the cargo feature of the same name. Without
+//! it, the functions here report the compression as unsupported rather than
+//! handing the compressed bytes to the parser.
+
+use crate::{Compression, ReadError, Result, WriteError};
+use std::io::{BufRead, Write};
+
+/// Default levels of the `gzip` and `zstd` command lines
+#[cfg(feature = "gzip")]
+const GZIP_LEVEL: u32 = 6;
+#[cfg(feature = "zstd")]
+const ZSTD_LEVEL: i32 = 3;
+
+/// Stream of the decompressed bytes of `reader`
+///
+/// Concatenated gzip members or zstd frames are read as one stream, the same
+/// as `gzip -d` and `zstd -d` do.
+#[allow(unused_variables)]
+pub fn decoder<'a, R: BufRead + 'a>(
+    compression: Compression,
+    reader: R,
+) -> Result<Box<dyn BufRead + 'a>> {
+    match compression {
+        Compression::None => Ok(Box::new(reader)),
+        #[cfg(feature = "gzip")]
+        Compression::Gzip => Ok(Box::new(std::io::BufReader::new(
+            flate2::bufread::MultiGzDecoder::new(reader),
+        ))),
+        #[cfg(feature = "zstd")]
+        Compression::Zstd => {
+            let decoder = zstd::stream::read::Decoder::with_buffer(reader)
+                .map_err(ReadError::ReadingError)?;
+            Ok(Box::new(std::io::BufReader::new(decoder)))
+        }
+        #[allow(unreachable_patterns)]
+        _ => Err(ReadError::UnsupportedCompression(compression).into()),
+    }
+}
+
+/// Compress everything `write` writes into `writer`
+///
+/// zstd compresses on one worker per available core next to the thread
+/// calling `write`, which keeps formatting the record.
+#[allow(unused_variables)]
+pub fn encode<W: Write, F: FnOnce(&mut dyn Write) -> Result<()>>(
+    compression: Compression,
+    writer: &mut W,
+    write: F,
+) -> Result<()> {
+    match compression {
+        Compression::None => write(writer),
+        #[cfg(feature = "gzip")]
+        Compression::Gzip => {
+            let mut encoder =
+                flate2::write::GzEncoder::new(writer, flate2::Compression::new(GZIP_LEVEL));
+            write(&mut encoder)?;
+            encoder.finish().map_err(WriteError::WrittingError)?;
+            Ok(())
+        }
+        #[cfg(feature = "zstd")]
+        Compression::Zstd => {
+            let mut encoder = zstd::stream::write::Encoder::new(writer, ZSTD_LEVEL)
+                .map_err(WriteError::WrittingError)?;
+            let workers = crate::worker_count(0, usize::MAX) as u32;
+            encoder
+                .multithread(workers)
+                .map_err(WriteError::WrittingError)?;
+            write(&mut encoder)?;
+            encoder.finish().map_err(WriteError::WrittingError)?;
+            Ok(())
+        }
+        #[allow(unreachable_patterns)]
+        _ => Err(WriteError::UnsupportedCompression(compression).into()),
+    }
+}
+
+#[cfg(test)]
+mod test_compression {
+    use super::*;
+    use std::io::Read;
+
+    const CONTENTS: &[u8] = b"CITIFILE A.01.00\nNAME MEMORY\n";
+
+    fn round_trip(compression: Compression) -> Vec<u8> {
+        let mut compressed = vec![];
+        encode(compression, &mut compressed, |writer| {
+            writer.write_all(CONTENTS).unwrap();
+            Ok(())
+        })
+        .unwrap();
+        assert_eq!(Compression::from_magic(&compressed), compression);
+
+        let mut decompressed = vec![];
+        decoder(compression, &compressed[..])
+            .unwrap()
+            .read_to_end(&mut decompressed)
+            .unwrap();
+        decompressed
+    }
+
+    #[test]
+    fn none() {
+        assert_eq!(round_trip(Compression::None), CONTENTS);
+    }
+
+    #[cfg(feature = "gzip")]
+    #[test]
+    fn gzip() {
+        assert_eq!(round_trip(Compression::Gzip), CONTENTS);
+    }
+
+    #[cfg(feature = "zstd")]
+    #[test]
+    fn zstd() {
+        assert_eq!(round_trip(Compression::Zstd), CONTENTS);
+    }
+
+    #[cfg(not(feature = "gzip"))]
+    #[test]
+    fn gzip_unsupported() {
+        match decoder(Compression::Gzip, &b"\x1F\x8B"[..]) {
+            Err(crate::Error::ReadError(ReadError::UnsupportedCompression(Compression::Gzip))) => {
+                ()
+            }
+            Err(e) => panic!("{:?}", e),
+            Ok(_) => panic!("Gzip decoded without the feature"),
+        }
+    }
+
+    #[cfg(not(feature = "zstd"))]
+    #[test]
+    fn zstd_unsupported() {
+        match encode(Compression::Zstd, &mut vec![], |_| Ok(())) {
+            Err(crate::Error::WriteError(WriteError::UnsupportedCompression(
+                Compression::Zstd,
+            ))) => {}
+            e => panic!("{:?}", e),
+        }
+    }
+}
@@ -0,0 +1,160 @@
+//! Conversion kernels between the `DATA` formats
+//!
+//! Each sample holds the two numbers of a data pair in `re` and `im`, in the
+//! order they are written: `real, imag` for RI, `magnitude, angle` for MA and
+//! `20 log10(magnitude), angle` for DB. Angles are in degrees.
+//!
+//! Every kernel is a single branch-free pass over the samples with the
+//! scaling inlined, leaving only the `hypot`, `atan2`, `log10`, `powf` and
+//! `sin_cos` calls of `std` per sample.
+
+use crate::DataFormat;
+use num_complex::Complex;
+
+/// Convert `samples` from `from` to `to` in place
+pub fn convert(samples: &mut [Complex<f64>], from: DataFormat, to: DataFormat) {
+    use DataFormat::*;
+
+    match (from, to) {
+        (RealImaginary, MagnitudeAngle) => real_imaginary_to_polar(samples, magnitude),
+        (RealImaginary, DecibelAngle) => real_imaginary_to_polar(samples, decibel),
+        (MagnitudeAngle, RealImaginary) => polar_to_real_imaginary(samples, magnitude),
+        (DecibelAngle, RealImaginary) => polar_to_real_imaginary(samples, from_decibel),
+        (MagnitudeAngle, DecibelAngle) => map_first(samples, decibel),
+        (DecibelAngle, MagnitudeAngle) => map_first(samples, from_decibel),
+        (RealImaginary, RealImaginary)
+        | (MagnitudeAngle, MagnitudeAngle)
+        | (DecibelAngle, DecibelAngle) => (),
+    }
+}
+
+fn magnitude(magnitude: f64) -> f64 {
+    magnitude
+}
+
+fn decibel(magnitude: f64) -> f64 {
+    20. * magnitude.log10()
+}
+
+fn from_decibel(decibel: f64) -> f64 {
+    10f64.powf(decibel / 20.)
+}
+
+/// `real, imag` to `scale(magnitude), angle`
+#[inline(always)]
+fn real_imaginary_to_polar<F: Fn(f64) -> f64>(samples: &mut [Complex<f64>], scale: F) {
+    for sample in samples.iter_mut() {
+        let (real, imag) = (sample.re, sample.im);
+        sample.re = scale(real.hypot(imag));
+        sample.im = imag.atan2(real).to_degrees();
+    }
+}
+
+/// `scale(magnitude), angle` to `real, imag`, where `unscale` undoes `scale`
+#[inline(always)]
+fn polar_to_real_imaginary<F: Fn(f64) -> f64>(samples: &mut [Complex<f64>], unscale: F) {
+    for sample in samples.iter_mut() {
+        let magnitude = unscale(sample.re);
+        let (sin, cos) = sample.im.to_radians().sin_cos();
+        sample.re = magnitude * cos;
+        sample.im = magnitude * sin;
+    }
+}
+
+/// Change the magnitude and leave the angle
+#[inline(always)]
+fn map_first<F: Fn(f64) -> f64>(samples: &mut [Complex<f64>], f: F) {
+    for sample in samples.iter_mut() {
+        sample.re = f(sample.re);
+    }
+}
+
+#[cfg(test)]
+mod test_convert {
+    use super::*;
+    use approx::*;
+    use DataFormat::*;
+
+    const FORMATS: [DataFormat; 3] = [RealImaginary, MagnitudeAngle, DecibelAngle];
+
+    fn converted(samples: &[Complex<f64>], from: DataFormat, to: DataFormat) -> Vec<Complex<f64>> {
+        let mut samples = samples.to_vec();
+        convert(&mut samples, from, to);
+        samples
+    }
+
+    fn assert_samples_eq(left: &[Complex<f64>], right: &[Complex<f64>]) {
+        assert_eq!(left.len(), right.len());
+        for (l, r) in left.iter().zip(right.iter()) {
+            assert_relative_eq!(l.re, r.re, epsilon = 1e-12, max_relative = 1e-12);
+            assert_relative_eq!(l.im, r.im, epsilon = 1e-12, max_relative = 1e-12);
+        }
+    }
+
+    #[test]
+    fn real_imaginary_to_magnitude_angle() {
+        let samples = [
+            Complex::new(3., 4.),
+            Complex::new(0., -2.),
+            Complex::new(-1., 0.),
+        ];
+        assert_samples_eq(
+            &converted(&samples, RealImaginary, MagnitudeAngle),
+            &[
+                Complex::new(5., 4f64.atan2(3.).to_degrees()),
+                Complex::new(2., -90.),
+                Complex::new(1., 180.),
+            ],
+        );
+    }
+
+    #[test]
+    fn real_imaginary_to_decibel_angle() {
+        let samples = [Complex::new(10., 0.), Complex::new(0., 0.1)];
+        assert_samples_eq(
+            &converted(&samples, RealImaginary, DecibelAngle),
+            &[Complex::new(20., 0.), Complex::new(-20., 90.)],
+        );
+    }
+
+    #[test]
+    fn magnitude_angle_to_decibel_angle() {
+        let samples = [Complex::new(100., 45.)];
+        assert_samples_eq(
+            &converted(&samples, MagnitudeAngle, DecibelAngle),
+            &[Complex::new(40., 45.)],
+        );
+    }
+
+    #[test]
+    fn decibel_angle_to_real_imaginary() {
+        let samples = [Complex::new(0., 90.), Complex::new(20., 180.)];
+        assert_samples_eq(
+            &converted(&samples, DecibelAngle, RealImaginary),
+            &[Complex::new(0., 1.), Complex::new(-10., 0.)],
+        );
+    }
+
+    #[test]
+    fn same_format_is_unchanged() {
+        let samples = [Complex::new(-1.31189E-3, 0.86303E-1)];
+        for &format in FORMATS.iter() {
+            assert_eq!(converted(&samples, format, format), samples);
+        }
+    }
+
+    #[test]
+    fn round_trips() {
+        let samples = [
+            Complex::new(0.86303E-1, -8.98651E-1),
+            Complex::new(-4.96887E-1, 7.87323E-1),
+            Complex::new(-5.65338E-1, -7.05291E-1),
+        ];
+        for &from in FORMATS.iter() {
+            for &to in FORMATS.iter() {
+                let there = converted(&converted(&samples, RealImaginary, from), from, to);
+                assert_samples_eq(&converted(&there, to, RealImaginary), &samples);
+            }
+        }
+    }
+}
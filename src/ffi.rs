@@ -16,14 +16,24 @@
 //! function. Note that all functions as part of the C-api will either
 //! return a pointer (null pointers represent an error) or an integer
 //! where negative values represent an error code.
+//!
+//! Strings
+//!
+//! Strings returned by the getters are owned by the record and must not
+//! be freed. Each one is converted to a C string once and cached, so calling
+//! a getter again returns the same pointer without allocating. A pointer stays
+//! valid until the record is destroyed or the string it was built from is
+//! changed and fetched again.
 
-use crate::{Record, DataArray, Device, Error, ParseError, ReadError, WriteError};
+use crate::{Record, RecordParser, RecordWriter, ColumnarError, Compression, ConvertError, DataArray, DataFormat, Device, Error, FloatFormat, ParseError, ReadError, ReadOptions, ReadStats, WriteError, WriteOptions, WriteStats};
 
 use num_complex::Complex;
 use std::ffi::{CString, CStr};
 use libc::{c_char, c_double, c_int, size_t};
 use std::fs::File;
 use std::cell::RefCell;
+use std::collections::HashMap;
+use std::sync::{Arc, Mutex, MutexGuard};
 
 /// Error code values must be maintained across any ffi boundaries
 #[derive(Copy, Clone, PartialEq)]
@@ -85,6 +95,45 @@ enum ErrorCode {
     NullByte = -40,
 
     IndexOutOfBounds = -41,
+
+    // IndexedRecord
+    RecordReadErrorStaleIndex = -42,
+
+    // Record::from_binary_reader
+    RecordReadErrorInvalidBinary = -43,
+
+    // RecordParser
+    RecordReadErrorParserFailed = -44,
+
+    // RecordWriter
+    RecordWriteErrorOutOfOrder = -45,
+    RecordWriteErrorUndeclaredDataArray = -46,
+    RecordWriteErrorMissingDataArray = -47,
+
+    // DataArray::convert_to
+    RecordConvertErrorUnsupportedFormat = -48,
+
+    // Lookups by name
+    NameNotFound = -49,
+
+    // Compression
+    RecordReadErrorUnsupportedCompression = -50,
+    RecordWriteErrorUnsupportedCompression = -51,
+
+    // columnar
+    RecordColumnarErrorUnsupported = -52,
+    RecordColumnarErrorNoRecords = -53,
+    RecordColumnarErrorSchemaMismatch = -54,
+    RecordColumnarErrorRaggedDataArray = -55,
+    // Only built with the `columnar` feature
+    #[cfg_attr(not(feature = "columnar"), allow(dead_code))]
+    RecordColumnarErrorArrow = -56,
+
+    // RecordParser
+    RecordReadErrorLineTooLong = -57,
+
+    // SEG lines
+    RecordReadErrorSegmentsTooLong = -58,
 }
 
 /// Note that this static array must be kept in sync with the error code enum.
@@ -146,6 +195,33 @@ const ERROR_DESCRIPTION: &[&str] = &[
     "An interior null byte was found in string",
 
     "Index is outside of acceptable bounds",
+
+    "Record read error due to a block index that does not match its file",
+
+    "Record read error due to an invalid binary record",
+
+    "Record read error due to a parser that already failed",
+
+    "Record write error due to a call out of order",
+    "Record write error due to a data array that does not match its declaration",
+    "Record write error due to a declared data array that was not written",
+
+    "Data conversion error due to an unsupported format",
+
+    "No entry with the given name was found",
+
+    "Record read error due to a compression this build does not support",
+    "Record write error due to a compression this build does not support",
+
+    "Record export error due to a build without columnar support",
+    "Record export error due to no records to export",
+    "Record export error due to a record without the columns of the first record",
+    "Record export error due to a data array without one sample per independent variable value",
+    "Record export error from Arrow or Parquet",
+
+    "Record read error due to a line longer than the parser holds back",
+
+    "Record read error due to segments with more values than accepted",
 ];
 
 thread_local!{
@@ -156,6 +232,99 @@ thread_local!{
     static LAST_ERROR_CODE: RefCell<Option<ErrorCode>> = RefCell::new(None);
 }
 
+/// NUL-terminated copies of [`ERROR_DESCRIPTION`], built on first use
+static ERROR_DESCRIPTION_CACHE: Mutex<Vec<CString>> = Mutex::new(Vec::new());
+
+/// Buffers handed out for each live record, keyed by its address
+///
+/// The records are spread over [`RECORD_CACHE_SHARDS`] locks, so threads
+/// working on different records rarely wait on each other. Entries are
+/// dropped in [`record_destroy`] and every other call that frees a record.
+static RECORD_CACHE: [RecordCacheShard; RECORD_CACHE_SHARDS] = [EMPTY_SHARD; RECORD_CACHE_SHARDS];
+
+const RECORD_CACHE_SHARDS: usize = 64;
+
+type RecordCacheShard = Mutex<Option<HashMap<usize, RecordCache>>>;
+
+// A `const` so that the array above gets a new lock for each shard
+#[allow(clippy::declare_interior_mutable_const)]
+const EMPTY_SHARD: RecordCacheShard = Mutex::new(None);
+
+/// Lock of the shard holding the cache of `record`
+fn lock_record_cache(record: *const Record) -> MutexGuard<'static, Option<HashMap<usize, RecordCache>>> {
+    // Records are boxed, so addresses differ by at least their alignment
+    let shard = (record as usize / std::mem::align_of::<Record>()) % RECORD_CACHE_SHARDS;
+    lock_cache(&RECORD_CACHE[shard])
+}
+
+/// Everything borrowed from a single record across the FFI
+#[derive(Default)]
+struct RecordCache {
+    strings: HashMap<StringField, CString>,
+    header_snapshot: Vec<u8>,
+}
+
+/// Which string of a record a cached C string was built from
+#[derive(Copy, Clone, PartialEq, Eq, Hash)]
+enum StringField {
+    Version,
+    Name,
+    Comment(size_t),
+    DeviceName(size_t),
+    DeviceEntry(size_t, size_t),
+    IndependentVariableName,
+    IndependentVariableFormat,
+    DataArrayName(size_t),
+    DataArrayFormat(size_t),
+}
+
+/// Lock a cache, ignoring poisoning since the caches are never left half updated
+fn lock_cache<T>(cache: &Mutex<T>) -> MutexGuard<'_, T> {
+    cache.lock().unwrap_or_else(|poisoned| poisoned.into_inner())
+}
+
+/// Run `f` on the cache of a record, creating it if needed
+fn with_record_cache<R>(record: *const Record, f: impl FnOnce(&mut RecordCache) -> R) -> R {
+    let mut cache = lock_record_cache(record);
+    f(cache.get_or_insert_with(HashMap::new).entry(record as usize).or_default())
+}
+
+/// Get the cached C string for a record field
+///
+/// The C string is only rebuilt when `val` no longer matches it.
+fn cached_c_str(record: *const Record, field: StringField, val: &str) -> *const c_char {
+    with_record_cache(record, |cache| {
+        let strings = &mut cache.strings;
+
+        if let Some(c_str) = strings.get(&field) {
+            if c_str.to_bytes() == val.as_bytes() {
+                return c_str.as_ptr()
+            }
+        }
+
+        // Convert to C string. Going through CString adds null terminator.
+        let c_str = match CString::new(val) {
+            Ok(s) => s,
+            Err(_) => {
+                // The only expected error is due to an interior null byte
+                update_error_code(ErrorCode::NullByte);
+                return std::ptr::null_mut()
+            }
+        };
+
+        let ptr = c_str.as_ptr();
+        strings.insert(field, c_str);
+        ptr
+    })
+}
+
+/// Drop everything cached for a record
+fn release_record_cache(record: *const Record) {
+    if let Some(cache) = lock_record_cache(record).as_mut() {
+        cache.remove(&(record as usize));
+    }
+}
+
 /// Update the last saved error code
 ///
 /// This function is not public and is for use from the rust
@@ -191,7 +360,7 @@ pub extern "C" fn get_last_error_code() -> c_int {
 /// Get string description for error code
 ///
 /// This function should be called with the return value of
-/// `get_last_error_code`.
+/// `get_last_error_code`. The description is static and must not be freed.
 #[no_mangle]
 pub extern "C" fn get_error_description(error_code: c_int) -> *const c_char {
     // Convert error code to index into static description array
@@ -201,10 +370,13 @@ pub extern "C" fn get_error_description(error_code: c_int) -> *const c_char {
         return unsafe { CStr::from_bytes_with_nul_unchecked(b"Invalid error code\0").as_ptr() };
     }
     
-    // This should never return an error type
-    let c_str = CString::new(ERROR_DESCRIPTION[error_description_index as usize]).unwrap();
+    let mut descriptions = lock_cache(&ERROR_DESCRIPTION_CACHE);
+    if descriptions.is_empty() {
+        // This should never return an error type
+        descriptions.extend(ERROR_DESCRIPTION.iter().map(|description| CString::new(*description).unwrap()));
+    }
 
-    c_str.into_raw()
+    descriptions[error_description_index as usize].as_ptr()
 }
 
 /// Check if index is out of bounds
@@ -242,7 +414,10 @@ fn set_str_value<T>(ptr: *mut T, val: *const c_char, update_field: fn(&mut T, st
 }
 
 /// Helper function to validate pointers and get value from data field
-fn check_ptr_transform_to_cstring(record: *const Record, get_val: fn(&Record) -> &str) -> *const c_char {
+fn check_ptr_transform_to_cstring(
+    record: *const Record,
+    field: StringField,
+    get_val: fn(&Record) -> &str) -> *const c_char {
 
     if record.is_null() {
         update_error_code(ErrorCode::NullArgument);
@@ -251,23 +426,14 @@ fn check_ptr_transform_to_cstring(record: *const Record, get_val: fn(&Record) ->
 
     let record_ref = unsafe { &*record };
 
-    // Convert to C string. Going through CString adds null terminator.
-    let c_str = match CString::new(get_val(record_ref)) {
-        Ok(s) => s,
-        Err(_) => {
-            // The only expected error is due to an interior null byte
-            update_error_code(ErrorCode::NullByte);
-            return std::ptr::null_mut()
-        }
-    };
-
-    c_str.into_raw()
+    cached_c_str(record, field, get_val(record_ref))
 }
 
 /// Helper function to validate pointers and get value from index
 fn check_ptr_index_transform_to_cstring<T>(
     record: *const Record, 
     idx: size_t, 
+    field: impl Fn(size_t) -> StringField,
     get_vals: impl Fn(&Record) -> &[T], 
     get_val: impl Fn(&[T], size_t) -> &str) -> *const c_char {
 
@@ -284,19 +450,7 @@ fn check_ptr_index_transform_to_cstring<T>(
         return std::ptr::null_mut()
     }
 
-    let val = get_val(vals, idx);
-
-    // Convert to C string. Going through CString adds null terminator.
-    let c_str = match CString::new(val) {
-        Ok(s) => s,
-        Err(_) => {
-            // The only expected error is due to an interior null byte
-            update_error_code(ErrorCode::NullByte);
-            return std::ptr::null_mut()
-        }
-    };
-
-    c_str.into_raw()
+    cached_c_str(record, field(idx), get_val(vals, idx))
 }
 
 /// Helper function to map rust error type to ErrorCode
@@ -347,6 +501,13 @@ fn map_record_error_to_error_code(err: Error) -> ErrorCode {
                 ReadError::NoIndependentVariable => update_error_code(ErrorCode::RecordReadErrorNoIndependentVariable),
                 ReadError::NoData => update_error_code(ErrorCode::RecordReadErrorNoData),
                 ReadError::VarAndDataDifferentLengths(_, _, _) => update_error_code(ErrorCode::RecordReadErrorVarAndDataDifferentLengths),
+                ReadError::StaleIndex => update_error_code(ErrorCode::RecordReadErrorStaleIndex),
+                ReadError::InvalidBinary(_) => update_error_code(ErrorCode::RecordReadErrorInvalidBinary),
+                ReadError::ParserFailed => update_error_code(ErrorCode::RecordReadErrorParserFailed),
+                ReadError::UnsupportedCompression(_) => update_error_code(ErrorCode::RecordReadErrorUnsupportedCompression),
+                ReadError::LineTooLong(_) => update_error_code(ErrorCode::RecordReadErrorLineTooLong),
+                ReadError::DataArrayLongerThanVar(_, _) => update_error_code(ErrorCode::RecordReadErrorVarAndDataDifferentLengths),
+                ReadError::SegmentsTooLong(_) => update_error_code(ErrorCode::RecordReadErrorSegmentsTooLong),
             }
         },
         Error::WriteError(write_err) => {
@@ -356,6 +517,25 @@ fn map_record_error_to_error_code(err: Error) -> ErrorCode {
                 WriteError::NoDataName(_) => update_error_code(ErrorCode::RecordWriteErrorNoDataName),
                 WriteError::NoDataFormat(_) => update_error_code(ErrorCode::RecordWriteErrorNoDataFormat),
                 WriteError::WrittingError(_) => update_error_code(ErrorCode::RecordWriteErrorWrittingError),
+                WriteError::OutOfOrder(_) => update_error_code(ErrorCode::RecordWriteErrorOutOfOrder),
+                WriteError::UndeclaredDataArray(_) => update_error_code(ErrorCode::RecordWriteErrorUndeclaredDataArray),
+                WriteError::MissingDataArray(_) => update_error_code(ErrorCode::RecordWriteErrorMissingDataArray),
+                WriteError::UnsupportedCompression(_) => update_error_code(ErrorCode::RecordWriteErrorUnsupportedCompression),
+            }
+        },
+        Error::ConvertError(convert_err) => {
+            match convert_err {
+                ConvertError::UnsupportedFormat(_) => update_error_code(ErrorCode::RecordConvertErrorUnsupportedFormat),
+            }
+        },
+        Error::ColumnarError(columnar_err) => {
+            match columnar_err {
+                ColumnarError::Unsupported => update_error_code(ErrorCode::RecordColumnarErrorUnsupported),
+                ColumnarError::NoRecords => update_error_code(ErrorCode::RecordColumnarErrorNoRecords),
+                ColumnarError::SchemaMismatch(_) => update_error_code(ErrorCode::RecordColumnarErrorSchemaMismatch),
+                ColumnarError::RaggedDataArray(_, _) => update_error_code(ErrorCode::RecordColumnarErrorRaggedDataArray),
+                #[cfg(feature = "columnar")]
+                ColumnarError::Arrow(_) | ColumnarError::Parquet(_) => update_error_code(ErrorCode::RecordColumnarErrorArrow),
             }
         }
     }
@@ -374,6 +554,7 @@ pub extern "C" fn record_destroy(record: *mut Record) -> c_int {
         return update_error_code(ErrorCode::NullArgument) as c_int
     }
 
+    release_record_cache(record);
     unsafe { drop(Box::from_raw(record)) }
 
     update_error_code(ErrorCode::NoError) as c_int
@@ -410,6 +591,9 @@ pub extern "C" fn record_default() -> *mut Record {
 
 /// Read record from file
 /// 
+/// Gzip and zstd compressed files are detected from their first bytes and
+/// decompressed while they are parsed (see [`Compression`]).
+///
 /// This allocates memory and must be destroyed by the caller
 /// (see [`record_destroy`]).
 /// - A null pointer is returned if the filename is null, a file corresponding
@@ -451,984 +635,3609 @@ pub extern "C" fn record_read(filename: *const c_char) -> *mut Record {
     Box::into_raw(Box::new(record))
 }
 
-/// Write record to file
+/// Read record from file by memory mapping it
 ///
-/// This function will write to a filepath the from the contents
-/// of the given Record.
+/// This is the same as [`record_read`] except that regular files are
+/// memory mapped and parsed directly from the mapped bytes (see
+/// [`Record::from_file_mmap`]). Files that cannot be mapped, such as
+/// pipes, are read through a buffer instead.
+///
+/// This allocates memory and must be destroyed by the caller
+/// (see [`record_destroy`]).
+/// - A null pointer is returned if the filename is null, a file corresponding
+/// to the filename does not exist, or the file cannot be read
 #[no_mangle]
 #[allow(clippy::not_unsafe_ptr_arg_deref)]
-pub extern "C" fn record_write(record: *mut Record, filename: *const c_char) -> c_int {
-    if record.is_null() {
-        return update_error_code(ErrorCode::NullArgument) as c_int
-    }
+pub extern "C" fn record_read_mmap(filename: *const c_char) -> *mut Record {
 
     if filename.is_null() {
-        return update_error_code(ErrorCode::NullArgument) as c_int
+        update_error_code(ErrorCode::NullArgument);
+        return std::ptr::null_mut()
     }
 
     let filename_string = match unsafe { CStr::from_ptr(filename) }.to_str() {
         Ok(s) => s.to_string(),
         Err(_) => {
             // The only expected error is due to invalid UTF encoding
-            return update_error_code(ErrorCode::InvalidUTF8String) as c_int
+            update_error_code(ErrorCode::InvalidUTF8String);
+            return std::ptr::null_mut()
         }
     };
 
-    let record_ref = unsafe { &*record };
-
-    let mut file = match File::create(filename_string) {
+    let mut file = match File::open(filename_string) {
         Ok(f) => f,
         Err(err) => {
-            return map_io_error_to_error_code(err) as c_int
+            map_io_error_to_error_code(err);
+            return std::ptr::null_mut()
         }
     };
 
-    if let Err(err) = record_ref.to_writer(&mut file) {
-        return map_record_error_to_error_code(err) as c_int
-    }
-
-    ErrorCode::NoError as c_int
-}
-
-/// Get the record version
-/// 
-/// - If the [`Record`] pointer is null, null is returned.
-/// - If the current version cannot be cast to [`std::ffi::CString`], null is returned.
-/// - Returned version in null terminated
-#[no_mangle]
-#[allow(clippy::not_unsafe_ptr_arg_deref)]
-pub extern "C" fn record_get_version(record: *mut Record) -> *const c_char {
+    let record = match Record::from_file_mmap(&mut file) {
+        Ok(r) => r,
+        Err(err) => {
+            map_record_error_to_error_code(err);
+            return std::ptr::null_mut()
+        }
+    };
 
-    check_ptr_transform_to_cstring(record, |record_ref| { &record_ref.header.version[..] })
+    Box::into_raw(Box::new(record))
 }
 
-
-/// Set the record version
-/// 
-/// - If the [`Record`] pointer is null, the function does nothing and returns.
-/// - If the version pointer is null, the function does nothing and returns.
-/// - Input string should be UTF-8 encoded
+/// Read record from file, parsing the data arrays on several threads
+///
+/// This is the same as [`record_read`] except that the `BEGIN`/`END`
+/// blocks are parsed on up to `threads` threads (see
+/// [`Record::from_path_parallel`]). A `threads` of 0 uses one thread per
+/// available core.
+///
+/// This allocates memory and must be destroyed by the caller
+/// (see [`record_destroy`]).
+/// - A null pointer is returned if the filename is null, a file corresponding
+/// to the filename does not exist, or the file cannot be read
 #[no_mangle]
 #[allow(clippy::not_unsafe_ptr_arg_deref)]
-pub extern "C" fn record_set_version(record: *mut Record, version: *const c_char) -> c_int {
+pub extern "C" fn record_read_parallel(filename: *const c_char, threads: size_t) -> *mut Record {
 
-    set_str_value(record, version, |record_ref, string_version| {
-        record_ref.header.version = string_version;
-    }) as c_int
-}
+    if filename.is_null() {
+        update_error_code(ErrorCode::NullArgument);
+        return std::ptr::null_mut()
+    }
 
-/// Get the record name
-/// 
-/// - If the [`Record`] pointer is null, null is returned.
-/// - If the current name cannot be cast to [`std::ffi::CString`], null is returned.
-/// - Returned name in null terminated
-#[no_mangle]
-#[allow(clippy::not_unsafe_ptr_arg_deref)]
-pub extern "C" fn record_get_name(record: *mut Record) -> *const c_char {
+    let filename_string = match unsafe { CStr::from_ptr(filename) }.to_str() {
+        Ok(s) => s.to_string(),
+        Err(_) => {
+            // The only expected error is due to invalid UTF encoding
+            update_error_code(ErrorCode::InvalidUTF8String);
+            return std::ptr::null_mut()
+        }
+    };
 
-    check_ptr_transform_to_cstring(record, |record_ref| { &record_ref.header.name[..] })
-}
+    let mut file = match File::open(filename_string) {
+        Ok(f) => f,
+        Err(err) => {
+            map_io_error_to_error_code(err);
+            return std::ptr::null_mut()
+        }
+    };
 
-/// Set the record name
-/// 
-/// - If the [`Record`] pointer is null, the function does nothing and returns.
-/// - If the name pointer is null, the function does nothing and returns.
-/// - Input string should be UTF-8 encoded
-#[no_mangle]
-#[allow(clippy::not_unsafe_ptr_arg_deref)]
-pub extern "C" fn record_set_name(record: *mut Record, name: *const c_char) -> c_int {
+    let record = match Record::from_file_parallel(&mut file, threads) {
+        Ok(r) => r,
+        Err(err) => {
+            map_record_error_to_error_code(err);
+            return std::ptr::null_mut()
+        }
+    };
 
-    set_str_value(record, name, |record_ref, string_name| {
-        record_ref.header.name = string_name;
-    }) as c_int
+    Box::into_raw(Box::new(record))
 }
 
-/// Get the number of comments
-/// 
-/// - If the [`Record`] pointer is null, zero is returned.
+/// Read record from file into an existing record
+///
+/// This is the same as [`record_read`] except that the file is read into
+/// `record`, whose strings and arrays are reused instead of allocating new
+/// ones (see [`Record::read_into`]). Reading many files of the same shape
+/// through one record therefore allocates next to nothing after the first.
+///
+/// Pointers previously returned for `record`, such as those of
+/// [`record_get_data_array_ptr`], are invalidated.
+/// - If the file cannot be read, `record` is left blank
 #[no_mangle]
 #[allow(clippy::not_unsafe_ptr_arg_deref)]
-pub extern "C" fn record_get_number_of_comments(record: *mut Record) -> c_int {
+pub extern "C" fn record_read_into(record: *mut Record, filename: *const c_char) -> c_int {
 
     if record.is_null() {
         return update_error_code(ErrorCode::NullArgument) as c_int
     }
 
-    unsafe { &*record }.header.comments.len() as c_int
-}
+    if filename.is_null() {
+        return update_error_code(ErrorCode::NullArgument) as c_int
+    }
 
-/// Get an array of comments
-/// 
-/// - If the [`Record`] pointer is null, a corresponding error code is returned
-/// - If index is out of bounds, a null pointer is returned.
-#[no_mangle]
-#[allow(clippy::not_unsafe_ptr_arg_deref)]
-pub extern "C" fn record_get_comment(record: *mut Record, idx: size_t) -> *const c_char {
+    let filename_string = match unsafe { CStr::from_ptr(filename) }.to_str() {
+        Ok(s) => s.to_string(),
+        Err(_) => {
+            // The only expected error is due to invalid UTF encoding
+            return update_error_code(ErrorCode::InvalidUTF8String) as c_int
+        }
+    };
 
-    check_ptr_index_transform_to_cstring(
-        record, idx,
-        |record_ref| { &record_ref.header.comments },
-        |comments, idx| { &comments[idx] })
-}
+    let record_ref = unsafe { &mut *record };
 
-/// Append to an array of comments
-/// 
-/// - If the [`Record`] pointer is null, a corresponding error code is returned
-#[no_mangle]
-#[allow(clippy::not_unsafe_ptr_arg_deref)]
-pub extern "C" fn record_append_comment(record: *mut Record, comment: *const c_char) -> c_int {
+    let mut file = match File::open(filename_string) {
+        Ok(f) => f,
+        Err(err) => {
+            *record_ref = Record::blank();
+            return map_io_error_to_error_code(err) as c_int
+        }
+    };
 
-    set_str_value(record, comment, |record_ref, string_comment| {
-        record_ref.header.comments.push(string_comment);
-    }) as c_int
+    match record_ref.read_into(&mut file) {
+        Ok(_) => update_error_code(ErrorCode::NoError) as c_int,
+        Err(err) => map_record_error_to_error_code(err) as c_int,
+    }
 }
 
-/// Get the number of devices
-/// 
-/// - If the [`Record`] pointer is null, zero is returned.
+/// Read record from file, skipping what is not needed
+///
+/// This is the same as [`record_read`] except that only part of the file
+/// may be parsed (see [`Record::from_reader_with_options`]):
+/// - A non-zero `header_only` stops reading at the first `BEGIN`, leaving
+/// every data array without samples
+/// - `data_arrays` holds the `number_of_data_arrays` names of the data arrays
+/// to read; the others are skipped and left out of the record. A null
+/// `data_arrays` or a zero `number_of_data_arrays` reads all of them.
+///
+/// This allocates memory and must be destroyed by the caller
+/// (see [`record_destroy`]).
+/// - A null pointer is returned if the filename or one of the names is null,
+/// a file corresponding to the filename does not exist, or the file cannot be read
 #[no_mangle]
 #[allow(clippy::not_unsafe_ptr_arg_deref)]
-pub extern "C" fn record_get_number_of_devices(record: *mut Record) -> c_int {
+pub extern "C" fn record_read_with_options(
+    filename: *const c_char,
+    header_only: c_int,
+    data_arrays: *const *const c_char,
+    number_of_data_arrays: size_t) -> *mut Record {
 
-    if record.is_null() {
-        return update_error_code(ErrorCode::NullArgument) as c_int
+    if filename.is_null() {
+        update_error_code(ErrorCode::NullArgument);
+        return std::ptr::null_mut()
     }
 
-    unsafe { &*record }.header.devices.len() as c_int
-}
+    let filename_string = match unsafe { CStr::from_ptr(filename) }.to_str() {
+        Ok(s) => s.to_string(),
+        Err(_) => {
+            // The only expected error is due to invalid UTF encoding
+            update_error_code(ErrorCode::InvalidUTF8String);
+            return std::ptr::null_mut()
+        }
+    };
 
-/// Get the device name
-/// 
-/// - If the [`Record`] pointer is null, a null pointer is returned.
-/// - If the index is out of bounds, a null pointer is returned.
-#[no_mangle]
-#[allow(clippy::not_unsafe_ptr_arg_deref)]
-pub extern "C" fn record_get_device_name(record: *mut Record, idx: size_t) -> *const c_char {
+    let mut options = ReadOptions {
+        header_only: header_only != 0,
+        data_arrays: None,
+    };
 
-    check_ptr_index_transform_to_cstring(
-        record, idx,
-        |record_ref| { &record_ref.header.devices },
-        |devices, idx| { &devices[idx].name })
+    if !data_arrays.is_null() && number_of_data_arrays > 0 {
+        let names = unsafe { std::slice::from_raw_parts(data_arrays, number_of_data_arrays) };
+        let mut selected = Vec::with_capacity(names.len());
+
+        for &name in names {
+            if name.is_null() {
+                update_error_code(ErrorCode::NullArgument);
+                return std::ptr::null_mut()
+            }
+
+            match unsafe { CStr::from_ptr(name) }.to_str() {
+                Ok(s) => selected.push(s.to_string()),
+                Err(_) => {
+                    // The only expected error is due to invalid UTF encoding
+                    update_error_code(ErrorCode::InvalidUTF8String);
+                    return std::ptr::null_mut()
+                }
+            }
+        }
+
+        options.data_arrays = Some(selected);
+    }
+
+    let mut file = match File::open(filename_string) {
+        Ok(f) => f,
+        Err(err) => {
+            map_io_error_to_error_code(err);
+            return std::ptr::null_mut()
+        }
+    };
+
+    let record = match Record::from_reader_with_options(&mut file, &options) {
+        Ok(r) => r,
+        Err(err) => {
+            map_record_error_to_error_code(err);
+            return std::ptr::null_mut()
+        }
+    };
+
+    Box::into_raw(Box::new(record))
 }
 
-/// Append to an array of devices
-/// 
-/// - If the [`Record`] pointer is null, a corresponding error code is returned
+/// Read record from file while counting and timing the read
+///
+/// This is the same as [`record_read`] except that the counts and times
+/// of [`Record::from_reader_with_stats`] are added to `stats`, which is
+/// also done for a read that fails.
+///
+/// - A null pointer is returned if the filename or `stats` is null, a file
+/// corresponding to the filename does not exist or there is a record
+/// read error.
 #[no_mangle]
 #[allow(clippy::not_unsafe_ptr_arg_deref)]
-pub extern "C" fn record_append_device(record: *mut Record, name: *const c_char) -> c_int {
+pub extern "C" fn record_read_with_stats(filename: *const c_char, stats: *mut ReadStats) -> *mut Record {
 
-    set_str_value(record, name, |record_ref, device_name| {
-        record_ref.header.devices.push(Device::new(&device_name));
-    }) as c_int
+    if filename.is_null() || stats.is_null() {
+        update_error_code(ErrorCode::NullArgument);
+        return std::ptr::null_mut()
+    }
+
+    let filename_string = match unsafe { CStr::from_ptr(filename) }.to_str() {
+        Ok(s) => s.to_string(),
+        Err(_) => {
+            // The only expected error is due to invalid UTF encoding
+            update_error_code(ErrorCode::InvalidUTF8String);
+            return std::ptr::null_mut()
+        }
+    };
+
+    let mut file = match File::open(filename_string) {
+        Ok(f) => f,
+        Err(err) => {
+            map_io_error_to_error_code(err);
+            return std::ptr::null_mut()
+        }
+    };
+
+    let stats_ref = unsafe { &mut *stats };
+    let record = match Record::from_reader_with_stats(&mut file, &ReadOptions::default(), stats_ref) {
+        Ok(r) => r,
+        Err(err) => {
+            map_record_error_to_error_code(err);
+            return std::ptr::null_mut()
+        }
+    };
+
+    Box::into_raw(Box::new(record))
 }
 
-/// Get the number of entries in a device
-/// 
-/// - If the [`Record`] pointer is null, zero.
-/// - If the index is out of bounds, zero.
+/// Read record from a file written by [`record_write_binary`]
+///
+/// Nothing is parsed: the floats are copied straight out of the file, which
+/// is memory mapped when possible (see [`Record::from_path_binary`]).
+///
+/// This allocates memory and must be destroyed by the caller
+/// (see [`record_destroy`]).
+/// - A null pointer is returned if the filename is null, a file corresponding
+/// to the filename does not exist, or the file is not a valid binary record
 #[no_mangle]
 #[allow(clippy::not_unsafe_ptr_arg_deref)]
-pub extern "C" fn record_get_device_number_of_entries(record: *mut Record, idx: size_t) -> c_int {
+pub extern "C" fn record_read_binary(filename: *const c_char) -> *mut Record {
 
-    if record.is_null() {
-        return update_error_code(ErrorCode::NullArgument) as c_int
+    if filename.is_null() {
+        update_error_code(ErrorCode::NullArgument);
+        return std::ptr::null_mut()
     }
 
-    let record_ref = unsafe { &*record };
-    if check_index_bounds(idx, record_ref.header.devices.len()) == false {
-        return update_error_code(ErrorCode::IndexOutOfBounds) as c_int
-    }
+    let filename_string = match unsafe { CStr::from_ptr(filename) }.to_str() {
+        Ok(s) => s.to_string(),
+        Err(_) => {
+            // The only expected error is due to invalid UTF encoding
+            update_error_code(ErrorCode::InvalidUTF8String);
+            return std::ptr::null_mut()
+        }
+    };
 
-    record_ref.header.devices[idx].entries.len() as c_int
+    let record = match Record::from_path_binary(filename_string) {
+        Ok(r) => r,
+        Err(Error::ReadError(ReadError::ReadingError(err))) => {
+            map_io_error_to_error_code(err);
+            return std::ptr::null_mut()
+        }
+        Err(err) => {
+            map_record_error_to_error_code(err);
+            return std::ptr::null_mut()
+        }
+    };
+
+    Box::into_raw(Box::new(record))
 }
 
-/// Get the entry from a device
-/// 
-/// - If the [`Record`] pointer is null, zero.
-/// - If the index is out of bounds, zero.
+/// Read record from file through a binary copy kept next to it
+///
+/// This is the same as [`record_read`] except that a binary copy of the
+/// record is kept at the filename with `.bin` appended and read instead
+/// while the file keeps the same size and modification time (see
+/// [`Record::from_path_cached`]).
+///
+/// This allocates memory and must be destroyed by the caller
+/// (see [`record_destroy`]).
+/// - A null pointer is returned if the filename is null, a file corresponding
+/// to the filename does not exist, or the file cannot be read
 #[no_mangle]
 #[allow(clippy::not_unsafe_ptr_arg_deref)]
-pub extern "C" fn record_get_device_entry(record: *mut Record, device_idx: size_t, entry_idx: size_t) -> *const c_char {
+pub extern "C" fn record_read_cached(filename: *const c_char) -> *mut Record {
 
-    if record.is_null() {
+    if filename.is_null() {
         update_error_code(ErrorCode::NullArgument);
         return std::ptr::null_mut()
     }
 
-    let record_ref = unsafe { &*record };
-    if check_index_bounds(device_idx, record_ref.header.devices.len()) == false {
-        update_error_code(ErrorCode::IndexOutOfBounds);
-        return std::ptr::null_mut();
+    let filename_string = match unsafe { CStr::from_ptr(filename) }.to_str() {
+        Ok(s) => s.to_string(),
+        Err(_) => {
+            // The only expected error is due to invalid UTF encoding
+            update_error_code(ErrorCode::InvalidUTF8String);
+            return std::ptr::null_mut()
+        }
+    };
+
+    let record = match Record::from_path_cached(filename_string) {
+        Ok(r) => r,
+        Err(Error::ReadError(ReadError::ReadingError(err))) => {
+            map_io_error_to_error_code(err);
+            return std::ptr::null_mut()
+        }
+        Err(err) => {
+            map_record_error_to_error_code(err);
+            return std::ptr::null_mut()
+        }
+    };
+
+    Box::into_raw(Box::new(record))
+}
+
+/// Read many records on a pool of threads
+///
+/// Each of the `number_of_files` filenames is read as with [`record_read_mmap`]
+/// by one of up to `threads` workers (see [`crate::read_many`]). A `threads`
+/// of 0 uses one thread per available core.
+///
+/// The caller provides `records` and `error_codes`, each with room for
+/// `number_of_files` values. For every file, either a record is stored in
+/// `records` and `NoError` in `error_codes`, or a null pointer is stored in
+/// `records` and the reason the file could not be read in `error_codes`.
+/// The records that are returned must be destroyed by the caller
+/// (see [`record_destroy`]).
+///
+/// The workers never touch the last error code. It is only updated on the
+/// calling thread, with the value that is returned.
+/// - `NullArgument` is returned, and nothing is read, if `filenames`,
+/// `records` or `error_codes` is null
+/// - Otherwise, the error code of the first file that could not be read is
+/// returned, or `NoError` if every file was read
+#[no_mangle]
+#[allow(clippy::not_unsafe_ptr_arg_deref)]
+pub extern "C" fn record_read_many(
+    filenames: *const *const c_char,
+    number_of_files: size_t,
+    threads: size_t,
+    records: *mut *mut Record,
+    error_codes: *mut c_int) -> c_int {
+
+    if filenames.is_null() || records.is_null() || error_codes.is_null() {
+        return update_error_code(ErrorCode::NullArgument) as c_int
     }
 
-    check_ptr_index_transform_to_cstring(
-        record, entry_idx, 
-        |record_ref| { &record_ref.header.devices[device_idx].entries },
-        |entries, idx| { &entries[idx] })
+    let filenames = unsafe { std::slice::from_raw_parts(filenames, number_of_files) };
+    let records = unsafe { std::slice::from_raw_parts_mut(records, number_of_files) };
+    let error_codes = unsafe { std::slice::from_raw_parts_mut(error_codes, number_of_files) };
+
+    // Filenames that cannot be converted are not read at all
+    let paths: Vec<Result<&str, ErrorCode>> = filenames
+        .iter()
+        .map(|&filename| match filename.is_null() {
+            true => Err(ErrorCode::NullArgument),
+            false => unsafe { CStr::from_ptr(filename) }
+                .to_str()
+                .map_err(|_| ErrorCode::InvalidUTF8String),
+        })
+        .collect();
+    let readable: Vec<&str> = paths.iter().filter_map(|path| path.ok()).collect();
+    let mut read = crate::read_many(&readable, threads).into_iter();
+
+    let mut first_error = ErrorCode::NoError;
+    for (i, path) in paths.into_iter().enumerate() {
+        let result = match path {
+            Ok(_) => match read.next() {
+                Some(Ok(record)) => Ok(record),
+                Some(Err(Error::ReadError(ReadError::ReadingError(err)))) => Err(map_io_error_to_error_code(err)),
+                Some(Err(err)) => Err(map_record_error_to_error_code(err)),
+                None => Err(ErrorCode::UnknownError),
+            },
+            Err(error_code) => Err(error_code),
+        };
+
+        match result {
+            Ok(record) => {
+                records[i] = Box::into_raw(Box::new(record));
+                error_codes[i] = ErrorCode::NoError as c_int;
+            }
+            Err(error_code) => {
+                records[i] = std::ptr::null_mut();
+                error_codes[i] = error_code as c_int;
+                if first_error == ErrorCode::NoError {
+                    first_error = error_code;
+                }
+            }
+        }
+    }
+
+    update_error_code(first_error) as c_int
 }
 
-/// Append to an array of entries for a given device
-/// 
-/// - If the [`Record`] pointer is null, a corresponding error code is returned
+/// Export many record files into a single Parquet file
+///
+/// The `number_of_files` filenames are read one at a time and written to
+/// `output` as described in [`crate::columnar`], with the samples of each data
+/// array split into `_re` and `_im` columns, or kept together as structs when
+/// `struct_samples` is not 0. See [`crate::columnar::write_parquet_files`].
+///
+/// The error code is returned, and is `RecordColumnarErrorUnsupported` when
+/// the library was built without the `columnar` feature.
 #[no_mangle]
 #[allow(clippy::not_unsafe_ptr_arg_deref)]
-pub extern "C" fn record_append_entry_to_device(
-    record: *mut Record, device_idx: size_t, entry: *const c_char) -> c_int {
+pub extern "C" fn record_export_parquet(
+    filenames: *const *const c_char,
+    number_of_files: size_t,
+    output: *const c_char,
+    struct_samples: c_int) -> c_int {
 
-    if record.is_null() || entry.is_null() {
+    if filenames.is_null() || output.is_null() {
         return update_error_code(ErrorCode::NullArgument) as c_int
     }
 
-    let record_ref = unsafe { &mut *record };
-    if check_index_bounds(device_idx, record_ref.header.devices.len()) == false {
-        return update_error_code(ErrorCode::IndexOutOfBounds) as c_int
+    let filenames = unsafe { std::slice::from_raw_parts(filenames, number_of_files) };
+    let mut paths = Vec::with_capacity(number_of_files);
+    for &filename in filenames.iter().chain(std::iter::once(&output)) {
+        if filename.is_null() {
+            return update_error_code(ErrorCode::NullArgument) as c_int
+        }
+        match unsafe { CStr::from_ptr(filename) }.to_str() {
+            Ok(path) => paths.push(path),
+            Err(_) => return update_error_code(ErrorCode::InvalidUTF8String) as c_int,
+        }
     }
+    let output = paths.pop().unwrap_or_default();
 
-    let entry_str = match unsafe { CStr::from_ptr(entry) }.to_str() {
-        Ok(s) => s.to_string(),
-        Err(_) => {
-            // The only expected error is due to invalid utf8 encoding
-            return ErrorCode::InvalidUTF8String as c_int
-        }
+    let options = crate::columnar::ColumnarOptions {
+        samples: match struct_samples {
+            0 => crate::columnar::SampleColumns::Split,
+            _ => crate::columnar::SampleColumns::Struct,
+        },
     };
+    match crate::columnar::write_parquet_files(&paths, output, options) {
+        Ok(_) => update_error_code(ErrorCode::NoError) as c_int,
+        Err(Error::ReadError(ReadError::ReadingError(err))) => map_io_error_to_error_code(err) as c_int,
+        Err(err) => map_record_error_to_error_code(err) as c_int,
+    }
+}
 
-    record_ref.header.devices[device_idx].entries.push(entry_str);
-
-    ErrorCode::NoError as c_int
+/// Create a push parser for a record that arrives in pieces
+///
+/// See [`RecordParser`]. This allocates memory and must be released by the
+/// caller, either with [`record_parser_finish`] or [`record_parser_destroy`].
+#[no_mangle]
+pub extern "C" fn record_parser_new() -> *mut RecordParser {
+    Box::into_raw(Box::new(RecordParser::new()))
 }
 
-/// Get independent variable name
-/// 
-/// - If the [`Record`] pointer is null, return null pointer.
+/// Free a pointer to `RecordParser` without finishing it
+///
+/// This can be called on `null`, like [`record_destroy`]. The record
+/// returned by [`record_parser_get_record`] is freed with it.
 #[no_mangle]
 #[allow(clippy::not_unsafe_ptr_arg_deref)]
-pub extern "C" fn record_get_independent_variable_name(record: *mut Record) -> *const c_char {
+pub extern "C" fn record_parser_destroy(parser: *mut RecordParser) -> c_int {
+    if parser.is_null() {
+        return update_error_code(ErrorCode::NullArgument) as c_int
+    }
 
-    check_ptr_transform_to_cstring(record, |record_ref| { &record_ref.header.independent_variable.name[..] })
+    release_record_cache(record_parser_get_record(parser));
+    unsafe { drop(Box::from_raw(parser)) }
+
+    update_error_code(ErrorCode::NoError) as c_int
 }
 
-/// Get independent variable format
-/// 
-/// - If the [`Record`] pointer is null, return null pointer.
+/// Parse the `length` bytes at `bytes`
+///
+/// Every line completed by the bytes is parsed; a line split across calls
+/// is held back until the rest of it arrives (see [`RecordParser::feed`]).
+/// A line longer than 1 MiB returns `RecordReadErrorLineTooLong`. Once an
+/// error has been returned, every later call returns
+/// `RecordReadErrorParserFailed`.
 #[no_mangle]
 #[allow(clippy::not_unsafe_ptr_arg_deref)]
-pub extern "C" fn record_get_independent_variable_format(record: *mut Record) -> *const c_char {
+pub extern "C" fn record_parser_feed(parser: *mut RecordParser, bytes: *const c_char, length: size_t) -> c_int {
+    if parser.is_null() || bytes.is_null() {
+        return update_error_code(ErrorCode::NullArgument) as c_int
+    }
 
-    check_ptr_transform_to_cstring(record, |record_ref| { &record_ref.header.independent_variable.format[..] })
+    let bytes = unsafe { std::slice::from_raw_parts(bytes as *const u8, length) };
+    match unsafe { &mut *parser }.feed(bytes) {
+        Ok(()) => update_error_code(ErrorCode::NoError) as c_int,
+        Err(err) => map_record_error_to_error_code(err) as c_int,
+    }
 }
 
-/// Get independent variable length
-/// 
-/// - If the [`Record`] pointer is null, return null pointer.
+/// Get the number of data arrays whose `END` has been parsed
+///
+/// Those data arrays are complete and can be read from the record returned
+/// by [`record_parser_get_record`] while later ones are still arriving.
 #[no_mangle]
 #[allow(clippy::not_unsafe_ptr_arg_deref)]
-pub extern "C" fn record_get_independent_variable_length(record: *mut Record) -> c_int {
-
-    if record.is_null() {
+pub extern "C" fn record_parser_get_number_of_finished_data_arrays(parser: *mut RecordParser) -> c_int {
+    if parser.is_null() {
         return update_error_code(ErrorCode::NullArgument) as c_int
     }
 
-    unsafe { &*record }.header.independent_variable.data.len() as c_int
+    unsafe { &*parser }.data_arrays().len() as c_int
 }
 
-/// Get independent variable array
-/// 
-/// - If the [`Record`] pointer is null, return null pointer.
+/// Get the record parsed so far
+///
+/// The record is owned by the parser and must not be destroyed or modified.
+/// Its header and finished data arrays (see
+/// [`record_parser_get_number_of_finished_data_arrays`]) can be read with
+/// the usual getters until the next call that takes the parser.
+/// - If the parser pointer is null, return null pointer.
 #[no_mangle]
 #[allow(clippy::not_unsafe_ptr_arg_deref)]
-pub extern "C" fn record_get_independent_variable_array(record: *mut Record) -> *const c_double {
+pub extern "C" fn record_parser_get_record(parser: *mut RecordParser) -> *mut Record {
+    if parser.is_null() {
+        update_error_code(ErrorCode::NullArgument);
+        return std::ptr::null_mut()
+    }
 
-    if record.is_null() {
+    &mut unsafe { &mut *parser }.state.record
+}
+
+/// Finish parsing once the stream has ended
+///
+/// Any last line without a line ending is parsed and the record is
+/// validated (see [`RecordParser::finish`]). The parser is freed whether or
+/// not the record is valid, so it must not be used again.
+///
+/// This allocates memory and must be destroyed by the caller
+/// (see [`record_destroy`]).
+/// - A null pointer is returned if the parser is null or the record is invalid
+#[no_mangle]
+#[allow(clippy::not_unsafe_ptr_arg_deref)]
+pub extern "C" fn record_parser_finish(parser: *mut RecordParser) -> *mut Record {
+    if parser.is_null() {
         update_error_code(ErrorCode::NullArgument);
         return std::ptr::null_mut()
     }
 
-    unsafe { &*record }.header.independent_variable.data.as_ptr()
+    release_record_cache(record_parser_get_record(parser));
+    let parser = unsafe { Box::from_raw(parser) };
+    match parser.finish() {
+        Ok(record) => Box::into_raw(Box::new(record)),
+        Err(err) => {
+            map_record_error_to_error_code(err);
+            std::ptr::null_mut()
+        }
+    }
 }
 
-/// Set independent variable array
-/// 
-/// - If the [`Record`] pointer is null, return null pointer.
+/// Create a streaming writer to the file at `filename`
+///
+/// See [`RecordWriter`]. A `significant_digits` of 0 writes the shortest
+/// round trip digits, as in [`record_write_with_options`]. The file is
+/// created straight away. This allocates memory and must be released by the
+/// caller, either with [`record_writer_finish`] or [`record_writer_destroy`].
+/// - A null pointer is returned if the file cannot be created
 #[no_mangle]
 #[allow(clippy::not_unsafe_ptr_arg_deref)]
-pub extern "C" fn record_set_independent_variable(
-    record: *mut Record,
-    name: *const c_char, format: *const c_char,
-    vals: *const c_double, len: size_t) -> c_int {
+pub extern "C" fn record_writer_new(filename: *const c_char, significant_digits: size_t) -> *mut RecordWriter<File> {
 
-    if record.is_null() || name.is_null() || format.is_null() || vals.is_null() {
-        return update_error_code(ErrorCode::NullArgument) as c_int
+    if filename.is_null() {
+        update_error_code(ErrorCode::NullArgument);
+        return std::ptr::null_mut()
     }
 
-    let name_str = match unsafe { CStr::from_ptr(name) }.to_str() {
+    let filename_string = match unsafe { CStr::from_ptr(filename) }.to_str() {
         Ok(s) => s.to_string(),
         Err(_) => {
-            // The only expected error is due to invalid utf8 encoding
-            return ErrorCode::InvalidUTF8String as c_int
+            // The only expected error is due to invalid UTF encoding
+            update_error_code(ErrorCode::InvalidUTF8String);
+            return std::ptr::null_mut()
         }
     };
 
-    let format_str = match unsafe { CStr::from_ptr(format) }.to_str() {
-        Ok(s) => s.to_string(),
-        Err(_) => {
-            // The only expected error is due to invalid utf8 encoding
-            return ErrorCode::InvalidUTF8String as c_int
+    match File::create(filename_string) {
+        Ok(file) => Box::into_raw(Box::new(RecordWriter::with_options(file, write_options(significant_digits)))),
+        Err(err) => {
+            map_io_error_to_error_code(err);
+            std::ptr::null_mut()
         }
-    };
+    }
+}
 
-    let vals_slice = unsafe { std::slice::from_raw_parts(vals, len) };
-    let vals = vals_slice.iter().cloned().collect();
+/// Free a pointer to `RecordWriter` without finishing it
+///
+/// Whatever is still buffered is written to the file, which is left
+/// incomplete unless every array was written.
+#[no_mangle]
+#[allow(clippy::not_unsafe_ptr_arg_deref)]
+pub extern "C" fn record_writer_destroy(writer: *mut RecordWriter<File>) -> c_int {
+    if writer.is_null() {
+        return update_error_code(ErrorCode::NullArgument) as c_int
+    }
 
-    let record_ref = unsafe { &mut *record };
-    record_ref.header.independent_variable.name = name_str;
-    record_ref.header.independent_variable.format = format_str;
-    record_ref.header.independent_variable.data = vals;
+    unsafe { drop(Box::from_raw(writer)) }
 
-    ErrorCode::NoError as c_int
+    update_error_code(ErrorCode::NoError) as c_int
 }
 
-/// Get number of data arrays
-/// 
-/// - If the [`Record`] pointer is null, return zero.
+/// Write the header of `record`
+///
+/// Every data array of `record` is declared by its name and format; its
+/// samples are not written. The arrays must then be written in that order
+/// (see [`RecordWriter::begin`]). Once a write to the file fails, every
+/// later call fails as out of order.
 #[no_mangle]
 #[allow(clippy::not_unsafe_ptr_arg_deref)]
-pub extern "C" fn record_get_number_of_data_arrays(record: *mut Record) -> c_int {
-
-    if record.is_null() {
+pub extern "C" fn record_writer_begin(writer: *mut RecordWriter<File>, record: *const Record) -> c_int {
+    if writer.is_null() || record.is_null() {
         return update_error_code(ErrorCode::NullArgument) as c_int
     }
 
-    unsafe { &*record }.data.len() as c_int
+    let record_ref = unsafe { &*record };
+    let declarations: Vec<(&str, &str)> = record_ref.data_declarations().collect();
+    match unsafe { &mut *writer }.begin(&record_ref.header, &declarations) {
+        Ok(()) => update_error_code(ErrorCode::NoError) as c_int,
+        Err(err) => map_record_error_to_error_code(err) as c_int,
+    }
 }
 
-/// Get data array name
-/// 
-/// - If the [`Record`] pointer is null, return null pointer.
-/// - If the index is out of bounds, return null pointer.
+/// Start the next declared data array
 #[no_mangle]
 #[allow(clippy::not_unsafe_ptr_arg_deref)]
-pub extern "C" fn record_get_data_array_name(record: *mut Record, idx: size_t) -> *const c_char {
+pub extern "C" fn record_writer_begin_array(writer: *mut RecordWriter<File>, name: *const c_char, format: *const c_char) -> c_int {
+    if writer.is_null() || name.is_null() || format.is_null() {
+        return update_error_code(ErrorCode::NullArgument) as c_int
+    }
 
-    check_ptr_index_transform_to_cstring(
-        record, idx,
-        |record_ref| { &record_ref.data },
-        |data, idx| { &data[idx].name })
+    let (name_str, format_str) = match (unsafe { CStr::from_ptr(name) }.to_str(), unsafe { CStr::from_ptr(format) }.to_str()) {
+        (Ok(name_str), Ok(format_str)) => (name_str, format_str),
+        // The only expected error is due to invalid UTF encoding
+        _ => return update_error_code(ErrorCode::InvalidUTF8String) as c_int,
+    };
+
+    match unsafe { &mut *writer }.begin_array(name_str, format_str) {
+        Ok(()) => update_error_code(ErrorCode::NoError) as c_int,
+        Err(err) => map_record_error_to_error_code(err) as c_int,
+    }
 }
 
-/// Get data array format
-/// 
-/// - If the [`Record`] pointer is null, return zero.
-/// - If the index is out of bounds, return zero.
+/// Append `length` samples to the current data array
+///
+/// The samples are interleaved as `real, imag` pairs, so `samples` points
+/// to `2 * length` values, as returned by [`record_get_data_array_ptr`].
 #[no_mangle]
 #[allow(clippy::not_unsafe_ptr_arg_deref)]
-pub extern "C" fn record_get_data_array_format(record: *mut Record, idx: size_t) -> *const c_char {
+pub extern "C" fn record_writer_push_samples(writer: *mut RecordWriter<File>, samples: *const c_double, length: size_t) -> c_int {
+    if writer.is_null() || samples.is_null() {
+        return update_error_code(ErrorCode::NullArgument) as c_int
+    }
 
-    check_ptr_index_transform_to_cstring(
-        record, idx,
-        |record_ref| { &record_ref.data },
-        |data, idx| { &data[idx].format })
+    // `Complex<f64>` is `#[repr(C)]` with `re` then `im`
+    let samples = unsafe { std::slice::from_raw_parts(samples as *const Complex<f64>, length) };
+    match unsafe { &mut *writer }.push_samples(samples) {
+        Ok(()) => update_error_code(ErrorCode::NoError) as c_int,
+        Err(err) => map_record_error_to_error_code(err) as c_int,
+    }
 }
 
-/// Get data array length
-/// 
-/// - If the [`Record`] pointer is null, return zero.
+/// Close the current data array
 #[no_mangle]
 #[allow(clippy::not_unsafe_ptr_arg_deref)]
-pub extern "C" fn record_get_data_array_length(record: *mut Record, idx: size_t) -> c_int {
-
-    if record.is_null() {
+pub extern "C" fn record_writer_end_array(writer: *mut RecordWriter<File>) -> c_int {
+    if writer.is_null() {
         return update_error_code(ErrorCode::NullArgument) as c_int
     }
 
-    let record_ref = unsafe { &*record };
-    if check_index_bounds(idx, record_ref.data.len()) == false {
-        return update_error_code(ErrorCode::IndexOutOfBounds) as c_int
+    match unsafe { &mut *writer }.end_array() {
+        Ok(()) => update_error_code(ErrorCode::NoError) as c_int,
+        Err(err) => map_record_error_to_error_code(err) as c_int,
     }
+}
 
-    record_ref.data[idx].samples.len() as c_int
+/// Flush the file once every declared array has been written
+///
+/// The writer is freed whether or not this succeeds, so it must not be
+/// used again (see [`RecordWriter::finish`]).
+#[no_mangle]
+#[allow(clippy::not_unsafe_ptr_arg_deref)]
+pub extern "C" fn record_writer_finish(writer: *mut RecordWriter<File>) -> c_int {
+    if writer.is_null() {
+        return update_error_code(ErrorCode::NullArgument) as c_int
+    }
+
+    let writer = unsafe { Box::from_raw(writer) };
+    match writer.finish() {
+        Ok(_) => update_error_code(ErrorCode::NoError) as c_int,
+        Err(err) => map_record_error_to_error_code(err) as c_int,
+    }
 }
 
-/// Get data array
-/// 
-/// - If the [`Record`] pointer is null, nothing happens.
-/// - If the index is out of bounds, nothing happens.
-/// - Caller is responsible for allocation of the appropriate size and deallocation.
+/// Write record to file
+///
+/// This function will write to a filepath the from the contents
+/// of the given Record. Filenames ending in `.gz` or `.zst` are
+/// compressed (see [`Compression::from_path`]); reading them back with
+/// [`record_read`] and the other readers needs no extra step.
 #[no_mangle]
 #[allow(clippy::not_unsafe_ptr_arg_deref)]
-pub extern "C" fn record_get_data_array(
-    record: *mut Record,
-    idx: size_t,
-    real: *mut c_double, imag: *mut c_double) -> c_int {
+pub extern "C" fn record_write(record: *mut Record, filename: *const c_char) -> c_int {
+    record_write_with_options(record, filename, 0, 1, 0)
+}
 
+/// Write record to file with a fixed number of significant digits
+///
+/// This is the same as [`record_write`] except that the data pairs are
+/// written in E notation with `significant_digits` digits. A value of 0
+/// writes the shortest digits that read back to the same value, which is
+/// what [`record_write`] does.
+///
+/// The data pairs are formatted by `threads` workers, where 0 uses one per
+/// available core and 1 formats them on the calling thread, as
+/// [`record_write`] does (see [`WriteOptions::threads`]). The file is the
+/// same whatever the number of workers.
+///
+/// A non-zero `segments` writes an independent variable that is one linear
+/// sweep as a `SEG_LIST` (see [`WriteOptions::segments`]). A `SEG_LIST`
+/// read from a file is written back as it was either way.
+#[no_mangle]
+#[allow(clippy::not_unsafe_ptr_arg_deref)]
+pub extern "C" fn record_write_with_options(record: *mut Record, filename: *const c_char, significant_digits: size_t, threads: size_t, segments: c_int) -> c_int {
     if record.is_null() {
         return update_error_code(ErrorCode::NullArgument) as c_int
     }
 
-    if real.is_null() {
-        return update_error_code(ErrorCode::NullArgument) as c_int
-    }
-    if imag.is_null() {
+    if filename.is_null() {
         return update_error_code(ErrorCode::NullArgument) as c_int
     }
 
+    let filename_string = match unsafe { CStr::from_ptr(filename) }.to_str() {
+        Ok(s) => s.to_string(),
+        Err(_) => {
+            // The only expected error is due to invalid UTF encoding
+            return update_error_code(ErrorCode::InvalidUTF8String) as c_int
+        }
+    };
+
     let record_ref = unsafe { &*record };
-    if check_index_bounds(idx, record_ref.data.len()) == false {
-        return update_error_code(ErrorCode::IndexOutOfBounds) as c_int
-    }
 
-    // Fill array
-    for (i, item) in record_ref.data[idx].samples.iter().enumerate() {
-        unsafe {
-            *real.offset(i as isize) = item.re;
-            *imag.offset(i as isize) = item.im;
+    let mut file = match File::create(&filename_string) {
+        Ok(f) => f,
+        Err(err) => {
+            return map_io_error_to_error_code(err) as c_int
         }
+    };
+
+    let options = WriteOptions {
+        compression: Compression::from_path(&filename_string),
+        threads,
+        segments: segments != 0,
+        ..write_options(significant_digits)
+    };
+    if let Err(err) = record_ref.to_writer_with_options(&mut file, &options) {
+        return map_record_error_to_error_code(err) as c_int
     }
 
     ErrorCode::NoError as c_int
 }
 
-/// Append data array
-/// 
-/// - If the [`Record`] pointer is null, a corresponding error code is returned
+/// Write record to file while counting and timing the write
+///
+/// This is the same as [`record_write_with_options`] except that the
+/// counts and times of [`Record::to_writer_with_stats`] are added to
+/// `stats`, which is also done for a write that fails.
 #[no_mangle]
 #[allow(clippy::not_unsafe_ptr_arg_deref)]
-pub extern "C" fn record_append_data_array(
-    record: *mut Record, name: *const c_char, format: *const c_char,
-    reals: *const c_double, imags: *const c_double, len: size_t) -> c_int {
-
-    if record.is_null() ||
-        name.is_null() || format.is_null() ||
-        reals.is_null() || imags.is_null() {
+pub extern "C" fn record_write_with_stats(record: *mut Record, filename: *const c_char, significant_digits: size_t, threads: size_t, segments: c_int, stats: *mut WriteStats) -> c_int {
+    if record.is_null() || filename.is_null() || stats.is_null() {
         return update_error_code(ErrorCode::NullArgument) as c_int
     }
 
-    let name_str = match unsafe { CStr::from_ptr(name) }.to_str() {
+    let filename_string = match unsafe { CStr::from_ptr(filename) }.to_str() {
         Ok(s) => s.to_string(),
         Err(_) => {
-            // The only expected error is due to invalid utf8 encoding
-            return ErrorCode::InvalidUTF8String as c_int
+            // The only expected error is due to invalid UTF encoding
+            return update_error_code(ErrorCode::InvalidUTF8String) as c_int
         }
     };
 
-    let format_str = match unsafe { CStr::from_ptr(format) }.to_str() {
-        Ok(s) => s.to_string(),
-        Err(_) => {
-            // The only expected error is due to invalid utf8 encoding
-            return ErrorCode::InvalidUTF8String as c_int
+    let record_ref = unsafe { &*record };
+    let stats_ref = unsafe { &mut *stats };
+
+    let mut file = match File::create(&filename_string) {
+        Ok(f) => f,
+        Err(err) => {
+            return map_io_error_to_error_code(err) as c_int
         }
     };
 
-    let reals_slice = unsafe { std::slice::from_raw_parts(reals, len) };
-    let imags_slice = unsafe { std::slice::from_raw_parts(imags, len) };
-    let samples = reals_slice.iter()
-        .zip(imags_slice.iter())
-        .map(|(re, im)| Complex::<f64>::new(*re, *im))
-        .collect();
-
-    let record_ref = unsafe { &mut *record };
-    record_ref.data.push(DataArray {
-        name: name_str,
-        format: format_str,
-        samples: samples
-    });
+    let options = WriteOptions {
+        compression: Compression::from_path(&filename_string),
+        threads,
+        segments: segments != 0,
+        ..write_options(significant_digits)
+    };
+    if let Err(err) = record_ref.to_writer_with_stats(&mut file, &options, stats_ref) {
+        return map_record_error_to_error_code(err) as c_int
+    }
 
     ErrorCode::NoError as c_int
 }
 
-/// Create null pointer
-#[cfg(test)]
-fn null_setup() -> *mut Record {
-    std::ptr::null_mut()
+/// A `significant_digits` of 0 writes the shortest round trip digits
+fn write_options(significant_digits: size_t) -> WriteOptions {
+    WriteOptions {
+        data_format: match significant_digits {
+            0 => FloatFormat::RoundTrip,
+            n => FloatFormat::SignificantDigits(n),
+        },
+        ..WriteOptions::default()
+    }
 }
 
-/// Create pointer from `record_default`
-#[cfg(test)]
-fn default_setup() -> *mut Record {
-    record_default()
-}
+/// Write record to file in the binary format
+///
+/// The file is read back with [`record_read_binary`]. Unlike [`record_write`],
+/// any record can be written.
+#[no_mangle]
+#[allow(clippy::not_unsafe_ptr_arg_deref)]
+pub extern "C" fn record_write_binary(record: *mut Record, filename: *const c_char) -> c_int {
+    if record.is_null() {
+        return update_error_code(ErrorCode::NullArgument) as c_int
+    }
 
-/// Release Record pointer
-#[cfg(test)]
-fn teardown(record_ptr: *mut Record) {
-    record_destroy(record_ptr);
-}
+    if filename.is_null() {
+        return update_error_code(ErrorCode::NullArgument) as c_int
+    }
 
-/// Test runner to handle creation and destruction of pointer
-#[cfg(test)]
-fn test_runner<S, T>(setup_fn: S, test_fn: T) -> () where
-    S: Fn() -> *mut Record,
-    T: FnOnce(*mut Record) -> () + std::panic::UnwindSafe
-{
-    // Setup
-    let record_ptr: *mut Record = setup_fn();
+    let filename_string = match unsafe { CStr::from_ptr(filename) }.to_str() {
+        Ok(s) => s.to_string(),
+        Err(_) => {
+            // The only expected error is due to invalid UTF encoding
+            return update_error_code(ErrorCode::InvalidUTF8String) as c_int
+        }
+    };
 
-    // Run test
-    let result = std::panic::catch_unwind(|| {
-        test_fn(record_ptr)
-    });
+    let record_ref = unsafe { &*record };
 
-    // Teardown
-    teardown(record_ptr);
+    let mut file = match File::create(filename_string) {
+        Ok(f) => f,
+        Err(err) => {
+            return map_io_error_to_error_code(err) as c_int
+        }
+    };
 
-    // Assert
-    assert!(result.is_ok())
+    if let Err(err) = record_ref.to_binary_writer(&mut file) {
+        return map_record_error_to_error_code(err) as c_int
+    }
+
+    ErrorCode::NoError as c_int
 }
 
-#[cfg(test)]
-mod test_runners {
-    use super::*;
+/// Get the record version
+/// 
+/// - If the [`Record`] pointer is null, null is returned.
+/// - If the current version cannot be cast to [`std::ffi::CString`], null is returned.
+/// - Returned version in null terminated
+#[no_mangle]
+#[allow(clippy::not_unsafe_ptr_arg_deref)]
+pub extern "C" fn record_get_version(record: *mut Record) -> *const c_char {
 
-    mod null {
-        use super::*;
+    check_ptr_transform_to_cstring(record, StringField::Version, |record_ref| { &record_ref.header.version[..] })
+}
 
-        #[test]
-        fn null_is_passed() {
-            test_runner(null_setup, |record_ptr| {
-                assert!(record_ptr.is_null());
-            });
-        }
 
-        #[test]
-        fn pass_passes() {
-            test_runner(null_setup, |_record_ptr| {
-                assert!(true);
-            });
-        }
+/// Set the record version
+/// 
+/// - If the [`Record`] pointer is null, the function does nothing and returns.
+/// - If the version pointer is null, the function does nothing and returns.
+/// - Input string should be UTF-8 encoded
+#[no_mangle]
+#[allow(clippy::not_unsafe_ptr_arg_deref)]
+pub extern "C" fn record_set_version(record: *mut Record, version: *const c_char) -> c_int {
 
-        #[test]
-        #[should_panic]
-        fn fail_fails() {
+    set_str_value(record, version, |record_ref, string_version| {
+        record_ref.header.version = string_version;
+    }) as c_int
+}
+
+/// Get the record name
+/// 
+/// - If the [`Record`] pointer is null, null is returned.
+/// - If the current name cannot be cast to [`std::ffi::CString`], null is returned.
+/// - Returned name in null terminated
+#[no_mangle]
+#[allow(clippy::not_unsafe_ptr_arg_deref)]
+pub extern "C" fn record_get_name(record: *mut Record) -> *const c_char {
+
+    check_ptr_transform_to_cstring(record, StringField::Name, |record_ref| { &record_ref.header.name[..] })
+}
+
+/// Set the record name
+/// 
+/// - If the [`Record`] pointer is null, the function does nothing and returns.
+/// - If the name pointer is null, the function does nothing and returns.
+/// - Input string should be UTF-8 encoded
+#[no_mangle]
+#[allow(clippy::not_unsafe_ptr_arg_deref)]
+pub extern "C" fn record_set_name(record: *mut Record, name: *const c_char) -> c_int {
+
+    set_str_value(record, name, |record_ref, string_name| {
+        record_ref.header.name = string_name;
+    }) as c_int
+}
+
+/// Get the number of comments
+/// 
+/// - If the [`Record`] pointer is null, zero is returned.
+#[no_mangle]
+#[allow(clippy::not_unsafe_ptr_arg_deref)]
+pub extern "C" fn record_get_number_of_comments(record: *mut Record) -> c_int {
+
+    if record.is_null() {
+        return update_error_code(ErrorCode::NullArgument) as c_int
+    }
+
+    unsafe { &*record }.header.comments.len() as c_int
+}
+
+/// Get an array of comments
+/// 
+/// - If the [`Record`] pointer is null, a corresponding error code is returned
+/// - If index is out of bounds, a null pointer is returned.
+#[no_mangle]
+#[allow(clippy::not_unsafe_ptr_arg_deref)]
+pub extern "C" fn record_get_comment(record: *mut Record, idx: size_t) -> *const c_char {
+
+    check_ptr_index_transform_to_cstring(
+        record, idx, StringField::Comment,
+        |record_ref| { &record_ref.header.comments },
+        |comments, idx| { &comments[idx] })
+}
+
+/// Append to an array of comments
+/// 
+/// - If the [`Record`] pointer is null, a corresponding error code is returned
+#[no_mangle]
+#[allow(clippy::not_unsafe_ptr_arg_deref)]
+pub extern "C" fn record_append_comment(record: *mut Record, comment: *const c_char) -> c_int {
+
+    set_str_value(record, comment, |record_ref, string_comment| {
+        record_ref.header.comments.push(string_comment);
+    }) as c_int
+}
+
+/// Get the number of devices
+/// 
+/// - If the [`Record`] pointer is null, zero is returned.
+#[no_mangle]
+#[allow(clippy::not_unsafe_ptr_arg_deref)]
+pub extern "C" fn record_get_number_of_devices(record: *mut Record) -> c_int {
+
+    if record.is_null() {
+        return update_error_code(ErrorCode::NullArgument) as c_int
+    }
+
+    unsafe { &*record }.header.devices.len() as c_int
+}
+
+/// Get the device name
+/// 
+/// - If the [`Record`] pointer is null, a null pointer is returned.
+/// - If the index is out of bounds, a null pointer is returned.
+#[no_mangle]
+#[allow(clippy::not_unsafe_ptr_arg_deref)]
+pub extern "C" fn record_get_device_name(record: *mut Record, idx: size_t) -> *const c_char {
+
+    check_ptr_index_transform_to_cstring(
+        record, idx, StringField::DeviceName,
+        |record_ref| { &record_ref.header.devices },
+        |devices, idx| { &devices[idx].name })
+}
+
+/// Append to an array of devices
+/// 
+/// - If the [`Record`] pointer is null, a corresponding error code is returned
+#[no_mangle]
+#[allow(clippy::not_unsafe_ptr_arg_deref)]
+pub extern "C" fn record_append_device(record: *mut Record, name: *const c_char) -> c_int {
+
+    set_str_value(record, name, |record_ref, device_name| {
+        record_ref.header.devices.push(Device::new(&device_name));
+    }) as c_int
+}
+
+/// Get the number of entries in a device
+/// 
+/// - If the [`Record`] pointer is null, zero.
+/// - If the index is out of bounds, zero.
+#[no_mangle]
+#[allow(clippy::not_unsafe_ptr_arg_deref)]
+pub extern "C" fn record_get_device_number_of_entries(record: *mut Record, idx: size_t) -> c_int {
+
+    if record.is_null() {
+        return update_error_code(ErrorCode::NullArgument) as c_int
+    }
+
+    let record_ref = unsafe { &*record };
+    if check_index_bounds(idx, record_ref.header.devices.len()) == false {
+        return update_error_code(ErrorCode::IndexOutOfBounds) as c_int
+    }
+
+    record_ref.header.devices[idx].entries.len() as c_int
+}
+
+/// Get the entry from a device
+/// 
+/// - If the [`Record`] pointer is null, zero.
+/// - If the index is out of bounds, zero.
+#[no_mangle]
+#[allow(clippy::not_unsafe_ptr_arg_deref)]
+pub extern "C" fn record_get_device_entry(record: *mut Record, device_idx: size_t, entry_idx: size_t) -> *const c_char {
+
+    if record.is_null() {
+        update_error_code(ErrorCode::NullArgument);
+        return std::ptr::null_mut()
+    }
+
+    let record_ref = unsafe { &*record };
+    if check_index_bounds(device_idx, record_ref.header.devices.len()) == false {
+        update_error_code(ErrorCode::IndexOutOfBounds);
+        return std::ptr::null_mut();
+    }
+
+    check_ptr_index_transform_to_cstring(
+        record, entry_idx, |idx| StringField::DeviceEntry(device_idx, idx),
+        |record_ref| { &record_ref.header.devices[device_idx].entries },
+        |entries, idx| { &entries[idx] })
+}
+
+/// Append to an array of entries for a given device
+/// 
+/// - If the [`Record`] pointer is null, a corresponding error code is returned
+#[no_mangle]
+#[allow(clippy::not_unsafe_ptr_arg_deref)]
+pub extern "C" fn record_append_entry_to_device(
+    record: *mut Record, device_idx: size_t, entry: *const c_char) -> c_int {
+
+    if record.is_null() || entry.is_null() {
+        return update_error_code(ErrorCode::NullArgument) as c_int
+    }
+
+    let record_ref = unsafe { &mut *record };
+    if check_index_bounds(device_idx, record_ref.header.devices.len()) == false {
+        return update_error_code(ErrorCode::IndexOutOfBounds) as c_int
+    }
+
+    let entry_str = match unsafe { CStr::from_ptr(entry) }.to_str() {
+        Ok(s) => s.to_string(),
+        Err(_) => {
+            // The only expected error is due to invalid utf8 encoding
+            return ErrorCode::InvalidUTF8String as c_int
+        }
+    };
+
+    record_ref.header.devices[device_idx].entries.push(entry_str);
+
+    ErrorCode::NoError as c_int
+}
+
+/// Get independent variable name
+/// 
+/// - If the [`Record`] pointer is null, return null pointer.
+#[no_mangle]
+#[allow(clippy::not_unsafe_ptr_arg_deref)]
+pub extern "C" fn record_get_independent_variable_name(record: *mut Record) -> *const c_char {
+
+    check_ptr_transform_to_cstring(record, StringField::IndependentVariableName, |record_ref| { &record_ref.header.independent_variable.name[..] })
+}
+
+/// Get independent variable format
+/// 
+/// - If the [`Record`] pointer is null, return null pointer.
+#[no_mangle]
+#[allow(clippy::not_unsafe_ptr_arg_deref)]
+pub extern "C" fn record_get_independent_variable_format(record: *mut Record) -> *const c_char {
+
+    check_ptr_transform_to_cstring(record, StringField::IndependentVariableFormat, |record_ref| { &record_ref.header.independent_variable.format[..] })
+}
+
+/// Get independent variable length
+/// 
+/// - If the [`Record`] pointer is null, return null pointer.
+#[no_mangle]
+#[allow(clippy::not_unsafe_ptr_arg_deref)]
+pub extern "C" fn record_get_independent_variable_length(record: *mut Record) -> c_int {
+
+    if record.is_null() {
+        return update_error_code(ErrorCode::NullArgument) as c_int
+    }
+
+    unsafe { &*record }.header.independent_variable.len() as c_int
+}
+
+/// Get independent variable array
+/// 
+/// - If the [`Record`] pointer is null, return null pointer.
+#[no_mangle]
+#[allow(clippy::not_unsafe_ptr_arg_deref)]
+pub extern "C" fn record_get_independent_variable_array(record: *mut Record) -> *const c_double {
+
+    if record.is_null() {
+        update_error_code(ErrorCode::NullArgument);
+        return std::ptr::null_mut()
+    }
+
+    unsafe { &*record }.header.independent_variable.data.as_ptr()
+}
+
+/// Set independent variable array
+/// 
+/// - If the [`Record`] pointer is null, return null pointer.
+#[no_mangle]
+#[allow(clippy::not_unsafe_ptr_arg_deref)]
+pub extern "C" fn record_set_independent_variable(
+    record: *mut Record,
+    name: *const c_char, format: *const c_char,
+    vals: *const c_double, len: size_t) -> c_int {
+
+    if record.is_null() || name.is_null() || format.is_null() || vals.is_null() {
+        return update_error_code(ErrorCode::NullArgument) as c_int
+    }
+
+    let name_str = match unsafe { CStr::from_ptr(name) }.to_str() {
+        Ok(s) => s.to_string(),
+        Err(_) => {
+            // The only expected error is due to invalid utf8 encoding
+            return ErrorCode::InvalidUTF8String as c_int
+        }
+    };
+
+    let format_str = match unsafe { CStr::from_ptr(format) }.to_str() {
+        Ok(s) => s.to_string(),
+        Err(_) => {
+            // The only expected error is due to invalid utf8 encoding
+            return ErrorCode::InvalidUTF8String as c_int
+        }
+    };
+
+    let vals_slice = unsafe { std::slice::from_raw_parts(vals, len) };
+    let vals = vals_slice.iter().cloned().collect();
+
+    let record_ref = unsafe { &mut *record };
+    record_ref.header.independent_variable.name = name_str;
+    record_ref.header.independent_variable.format = format_str;
+    record_ref.header.independent_variable.set_data(vals);
+
+    ErrorCode::NoError as c_int
+}
+
+/// Get number of data arrays
+/// 
+/// - If the [`Record`] pointer is null, return zero.
+#[no_mangle]
+#[allow(clippy::not_unsafe_ptr_arg_deref)]
+pub extern "C" fn record_get_number_of_data_arrays(record: *mut Record) -> c_int {
+
+    if record.is_null() {
+        return update_error_code(ErrorCode::NullArgument) as c_int
+    }
+
+    unsafe { &*record }.data.len() as c_int
+}
+
+/// Find data array by name
+///
+/// Returns the index of the first data array called `name`, which can be
+/// passed to the other data array functions. Only the names are compared;
+/// no samples are touched. Each call scans the names, so a caller looking up
+/// many names keeps the indices, as the C++ `Record` does.
+/// - If the [`Record`] pointer or name is null, return the error code.
+/// - If there is no such data array, return [`ErrorCode::NameNotFound`].
+#[no_mangle]
+#[allow(clippy::not_unsafe_ptr_arg_deref)]
+pub extern "C" fn record_find_data_array(record: *mut Record, name: *const c_char) -> c_int {
+
+    if record.is_null() {
+        return update_error_code(ErrorCode::NullArgument) as c_int
+    }
+
+    if name.is_null() {
+        return update_error_code(ErrorCode::NullArgument) as c_int
+    }
+
+    let name_str = match unsafe { CStr::from_ptr(name) }.to_str() {
+        Ok(s) => s,
+        Err(_) => {
+            // The only expected error is due to invalid UTF encoding
+            return update_error_code(ErrorCode::InvalidUTF8String) as c_int
+        }
+    };
+
+    match unsafe { &*record }.index_data_array(name_str) {
+        Some(idx) => idx as c_int,
+        None => update_error_code(ErrorCode::NameNotFound) as c_int,
+    }
+}
+
+/// Get data array name
+/// 
+/// - If the [`Record`] pointer is null, return null pointer.
+/// - If the index is out of bounds, return null pointer.
+#[no_mangle]
+#[allow(clippy::not_unsafe_ptr_arg_deref)]
+pub extern "C" fn record_get_data_array_name(record: *mut Record, idx: size_t) -> *const c_char {
+
+    check_ptr_index_transform_to_cstring(
+        record, idx, StringField::DataArrayName,
+        |record_ref| { &record_ref.data },
+        |data, idx| { &data[idx].name })
+}
+
+/// Get data array format
+/// 
+/// - If the [`Record`] pointer is null, return zero.
+/// - If the index is out of bounds, return zero.
+#[no_mangle]
+#[allow(clippy::not_unsafe_ptr_arg_deref)]
+pub extern "C" fn record_get_data_array_format(record: *mut Record, idx: size_t) -> *const c_char {
+
+    check_ptr_index_transform_to_cstring(
+        record, idx, StringField::DataArrayFormat,
+        |record_ref| { &record_ref.data },
+        |data, idx| { &data[idx].format })
+}
+
+/// Get data array length
+/// 
+/// - If the [`Record`] pointer is null, return zero.
+#[no_mangle]
+#[allow(clippy::not_unsafe_ptr_arg_deref)]
+pub extern "C" fn record_get_data_array_length(record: *mut Record, idx: size_t) -> c_int {
+
+    if record.is_null() {
+        return update_error_code(ErrorCode::NullArgument) as c_int
+    }
+
+    let record_ref = unsafe { &*record };
+    if check_index_bounds(idx, record_ref.data.len()) == false {
+        return update_error_code(ErrorCode::IndexOutOfBounds) as c_int
+    }
+
+    record_ref.data[idx].samples.len() as c_int
+}
+
+/// Get data array
+/// 
+/// - If the [`Record`] pointer is null, nothing happens.
+/// - If the index is out of bounds, nothing happens.
+/// - Caller is responsible for allocation of the appropriate size and deallocation.
+#[no_mangle]
+#[allow(clippy::not_unsafe_ptr_arg_deref)]
+pub extern "C" fn record_get_data_array(
+    record: *mut Record,
+    idx: size_t,
+    real: *mut c_double, imag: *mut c_double) -> c_int {
+
+    if record.is_null() {
+        return update_error_code(ErrorCode::NullArgument) as c_int
+    }
+
+    if real.is_null() {
+        return update_error_code(ErrorCode::NullArgument) as c_int
+    }
+    if imag.is_null() {
+        return update_error_code(ErrorCode::NullArgument) as c_int
+    }
+
+    let record_ref = unsafe { &*record };
+    if check_index_bounds(idx, record_ref.data.len()) == false {
+        return update_error_code(ErrorCode::IndexOutOfBounds) as c_int
+    }
+
+    // Fill array
+    for (i, item) in record_ref.data[idx].samples.iter().enumerate() {
+        unsafe {
+            *real.offset(i as isize) = item.re;
+            *imag.offset(i as isize) = item.im;
+        }
+    }
+
+    ErrorCode::NoError as c_int
+}
+
+/// Get a borrowed pointer to a data array
+///
+/// The samples are interleaved as `re, im, re, im, ...`, which matches the
+/// layout of `std::complex<double>[]`, and there are
+/// [`record_get_data_array_length`] of them. Nothing is copied.
+/// - If the [`Record`] pointer is null, null is returned.
+/// - If the index is out of bounds, null is returned.
+/// - The pointer is owned by the record; it stays valid until the record is
+/// destroyed or its data arrays are modified, and must not be freed.
+#[no_mangle]
+#[allow(clippy::not_unsafe_ptr_arg_deref)]
+pub extern "C" fn record_get_data_array_ptr(record: *mut Record, idx: size_t) -> *const c_double {
+    if record.is_null() {
+        update_error_code(ErrorCode::NullArgument);
+        return std::ptr::null()
+    }
+
+    let record_ref = unsafe { &*record };
+    if check_index_bounds(idx, record_ref.data.len()) == false {
+        update_error_code(ErrorCode::IndexOutOfBounds);
+        return std::ptr::null()
+    }
+
+    // `Complex<f64>` is `#[repr(C)]` with `re` then `im`
+    record_ref.data[idx].samples.as_ptr() as *const c_double
+}
+
+/// Append data array
+/// 
+/// - If the [`Record`] pointer is null, a corresponding error code is returned
+#[no_mangle]
+#[allow(clippy::not_unsafe_ptr_arg_deref)]
+pub extern "C" fn record_append_data_array(
+    record: *mut Record, name: *const c_char, format: *const c_char,
+    reals: *const c_double, imags: *const c_double, len: size_t) -> c_int {
+
+    if record.is_null() ||
+        name.is_null() || format.is_null() ||
+        reals.is_null() || imags.is_null() {
+        return update_error_code(ErrorCode::NullArgument) as c_int
+    }
+
+    let name_str = match unsafe { CStr::from_ptr(name) }.to_str() {
+        Ok(s) => s.to_string(),
+        Err(_) => {
+            // The only expected error is due to invalid utf8 encoding
+            return ErrorCode::InvalidUTF8String as c_int
+        }
+    };
+
+    let format_str = match unsafe { CStr::from_ptr(format) }.to_str() {
+        Ok(s) => s.to_string(),
+        Err(_) => {
+            // The only expected error is due to invalid utf8 encoding
+            return ErrorCode::InvalidUTF8String as c_int
+        }
+    };
+
+    let reals_slice = unsafe { std::slice::from_raw_parts(reals, len) };
+    let imags_slice = unsafe { std::slice::from_raw_parts(imags, len) };
+    let samples = reals_slice.iter()
+        .zip(imags_slice.iter())
+        .map(|(re, im)| Complex::<f64>::new(*re, *im))
+        .collect();
+
+    let record_ref = unsafe { &mut *record };
+    record_ref.data.push(DataArray {
+        name: name_str,
+        format: format_str,
+        samples: samples
+    });
+
+    ErrorCode::NoError as c_int
+}
+
+/// Append data array from interleaved samples
+///
+/// The samples are laid out as `real, imag` pairs, so `samples` points to
+/// `2 * len` values, as returned by [`record_get_data_array_ptr`] and the
+/// layout of `std::complex<double>[]`. They are copied in one go, without
+/// splitting them up as [`record_append_data_array`] needs.
+/// - If the [`Record`] pointer is null, a corresponding error code is returned
+/// - `samples` may only be null when `len` is zero
+#[no_mangle]
+#[allow(clippy::not_unsafe_ptr_arg_deref)]
+pub extern "C" fn record_append_data_array_interleaved(
+    record: *mut Record, name: *const c_char, format: *const c_char,
+    samples: *const c_double, len: size_t) -> c_int {
+
+    if record.is_null() || name.is_null() || format.is_null() || (samples.is_null() && len != 0) {
+        return update_error_code(ErrorCode::NullArgument) as c_int
+    }
+
+    let name_str = match unsafe { CStr::from_ptr(name) }.to_str() {
+        Ok(s) => s.to_string(),
+        Err(_) => {
+            // The only expected error is due to invalid utf8 encoding
+            return ErrorCode::InvalidUTF8String as c_int
+        }
+    };
+
+    let format_str = match unsafe { CStr::from_ptr(format) }.to_str() {
+        Ok(s) => s.to_string(),
+        Err(_) => {
+            // The only expected error is due to invalid utf8 encoding
+            return ErrorCode::InvalidUTF8String as c_int
+        }
+    };
+
+    // `Complex<f64>` is `#[repr(C)]` with `re` then `im`
+    let samples = match len {
+        0 => vec![],
+        _ => unsafe { std::slice::from_raw_parts(samples as *const Complex<f64>, len) }.to_vec(),
+    };
+
+    let record_ref = unsafe { &mut *record };
+    record_ref.data.push(DataArray {
+        name: name_str,
+        format: format_str,
+        samples,
+    });
+
+    ErrorCode::NoError as c_int
+}
+
+/// Convert the samples of a data array to `format` in place
+///
+/// `format` is one of `RI`, `MA` or `DB`, as is the current format of the
+/// array. The format of the array is changed to match (see
+/// [`DataArray::convert_to`]).
+/// - If the [`Record`] pointer is null, a corresponding error code is returned
+/// - If the index is out of bounds, a corresponding error code is returned
+#[no_mangle]
+#[allow(clippy::not_unsafe_ptr_arg_deref)]
+pub extern "C" fn record_convert_data_array(record: *mut Record, idx: size_t, format: *const c_char) -> c_int {
+
+    if record.is_null() || format.is_null() {
+        return update_error_code(ErrorCode::NullArgument) as c_int
+    }
+
+    let format = match parse_data_format(format) {
+        Ok(format) => format,
+        Err(error_code) => return error_code as c_int,
+    };
+
+    let record_ref = unsafe { &mut *record };
+    if check_index_bounds(idx, record_ref.data.len()) == false {
+        return update_error_code(ErrorCode::IndexOutOfBounds) as c_int
+    }
+
+    match record_ref.data[idx].convert_to(format) {
+        Ok(()) => update_error_code(ErrorCode::NoError) as c_int,
+        Err(err) => map_record_error_to_error_code(err) as c_int,
+    }
+}
+
+/// Convert the samples of every data array to `format` in place
+///
+/// This is [`record_convert_data_array`] for each array, spread over up to
+/// `threads` workers where 0 uses one thread per available core. Either all
+/// arrays are converted or none is (see [`Record::convert_data_to`]).
+/// - If the [`Record`] pointer is null, a corresponding error code is returned
+#[no_mangle]
+#[allow(clippy::not_unsafe_ptr_arg_deref)]
+pub extern "C" fn record_convert_data_arrays(record: *mut Record, format: *const c_char, threads: size_t) -> c_int {
+
+    if record.is_null() || format.is_null() {
+        return update_error_code(ErrorCode::NullArgument) as c_int
+    }
+
+    let format = match parse_data_format(format) {
+        Ok(format) => format,
+        Err(error_code) => return error_code as c_int,
+    };
+
+    match unsafe { &mut *record }.convert_data_to(format, threads) {
+        Ok(()) => update_error_code(ErrorCode::NoError) as c_int,
+        Err(err) => map_record_error_to_error_code(err) as c_int,
+    }
+}
+
+/// Parse the name of a [`DataFormat`], setting the error code on failure
+fn parse_data_format(format: *const c_char) -> Result<DataFormat, ErrorCode> {
+    let format_str = match unsafe { CStr::from_ptr(format) }.to_str() {
+        Ok(s) => s,
+        Err(_) => {
+            // The only expected error is due to invalid utf8 encoding
+            return Err(update_error_code(ErrorCode::InvalidUTF8String))
+        }
+    };
+
+    format_str.parse::<DataFormat>().map_err(|err| map_record_error_to_error_code(err.into()))
+}
+
+/// Append a length-prefixed string to a header snapshot
+fn push_snapshot_str(buffer: &mut Vec<u8>, val: &str) {
+    push_snapshot_count(buffer, val.len());
+    buffer.extend_from_slice(val.as_bytes());
+}
+
+/// Append a count or length to a header snapshot
+fn push_snapshot_count(buffer: &mut Vec<u8>, count: usize) {
+    buffer.extend_from_slice(&(count as u64).to_ne_bytes());
+}
+
+/// Pack the header of a record into a string table
+fn write_header_snapshot(record: &Record, buffer: &mut Vec<u8>) {
+    buffer.clear();
+
+    let header = &record.header;
+    push_snapshot_str(buffer, &header.version);
+    push_snapshot_str(buffer, &header.name);
+
+    push_snapshot_count(buffer, header.comments.len());
+    for comment in header.comments.iter() {
+        push_snapshot_str(buffer, comment);
+    }
+
+    push_snapshot_count(buffer, header.devices.len());
+    for device in header.devices.iter() {
+        push_snapshot_str(buffer, &device.name);
+        push_snapshot_count(buffer, device.entries.len());
+        for entry in device.entries.iter() {
+            push_snapshot_str(buffer, entry);
+        }
+    }
+
+    push_snapshot_count(buffer, header.constants.len());
+    for constant in header.constants.iter() {
+        push_snapshot_str(buffer, &constant.name);
+        push_snapshot_str(buffer, &constant.value);
+    }
+
+    push_snapshot_str(buffer, &header.independent_variable.name);
+    push_snapshot_str(buffer, &header.independent_variable.format);
+    push_snapshot_count(buffer, header.independent_variable.len());
+
+    push_snapshot_count(buffer, record.data.len());
+    for data_array in record.data.iter() {
+        push_snapshot_str(buffer, &data_array.name);
+        push_snapshot_str(buffer, &data_array.format);
+        push_snapshot_count(buffer, data_array.samples.len());
+    }
+}
+
+/// Get the whole header in a single call
+///
+/// The header is packed into a table of native-endian `uint64_t` counts
+/// and strings, where each string is a `uint64_t` byte length followed by
+/// that many UTF-8 bytes without a null terminator. In order:
+/// - version, name
+/// - number of comments, then each comment
+/// - number of devices, then for each: name, number of entries, entries
+/// - number of constants, then for each: name, value
+/// - independent variable name, format, length
+/// - number of data arrays, then for each: name, format, length
+///
+/// The size of the table in bytes is written to `length`.
+/// - If the [`Record`] or `length` pointer is null, null is returned.
+/// - The table is owned by the record; it stays valid until the record is
+/// destroyed or this function is called again, and must not be freed.
+#[no_mangle]
+#[allow(clippy::not_unsafe_ptr_arg_deref)]
+pub extern "C" fn record_get_header_snapshot(record: *mut Record, length: *mut size_t) -> *const c_char {
+    if record.is_null() || length.is_null() {
+        update_error_code(ErrorCode::NullArgument);
+        return std::ptr::null()
+    }
+
+    let record_ref = unsafe { &*record };
+    with_record_cache(record, |cache| {
+        write_header_snapshot(record_ref, &mut cache.header_snapshot);
+        unsafe { *length = cache.header_snapshot.len() };
+        cache.header_snapshot.as_ptr() as *const c_char
+    })
+}
+
+/// Read-only record behind the handles of [`record_share`]
+///
+/// Nothing in it changes once it is shared, so the header snapshot is built
+/// up front instead of going through the per record cache.
+pub struct SharedRecord {
+    record: Record,
+    header_snapshot: Vec<u8>,
+}
+
+/// Share a record between threads
+///
+/// The record is moved into a reference counted, immutable handle, so
+/// `record` must not be used or destroyed afterwards. The handle can be read
+/// from any number of threads at once through the `shared_record_*`
+/// functions, which never change the last error code; they return it
+/// instead, or null for pointers. Each thread that keeps the record should
+/// take its own handle with [`record_retain`].
+///
+/// The handle must be released by the caller (see [`record_release`]).
+/// - A null pointer is returned if the record is null
+#[no_mangle]
+#[allow(clippy::not_unsafe_ptr_arg_deref)]
+pub extern "C" fn record_share(record: *mut Record) -> *const SharedRecord {
+    if record.is_null() {
+        update_error_code(ErrorCode::NullArgument);
+        return std::ptr::null()
+    }
+
+    // As for `record_destroy`, strings handed out for it are freed
+    release_record_cache(record);
+    let record = *unsafe { Box::from_raw(record) };
+    let mut header_snapshot = vec![];
+    write_header_snapshot(&record, &mut header_snapshot);
+
+    Arc::into_raw(Arc::new(SharedRecord { record, header_snapshot }))
+}
+
+/// Take another handle to a shared record
+///
+/// The same pointer is returned, and must be released separately. This can
+/// be called on `null`, which is returned.
+#[no_mangle]
+#[allow(clippy::not_unsafe_ptr_arg_deref)]
+pub extern "C" fn record_retain(shared: *const SharedRecord) -> *const SharedRecord {
+    if !shared.is_null() {
+        unsafe { Arc::increment_strong_count(shared) };
+    }
+    shared
+}
+
+/// Release a handle to a shared record
+///
+/// The record is freed with its last handle. This can be called on `null`.
+#[no_mangle]
+#[allow(clippy::not_unsafe_ptr_arg_deref)]
+pub extern "C" fn record_release(shared: *const SharedRecord) -> c_int {
+    if !shared.is_null() {
+        unsafe { Arc::decrement_strong_count(shared) };
+    }
+    ErrorCode::NoError as c_int
+}
+
+/// Copy a shared record into a record of its own
+///
+/// This allocates memory and must be destroyed by the caller
+/// (see [`record_destroy`]).
+/// - A null pointer is returned if the handle is null
+#[no_mangle]
+#[allow(clippy::not_unsafe_ptr_arg_deref)]
+pub extern "C" fn shared_record_copy(shared: *const SharedRecord) -> *mut Record {
+    if shared.is_null() {
+        return std::ptr::null_mut()
+    }
+
+    Box::into_raw(Box::new(unsafe { &*shared }.record.clone()))
+}
+
+/// Get the whole header of a shared record in a single call
+///
+/// The table is laid out as for [`record_get_header_snapshot`] and stays
+/// valid for as long as the handle is held.
+/// - If the handle or `length` pointer is null, null is returned.
+#[no_mangle]
+#[allow(clippy::not_unsafe_ptr_arg_deref)]
+pub extern "C" fn shared_record_get_header_snapshot(shared: *const SharedRecord, length: *mut size_t) -> *const c_char {
+    if shared.is_null() || length.is_null() {
+        return std::ptr::null()
+    }
+
+    let header_snapshot = &unsafe { &*shared }.header_snapshot;
+    unsafe { *length = header_snapshot.len() };
+    header_snapshot.as_ptr() as *const c_char
+}
+
+/// Get a borrowed pointer to the independent variable of a shared record
+///
+/// There are as many values as the length in the header snapshot.
+/// - If the handle is null, null is returned.
+#[no_mangle]
+#[allow(clippy::not_unsafe_ptr_arg_deref)]
+pub extern "C" fn shared_record_get_independent_variable_array(shared: *const SharedRecord) -> *const c_double {
+    if shared.is_null() {
+        return std::ptr::null()
+    }
+
+    unsafe { &*shared }.record.header.independent_variable.data.as_ptr()
+}
+
+/// Find data array of a shared record by name
+///
+/// This is the same as [`record_find_data_array`] except that the error
+/// code is only returned.
+#[no_mangle]
+#[allow(clippy::not_unsafe_ptr_arg_deref)]
+pub extern "C" fn shared_record_find_data_array(shared: *const SharedRecord, name: *const c_char) -> c_int {
+    if shared.is_null() || name.is_null() {
+        return ErrorCode::NullArgument as c_int
+    }
+
+    let name_str = match unsafe { CStr::from_ptr(name) }.to_str() {
+        Ok(s) => s,
+        Err(_) => return ErrorCode::InvalidUTF8String as c_int,
+    };
+
+    match unsafe { &*shared }.record.index_data_array(name_str) {
+        Some(idx) => idx as c_int,
+        None => ErrorCode::NameNotFound as c_int,
+    }
+}
+
+/// Get data array length of a shared record
+///
+/// - If the handle is null or the index is out of bounds, the error code is
+/// returned.
+#[no_mangle]
+#[allow(clippy::not_unsafe_ptr_arg_deref)]
+pub extern "C" fn shared_record_get_data_array_length(shared: *const SharedRecord, idx: size_t) -> c_int {
+    if shared.is_null() {
+        return ErrorCode::NullArgument as c_int
+    }
+
+    match unsafe { &*shared }.record.data.get(idx) {
+        Some(data_array) => data_array.samples.len() as c_int,
+        None => ErrorCode::IndexOutOfBounds as c_int,
+    }
+}
+
+/// Get a borrowed pointer to a data array of a shared record
+///
+/// The samples are laid out as for [`record_get_data_array_ptr`] and stay
+/// valid for as long as the handle is held.
+/// - If the handle is null or the index is out of bounds, null is returned.
+#[no_mangle]
+#[allow(clippy::not_unsafe_ptr_arg_deref)]
+pub extern "C" fn shared_record_get_data_array_ptr(shared: *const SharedRecord, idx: size_t) -> *const c_double {
+    if shared.is_null() {
+        return std::ptr::null()
+    }
+
+    match unsafe { &*shared }.record.data.get(idx) {
+        Some(data_array) => data_array.samples.as_ptr() as *const c_double,
+        None => std::ptr::null(),
+    }
+}
+
+/// Create null pointer
+#[cfg(test)]
+fn null_setup() -> *mut Record {
+    std::ptr::null_mut()
+}
+
+/// Create pointer from `record_default`
+#[cfg(test)]
+fn default_setup() -> *mut Record {
+    record_default()
+}
+
+/// Release Record pointer
+#[cfg(test)]
+fn teardown(record_ptr: *mut Record) {
+    record_destroy(record_ptr);
+}
+
+/// Test runner to handle creation and destruction of pointer
+#[cfg(test)]
+fn test_runner<S, T>(setup_fn: S, test_fn: T) -> () where
+    S: Fn() -> *mut Record,
+    T: FnOnce(*mut Record) -> () + std::panic::UnwindSafe
+{
+    // Setup
+    let record_ptr: *mut Record = setup_fn();
+
+    // Run test
+    let result = std::panic::catch_unwind(|| {
+        test_fn(record_ptr)
+    });
+
+    // Teardown
+    teardown(record_ptr);
+
+    // Assert
+    assert!(result.is_ok())
+}
+
+#[cfg(test)]
+mod test_runners {
+    use super::*;
+
+    mod null {
+        use super::*;
+
+        #[test]
+        fn null_is_passed() {
+            test_runner(null_setup, |record_ptr| {
+                assert!(record_ptr.is_null());
+            });
+        }
+
+        #[test]
+        fn pass_passes() {
+            test_runner(null_setup, |_record_ptr| {
+                assert!(true);
+            });
+        }
+
+        #[test]
+        #[should_panic]
+        fn fail_fails() {
             test_runner(null_setup, |_record_ptr| {
                 assert!(false);
             });
         }
     }
 
-    mod default {
+    mod default {
+        use super::*;
+
+        #[test]
+        fn not_null_is_passed() {
+            test_runner(default_setup, |record_ptr| {
+                assert!(!record_ptr.is_null());
+            });
+        }
+
+        #[test]
+        fn pass_passes() {
+            test_runner(default_setup, |_record_ptr| {
+                assert!(true);
+            });
+        }
+
+        #[test]
+        #[should_panic]
+        fn fail_fails() {
+            test_runner(default_setup, |_record_ptr| {
+                assert!(false);
+            });
+        }
+    }
+}
+
+#[cfg(test)]
+mod interface {
+    use super::*;
+
+    mod record_get_version {
+        use super::*;
+
+        #[test]
+        fn null() {
+            test_runner(null_setup, |record_ptr| {
+                let c_str = record_get_version(record_ptr);
+                assert!(c_str.is_null());
+            });
+        }
+
+        #[test]
+        fn default() {
+            test_runner(default_setup, unsafe { |record_ptr| {
+                let c_str = record_get_version(record_ptr);
+                assert!(!c_str.is_null());
+                assert_eq!(CStr::from_ptr(c_str), &CString::new("A.01.00").unwrap()[..]);
+            }});
+        }
+    }
+
+    mod record_set_version {
+        use super::*;
+
+        #[test]
+        fn null_record() {
+            test_runner(null_setup, |record_ptr| {
+                let version = CString::new("foo").unwrap().into_raw();
+                record_set_version(record_ptr, version);
+                let c_str = record_get_version(record_ptr);
+                assert!(c_str.is_null());
+            });
+        }
+
+        #[test]
+        fn null_version() {
+            test_runner(default_setup, unsafe { |record_ptr| {
+                let version = std::ptr::null_mut();
+                record_set_version(record_ptr, version);
+                let c_str = record_get_version(record_ptr);
+                assert!(!c_str.is_null());
+                assert_eq!(CStr::from_ptr(c_str), &CString::new("A.01.00").unwrap()[..]);
+            }});
+        }
+
+        #[test]
+        fn set_version() {
+            test_runner(default_setup, unsafe { |record_ptr| {
+                let version = CString::new("foo").unwrap().into_raw();
+                record_set_version(record_ptr, version);
+                let c_str = record_get_version(record_ptr);
+                assert!(!c_str.is_null());
+                assert_eq!(CStr::from_ptr(c_str), &CString::new("foo").unwrap()[..]);
+            }});
+        }
+    }
+
+    mod record_get_name {
+        use super::*;
+
+        #[test]
+        fn null() {
+            test_runner(null_setup, |record_ptr| {
+                let c_str = record_get_name(record_ptr);
+                assert!(c_str.is_null());
+            });
+        }
+
+        #[test]
+        fn default() {
+            test_runner(default_setup, unsafe { |record_ptr| {
+                let c_str = record_get_name(record_ptr);
+                assert!(!c_str.is_null());
+                assert_eq!(CStr::from_ptr(c_str), &CString::new("").unwrap()[..]);
+            }});
+        }
+
+        #[test]
+        fn repeated_calls_share_a_pointer() {
+            test_runner(default_setup, |record_ptr| {
+                assert_eq!(record_get_name(record_ptr), record_get_name(record_ptr));
+            });
+        }
+
+        #[test]
+        fn cache_is_released() {
+            let record_ptr = record_default();
+            record_get_name(record_ptr);
+            let cached = |record: *const Record| {
+                lock_record_cache(record)
+                    .as_ref()
+                    .map_or(false, |cache| cache.contains_key(&(record as usize)))
+            };
+            assert!(cached(record_ptr));
+            // Still alive, so no other record can take its address meanwhile
+            release_record_cache(record_ptr);
+            assert!(!cached(record_ptr));
+            record_destroy(record_ptr);
+        }
+
+        #[test]
+        fn follows_set_name() {
+            test_runner(default_setup, unsafe { |record_ptr| {
+                record_get_name(record_ptr);
+                let name = CString::new("foo").unwrap();
+                assert_eq!(record_set_name(record_ptr, name.as_ptr()), 0);
+                let c_str = record_get_name(record_ptr);
+                assert_eq!(CStr::from_ptr(c_str), &name[..]);
+            }});
+        }
+    }
+
+    mod record_get_header_snapshot {
+        use super::*;
+        use std::convert::TryInto;
+
+        /// Walks a header snapshot the way a caller would
+        struct SnapshotReader<'a> {
+            bytes: &'a [u8],
+        }
+
+        impl<'a> SnapshotReader<'a> {
+            fn count(&mut self) -> usize {
+                let (count, rest) = self.bytes.split_at(8);
+                self.bytes = rest;
+                u64::from_ne_bytes(count.try_into().unwrap()) as usize
+            }
+
+            fn string(&mut self) -> &'a str {
+                let length = self.count();
+                let (string, rest) = self.bytes.split_at(length);
+                self.bytes = rest;
+                std::str::from_utf8(string).unwrap()
+            }
+        }
+
+        fn snapshot<'a>(record_ptr: *mut Record) -> SnapshotReader<'a> {
+            let mut length: size_t = 0;
+            let ptr = record_get_header_snapshot(record_ptr, &mut length);
+            assert!(!ptr.is_null());
+            SnapshotReader { bytes: unsafe { std::slice::from_raw_parts(ptr as *const u8, length) } }
+        }
+
+        #[test]
+        fn null() {
+            test_runner(null_setup, |record_ptr| {
+                let mut length: size_t = 0;
+                assert!(record_get_header_snapshot(record_ptr, &mut length).is_null());
+                assert_eq!(get_last_error_code(), ErrorCode::NullArgument as c_int);
+            });
+        }
+
+        #[test]
+        fn null_length() {
+            test_runner(default_setup, |record_ptr| {
+                assert!(record_get_header_snapshot(record_ptr, std::ptr::null_mut()).is_null());
+                assert_eq!(get_last_error_code(), ErrorCode::NullArgument as c_int);
+            });
+        }
+
+        #[test]
+        fn default() {
+            test_runner(default_setup, |record_ptr| {
+                let mut reader = snapshot(record_ptr);
+                assert_eq!(reader.string(), "A.01.00");
+                assert_eq!(reader.string(), "");
+                assert_eq!(reader.count(), 0);
+                assert_eq!(reader.count(), 0);
+                assert_eq!(reader.count(), 0);
+                assert_eq!(reader.string(), "");
+                assert_eq!(reader.string(), "");
+                assert_eq!(reader.count(), 0);
+                assert_eq!(reader.count(), 0);
+                assert!(reader.bytes.is_empty());
+            });
+        }
+
+        #[test]
+        fn full() {
+            let mut record = Record::default();
+            record.header.name = String::from("CAL_SET");
+            record.header.comments.push(String::from("A comment"));
+            record.header.devices.push(Device {
+                name: String::from("NA"),
+                entries: vec![String::from("VERSION HP8510B.05.00"), String::from("REGISTER 1")],
+            });
+            record.header.constants.push(crate::Constant::new("A", "1"));
+            record.header.independent_variable = crate::Var::new("FREQ", "MAG");
+            record.header.independent_variable.data = vec![1., 2.];
+            let mut data_array = DataArray::new("S[1,1]", "RI");
+            data_array.samples = vec![Complex::new(1., 2.); 2];
+            record.data.push(data_array);
+            let record_ptr = Box::into_raw(Box::new(record));
+
+            let mut reader = snapshot(record_ptr);
+            assert_eq!(reader.string(), "A.01.00");
+            assert_eq!(reader.string(), "CAL_SET");
+            assert_eq!(reader.count(), 1);
+            assert_eq!(reader.string(), "A comment");
+            assert_eq!(reader.count(), 1);
+            assert_eq!(reader.string(), "NA");
+            assert_eq!(reader.count(), 2);
+            assert_eq!(reader.string(), "VERSION HP8510B.05.00");
+            assert_eq!(reader.string(), "REGISTER 1");
+            assert_eq!(reader.count(), 1);
+            assert_eq!(reader.string(), "A");
+            assert_eq!(reader.string(), "1");
+            assert_eq!(reader.string(), "FREQ");
+            assert_eq!(reader.string(), "MAG");
+            assert_eq!(reader.count(), 2);
+            assert_eq!(reader.count(), 1);
+            assert_eq!(reader.string(), "S[1,1]");
+            assert_eq!(reader.string(), "RI");
+            assert_eq!(reader.count(), 2);
+            assert!(reader.bytes.is_empty());
+
+            record_destroy(record_ptr);
+        }
+
+        #[test]
+        fn follows_changes() {
+            test_runner(default_setup, |record_ptr| {
+                snapshot(record_ptr);
+                let name = CString::new("foo").unwrap();
+                assert_eq!(record_set_name(record_ptr, name.as_ptr()), 0);
+                let mut reader = snapshot(record_ptr);
+                reader.string();
+                assert_eq!(reader.string(), "foo");
+            });
+        }
+    }
+
+    mod get_error_description {
+        use super::*;
+
+        #[test]
+        fn no_error() {
+            let c_str = get_error_description(ErrorCode::NoError as c_int);
+            assert_eq!(unsafe { CStr::from_ptr(c_str) }.to_str().unwrap(), "No error");
+        }
+
+        #[test]
+        fn repeated_calls_share_a_pointer() {
+            let code = ErrorCode::IndexOutOfBounds as c_int;
+            assert_eq!(get_error_description(code), get_error_description(code));
+        }
+
+        #[test]
+        fn invalid() {
+            let c_str = get_error_description(1);
+            assert_eq!(unsafe { CStr::from_ptr(c_str) }.to_str().unwrap(), "Invalid error code");
+        }
+    }
+
+    mod record_set_name {
+        use super::*;
+
+        #[test]
+        fn null_record() {
+            test_runner(null_setup, |record_ptr| {
+                let name = CString::new("foo").unwrap().into_raw();
+                record_set_name(record_ptr, name);
+                let c_str = record_get_name(record_ptr);
+                assert!(c_str.is_null());
+            });
+        }
+
+        #[test]
+        fn null_version() {
+            test_runner(default_setup, unsafe { |record_ptr| {
+                let name = std::ptr::null_mut();
+                record_set_name(record_ptr, name);
+                let c_str = record_get_name(record_ptr);
+                assert!(!c_str.is_null());
+                assert_eq!(CStr::from_ptr(c_str), &CString::new("").unwrap()[..]);
+            }});
+        }
+
+        #[test]
+        fn set_version() {
+            test_runner(default_setup, unsafe { |record_ptr| {
+                let name = CString::new("foo").unwrap().into_raw();
+                record_set_name(record_ptr, name);
+                let c_str = record_get_name(record_ptr);
+                assert!(!c_str.is_null());
+                assert_eq!(CStr::from_ptr(c_str), &CString::new("foo").unwrap()[..]);
+            }});
+        }
+    }
+
+    mod record_get_number_of_comments {
+        use super::*;
+
+        #[test]
+        fn null() {
+            test_runner(null_setup, |record_ptr| {
+                let count = record_get_number_of_comments(record_ptr);
+                assert_eq!(count, ErrorCode::NullArgument as c_int);
+            });
+        }
+
+        #[test]
+        fn default() {
+            test_runner(default_setup, |record_ptr| {
+                let count = record_get_number_of_comments(record_ptr);
+                assert_eq!(count, 0);
+            });
+        }
+    }
+
+    mod record_get_comment {
+        use super::*;
+
+        #[test]
+        fn null_returns_null() {
+            test_runner(null_setup, |record_ptr| {
+                let comment = record_get_comment(record_ptr, 0_usize);
+                assert!(comment.is_null());
+            });
+        }
+
+        #[test]
+        fn empty_returns_null() {
+            test_runner(default_setup, |record_ptr| {
+                let comment = record_get_comment(record_ptr, 0_usize);
+                assert!(comment.is_null());
+            });
+        }
+    }
+
+    mod record_get_number_of_devices {
+        use super::*;
+
+        #[test]
+        fn null() {
+            test_runner(null_setup, |record_ptr| {
+                let count = record_get_number_of_devices(record_ptr);
+                assert_eq!(count, ErrorCode::NullArgument as c_int);
+            });
+        }
+
+        #[test]
+        fn default() {
+            test_runner(default_setup, |record_ptr| {
+                let count = record_get_number_of_devices(record_ptr);
+                assert_eq!(count, 0);
+            });
+        }
+    }
+
+    mod record_get_device_name {
+        use super::*;
+
+        #[test]
+        fn null_returns_null() {
+            test_runner(null_setup, |record_ptr| {
+                let comment = record_get_device_name(record_ptr, 0_usize);
+                assert!(comment.is_null());
+            });
+        }
+
+        #[test]
+        fn empty_returns_null() {
+            test_runner(default_setup, |record_ptr| {
+                let comment = record_get_device_name(record_ptr, 0_usize);
+                assert!(comment.is_null());
+            });
+        }
+    }
+
+    mod record_get_device_number_of_entries {
+        use super::*;
+
+        #[test]
+        fn null() {
+            test_runner(null_setup, |record_ptr| {
+                let count = record_get_device_number_of_entries(record_ptr, 0_usize);
+                assert_eq!(count, ErrorCode::NullArgument as c_int);
+            });
+        }
+
+        #[test]
+        fn default() {
+            test_runner(default_setup, |record_ptr| {
+                let count = record_get_device_number_of_entries(record_ptr, 0_usize);
+                assert_eq!(count, ErrorCode::IndexOutOfBounds as c_int);
+            });
+        }
+    }
+
+    mod record_get_device_entry {
+        use super::*;
+
+        #[test]
+        fn null_returns_null() {
+            test_runner(null_setup, |record_ptr| {
+                let comment = record_get_device_entry(record_ptr, 0_usize, 0_usize);
+                assert!(comment.is_null());
+            });
+        }
+
+        #[test]
+        fn empty_returns_null() {
+            test_runner(default_setup, |record_ptr| {
+                let comment = record_get_device_entry(record_ptr, 0_usize, 0_usize);
+                assert!(comment.is_null());
+            });
+        }
+    }
+
+    mod record_get_independent_variable_name {
+        use super::*;
+
+        #[test]
+        fn null_returns_null() {
+            test_runner(null_setup, |record_ptr| {
+                let name = record_get_independent_variable_name(record_ptr);
+                assert!(name.is_null());
+            });
+        }
+
+        #[test]
+        fn empty_returns_not_null() {
+            test_runner(default_setup, |record_ptr| {
+                let name = record_get_independent_variable_name(record_ptr);
+                assert!(!name.is_null());
+            });
+        }
+    }
+    
+    mod record_get_independent_variable_format {
+        use super::*;
+
+        #[test]
+        fn null_returns_null() {
+            test_runner(null_setup, |record_ptr| {
+                let name = record_get_independent_variable_format(record_ptr);
+                assert!(name.is_null());
+            });
+        }
+
+        #[test]
+        fn empty_returns_not_null() {
+            test_runner(default_setup, |record_ptr| {
+                let name = record_get_independent_variable_format(record_ptr);
+                assert!(!name.is_null());
+            });
+        }
+    }
+
+    mod record_get_independent_variable_length {
+        use super::*;
+
+        #[test]
+        fn null_returns_zero() {
+            test_runner(null_setup, |record_ptr| {
+                let length = record_get_independent_variable_length(record_ptr);
+                assert_eq!(length, ErrorCode::NullArgument as c_int);
+            });
+        }
+
+        #[test]
+        fn empty_returns_zero() {
+            test_runner(default_setup, |record_ptr| {
+                let length = record_get_independent_variable_length(record_ptr);
+                assert_eq!(length, 0);
+            });
+        }        
+    }
+
+    mod record_get_independent_variable_array {
+        use super::*;
+
+        #[test]
+        fn null_returns_null() {
+            test_runner(null_setup, |record_ptr| {
+                let array = record_get_independent_variable_array(record_ptr);
+                assert!(array.is_null());
+            });
+        }
+
+        #[test]
+        fn empty_returns_not_null() {
+            test_runner(default_setup, |record_ptr| {
+                let array = record_get_independent_variable_array(record_ptr);
+                assert!(!array.is_null());
+            });
+        }
+    }
+
+    mod record_get_number_of_data_arrays {
+        use super::*;
+
+        #[test]
+        fn null_returns_zero() {
+            test_runner(null_setup, |record_ptr| {
+                let number = record_get_number_of_data_arrays(record_ptr);
+                assert_eq!(number, ErrorCode::NullArgument as c_int);
+            });
+        }
+
+        #[test]
+        fn empty_is_zero() {
+            test_runner(default_setup, |record_ptr| {
+                let number = record_get_number_of_data_arrays(record_ptr);
+                assert_eq!(number, 0);
+            });
+        }
+    }
+
+    mod record_find_data_array {
+        use super::*;
+
+        #[test]
+        fn null_record() {
+            let name = CString::new("S").unwrap();
+            assert_eq!(record_find_data_array(std::ptr::null_mut(), name.as_ptr()), ErrorCode::NullArgument as c_int);
+        }
+
+        #[test]
+        fn null_name() {
+            let record_ptr = record_default();
+            let error_code = record_find_data_array(record_ptr, std::ptr::null());
+            record_destroy(record_ptr);
+            assert_eq!(error_code, ErrorCode::NullArgument as c_int);
+        }
+
+        #[test]
+        fn found() {
+            let mut record = Record::default();
+            for name in ["S[1,1]", "S[2,1]", "S[2,1]"].iter() {
+                record.data.push(DataArray::new(name, "RI"));
+            }
+            let record_ptr = Box::into_raw(Box::new(record));
+            let name = CString::new("S[2,1]").unwrap();
+            let missing = CString::new("S[1,2]").unwrap();
+
+            let result = std::panic::catch_unwind(|| {
+                assert_eq!(record_find_data_array(record_ptr, name.as_ptr()), 1);
+                assert_eq!(record_find_data_array(record_ptr, missing.as_ptr()), ErrorCode::NameNotFound as c_int);
+            });
+            record_destroy(record_ptr);
+            assert!(result.is_ok())
+        }
+    }
+
+    mod record_get_data_array_name{
+        use super::*;
+
+        #[test]
+        fn null_returns_null() {
+            test_runner(null_setup, |record_ptr| {
+                let name = record_get_data_array_name(record_ptr, 0);
+                assert!(name.is_null());
+            });
+        }
+
+        #[test]
+        fn empty_returns_null() {
+            test_runner(default_setup, |record_ptr| {
+                let name = record_get_data_array_name(record_ptr, 0);
+                assert!(name.is_null());
+            });
+        }
+    }
+
+    mod record_get_data_array_format {
+        use super::*;
+
+        #[test]
+        fn null_returns_null() {
+            test_runner(null_setup, |record_ptr| {
+                let name = record_get_data_array_format(record_ptr, 0);
+                assert!(name.is_null());
+            });
+        }
+
+        #[test]
+        fn empty_returns_null() {
+            test_runner(default_setup, |record_ptr| {
+                let name = record_get_data_array_format(record_ptr, 0);
+                assert!(name.is_null());
+            });
+        }
+    }
+
+    mod record_get_data_array_ptr {
         use super::*;
 
         #[test]
-        fn not_null_is_passed() {
+        fn null_returns_null() {
+            test_runner(null_setup, |record_ptr| {
+                assert!(record_get_data_array_ptr(record_ptr, 0).is_null());
+                assert_eq!(get_last_error_code(), ErrorCode::NullArgument as c_int);
+            });
+        }
+
+        #[test]
+        fn empty_returns_null() {
             test_runner(default_setup, |record_ptr| {
-                assert!(!record_ptr.is_null());
+                assert!(record_get_data_array_ptr(record_ptr, 0).is_null());
+                assert_eq!(get_last_error_code(), ErrorCode::IndexOutOfBounds as c_int);
             });
         }
 
         #[test]
-        fn pass_passes() {
-            test_runner(default_setup, |_record_ptr| {
-                assert!(true);
+        fn complex_is_two_doubles() {
+            assert_eq!(std::mem::size_of::<Complex<f64>>(), 2 * std::mem::size_of::<c_double>());
+            assert_eq!(std::mem::align_of::<Complex<f64>>(), std::mem::align_of::<c_double>());
+        }
+    }
+
+    mod record_append_data_array_interleaved {
+        use super::*;
+
+        #[test]
+        fn null_returns_error() {
+            let name = CString::new("S").unwrap();
+            let samples = [1., 2.];
+            test_runner(null_setup, |record_ptr| {
+                let error_code = record_append_data_array_interleaved(record_ptr, name.as_ptr(), name.as_ptr(), samples.as_ptr(), 1);
+                assert_eq!(error_code, ErrorCode::NullArgument as c_int);
+            });
+            test_runner(default_setup, |record_ptr| {
+                let error_code = record_append_data_array_interleaved(record_ptr, name.as_ptr(), name.as_ptr(), std::ptr::null(), 1);
+                assert_eq!(error_code, ErrorCode::NullArgument as c_int);
+            });
+        }
+
+        #[test]
+        fn appends_pairs() {
+            let name = CString::new("S").unwrap();
+            let format = CString::new("RI").unwrap();
+            let samples = [1., 2., 3., 4.];
+            test_runner(default_setup, |record_ptr| {
+                let error_code = record_append_data_array_interleaved(record_ptr, name.as_ptr(), format.as_ptr(), samples.as_ptr(), 2);
+                assert_eq!(error_code, ErrorCode::NoError as c_int);
+
+                let record = unsafe { &*record_ptr };
+                assert_eq!(record.data, vec![DataArray {
+                    name: String::from("S"),
+                    format: String::from("RI"),
+                    samples: vec![Complex::new(1., 2.), Complex::new(3., 4.)],
+                }]);
+            });
+        }
+
+        #[test]
+        fn empty_may_be_null() {
+            let name = CString::new("S").unwrap();
+            test_runner(default_setup, |record_ptr| {
+                let error_code = record_append_data_array_interleaved(record_ptr, name.as_ptr(), name.as_ptr(), std::ptr::null(), 0);
+                assert_eq!(error_code, ErrorCode::NoError as c_int);
+                assert_eq!(record_get_data_array_length(record_ptr, 0), 0);
+            });
+        }
+    }
+
+    mod record_convert_data_array {
+        use super::*;
+
+        fn setup() -> *mut Record {
+            let record = record_default();
+            let name = CString::new("S").unwrap();
+            let format = CString::new("RI").unwrap();
+            let samples = [3., 4., 0., 10.];
+            record_append_data_array_interleaved(record, name.as_ptr(), format.as_ptr(), samples.as_ptr(), 2);
+            record
+        }
+
+        #[test]
+        fn null_returns_error() {
+            let format = CString::new("MA").unwrap();
+            test_runner(null_setup, |record_ptr| {
+                assert_eq!(record_convert_data_array(record_ptr, 0, format.as_ptr()), ErrorCode::NullArgument as c_int);
+                assert_eq!(record_convert_data_arrays(record_ptr, format.as_ptr(), 0), ErrorCode::NullArgument as c_int);
+            });
+        }
+
+        #[test]
+        fn out_of_bounds() {
+            let format = CString::new("MA").unwrap();
+            test_runner(setup, |record_ptr| {
+                assert_eq!(record_convert_data_array(record_ptr, 1, format.as_ptr()), ErrorCode::IndexOutOfBounds as c_int);
+            });
+        }
+
+        #[test]
+        fn unsupported_format() {
+            let format = CString::new("XY").unwrap();
+            test_runner(setup, |record_ptr| {
+                assert_eq!(record_convert_data_array(record_ptr, 0, format.as_ptr()), ErrorCode::RecordConvertErrorUnsupportedFormat as c_int);
+                assert_eq!(record_convert_data_arrays(record_ptr, format.as_ptr(), 0), ErrorCode::RecordConvertErrorUnsupportedFormat as c_int);
+            });
+        }
+
+        #[test]
+        fn converts_and_sets_format() {
+            let format = CString::new("DB").unwrap();
+            test_runner(setup, unsafe { |record_ptr| {
+                assert_eq!(record_convert_data_array(record_ptr, 0, format.as_ptr()), ErrorCode::NoError as c_int);
+                assert_eq!(CStr::from_ptr(record_get_data_array_format(record_ptr, 0)), &format[..]);
+                let values = std::slice::from_raw_parts(record_get_data_array_ptr(record_ptr, 0), 4);
+                approx::assert_relative_eq!(values[0], 20. * 5f64.log10());
+                approx::assert_relative_eq!(values[2], 20.);
+                approx::assert_relative_eq!(values[3], 90.);
+            }});
+        }
+
+        #[test]
+        fn converts_every_array() {
+            let format = CString::new("MA").unwrap();
+            test_runner(setup, unsafe { |record_ptr| {
+                assert_eq!(record_convert_data_arrays(record_ptr, format.as_ptr(), 2), ErrorCode::NoError as c_int);
+                assert_eq!(CStr::from_ptr(record_get_data_array_format(record_ptr, 0)), &format[..]);
+                let values = std::slice::from_raw_parts(record_get_data_array_ptr(record_ptr, 0), 4);
+                approx::assert_relative_eq!(values[0], 5.);
+                approx::assert_relative_eq!(values[2], 10.);
+            }});
+        }
+    }
+
+    mod record_get_data_array_length {
+        use super::*;
+
+        #[test]
+        fn null_returns_zero() {
+            test_runner(null_setup, |record_ptr| {
+                let number = record_get_data_array_length(record_ptr, 0);
+                assert_eq!(number, ErrorCode::NullArgument as c_int);
+            });
+        }
+
+        #[test]
+        fn empty_is_zero() {
+            test_runner(default_setup, |record_ptr| {
+                let number = record_get_data_array_length(record_ptr, 0);
+                println!("arr len: {:}", number);
+                assert_eq!(number, ErrorCode::IndexOutOfBounds as c_int);
             });
         }
+    }
+}
+
+#[cfg(test)]
+mod write {
+    use super::*;
+    use tempfile::tempdir;
+
+    #[test]
+    fn null_record() {
+        let filename = CString::new("temp.cti").unwrap();
+        assert_eq!(record_write_with_options(std::ptr::null_mut(), filename.as_ptr(), 6, 1, 0), ErrorCode::NullArgument as c_int);
+    }
+
+    #[test]
+    fn significant_digits() {
+        let tmp = tempdir().unwrap();
+        let path_buf = tmp.path().join("temp.cti");
+        let filename = CString::new(path_buf.clone().into_os_string().into_string().unwrap()).unwrap();
+
+        let mut record = Record::new("A.01.00", "NAME");
+        let mut data_array = DataArray::new("S", "RI");
+        data_array.add_sample(0.78012, -8.98651E-1);
+        record.data.push(data_array);
+        let record_ptr = Box::into_raw(Box::new(record));
+
+        let result = std::panic::catch_unwind(|| {
+            assert_eq!(record_write_with_options(record_ptr, filename.as_ptr(), 6, 1, 0), ErrorCode::NoError as c_int);
+            let contents = std::fs::read_to_string(&path_buf).unwrap();
+            assert!(contents.contains("\nBEGIN\n7.80120E-1,-8.98651E-1\nEND\n"), "{}", contents);
+
+            assert_eq!(record_write(record_ptr, filename.as_ptr()), ErrorCode::NoError as c_int);
+            let contents = std::fs::read_to_string(&path_buf).unwrap();
+            assert!(contents.contains("\nBEGIN\n7.8012E-1,-8.98651E-1\nEND\n"), "{}", contents);
+        });
+        record_destroy(record_ptr);
+        assert!(result.is_ok())
+    }
+
+    #[test]
+    fn segments() {
+        let tmp = tempdir().unwrap();
+        let path_buf = tmp.path().join("temp.cti");
+        let filename = CString::new(path_buf.clone().into_os_string().into_string().unwrap()).unwrap();
+
+        let mut record = Record::new("A.01.00", "NAME");
+        record.header.independent_variable.seq(1e9, 4e9, 10);
+        let mut data_array = DataArray::new("S", "RI");
+        for i in 0..10 {
+            data_array.add_sample(i as f64, 0.);
+        }
+        record.data.push(data_array);
+        let record_ptr = Box::into_raw(Box::new(record));
+
+        let result = std::panic::catch_unwind(|| {
+            assert_eq!(record_write_with_options(record_ptr, filename.as_ptr(), 0, 1, 1), ErrorCode::NoError as c_int);
+            let contents = std::fs::read_to_string(&path_buf).unwrap();
+            assert!(contents.contains("\nSEG_LIST_BEGIN\nSEG 1E9 4E9 10\nSEG_LIST_END\n"), "{}", contents);
+
+            assert_eq!(record_write(record_ptr, filename.as_ptr()), ErrorCode::NoError as c_int);
+            let contents = std::fs::read_to_string(&path_buf).unwrap();
+            assert!(contents.contains("\nVAR_LIST_BEGIN\n"), "{}", contents);
+        });
+        record_destroy(record_ptr);
+        assert!(result.is_ok())
+    }
+
+    #[test]
+    fn threads() {
+        let tmp = tempdir().unwrap();
+        let path_buf = tmp.path().join("temp.cti");
+        let filename = CString::new(path_buf.clone().into_os_string().into_string().unwrap()).unwrap();
+
+        let mut record = Record::new("A.01.00", "NAME");
+        for name in ["S11", "S21", "S12"].iter() {
+            let mut data_array = DataArray::new(name, "RI");
+            for i in 0..1000 {
+                data_array.add_sample(i as f64 * 0.1, -(i as f64));
+            }
+            record.data.push(data_array);
+        }
+        let record_ptr = Box::into_raw(Box::new(record));
+
+        let result = std::panic::catch_unwind(|| {
+            assert_eq!(record_write_with_options(record_ptr, filename.as_ptr(), 0, 1, 0), ErrorCode::NoError as c_int);
+            let sequential = std::fs::read(&path_buf).unwrap();
+            assert_eq!(record_write_with_options(record_ptr, filename.as_ptr(), 0, 0, 0), ErrorCode::NoError as c_int);
+            assert!(std::fs::read(&path_buf).unwrap() == sequential);
+        });
+        record_destroy(record_ptr);
+        assert!(result.is_ok())
+    }
+}
+
+#[cfg(test)]
+mod stats {
+    use super::*;
+    use std::path::PathBuf;
+    use tempfile::tempdir;
+
+    fn data_file() -> CString {
+        let mut path_buf = PathBuf::from(env!("CARGO_MANIFEST_DIR"));
+        path_buf.push("tests");
+        path_buf.push("regression_files");
+        path_buf.push("data_file.cti");
+        CString::new(path_buf.into_os_string().into_string().unwrap()).unwrap()
+    }
+
+    #[test]
+    fn read_null_stats() {
+        let filename = data_file();
+        let record_ptr: *mut Record = record_read_with_stats(filename.as_ptr(), std::ptr::null_mut());
+        assert!(record_ptr.is_null());
+        assert_eq!(get_last_error_code(), ErrorCode::NullArgument as c_int);
+    }
+
+    #[test]
+    fn read_non_existant_file() {
+        let filename = CString::new("this is a file that does not exist").unwrap();
+        let mut stats = ReadStats::default();
+        let record_ptr: *mut Record = record_read_with_stats(filename.as_ptr(), &mut stats);
+        assert!(record_ptr.is_null());
+        assert_eq!(get_last_error_code(), ErrorCode::FileNotFound as c_int);
+        assert_eq!(stats, ReadStats::default());
+    }
+
+    #[test]
+    fn read() {
+        let filename = data_file();
+        let mut stats = ReadStats::default();
+        let record_ptr: *mut Record = record_read_with_stats(filename.as_ptr(), &mut stats);
+        assert!(!record_ptr.is_null());
+
+        let result = std::panic::catch_unwind(|| {
+            let length = std::fs::metadata(filename.to_str().unwrap()).unwrap().len();
+            assert_eq!(stats.bytes, length);
+            assert_eq!(stats.samples, 10);
+            assert_eq!(stats.keywords.data, 1);
+        });
+        record_destroy(record_ptr);
+        assert!(result.is_ok())
+    }
+
+    #[test]
+    fn write_null_stats() {
+        let filename = CString::new("temp.cti").unwrap();
+        let record_ptr = Box::into_raw(Box::new(Record::new("A.01.00", "NAME")));
+        assert_eq!(record_write_with_stats(record_ptr, filename.as_ptr(), 0, 1, 0, std::ptr::null_mut()), ErrorCode::NullArgument as c_int);
+        record_destroy(record_ptr);
+    }
+
+    #[test]
+    fn write() {
+        let tmp = tempdir().unwrap();
+        let path_buf = tmp.path().join("temp.cti");
+        let filename = CString::new(path_buf.clone().into_os_string().into_string().unwrap()).unwrap();
+
+        let mut record = Record::new("A.01.00", "NAME");
+        let mut data_array = DataArray::new("S", "RI");
+        data_array.add_sample(0.78012, -8.98651E-1);
+        record.data.push(data_array);
+        let record_ptr = Box::into_raw(Box::new(record));
+
+        let result = std::panic::catch_unwind(|| {
+            let mut stats = WriteStats::default();
+            assert_eq!(record_write_with_stats(record_ptr, filename.as_ptr(), 6, 1, 0, &mut stats), ErrorCode::NoError as c_int);
+            let contents = std::fs::read_to_string(&path_buf).unwrap();
+            assert!(contents.contains("\nBEGIN\n7.80120E-1,-8.98651E-1\nEND\n"), "{}", contents);
+            assert_eq!(stats.bytes, contents.len() as u64);
+            assert_eq!(stats.samples, 1);
+        });
+        record_destroy(record_ptr);
+        assert!(result.is_ok())
+    }
+}
+
+#[cfg(test)]
+mod binary {
+    use super::*;
+    use std::path::PathBuf;
+    use tempfile::tempdir;
+
+    fn list_cal_set() -> CString {
+        let mut path_buf = PathBuf::from(env!("CARGO_MANIFEST_DIR"));
+        path_buf.push("tests");
+        path_buf.push("regression_files");
+        path_buf.push("list_cal_set.cti");
+        CString::new(path_buf.into_os_string().into_string().unwrap()).unwrap()
+    }
+
+    #[test]
+    fn null_filename() {
+        assert!(record_read_binary(std::ptr::null_mut()).is_null());
+        assert_eq!(get_last_error_code(), ErrorCode::NullArgument as c_int);
+        assert!(record_read_cached(std::ptr::null_mut()).is_null());
+        assert_eq!(get_last_error_code(), ErrorCode::NullArgument as c_int);
+    }
+
+    #[test]
+    fn null_record() {
+        let filename = CString::new("temp.bin").unwrap();
+        assert_eq!(record_write_binary(std::ptr::null_mut(), filename.as_ptr()), ErrorCode::NullArgument as c_int);
+    }
+
+    #[test]
+    fn non_existant_file() {
+        let filename = CString::new("this is a file that does not exist").unwrap();
+        assert!(record_read_binary(filename.as_ptr()).is_null());
+        assert_eq!(get_last_error_code(), ErrorCode::FileNotFound as c_int);
+        assert!(record_read_cached(filename.as_ptr()).is_null());
+        assert_eq!(get_last_error_code(), ErrorCode::FileNotFound as c_int);
+    }
+
+    #[test]
+    fn text_file_is_invalid() {
+        let record_ptr = record_read_binary(list_cal_set().as_ptr());
+        assert!(record_ptr.is_null());
+        assert_eq!(get_last_error_code(), ErrorCode::RecordReadErrorInvalidBinary as c_int);
+    }
+
+    #[test]
+    fn same_as_record_read() {
+        let tmp = tempdir().unwrap();
+        let path_buf = tmp.path().join("temp.bin");
+        let filename = CString::new(path_buf.into_os_string().into_string().unwrap()).unwrap();
+
+        let text = record_read(list_cal_set().as_ptr());
+        assert_eq!(record_write_binary(text, filename.as_ptr()), ErrorCode::NoError as c_int);
+        let binary = record_read_binary(filename.as_ptr());
+
+        let result = std::panic::catch_unwind(|| {
+            assert!(!binary.is_null());
+            assert_eq!(unsafe { &*binary }, unsafe { &*text });
+        });
+        record_destroy(text);
+        record_destroy(binary);
+        assert!(result.is_ok())
+    }
+
+    #[test]
+    fn cached_same_as_record_read() {
+        let tmp = tempdir().unwrap();
+        let path_buf = tmp.path().join("temp.cti");
+        std::fs::copy(list_cal_set().to_str().unwrap(), &path_buf).unwrap();
+        let filename = CString::new(path_buf.clone().into_os_string().into_string().unwrap()).unwrap();
+
+        let text = record_read(filename.as_ptr());
+        let first = record_read_cached(filename.as_ptr());
+        let second = record_read_cached(filename.as_ptr());
+
+        let result = std::panic::catch_unwind(|| {
+            assert!(!first.is_null());
+            assert!(!second.is_null());
+            assert_eq!(unsafe { &*first }, unsafe { &*text });
+            assert_eq!(unsafe { &*second }, unsafe { &*text });
+            assert!(Record::cache_path(&path_buf).exists());
+        });
+        record_destroy(text);
+        record_destroy(first);
+        record_destroy(second);
+        assert!(result.is_ok())
+    }
+}
+
+#[cfg(test)]
+mod parser {
+    use super::*;
+
+    const RECORD: &[u8] = b"CITIFILE A.01.00\nNAME DATA\nVAR FREQ MAG 1\nDATA S RI\nDATA E RI\n\
+        VAR_LIST_BEGIN\n10\nVAR_LIST_END\nBEGIN\n1E0,2E0\nEND\nBEGIN\n3E0,4E0\nEND\n";
+
+    fn feed(parser: *mut RecordParser, bytes: &[u8]) -> c_int {
+        record_parser_feed(parser, bytes.as_ptr() as *const c_char, bytes.len())
+    }
+
+    #[test]
+    fn null_parser() {
+        assert_eq!(feed(std::ptr::null_mut(), b"NAME A\n"), ErrorCode::NullArgument as c_int);
+        assert_eq!(record_parser_get_number_of_finished_data_arrays(std::ptr::null_mut()), ErrorCode::NullArgument as c_int);
+        assert!(record_parser_get_record(std::ptr::null_mut()).is_null());
+        assert!(record_parser_finish(std::ptr::null_mut()).is_null());
+        assert_eq!(get_last_error_code(), ErrorCode::NullArgument as c_int);
+        assert_eq!(record_parser_destroy(std::ptr::null_mut()), ErrorCode::NullArgument as c_int);
+    }
+
+    #[test]
+    fn null_bytes() {
+        let parser = record_parser_new();
+        assert_eq!(record_parser_feed(parser, std::ptr::null(), 0), ErrorCode::NullArgument as c_int);
+        assert_eq!(record_parser_destroy(parser), ErrorCode::NoError as c_int);
+    }
+
+    #[test]
+    fn finished_data_arrays() {
+        let parser = record_parser_new();
+        let second = RECORD.len() - b"BEGIN\n3E0,4E0\nEND\n".len();
+
+        let result = std::panic::catch_unwind(|| {
+            for chunk in RECORD[..second].chunks(5) {
+                assert_eq!(feed(parser, chunk), ErrorCode::NoError as c_int);
+            }
+            assert_eq!(record_parser_get_number_of_finished_data_arrays(parser), 1);
+            let record = record_parser_get_record(parser);
+            assert_eq!(record_get_data_array_length(record, 0), 1);
+            let name = unsafe { CStr::from_ptr(record_get_data_array_name(record, 0)) };
+            assert_eq!(name.to_str().unwrap(), "S");
+
+            assert_eq!(feed(parser, &RECORD[second..]), ErrorCode::NoError as c_int);
+            assert_eq!(record_parser_get_number_of_finished_data_arrays(parser), 2);
+        });
+
+        let record = record_parser_finish(parser);
+        let expected = Record::from_reader(&mut &RECORD[..]).unwrap();
+        let finished = std::panic::catch_unwind(|| {
+            assert!(!record.is_null());
+            assert_eq!(unsafe { &*record }, &expected);
+        });
+        record_destroy(record);
+        assert!(result.is_ok());
+        assert!(finished.is_ok())
+    }
+
+    #[test]
+    fn failed() {
+        let parser = record_parser_new();
+        assert_eq!(feed(parser, b"NOT A KEYWORD\n"), ErrorCode::RecordReadErrorLineError as c_int);
+        assert_eq!(feed(parser, b"NAME A\n"), ErrorCode::RecordReadErrorParserFailed as c_int);
+        assert!(record_parser_finish(parser).is_null());
+        assert_eq!(get_last_error_code(), ErrorCode::RecordReadErrorParserFailed as c_int);
+    }
+
+    #[test]
+    fn invalid_record() {
+        let parser = record_parser_new();
+        assert_eq!(feed(parser, b"CITIFILE A.01.00\n"), ErrorCode::NoError as c_int);
+        assert!(record_parser_finish(parser).is_null());
+        assert_eq!(get_last_error_code(), ErrorCode::RecordReadErrorNoName as c_int);
+    }
+}
+
+#[cfg(test)]
+mod writer {
+    use super::*;
+    use tempfile::tempdir;
+
+    const RECORD: &[u8] = b"CITIFILE A.01.00\nNAME DATA\nVAR FREQ MAG 2\nDATA S RI\nDATA E RI\n\
+        VAR_LIST_BEGIN\n10\n20\nVAR_LIST_END\nBEGIN\n1E0,2E0\n3E0,4E0\nEND\nBEGIN\n5E0,6E0\n7E0,8E0\nEND\n";
+
+    fn begin_array(writer: *mut RecordWriter<File>, name: &str, format: &str) -> c_int {
+        let name = CString::new(name).unwrap();
+        let format = CString::new(format).unwrap();
+        record_writer_begin_array(writer, name.as_ptr(), format.as_ptr())
+    }
+
+    #[test]
+    fn null_writer() {
+        let name = CString::new("S").unwrap();
+        let samples = [1., 2.];
+        assert!(record_writer_new(std::ptr::null(), 0).is_null());
+        assert_eq!(get_last_error_code(), ErrorCode::NullArgument as c_int);
+        assert_eq!(record_writer_begin(std::ptr::null_mut(), std::ptr::null()), ErrorCode::NullArgument as c_int);
+        assert_eq!(record_writer_begin_array(std::ptr::null_mut(), name.as_ptr(), name.as_ptr()), ErrorCode::NullArgument as c_int);
+        assert_eq!(record_writer_push_samples(std::ptr::null_mut(), samples.as_ptr(), 1), ErrorCode::NullArgument as c_int);
+        assert_eq!(record_writer_end_array(std::ptr::null_mut()), ErrorCode::NullArgument as c_int);
+        assert_eq!(record_writer_finish(std::ptr::null_mut()), ErrorCode::NullArgument as c_int);
+        assert_eq!(record_writer_destroy(std::ptr::null_mut()), ErrorCode::NullArgument as c_int);
+    }
+
+    #[test]
+    fn directory_filename() {
+        let dir = tempdir().unwrap();
+        let filename = CString::new(dir.path().to_str().unwrap()).unwrap();
+        assert!(record_writer_new(filename.as_ptr(), 0).is_null());
+        assert!(get_last_error_code() < 0);
+    }
+
+    #[test]
+    fn matches_record_write() {
+        let dir = tempdir().unwrap();
+        let path = dir.path().join("streamed.cti");
+        let filename = CString::new(path.to_str().unwrap()).unwrap();
+        let record = Record::from_reader(&mut &RECORD[..]).unwrap();
+
+        let writer = record_writer_new(filename.as_ptr(), 0);
+        assert!(!writer.is_null());
+        assert_eq!(record_writer_begin(writer, &record), ErrorCode::NoError as c_int);
+        for array in record.data.iter() {
+            assert_eq!(begin_array(writer, &array.name, &array.format), ErrorCode::NoError as c_int);
+            for sample in array.samples.iter() {
+                let pair = [sample.re, sample.im];
+                assert_eq!(record_writer_push_samples(writer, pair.as_ptr(), 1), ErrorCode::NoError as c_int);
+            }
+            assert_eq!(record_writer_end_array(writer), ErrorCode::NoError as c_int);
+        }
+        assert_eq!(record_writer_finish(writer), ErrorCode::NoError as c_int);
 
-        #[test]
-        #[should_panic]
-        fn fail_fails() {
-            test_runner(default_setup, |_record_ptr| {
-                assert!(false);
-            });
-        }
+        let mut expected = vec![];
+        record.to_writer(&mut expected).unwrap();
+        assert_eq!(std::fs::read(&path).unwrap(), expected);
+    }
+
+    #[test]
+    fn error_codes() {
+        let dir = tempdir().unwrap();
+        let filename = CString::new(dir.path().join("streamed.cti").to_str().unwrap()).unwrap();
+        let record = Record::from_reader(&mut &RECORD[..]).unwrap();
+
+        let writer = record_writer_new(filename.as_ptr(), 0);
+        assert_eq!(record_writer_end_array(writer), ErrorCode::RecordWriteErrorOutOfOrder as c_int);
+        assert_eq!(record_writer_begin(writer, &record), ErrorCode::NoError as c_int);
+        assert_eq!(begin_array(writer, "E", "RI"), ErrorCode::RecordWriteErrorUndeclaredDataArray as c_int);
+        assert_eq!(begin_array(writer, "S", "RI"), ErrorCode::NoError as c_int);
+        assert_eq!(record_writer_end_array(writer), ErrorCode::NoError as c_int);
+        assert_eq!(record_writer_finish(writer), ErrorCode::RecordWriteErrorMissingDataArray as c_int);
+        assert_eq!(get_last_error_code(), ErrorCode::RecordWriteErrorMissingDataArray as c_int);
+    }
+
+    #[test]
+    fn invalid_header() {
+        let dir = tempdir().unwrap();
+        let filename = CString::new(dir.path().join("streamed.cti").to_str().unwrap()).unwrap();
+        let record = Record::new("A.01.00", "");
+
+        let writer = record_writer_new(filename.as_ptr(), 0);
+        assert_eq!(record_writer_begin(writer, &record), ErrorCode::RecordWriteErrorNoName as c_int);
+        assert_eq!(record_writer_destroy(writer), ErrorCode::NoError as c_int);
     }
 }
 
 #[cfg(test)]
-mod interface {
+mod read_many {
     use super::*;
+    use std::path::PathBuf;
 
-    mod record_get_version {
-        use super::*;
+    fn filename(name: &str) -> CString {
+        let mut path_buf = PathBuf::from(env!("CARGO_MANIFEST_DIR"));
+        path_buf.push("tests");
+        path_buf.push("regression_files");
+        path_buf.push(name);
+        CString::new(path_buf.into_os_string().into_string().unwrap()).unwrap()
+    }
 
-        #[test]
-        fn null() {
-            test_runner(null_setup, |record_ptr| {
-                let c_str = record_get_version(record_ptr);
-                assert!(c_str.is_null());
-            });
-        }
+    #[test]
+    fn null_arguments() {
+        let mut records = [std::ptr::null_mut()];
+        let mut error_codes = [0];
+        assert_eq!(record_read_many(std::ptr::null(), 1, 0, records.as_mut_ptr(), error_codes.as_mut_ptr()), ErrorCode::NullArgument as c_int);
+        assert_eq!(get_last_error_code(), ErrorCode::NullArgument as c_int);
+
+        let filenames = [filename("data_file.cti")];
+        let filenames: Vec<*const c_char> = filenames.iter().map(|f| f.as_ptr()).collect();
+        assert_eq!(record_read_many(filenames.as_ptr(), 1, 0, std::ptr::null_mut(), error_codes.as_mut_ptr()), ErrorCode::NullArgument as c_int);
+        assert_eq!(record_read_many(filenames.as_ptr(), 1, 0, records.as_mut_ptr(), std::ptr::null_mut()), ErrorCode::NullArgument as c_int);
+        assert!(records[0].is_null());
+    }
 
-        #[test]
-        fn default() {
-            test_runner(default_setup, unsafe { |record_ptr| {
-                let c_str = record_get_version(record_ptr);
-                assert!(!c_str.is_null());
-                assert_eq!(CStr::from_ptr(c_str), &CString::new("A.01.00").unwrap()[..]);
-            }});
+    #[test]
+    fn per_file_error_codes() {
+        let names = [filename("data_file.cti"), filename("this file does not exist"), filename("list_cal_set.cti")];
+        let mut filenames: Vec<*const c_char> = names.iter().map(|f| f.as_ptr()).collect();
+        filenames.push(std::ptr::null());
+        let mut records = [std::ptr::null_mut(); 4];
+        let mut error_codes = [1; 4];
+
+        let error_code = record_read_many(filenames.as_ptr(), 4, 2, records.as_mut_ptr(), error_codes.as_mut_ptr());
+        assert_eq!(error_code, ErrorCode::FileNotFound as c_int);
+        assert_eq!(get_last_error_code(), ErrorCode::FileNotFound as c_int);
+        assert_eq!(error_codes, [
+            ErrorCode::NoError as c_int,
+            ErrorCode::FileNotFound as c_int,
+            ErrorCode::NoError as c_int,
+            ErrorCode::NullArgument as c_int,
+        ]);
+
+        let expected = [record_read(names[0].as_ptr()), record_read(names[2].as_ptr())];
+        let result = std::panic::catch_unwind(|| {
+            assert!(records[1].is_null());
+            assert!(records[3].is_null());
+            assert_eq!(unsafe { &*records[0] }, unsafe { &*expected[0] });
+            assert_eq!(unsafe { &*records[2] }, unsafe { &*expected[1] });
+        });
+        for &record in records.iter().chain(expected.iter()) {
+            if !record.is_null() {
+                record_destroy(record);
+            }
         }
+        assert!(result.is_ok())
     }
 
-    mod record_set_version {
-        use super::*;
+    #[test]
+    fn all_read() {
+        let names = [filename("display_memory.cti"), filename("wvi_file.cti")];
+        let filenames: Vec<*const c_char> = names.iter().map(|f| f.as_ptr()).collect();
+        let mut records = [std::ptr::null_mut(); 2];
+        let mut error_codes = [1; 2];
 
-        #[test]
-        fn null_record() {
-            test_runner(null_setup, |record_ptr| {
-                let version = CString::new("foo").unwrap().into_raw();
-                record_set_version(record_ptr, version);
-                let c_str = record_get_version(record_ptr);
-                assert!(c_str.is_null());
-            });
+        let error_code = record_read_many(filenames.as_ptr(), 2, 0, records.as_mut_ptr(), error_codes.as_mut_ptr());
+        let result = std::panic::catch_unwind(|| {
+            assert_eq!(error_code, ErrorCode::NoError as c_int);
+            assert_eq!(error_codes, [0, 0]);
+            assert!(records.iter().all(|record| !record.is_null()));
+        });
+        for &record in records.iter() {
+            record_destroy(record);
         }
+        assert!(result.is_ok())
+    }
+}
 
-        #[test]
-        fn null_version() {
-            test_runner(default_setup, unsafe { |record_ptr| {
-                let version = std::ptr::null_mut();
-                record_set_version(record_ptr, version);
-                let c_str = record_get_version(record_ptr);
-                assert!(!c_str.is_null());
-                assert_eq!(CStr::from_ptr(c_str), &CString::new("A.01.00").unwrap()[..]);
-            }});
-        }
+#[cfg(test)]
+mod read_mmap {
+    use super::*;
+    use std::path::PathBuf;
 
-        #[test]
-        fn set_version() {
-            test_runner(default_setup, unsafe { |record_ptr| {
-                let version = CString::new("foo").unwrap().into_raw();
-                record_set_version(record_ptr, version);
-                let c_str = record_get_version(record_ptr);
-                assert!(!c_str.is_null());
-                assert_eq!(CStr::from_ptr(c_str), &CString::new("foo").unwrap()[..]);
-            }});
-        }
+    #[test]
+    fn null_filename() {
+        let record_ptr: *mut Record = record_read_mmap(std::ptr::null_mut());
+        assert!(record_ptr.is_null());
+        assert_eq!(get_last_error_code(), ErrorCode::NullArgument as c_int);
     }
 
-    mod record_get_name {
-        use super::*;
+    #[test]
+    fn non_existant_file() {
+        let record_ptr: *mut Record = record_read_mmap(CString::new("this is a file that does not exist").unwrap().into_raw());
+        assert!(record_ptr.is_null());
+        assert_eq!(get_last_error_code(), ErrorCode::FileNotFound as c_int);
+    }
 
-        #[test]
-        fn null() {
-            test_runner(null_setup, |record_ptr| {
-                let c_str = record_get_name(record_ptr);
-                assert!(c_str.is_null());
-            });
-        }
+    #[test]
+    fn same_as_record_read() {
+        let mut path_buf = PathBuf::from(env!("CARGO_MANIFEST_DIR"));
+        path_buf.push("tests");
+        path_buf.push("regression_files");
+        path_buf.push("wvi_file.cti");
+        let filename = CString::new(path_buf.into_os_string().into_string().unwrap()).unwrap();
 
-        #[test]
-        fn default() {
-            test_runner(default_setup, unsafe { |record_ptr| {
-                let c_str = record_get_name(record_ptr);
-                assert!(!c_str.is_null());
-                assert_eq!(CStr::from_ptr(c_str), &CString::new("").unwrap()[..]);
-            }});
-        }
-    }
+        let buffered = record_read(filename.as_ptr());
+        let mapped = record_read_mmap(filename.as_ptr());
 
-    mod record_set_name {
-        use super::*;
+        let result = std::panic::catch_unwind(|| {
+            assert!(!mapped.is_null());
+            assert_eq!(unsafe { &*mapped }, unsafe { &*buffered });
+        });
+        record_destroy(buffered);
+        record_destroy(mapped);
+        assert!(result.is_ok())
+    }
+}
 
-        #[test]
-        fn null_record() {
-            test_runner(null_setup, |record_ptr| {
-                let name = CString::new("foo").unwrap().into_raw();
-                record_set_name(record_ptr, name);
-                let c_str = record_get_name(record_ptr);
-                assert!(c_str.is_null());
-            });
-        }
+#[cfg(test)]
+mod read_parallel {
+    use super::*;
+    use std::path::PathBuf;
 
-        #[test]
-        fn null_version() {
-            test_runner(default_setup, unsafe { |record_ptr| {
-                let name = std::ptr::null_mut();
-                record_set_name(record_ptr, name);
-                let c_str = record_get_name(record_ptr);
-                assert!(!c_str.is_null());
-                assert_eq!(CStr::from_ptr(c_str), &CString::new("").unwrap()[..]);
-            }});
-        }
+    #[test]
+    fn null_filename() {
+        let record_ptr: *mut Record = record_read_parallel(std::ptr::null_mut(), 2);
+        assert!(record_ptr.is_null());
+        assert_eq!(get_last_error_code(), ErrorCode::NullArgument as c_int);
+    }
 
-        #[test]
-        fn set_version() {
-            test_runner(default_setup, unsafe { |record_ptr| {
-                let name = CString::new("foo").unwrap().into_raw();
-                record_set_name(record_ptr, name);
-                let c_str = record_get_name(record_ptr);
-                assert!(!c_str.is_null());
-                assert_eq!(CStr::from_ptr(c_str), &CString::new("foo").unwrap()[..]);
-            }});
-        }
+    #[test]
+    fn non_existant_file() {
+        let record_ptr: *mut Record = record_read_parallel(CString::new("this is a file that does not exist").unwrap().into_raw(), 2);
+        assert!(record_ptr.is_null());
+        assert_eq!(get_last_error_code(), ErrorCode::FileNotFound as c_int);
     }
 
-    mod record_get_number_of_comments {
-        use super::*;
+    #[test]
+    fn same_as_record_read() {
+        let mut path_buf = PathBuf::from(env!("CARGO_MANIFEST_DIR"));
+        path_buf.push("tests");
+        path_buf.push("regression_files");
+        path_buf.push("list_cal_set.cti");
+        let filename = CString::new(path_buf.into_os_string().into_string().unwrap()).unwrap();
 
-        #[test]
-        fn null() {
-            test_runner(null_setup, |record_ptr| {
-                let count = record_get_number_of_comments(record_ptr);
-                assert_eq!(count, ErrorCode::NullArgument as c_int);
-            });
-        }
+        let buffered = record_read(filename.as_ptr());
+        let parallel = record_read_parallel(filename.as_ptr(), 0);
 
-        #[test]
-        fn default() {
-            test_runner(default_setup, |record_ptr| {
-                let count = record_get_number_of_comments(record_ptr);
-                assert_eq!(count, 0);
-            });
-        }
+        let result = std::panic::catch_unwind(|| {
+            assert!(!parallel.is_null());
+            assert_eq!(unsafe { &*parallel }, unsafe { &*buffered });
+        });
+        record_destroy(buffered);
+        record_destroy(parallel);
+        assert!(result.is_ok())
     }
+}
 
-    mod record_get_comment {
-        use super::*;
+#[cfg(test)]
+mod export_parquet {
+    use super::*;
+    use std::path::PathBuf;
+    use tempfile::tempdir;
 
-        #[test]
-        fn null_returns_null() {
-            test_runner(null_setup, |record_ptr| {
-                let comment = record_get_comment(record_ptr, 0_usize);
-                assert!(comment.is_null());
-            });
-        }
+    fn filename(name: &str) -> CString {
+        let mut path_buf = PathBuf::from(env!("CARGO_MANIFEST_DIR"));
+        path_buf.push("tests");
+        path_buf.push("regression_files");
+        path_buf.push(name);
+        CString::new(path_buf.into_os_string().into_string().unwrap()).unwrap()
+    }
 
-        #[test]
-        fn empty_returns_null() {
-            test_runner(default_setup, |record_ptr| {
-                let comment = record_get_comment(record_ptr, 0_usize);
-                assert!(comment.is_null());
-            });
-        }
+    #[test]
+    fn null_arguments() {
+        let names = [filename("data_file.cti")];
+        let filenames: Vec<*const c_char> = names.iter().map(|f| f.as_ptr()).collect();
+        assert_eq!(record_export_parquet(std::ptr::null(), 1, names[0].as_ptr(), 0), ErrorCode::NullArgument as c_int);
+        assert_eq!(record_export_parquet(filenames.as_ptr(), 1, std::ptr::null(), 0), ErrorCode::NullArgument as c_int);
+        let null_filenames = [std::ptr::null()];
+        assert_eq!(record_export_parquet(null_filenames.as_ptr(), 1, names[0].as_ptr(), 0), ErrorCode::NullArgument as c_int);
+        assert_eq!(get_last_error_code(), ErrorCode::NullArgument as c_int);
     }
 
-    mod record_get_number_of_devices {
-        use super::*;
+    #[test]
+    fn export() {
+        let tmp = tempdir().unwrap();
+        let path_buf = tmp.path().join("records.parquet");
+        let output = CString::new(path_buf.clone().into_os_string().into_string().unwrap()).unwrap();
+        let names = [filename("list_cal_set.cti"), filename("list_cal_set.cti")];
+        let filenames: Vec<*const c_char> = names.iter().map(|f| f.as_ptr()).collect();
+
+        let error_code = record_export_parquet(filenames.as_ptr(), filenames.len(), output.as_ptr(), 1);
+        if cfg!(feature = "columnar") {
+            assert_eq!(error_code, ErrorCode::NoError as c_int);
+            assert_eq!(&std::fs::read(path_buf).unwrap()[..4], b"PAR1");
+        } else {
+            assert_eq!(error_code, ErrorCode::RecordColumnarErrorUnsupported as c_int);
+            assert!(!path_buf.exists());
+        }
+        assert_eq!(get_last_error_code(), error_code);
+    }
 
-        #[test]
-        fn null() {
-            test_runner(null_setup, |record_ptr| {
-                let count = record_get_number_of_devices(record_ptr);
-                assert_eq!(count, ErrorCode::NullArgument as c_int);
-            });
-        }
+    #[test]
+    fn no_files() {
+        let tmp = tempdir().unwrap();
+        let output = CString::new(tmp.path().join("records.parquet").into_os_string().into_string().unwrap()).unwrap();
+        let filenames: [*const c_char; 0] = [];
 
-        #[test]
-        fn default() {
-            test_runner(default_setup, |record_ptr| {
-                let count = record_get_number_of_devices(record_ptr);
-                assert_eq!(count, 0);
-            });
+        let error_code = record_export_parquet(filenames.as_ptr(), 0, output.as_ptr(), 0);
+        match cfg!(feature = "columnar") {
+            true => assert_eq!(error_code, ErrorCode::RecordColumnarErrorNoRecords as c_int),
+            false => assert_eq!(error_code, ErrorCode::RecordColumnarErrorUnsupported as c_int),
         }
     }
+}
+
+#[cfg(test)]
+mod compression {
+    use super::*;
+    use tempfile::tempdir;
+
+    fn write_and_read(extension: &str) -> (c_int, *mut Record) {
+        let tmp = tempdir().unwrap();
+        let path_buf = tmp.path().join(format!("temp.cti{}", extension));
+        let filename = CString::new(path_buf.into_os_string().into_string().unwrap()).unwrap();
+
+        let mut record = Record::new("A.01.00", "NAME");
+        record.header.independent_variable = crate::Var::new("FREQ", "MAG");
+        record.header.independent_variable.push(1E9);
+        let mut data_array = DataArray::new("S", "RI");
+        data_array.add_sample(0.78012, -8.98651E-1);
+        record.data.push(data_array);
+        let record_ptr = Box::into_raw(Box::new(record));
+
+        let error_code = record_write(record_ptr, filename.as_ptr());
+        record_destroy(record_ptr);
+        (error_code, record_read(filename.as_ptr()))
+    }
 
-    mod record_get_device_name {
-        use super::*;
+    fn round_trip(extension: &str) {
+        let (error_code, read_ptr) = write_and_read(extension);
+        let result = std::panic::catch_unwind(|| {
+            assert_eq!(error_code, ErrorCode::NoError as c_int);
+            assert!(!read_ptr.is_null());
+            assert_eq!(unsafe { &*read_ptr }.data[0].samples, vec![Complex::new(0.78012, -8.98651E-1)]);
+        });
+        record_destroy(read_ptr);
+        assert!(result.is_ok())
+    }
 
-        #[test]
-        fn null_returns_null() {
-            test_runner(null_setup, |record_ptr| {
-                let comment = record_get_device_name(record_ptr, 0_usize);
-                assert!(comment.is_null());
-            });
-        }
+    #[test]
+    fn plain() {
+        round_trip("");
+    }
 
-        #[test]
-        fn empty_returns_null() {
-            test_runner(default_setup, |record_ptr| {
-                let comment = record_get_device_name(record_ptr, 0_usize);
-                assert!(comment.is_null());
-            });
-        }
+    #[cfg(feature = "gzip")]
+    #[test]
+    fn gzip() {
+        round_trip(".gz");
+    }
+
+    #[cfg(feature = "zstd")]
+    #[test]
+    fn zstd() {
+        round_trip(".zst");
+    }
+
+    #[cfg(not(feature = "zstd"))]
+    #[test]
+    fn zstd_unsupported() {
+        let (error_code, read_ptr) = write_and_read(".zst");
+        record_destroy(read_ptr);
+        assert_eq!(error_code, ErrorCode::RecordWriteErrorUnsupportedCompression as c_int);
     }
+}
 
-    mod record_get_device_number_of_entries {
-        use super::*;
+#[cfg(test)]
+mod shared {
+    use super::*;
+    use std::path::PathBuf;
 
-        #[test]
-        fn null() {
-            test_runner(null_setup, |record_ptr| {
-                let count = record_get_device_number_of_entries(record_ptr, 0_usize);
-                assert_eq!(count, ErrorCode::NullArgument as c_int);
-            });
-        }
+    fn share_list_cal_set() -> (*const SharedRecord, Record) {
+        let mut path_buf = PathBuf::from(env!("CARGO_MANIFEST_DIR"));
+        path_buf.push("tests");
+        path_buf.push("regression_files");
+        path_buf.push("list_cal_set.cti");
+        let expected = Record::from_path_mmap(&path_buf).unwrap();
+        let shared = record_share(Box::into_raw(Box::new(expected.clone())));
+        (shared, expected)
+    }
 
-        #[test]
-        fn default() {
-            test_runner(default_setup, |record_ptr| {
-                let count = record_get_device_number_of_entries(record_ptr, 0_usize);
-                assert_eq!(count, ErrorCode::IndexOutOfBounds as c_int);
-            });
-        }
+    #[test]
+    fn null() {
+        assert!(record_share(std::ptr::null_mut()).is_null());
+        assert!(record_retain(std::ptr::null()).is_null());
+        assert_eq!(record_release(std::ptr::null()), ErrorCode::NoError as c_int);
+        assert!(shared_record_copy(std::ptr::null()).is_null());
+        assert!(shared_record_get_data_array_ptr(std::ptr::null(), 0).is_null());
+        assert_eq!(shared_record_get_data_array_length(std::ptr::null(), 0), ErrorCode::NullArgument as c_int);
     }
 
-    mod record_get_device_entry {
-        use super::*;
+    #[test]
+    fn retain_and_release() {
+        let (shared, _) = share_list_cal_set();
+        assert_eq!(record_retain(shared), shared);
+        assert_eq!(unsafe { Arc::strong_count(&std::mem::ManuallyDrop::new(Arc::from_raw(shared))) }, 2);
+        record_release(shared);
+        assert_eq!(unsafe { Arc::strong_count(&std::mem::ManuallyDrop::new(Arc::from_raw(shared))) }, 1);
+        record_release(shared);
+    }
 
-        #[test]
-        fn null_returns_null() {
-            test_runner(null_setup, |record_ptr| {
-                let comment = record_get_device_entry(record_ptr, 0_usize, 0_usize);
-                assert!(comment.is_null());
-            });
-        }
+    #[test]
+    fn same_as_record() {
+        let (shared, expected) = share_list_cal_set();
+        let copy = shared_record_copy(shared);
+        let name = CString::new("E[2]").unwrap();
+        let missing = CString::new("E[4]").unwrap();
 
-        #[test]
-        fn empty_returns_null() {
-            test_runner(default_setup, |record_ptr| {
-                let comment = record_get_device_entry(record_ptr, 0_usize, 0_usize);
-                assert!(comment.is_null());
-            });
-        }
+        let result = std::panic::catch_unwind(|| {
+            assert_eq!(unsafe { &*copy }, &expected);
+
+            let mut length = 0;
+            let table = shared_record_get_header_snapshot(shared, &mut length);
+            let mut expected_table = vec![];
+            write_header_snapshot(&expected, &mut expected_table);
+            assert_eq!(unsafe { std::slice::from_raw_parts(table as *const u8, length) }, &expected_table[..]);
+
+            let values = shared_record_get_independent_variable_array(shared);
+            let expected_values = &expected.header.independent_variable.data;
+            assert_eq!(unsafe { std::slice::from_raw_parts(values, expected_values.len()) }, &expected_values[..]);
+
+            assert_eq!(shared_record_find_data_array(shared, name.as_ptr()), 1);
+            assert_eq!(shared_record_find_data_array(shared, missing.as_ptr()), ErrorCode::NameNotFound as c_int);
+            assert_eq!(shared_record_get_data_array_length(shared, 1), expected.data[1].samples.len() as c_int);
+            assert_eq!(shared_record_get_data_array_length(shared, 3), ErrorCode::IndexOutOfBounds as c_int);
+            let samples = shared_record_get_data_array_ptr(shared, 1) as *const Complex<f64>;
+            assert_eq!(unsafe { std::slice::from_raw_parts(samples, expected.data[1].samples.len()) }, &expected.data[1].samples[..]);
+            assert!(shared_record_get_data_array_ptr(shared, 3).is_null());
+        });
+        record_destroy(copy);
+        record_release(shared);
+        assert!(result.is_ok())
     }
 
-    mod record_get_independent_variable_name {
-        use super::*;
-
-        #[test]
-        fn null_returns_null() {
-            test_runner(null_setup, |record_ptr| {
-                let name = record_get_independent_variable_name(record_ptr);
-                assert!(name.is_null());
-            });
+    #[test]
+    fn read_from_many_threads() {
+        let (shared, expected) = share_list_cal_set();
+        let address = shared as usize;
+        let handles: Vec<_> = (0..4)
+            .map(|_| {
+                let handle = record_retain(address as *const SharedRecord) as usize;
+                std::thread::spawn(move || {
+                    let shared = handle as *const SharedRecord;
+                    record_get_number_of_data_arrays(std::ptr::null_mut());
+                    let length = shared_record_get_data_array_length(shared, 3);
+                    let error_code = get_last_error_code();
+                    let samples = shared_record_get_data_array_length(shared, 0);
+                    record_release(shared);
+                    (length, error_code, samples)
+                })
+            })
+            .collect();
+        record_release(shared);
+
+        for handle in handles {
+            let (length, error_code, samples) = handle.join().unwrap();
+            assert_eq!(length, ErrorCode::IndexOutOfBounds as c_int);
+            // Still the error of the last call on a record of its own
+            assert_eq!(error_code, ErrorCode::NullArgument as c_int);
+            assert_eq!(samples, expected.data[0].samples.len() as c_int);
         }
+    }
+}
 
-        #[test]
-        fn empty_returns_not_null() {
-            test_runner(default_setup, |record_ptr| {
-                let name = record_get_independent_variable_name(record_ptr);
-                assert!(!name.is_null());
-            });
-        }
+#[cfg(test)]
+mod read_into {
+    use super::*;
+    use std::path::PathBuf;
+    use tempfile::tempdir;
+
+    fn filename(name: &str) -> CString {
+        let mut path_buf = PathBuf::from(env!("CARGO_MANIFEST_DIR"));
+        path_buf.push("tests");
+        path_buf.push("regression_files");
+        path_buf.push(name);
+        CString::new(path_buf.into_os_string().into_string().unwrap()).unwrap()
     }
-    
-    mod record_get_independent_variable_format {
-        use super::*;
 
-        #[test]
-        fn null_returns_null() {
-            test_runner(null_setup, |record_ptr| {
-                let name = record_get_independent_variable_format(record_ptr);
-                assert!(name.is_null());
-            });
-        }
+    #[test]
+    fn null_record() {
+        let error_code = record_read_into(std::ptr::null_mut(), filename("list_cal_set.cti").as_ptr());
+        assert_eq!(error_code, ErrorCode::NullArgument as c_int);
+    }
 
-        #[test]
-        fn empty_returns_not_null() {
-            test_runner(default_setup, |record_ptr| {
-                let name = record_get_independent_variable_format(record_ptr);
-                assert!(!name.is_null());
-            });
-        }
+    #[test]
+    fn null_filename() {
+        let record_ptr = record_default();
+        let error_code = record_read_into(record_ptr, std::ptr::null_mut());
+        record_destroy(record_ptr);
+        assert_eq!(error_code, ErrorCode::NullArgument as c_int);
     }
 
-    mod record_get_independent_variable_length {
-        use super::*;
+    #[test]
+    fn non_existant_file() {
+        let record_ptr = record_default();
+        let error_code = record_read_into(record_ptr, CString::new("this is a file that does not exist").unwrap().as_ptr());
+        let result = std::panic::catch_unwind(|| {
+            assert_eq!(error_code, ErrorCode::FileNotFound as c_int);
+            assert_eq!(unsafe { &*record_ptr }.header.version, "");
+        });
+        record_destroy(record_ptr);
+        assert!(result.is_ok())
+    }
 
-        #[test]
-        fn null_returns_zero() {
-            test_runner(null_setup, |record_ptr| {
-                let length = record_get_independent_variable_length(record_ptr);
-                assert_eq!(length, ErrorCode::NullArgument as c_int);
-            });
+    #[test]
+    fn same_as_record_read() {
+        let record_ptr = record_default();
+        let mut results = vec![];
+        for name in ["list_cal_set.cti", "display_memory.cti", "list_cal_set.cti"].iter() {
+            let filename = filename(name);
+            let error_code = record_read_into(record_ptr, filename.as_ptr());
+            let expected = record_read(filename.as_ptr());
+            results.push(std::panic::catch_unwind(|| {
+                assert_eq!(error_code, ErrorCode::NoError as c_int);
+                assert_eq!(unsafe { &*record_ptr }, unsafe { &*expected });
+            }));
+            record_destroy(expected);
         }
+        record_destroy(record_ptr);
+        assert!(results.iter().all(|result| result.is_ok()))
+    }
 
-        #[test]
-        fn empty_returns_zero() {
-            test_runner(default_setup, |record_ptr| {
-                let length = record_get_independent_variable_length(record_ptr);
-                assert_eq!(length, 0);
-            });
-        }        
+    #[test]
+    fn parse_error_leaves_blank() {
+        let tmp = tempdir().unwrap();
+        let path_buf = tmp.path().join("temp.cti");
+        std::fs::write(&path_buf, "CITIFILE A.01.00\n").unwrap();
+        let no_name = CString::new(path_buf.into_os_string().into_string().unwrap()).unwrap();
+
+        let record_ptr = record_read(filename("list_cal_set.cti").as_ptr());
+        let error_code = record_read_into(record_ptr, no_name.as_ptr());
+        let result = std::panic::catch_unwind(|| {
+            assert_eq!(error_code, ErrorCode::RecordReadErrorNoName as c_int);
+            assert_eq!(unsafe { &*record_ptr }.header.name, "");
+            assert!(unsafe { &*record_ptr }.data.is_empty());
+        });
+        record_destroy(record_ptr);
+        assert!(result.is_ok())
     }
+}
 
-    mod record_get_independent_variable_array {
-        use super::*;
+#[cfg(test)]
+mod read_with_options {
+    use super::*;
+    use std::path::PathBuf;
 
-        #[test]
-        fn null_returns_null() {
-            test_runner(null_setup, |record_ptr| {
-                let array = record_get_independent_variable_array(record_ptr);
-                assert!(array.is_null());
-            });
-        }
+    fn list_cal_set() -> CString {
+        let mut path_buf = PathBuf::from(env!("CARGO_MANIFEST_DIR"));
+        path_buf.push("tests");
+        path_buf.push("regression_files");
+        path_buf.push("list_cal_set.cti");
+        CString::new(path_buf.into_os_string().into_string().unwrap()).unwrap()
+    }
 
-        #[test]
-        fn empty_returns_not_null() {
-            test_runner(default_setup, |record_ptr| {
-                let array = record_get_independent_variable_array(record_ptr);
-                assert!(!array.is_null());
-            });
-        }
+    #[test]
+    fn null_filename() {
+        let record_ptr: *mut Record = record_read_with_options(std::ptr::null_mut(), 0, std::ptr::null(), 0);
+        assert!(record_ptr.is_null());
+        assert_eq!(get_last_error_code(), ErrorCode::NullArgument as c_int);
     }
 
-    mod record_get_number_of_data_arrays {
-        use super::*;
+    #[test]
+    fn non_existant_file() {
+        let filename = CString::new("this is a file that does not exist").unwrap();
+        let record_ptr: *mut Record = record_read_with_options(filename.as_ptr(), 0, std::ptr::null(), 0);
+        assert!(record_ptr.is_null());
+        assert_eq!(get_last_error_code(), ErrorCode::FileNotFound as c_int);
+    }
 
-        #[test]
-        fn null_returns_zero() {
-            test_runner(null_setup, |record_ptr| {
-                let number = record_get_number_of_data_arrays(record_ptr);
-                assert_eq!(number, ErrorCode::NullArgument as c_int);
-            });
-        }
+    #[test]
+    fn null_data_array_name() {
+        let filename = list_cal_set();
+        let names = [std::ptr::null()];
+        let record_ptr: *mut Record = record_read_with_options(filename.as_ptr(), 0, names.as_ptr(), names.len());
+        assert!(record_ptr.is_null());
+        assert_eq!(get_last_error_code(), ErrorCode::NullArgument as c_int);
+    }
 
-        #[test]
-        fn empty_is_zero() {
-            test_runner(default_setup, |record_ptr| {
-                let number = record_get_number_of_data_arrays(record_ptr);
-                assert_eq!(number, 0);
-            });
-        }
+    #[test]
+    fn invalid_utf8_data_array_name() {
+        let filename = list_cal_set();
+        let name = CString::new(vec![0xFF]).unwrap();
+        let names = [name.as_ptr()];
+        let record_ptr: *mut Record = record_read_with_options(filename.as_ptr(), 0, names.as_ptr(), names.len());
+        assert!(record_ptr.is_null());
+        assert_eq!(get_last_error_code(), ErrorCode::InvalidUTF8String as c_int);
     }
 
-    mod record_get_data_array_name{
-        use super::*;
+    #[test]
+    fn defaults_are_record_read() {
+        let filename = list_cal_set();
 
-        #[test]
-        fn null_returns_null() {
-            test_runner(null_setup, |record_ptr| {
-                let name = record_get_data_array_name(record_ptr, 0);
-                assert!(name.is_null());
-            });
-        }
+        let full = record_read(filename.as_ptr());
+        let record_ptr = record_read_with_options(filename.as_ptr(), 0, std::ptr::null(), 0);
 
-        #[test]
-        fn empty_returns_null() {
-            test_runner(default_setup, |record_ptr| {
-                let name = record_get_data_array_name(record_ptr, 0);
-                assert!(name.is_null());
-            });
-        }
+        let result = std::panic::catch_unwind(|| {
+            assert!(!record_ptr.is_null());
+            assert_eq!(unsafe { &*record_ptr }, unsafe { &*full });
+        });
+        record_destroy(full);
+        record_destroy(record_ptr);
+        assert!(result.is_ok())
     }
 
-    mod record_get_data_array_format {
-        use super::*;
+    #[test]
+    fn no_names_are_record_read() {
+        let filename = list_cal_set();
+        let names: [*const c_char; 0] = [];
 
-        #[test]
-        fn null_returns_null() {
-            test_runner(null_setup, |record_ptr| {
-                let name = record_get_data_array_format(record_ptr, 0);
-                assert!(name.is_null());
-            });
-        }
+        let full = record_read(filename.as_ptr());
+        let record_ptr = record_read_with_options(filename.as_ptr(), 0, names.as_ptr(), names.len());
 
-        #[test]
-        fn empty_returns_null() {
-            test_runner(default_setup, |record_ptr| {
-                let name = record_get_data_array_format(record_ptr, 0);
-                assert!(name.is_null());
-            });
-        }
+        let result = std::panic::catch_unwind(|| {
+            assert!(!record_ptr.is_null());
+            assert_eq!(unsafe { &*record_ptr }, unsafe { &*full });
+        });
+        record_destroy(full);
+        record_destroy(record_ptr);
+        assert!(result.is_ok())
     }
 
-    mod record_get_data_array_length {
-        use super::*;
+    #[test]
+    fn header_only() {
+        let filename = list_cal_set();
+        let record_ptr = record_read_with_options(filename.as_ptr(), 1, std::ptr::null(), 0);
 
-        #[test]
-        fn null_returns_zero() {
-            test_runner(null_setup, |record_ptr| {
-                let number = record_get_data_array_length(record_ptr, 0);
-                assert_eq!(number, ErrorCode::NullArgument as c_int);
-            });
-        }
+        let result = std::panic::catch_unwind(|| {
+            assert!(!record_ptr.is_null());
+            let record = unsafe { &*record_ptr };
+            assert_eq!(record.data.len(), 3);
+            assert!(record.data.iter().all(|data_array| data_array.samples.is_empty()));
+        });
+        record_destroy(record_ptr);
+        assert!(result.is_ok())
+    }
 
-        #[test]
-        fn empty_is_zero() {
-            test_runner(default_setup, |record_ptr| {
-                let number = record_get_data_array_length(record_ptr, 0);
-                println!("arr len: {:}", number);
-                assert_eq!(number, ErrorCode::IndexOutOfBounds as c_int);
-            });
-        }
+    #[test]
+    fn selected_data_array() {
+        let filename = list_cal_set();
+        let name = CString::new("E[2]").unwrap();
+        let names = [name.as_ptr()];
+
+        let full = record_read(filename.as_ptr());
+        let record_ptr = record_read_with_options(filename.as_ptr(), 0, names.as_ptr(), names.len());
+
+        let result = std::panic::catch_unwind(|| {
+            assert!(!record_ptr.is_null());
+            let record = unsafe { &*record_ptr };
+            assert_eq!(record.data, vec![unsafe { &*full }.data[1].clone()]);
+        });
+        record_destroy(full);
+        record_destroy(record_ptr);
+        assert!(result.is_ok())
     }
 }
 
@@ -1773,6 +4582,19 @@ mod read {
                 assert_eq!(number, 10);
             });
         }
+
+        #[test]
+        fn record_get_data_array_ptr_is_interleaved() {
+            test_runner(setup, unsafe { |record_ptr| {
+                let ptr = record_get_data_array_ptr(record_ptr, 0);
+                assert!(!ptr.is_null());
+                let values = std::slice::from_raw_parts(ptr, 20);
+                assert_eq!(values[0], 0.86303E-1);
+                assert_eq!(values[1], -8.98651E-1);
+                assert_eq!(values[18], -7.78350E-1);
+                assert_eq!(values[19], 5.72082E-1);
+            }});
+        }
     }
 
     mod list_cal_set_record {
@@ -0,0 +1,257 @@
+//! Float formatting for CITI data pairs
+//!
+//! Each function appends exactly the same bytes as the format string shown in
+//! its documentation, without going through [`std::fmt`] for the common case.
+
+use std::io::Write;
+
+/// `{:E}`
+///
+/// The shortest digits that read back to the same value are found with Ryu
+/// and laid out in the E notation used by [`std::fmt::UpperExp`], e.g.
+/// `-1.31189E-3` or `1E0`.
+pub fn push_round_trip(value: f64, line: &mut Vec<u8>) {
+    if !value.is_finite() {
+        // Not worth a fast path: `NaN`, `inf` and `-inf`
+        write!(line, "{:E}", value).unwrap();
+        return;
+    }
+
+    let mut buffer = ryu::Buffer::new();
+    let shortest = buffer.format_finite(value).as_bytes();
+
+    let (sign, shortest) = match shortest.split_first() {
+        Some((b'-', rest)) => (true, rest),
+        _ => (false, shortest),
+    };
+    let (mantissa, exponent) = match shortest.iter().position(|&b| b == b'e') {
+        Some(e) => (&shortest[..e], parse_exponent(&shortest[e + 1..])),
+        None => (shortest, 0),
+    };
+    let (integer, fraction) = match mantissa.iter().position(|&b| b == b'.') {
+        Some(dot) => (&mantissa[..dot], &mantissa[dot + 1..]),
+        None => (mantissa, &mantissa[mantissa.len()..]),
+    };
+
+    // All significant digits, with the decimal point dropped
+    let mut digits = [0u8; 32];
+    let length = integer.len() + fraction.len();
+    digits[..integer.len()].copy_from_slice(integer);
+    digits[integer.len()..length].copy_from_slice(fraction);
+
+    let leading = digits[..length].iter().take_while(|&&b| b == b'0').count();
+    let trailing = digits[leading..length]
+        .iter()
+        .rev()
+        .take_while(|&&b| b == b'0')
+        .count();
+    let significant = &digits[leading..length - trailing];
+
+    // Decimal exponent of the first significant digit
+    let exponent = exponent + integer.len() as i32 - 1 - leading as i32;
+
+    // Ryu breaks ties between two equally close candidates to even while
+    // `std` rounds them up, so leave those rare values to `std`
+    if !significant.is_empty() && is_tie(value, significant, exponent) {
+        write!(line, "{:E}", value).unwrap();
+        return;
+    }
+
+    if sign {
+        line.push(b'-');
+    }
+
+    match significant.split_first() {
+        None => line.extend_from_slice(b"0E0"),
+        Some((first, rest)) => {
+            line.push(*first);
+            if !rest.is_empty() {
+                line.push(b'.');
+                line.extend_from_slice(rest);
+            }
+            line.push(b'E');
+            push_exponent(exponent, line);
+        }
+    }
+}
+
+/// Whether `value` is exactly halfway between `significant` and one of the
+/// candidates next to it
+///
+/// `significant` holds the ASCII digits `d.ddd` scaled by `10^exponent`.
+/// The halfway points are `(10 × ddd ± 5) × 10^k` for `k` one below the last
+/// digit. An odd `m × 2^e` can only equal them when `e = k`, which leaves
+/// a single integer comparison.
+fn is_tie(value: f64, significant: &[u8], exponent: i32) -> bool {
+    let bits = value.to_bits();
+    let (mantissa, binary_exponent) = match ((bits >> 52) & 0x7FF) as i32 {
+        0 => (bits & ((1 << 52) - 1), -1074),
+        biased => (bits & ((1 << 52) - 1) | (1 << 52), biased - 1075),
+    };
+    if mantissa == 0 {
+        return false;
+    }
+    let zeros = mantissa.trailing_zeros();
+    let (mantissa, binary_exponent) = (
+        u128::from(mantissa >> zeros),
+        binary_exponent + zeros as i32,
+    );
+
+    let k = exponent - significant.len() as i32;
+    // Beyond 5^27 one side no longer fits in the range of the other
+    if binary_exponent != k || k.abs() > 27 {
+        return false;
+    }
+
+    let digits = significant
+        .iter()
+        .fold(0u128, |n, &b| n * 10 + u128::from(b - b'0'));
+    let power = 5u128.pow(k.unsigned_abs());
+    [digits * 10 + 5, digits * 10 - 5]
+        .iter()
+        .any(|&halfway| match k >= 0 {
+            true => mantissa == halfway * power,
+            false => mantissa * power == halfway,
+        })
+}
+
+/// `{:.*E}` with `digits - 1` decimals
+///
+/// A `digits` of zero is treated as one.
+pub fn push_significant(value: f64, digits: usize, line: &mut Vec<u8>) {
+    let decimals = digits.max(1) - 1;
+    write!(line, "{:.*E}", decimals, value).unwrap();
+}
+
+/// Decimal exponent, which is at most three digits for an `f64`
+fn push_exponent(exponent: i32, line: &mut Vec<u8>) {
+    if exponent < 0 {
+        line.push(b'-');
+    }
+    let magnitude = exponent.unsigned_abs();
+    if magnitude >= 100 {
+        line.push(b'0' + (magnitude / 100) as u8);
+    }
+    if magnitude >= 10 {
+        line.push(b'0' + (magnitude / 10 % 10) as u8);
+    }
+    line.push(b'0' + (magnitude % 10) as u8);
+}
+
+/// Exponent written by Ryu, which is always a few ASCII digits
+fn parse_exponent(exponent: &[u8]) -> i32 {
+    let (negative, digits) = match exponent.split_first() {
+        Some((b'-', rest)) => (true, rest),
+        _ => (false, exponent),
+    };
+    let magnitude = digits.iter().fold(0, |n, &b| n * 10 + i32::from(b - b'0'));
+    match negative {
+        true => -magnitude,
+        false => magnitude,
+    }
+}
+
+#[cfg(test)]
+mod test_formatter {
+    use super::*;
+
+    fn round_trip(value: f64) -> String {
+        let mut line = vec![];
+        push_round_trip(value, &mut line);
+        String::from_utf8(line).unwrap()
+    }
+
+    fn significant(value: f64, digits: usize) -> String {
+        let mut line = vec![];
+        push_significant(value, digits, &mut line);
+        String::from_utf8(line).unwrap()
+    }
+
+    mod test_push_round_trip {
+        use super::*;
+
+        #[test]
+        fn matches_upper_exp() {
+            for &value in &[
+                0.,
+                -0.,
+                1.,
+                -1.,
+                10.,
+                100.,
+                0.5,
+                1234.5,
+                -1.31189E-3,
+                0.86303E-1,
+                1e-5,
+                1e-7,
+                1.5e-7,
+                1e15,
+                1e16,
+                1.5e16,
+                123456789012345680.,
+                f64::MIN_POSITIVE,
+                5e-324,
+                f64::MAX,
+                f64::MIN,
+                f64::EPSILON,
+                std::f64::consts::PI,
+                1. / 3.,
+            ] {
+                assert_eq!(round_trip(value), format!("{:E}", value), "{:?}", value);
+            }
+        }
+
+        #[test]
+        fn non_finite() {
+            assert_eq!(round_trip(f64::NAN), "NaN");
+            assert_eq!(round_trip(f64::INFINITY), "inf");
+            assert_eq!(round_trip(f64::NEG_INFINITY), "-inf");
+        }
+
+        #[test]
+        fn ties_round_up() {
+            // Exactly halfway between two 16 and two 17 digit candidates
+            for &bits in &[4830972022612240506, 14057388626642543253] {
+                let value = f64::from_bits(bits);
+                assert_eq!(round_trip(value), format!("{:E}", value), "{:?}", value);
+            }
+        }
+
+        #[test]
+        fn reads_back() {
+            for &value in &[-1.31189E-3, std::f64::consts::E, 1e-300, 6.02214076e23] {
+                assert_eq!(round_trip(value).parse::<f64>().unwrap(), value);
+            }
+        }
+
+        #[test]
+        fn appends() {
+            let mut line = b"x".to_vec();
+            push_round_trip(2., &mut line);
+            assert_eq!(line, b"x2E0");
+        }
+    }
+
+    mod test_push_significant {
+        use super::*;
+
+        #[test]
+        fn instrument_style() {
+            assert_eq!(significant(0.78012, 6), "7.80120E-1");
+            assert_eq!(significant(-8.98651E-1, 6), "-8.98651E-1");
+        }
+
+        #[test]
+        fn rounds() {
+            assert_eq!(significant(1.23456, 3), "1.23E0");
+            assert_eq!(significant(9.996, 3), "1.00E1");
+        }
+
+        #[test]
+        fn one_digit() {
+            assert_eq!(significant(1234., 1), "1E3");
+            assert_eq!(significant(1234., 0), "1E3");
+        }
+    }
+}
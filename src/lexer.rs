@@ -0,0 +1,371 @@
+//! Line lexer for CITI keywords
+//!
+//! Each function matches exactly the same lines as the regular expression
+//! shown in its documentation and returns the captures as slices of the
+//! input line. Nothing is allocated here; building owned [`crate::Keyword`]
+//! values is left to the caller.
+//!
+//! Whitespace follows the Unicode definition used by `\s`. Digits are ASCII.
+
+/// ASCII subset of the Unicode `White_Space` property
+fn is_ascii_whitespace(b: u8) -> bool {
+    matches!(b, b'\t' | b'\n' | 0x0B | 0x0C | b'\r' | b' ')
+}
+
+/// Byte offset of the first whitespace character
+fn find_whitespace(s: &str) -> Option<usize> {
+    for (i, &b) in s.as_bytes().iter().enumerate() {
+        if b >= 0x80 {
+            // Everything before `i` is ASCII, so `i` is a char boundary
+            return s[i..]
+                .char_indices()
+                .find(|&(_, c)| c.is_whitespace())
+                .map(|(j, _)| i + j);
+        }
+        if is_ascii_whitespace(b) {
+            return Some(i);
+        }
+    }
+    None
+}
+
+/// `\S+`
+fn is_token(s: &str) -> bool {
+    !s.is_empty() && find_whitespace(s).is_none()
+}
+
+/// `\d+`
+fn is_digits(s: &str) -> bool {
+    !s.is_empty() && s.bytes().all(|b| b.is_ascii_digit())
+}
+
+fn count_digits(s: &[u8]) -> usize {
+    s.iter().take_while(|b| b.is_ascii_digit()).count()
+}
+
+/// `^[+-]?(\d+)\.?\d*[eE]?[+-]?\d+$`
+///
+/// Note that this requires at least two digits when there is no
+/// fractional part or exponent, e.g. `5` does not match while `50` does.
+pub fn is_number(s: &str) -> bool {
+    let bytes = s.as_bytes();
+    let mut i = 0;
+
+    if matches!(bytes.first(), Some(b'+') | Some(b'-')) {
+        i += 1;
+    }
+
+    let integer = count_digits(&bytes[i..]);
+    if integer == 0 {
+        return false;
+    }
+    i += integer;
+
+    let dot = bytes.get(i) == Some(&b'.');
+    if dot {
+        i += 1;
+    }
+
+    let fraction = count_digits(&bytes[i..]);
+    i += fraction;
+
+    let exponent = matches!(bytes.get(i), Some(b'e') | Some(b'E'));
+    if exponent {
+        i += 1;
+    }
+
+    let sign = matches!(bytes.get(i), Some(b'+') | Some(b'-'));
+    if sign {
+        i += 1;
+    }
+
+    let trailing = count_digits(&bytes[i..]);
+    i += trailing;
+
+    if i != bytes.len() {
+        return false;
+    }
+
+    match (exponent || sign, trailing > 0) {
+        (_, true) => true,
+        (true, false) => false,
+        // The final `\d+` has to borrow digits from an earlier run
+        (false, false) => fraction > 0 || (!dot && integer > 1),
+    }
+}
+
+/// `^(?P<Real>\S+),\s*(?P<Imag>\S+)$`
+pub fn data_pair(line: &str) -> Option<(&str, &str)> {
+    match find_whitespace(line) {
+        None => {
+            // Greedy `\S+` takes the last comma that leaves a non-empty tail
+            let comma = match line.rfind(',')? {
+                last if last + 1 == line.len() => line[..last].rfind(',')?,
+                last => last,
+            };
+            match comma {
+                0 => None,
+                _ => Some((&line[..comma], &line[comma + 1..])),
+            }
+        }
+        Some(first_whitespace) => {
+            // Whitespace may only appear directly after the comma
+            if first_whitespace < 2 || line.as_bytes()[first_whitespace - 1] != b',' {
+                return None;
+            }
+            let imag = line[first_whitespace..].trim_start_matches(char::is_whitespace);
+            match is_token(imag) {
+                true => Some((&line[..first_whitespace - 1], imag)),
+                false => None,
+            }
+        }
+    }
+}
+
+/// `(?P<First>\S+) (?P<Second>\S+)$`
+fn two_tokens(s: &str) -> Option<(&str, &str)> {
+    let end = find_whitespace(s)?;
+    if end == 0 || s.as_bytes()[end] != b' ' {
+        return None;
+    }
+    let second = &s[end + 1..];
+    match is_token(second) {
+        true => Some((&s[..end], second)),
+        false => None,
+    }
+}
+
+/// `^#(?P<Name>\S+) (?P<Value>.*)$`
+pub fn device(line: &str) -> Option<(&str, &str)> {
+    let rest = line.strip_prefix('#')?;
+    let end = find_whitespace(rest)?;
+    if end == 0 || rest.as_bytes()[end] != b' ' {
+        return None;
+    }
+    let value = &rest[end + 1..];
+    match value.contains('\n') {
+        true => None,
+        false => Some((&rest[..end], value)),
+    }
+}
+
+/// `^SEG (?P<First>number) (?P<Last>number) (?P<Number>\d+)$`
+///
+/// See [`is_number`] for the `number` pattern.
+pub fn seg_item(line: &str) -> Option<(&str, &str, &str)> {
+    let mut parts = line.strip_prefix("SEG ")?.splitn(3, ' ');
+    let first = parts.next()?;
+    let last = parts.next()?;
+    let number = parts.next()?;
+    match is_number(first) && is_number(last) && is_digits(number) {
+        true => Some((first, last, number)),
+        false => None,
+    }
+}
+
+/// `^DATA (?P<Name>\S+) (?P<Format>\S+)$`
+pub fn data(line: &str) -> Option<(&str, &str)> {
+    two_tokens(line.strip_prefix("DATA ")?)
+}
+
+/// `^VAR (?P<Name>\S+) ?(?P<Format>\S*) (?P<Length>\d+)$`
+///
+/// The format is optional, in which case an empty string is returned.
+pub fn var(line: &str) -> Option<(&str, &str, &str)> {
+    let rest = line.strip_prefix("VAR ")?;
+    let end = find_whitespace(rest)?;
+    if end == 0 || rest.as_bytes()[end] != b' ' {
+        return None;
+    }
+    let name = &rest[..end];
+    let tail = &rest[end + 1..];
+
+    let format_end = find_whitespace(tail).unwrap_or(tail.len());
+    if tail.as_bytes().get(format_end) == Some(&b' ') && is_digits(&tail[format_end + 1..]) {
+        return Some((name, &tail[..format_end], &tail[format_end + 1..]));
+    }
+
+    match is_digits(tail) {
+        true => Some((name, "", tail)),
+        false => None,
+    }
+}
+
+/// `^!(?P<Comment>.*)$`
+pub fn comment(line: &str) -> Option<&str> {
+    let comment = line.strip_prefix('!')?;
+    match comment.contains('\n') {
+        true => None,
+        false => Some(comment),
+    }
+}
+
+/// `^CITIFILE (?P<Version>\S+)$`
+pub fn citifile(line: &str) -> Option<&str> {
+    line.strip_prefix("CITIFILE ").filter(|s| is_token(s))
+}
+
+/// `^NAME (?P<Name>\S+)$`
+pub fn name(line: &str) -> Option<&str> {
+    line.strip_prefix("NAME ").filter(|s| is_token(s))
+}
+
+/// `^CONSTANT (?P<Name>\S+) (?P<Value>\S+)$`
+pub fn constant(line: &str) -> Option<(&str, &str)> {
+    two_tokens(line.strip_prefix("CONSTANT ")?)
+}
+
+#[cfg(test)]
+mod test_lexer {
+    use super::*;
+
+    mod test_find_whitespace {
+        use super::*;
+
+        #[test]
+        fn none() {
+            assert_eq!(find_whitespace("abc"), None);
+        }
+
+        #[test]
+        fn ascii() {
+            assert_eq!(find_whitespace("ab\tc d"), Some(2));
+        }
+
+        #[test]
+        fn vertical_tab() {
+            assert_eq!(find_whitespace("ab\x0Bc"), Some(2));
+        }
+
+        #[test]
+        fn unicode() {
+            assert_eq!(find_whitespace("é\u{00A0}c"), Some(2));
+        }
+    }
+
+    mod test_is_number {
+        use super::*;
+
+        #[test]
+        fn accepts() {
+            for s in &[
+                "10", "-10", "+10", "1.5", "1e5", "1E-5", "1.5e+5", "1-5", "100E+6",
+            ] {
+                assert!(is_number(s), "{}", s);
+            }
+        }
+
+        #[test]
+        fn rejects() {
+            for s in &["", "1", "-1", ".5", "1e", "1e+", "1.2.3", "a1", "1 2"] {
+                assert!(!is_number(s), "{}", s);
+            }
+        }
+
+        #[test]
+        fn trailing_dot() {
+            assert!(!is_number("1."));
+            assert!(!is_number("12."));
+        }
+    }
+
+    mod test_data_pair {
+        use super::*;
+
+        #[test]
+        fn simple() {
+            assert_eq!(data_pair("1,2"), Some(("1", "2")));
+        }
+
+        #[test]
+        fn spaced() {
+            assert_eq!(data_pair("1, \t2"), Some(("1", "2")));
+        }
+
+        #[test]
+        fn last_comma_is_split() {
+            assert_eq!(data_pair("1,2,3"), Some(("1,2", "3")));
+        }
+
+        #[test]
+        fn trailing_comma() {
+            assert_eq!(data_pair("1,2,"), Some(("1", "2,")));
+        }
+
+        #[test]
+        fn rejects() {
+            for s in &["", ",", "1,", ",1", "1 ,2", "1,2 ", "1, 2 3", "a b,c"] {
+                assert_eq!(data_pair(s), None, "{}", s);
+            }
+        }
+    }
+
+    mod test_var {
+        use super::*;
+
+        #[test]
+        fn with_format() {
+            assert_eq!(var("VAR FREQ MAG 201"), Some(("FREQ", "MAG", "201")));
+        }
+
+        #[test]
+        fn without_format() {
+            assert_eq!(var("VAR FREQ 201"), Some(("FREQ", "", "201")));
+        }
+
+        #[test]
+        fn double_space() {
+            assert_eq!(var("VAR FREQ  201"), Some(("FREQ", "", "201")));
+        }
+
+        #[test]
+        fn rejects() {
+            for s in &[
+                "VAR",
+                "VAR FREQ",
+                "VAR FREQ MAG",
+                "VAR FREQ MAG 2a",
+                "VAR  MAG 1",
+            ] {
+                assert_eq!(var(s), None, "{}", s);
+            }
+        }
+    }
+
+    mod test_device {
+        use super::*;
+
+        #[test]
+        fn value_with_spaces() {
+            assert_eq!(device("#NA A B"), Some(("NA", "A B")));
+        }
+
+        #[test]
+        fn empty_value() {
+            assert_eq!(device("#NA "), Some(("NA", "")));
+        }
+
+        #[test]
+        fn rejects() {
+            for s in &["#", "#NA", "# NA", "#NA\tA", "#NA A\nB"] {
+                assert_eq!(device(s), None, "{:?}", s);
+            }
+        }
+    }
+
+    mod test_seg_item {
+        use super::*;
+
+        #[test]
+        fn simple() {
+            assert_eq!(seg_item("SEG 10 20 3"), Some(("10", "20", "3")));
+        }
+
+        #[test]
+        fn rejects() {
+            for s in &["SEG 1 20 3", "SEG 10 20", "SEG 10 20 3 4", "SEG 10  20 3"] {
+                assert_eq!(seg_item(s), None, "{}", s);
+            }
+        }
+    }
+}
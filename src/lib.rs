@@ -37,6 +37,21 @@
 //! let record = Record::from_reader(&mut file);
 //! ```
 //!
+//! Large files can instead be memory mapped, which parses straight from the mapped bytes:
+//! ```no_run
+//! use citi::Record;
+//!
+//! let record = Record::from_path_mmap("file.cti");
+//! ```
+//!
+//! Single data arrays of a large file can be read on demand through an index of its blocks:
+//! ```no_run
+//! use citi::IndexedRecord;
+//!
+//! let mut record = IndexedRecord::open("file.cti").unwrap();
+//! let data_array = record.read_data_array(3);
+//! ```
+//!
 //! Write file:
 //! ```no_run
 //! use citi::Record;
@@ -47,6 +62,9 @@
 //! record.to_writer(&mut file);
 //! ```
 //!
+//! With the `async` feature, `Record::from_async_reader` and `Record::to_async_writer`
+//! read and write through the `futures` IO traits without blocking a thread.
+//!
 //! ## Input-Output Consistency:
 //!
 //! General input-output consistency cannot be guaranteed with CITI records because of their
@@ -56,19 +74,30 @@
 //!
 //! - ASCII representation of floating points may change because of the String -> Float -> String conversion.
 //! - Floats may be shifted in exponential format.
-//! - All `SEG_LIST` keywords will be converted to `VAR_LIST`
+//! - `SEG_LIST` keywords are converted to `VAR_LIST`, unless [`WriteOptions::segments`] is set
+//!   and the independent variable is one linear sweep.
 
-use lazy_static::lazy_static;
 use num_complex::Complex;
-use regex::Regex;
 
+use std::collections::HashMap;
 use std::convert::TryFrom;
 use std::fmt;
-use std::io::BufRead;
+use std::fs::File;
+use std::io::{BufRead, Read, Seek, SeekFrom, Write};
+use std::ops::ControlFlow;
+use std::path::{Path, PathBuf};
 use std::str::FromStr;
+use std::sync::atomic::{AtomicUsize, Ordering};
+use std::time::{Duration, Instant, SystemTime};
 
 use thiserror::Error;
 
+mod binary;
+pub mod columnar;
+mod compression;
+mod convert;
+mod formatter;
+mod lexer;
 mod macros;
 pub mod ffi;
 
@@ -84,6 +113,10 @@ pub enum Error {
     ReadError(#[from] ReadError),
     #[error("Error writing record: `{0}`")]
     WriteError(#[from] WriteError),
+    #[error("Error converting data: `{0}`")]
+    ConvertError(#[from] ConvertError),
+    #[error("Error exporting records: `{0}`")]
+    ColumnarError(#[from] ColumnarError),
 }
 /// Crate interface result
 pub type Result<T> = std::result::Result<T, Error>;
@@ -121,6 +154,24 @@ mod test_error {
                 "Error writing record: `Version is not defined`"
             );
         }
+
+        #[test]
+        fn convert_error() {
+            let error = Error::ConvertError(ConvertError::UnsupportedFormat(String::from("XY")));
+            assert_eq!(
+                format!("{}", error),
+                "Error converting data: `Format `XY` cannot be converted`"
+            );
+        }
+
+        #[test]
+        fn columnar_error() {
+            let error = Error::ColumnarError(ColumnarError::SchemaMismatch(2));
+            assert_eq!(
+                format!("{}", error),
+                "Error exporting records: `Record 2 does not have the columns of the first record`"
+            );
+        }
     }
 
     mod from_error {
@@ -149,6 +200,22 @@ mod test_error {
                 e => panic!("{:?}", e),
             }
         }
+
+        #[test]
+        fn from_convert_error() {
+            match Error::from(ConvertError::UnsupportedFormat(String::new())) {
+                Error::ConvertError(ConvertError::UnsupportedFormat(_)) => (),
+                e => panic!("{:?}", e),
+            }
+        }
+
+        #[test]
+        fn from_columnar_error() {
+            match Error::from(ColumnarError::NoRecords) {
+                Error::ColumnarError(ColumnarError::NoRecords) => (),
+                e => panic!("{:?}", e),
+            }
+        }
     }
 }
 
@@ -263,201 +330,313 @@ impl TryFrom<&str> for Keyword {
     type Error = ParseError;
 
     fn try_from(line: &str) -> std::result::Result<Self, Self::Error> {
-        // Avoid recompiling each time
-        lazy_static! {
-            static ref RE_DEVICE: Regex = Regex::new(r"^#(?P<Name>\S+) (?P<Value>.*)$").unwrap();
-            static ref RE_VAR: Regex = Regex::new(r"^VAR (?P<Name>\S+) ?(?P<Format>\S*) (?P<Length>\d+)$").unwrap();
-            static ref RE_CITIFILE: Regex = Regex::new(r"^CITIFILE (?P<Version>\S+)$").unwrap();
-            static ref RE_NAME: Regex = Regex::new(r"^NAME (?P<Name>\S+)$").unwrap();
-            static ref RE_DATA: Regex = Regex::new(r"^DATA (?P<Name>\S+) (?P<Format>\S+)$").unwrap();
-            static ref RE_SEG_ITEM: Regex = Regex::new(r"^SEG (?P<First>[+-]?(\d+)\.?\d*[eE]?[+-]?\d+) (?P<Last>[+-]?(\d+)\.?\d*[eE]?[+-]?\d+) (?P<Number>\d+)$").unwrap();
-            static ref RE_VAR_ITEM: Regex = Regex::new(r"^(?P<Value>[+-]?(\d+)\.?\d*[eE]?[+-]?\d+)$").unwrap();
-            static ref RE_DATA_PAIR: Regex = Regex::new(r"^(?P<Real>\S+),\s*(?P<Imag>\S+)$").unwrap();
-            static ref RE_CONSTANT: Regex = Regex::new(r"^CONSTANT (?P<Name>\S+) (?P<Value>\S+)$").unwrap();
-            static ref RE_COMMENT: Regex = Regex::new(r"^!(?P<Comment>.*)$").unwrap();
-        }
+        KeywordRef::try_from(line).map(Keyword::from)
+    }
+}
+
+/// Borrowed form of [`Keyword`]
+///
+/// Strings are slices of the line they were read from, so lexing a line
+/// does not allocate. The reader works on these directly and only copies
+/// out the header strings it keeps.
+#[derive(Debug, PartialEq, Clone, Copy)]
+enum KeywordRef<'a> {
+    CitiFile {
+        version: &'a str,
+    },
+    Name(&'a str),
+    Var {
+        name: &'a str,
+        format: &'a str,
+        length: usize,
+    },
+    Constant {
+        name: &'a str,
+        value: &'a str,
+    },
+    Device {
+        name: &'a str,
+        value: &'a str,
+    },
+    SegListBegin,
+    SegItem {
+        first: f64,
+        last: f64,
+        number: usize,
+    },
+    SegListEnd,
+    VarListBegin,
+    VarListItem(f64),
+    VarListEnd,
+    Data {
+        name: &'a str,
+        format: &'a str,
+    },
+    DataPair {
+        real: f64,
+        imag: f64,
+    },
+    Begin,
+    End,
+    Comment(&'a str),
+}
+
+impl<'a> TryFrom<&'a str> for KeywordRef<'a> {
+    type Error = ParseError;
 
+    fn try_from(line: &'a str) -> std::result::Result<Self, Self::Error> {
         match line {
-            "SEG_LIST_BEGIN" => Ok(Keyword::SegListBegin),
-            "SEG_LIST_END" => Ok(Keyword::SegListEnd),
-            "VAR_LIST_BEGIN" => Ok(Keyword::VarListBegin),
-            "VAR_LIST_END" => Ok(Keyword::VarListEnd),
-            "BEGIN" => Ok(Keyword::Begin),
-            "END" => Ok(Keyword::End),
-            _ if RE_DATA_PAIR.is_match(line) => {
-                let cap = RE_DATA_PAIR.captures(line).ok_or(ParseError::BadRegex)?;
-                Ok(Keyword::DataPair {
-                    real: cap
-                        .name("Real")
-                        .map(|m| m.as_str())
-                        .ok_or(ParseError::BadRegex)?
-                        .parse::<f64>()
-                        .map_err(|_| ParseError::NumberParseError(String::from(line)))?,
-                    imag: cap
-                        .name("Imag")
-                        .map(|m| m.as_str())
-                        .ok_or(ParseError::BadRegex)?
-                        .parse::<f64>()
-                        .map_err(|_| ParseError::NumberParseError(String::from(line)))?,
-                })
-            }
-            _ if RE_DEVICE.is_match(line) => {
-                let cap = RE_DEVICE.captures(line).ok_or(ParseError::BadRegex)?;
-                Ok(Keyword::Device {
-                    name: String::from(
-                        cap.name("Name")
-                            .map(|m| m.as_str())
-                            .ok_or(ParseError::BadRegex)?,
-                    ),
-                    value: String::from(
-                        cap.name("Value")
-                            .map(|m| m.as_str())
-                            .ok_or(ParseError::BadRegex)?,
-                    ),
-                })
-            }
-            _ if RE_SEG_ITEM.is_match(line) => {
-                let cap = RE_SEG_ITEM.captures(line).ok_or(ParseError::BadRegex)?;
-                Ok(Keyword::SegItem {
-                    first: cap
-                        .name("First")
-                        .map(|m| m.as_str())
-                        .ok_or(ParseError::BadRegex)?
-                        .parse::<f64>()
-                        .map_err(|_| ParseError::NumberParseError(String::from(line)))?,
-                    last: cap
-                        .name("Last")
-                        .map(|m| m.as_str())
-                        .ok_or(ParseError::BadRegex)?
-                        .parse::<f64>()
-                        .map_err(|_| ParseError::NumberParseError(String::from(line)))?,
-                    number: cap
-                        .name("Number")
-                        .map(|m| m.as_str())
-                        .ok_or(ParseError::BadRegex)?
-                        .parse::<usize>()
-                        .map_err(|_| ParseError::NumberParseError(String::from(line)))?,
-                })
-            }
-            _ if RE_VAR_ITEM.is_match(line) => {
-                let cap = RE_VAR_ITEM.captures(line).ok_or(ParseError::BadRegex)?;
-                Ok(Keyword::VarListItem(
-                    cap.name("Value")
-                        .map(|m| m.as_str())
-                        .ok_or(ParseError::BadRegex)?
-                        .parse::<f64>()
-                        .map_err(|_| ParseError::NumberParseError(String::from(line)))?,
-                ))
-            }
-            _ if RE_DATA.is_match(line) => {
-                let cap = RE_DATA.captures(line).ok_or(ParseError::BadRegex)?;
-                Ok(Keyword::Data {
-                    name: String::from(
-                        cap.name("Name")
-                            .map(|m| m.as_str())
-                            .ok_or(ParseError::BadRegex)?,
-                    ),
-                    format: String::from(
-                        cap.name("Format")
-                            .map(|m| m.as_str())
-                            .ok_or(ParseError::BadRegex)?,
-                    ),
-                })
-            }
-            _ if RE_VAR.is_match(line) => {
-                let cap = RE_VAR.captures(line).ok_or(ParseError::BadRegex)?;
-                Ok(Keyword::Var {
-                    name: String::from(
-                        cap.name("Name")
-                            .map(|m| m.as_str())
-                            .ok_or(ParseError::BadRegex)?,
-                    ),
-                    format: String::from(
-                        cap.name("Format")
-                            .map(|m| m.as_str())
-                            .ok_or(ParseError::BadRegex)?,
-                    ),
-                    length: cap
-                        .name("Length")
-                        .map(|m| m.as_str())
-                        .ok_or(ParseError::BadRegex)?
-                        .parse::<usize>()
-                        .map_err(|_| ParseError::NumberParseError(String::from(line)))?,
-                })
-            }
-            _ if RE_COMMENT.is_match(line) => {
-                let cap = RE_COMMENT.captures(line).ok_or(ParseError::BadRegex)?;
-                Ok(Keyword::Comment(String::from(
-                    cap.name("Comment")
-                        .map(|m| m.as_str())
-                        .ok_or(ParseError::BadRegex)?,
-                )))
-            }
-            _ if RE_CITIFILE.is_match(line) => {
-                let cap = RE_CITIFILE.captures(line).ok_or(ParseError::BadRegex)?;
-                Ok(Keyword::CitiFile {
-                    version: String::from(
-                        cap.name("Version")
-                            .map(|m| m.as_str())
-                            .ok_or(ParseError::BadRegex)?,
-                    ),
-                })
+            "SEG_LIST_BEGIN" => return Ok(KeywordRef::SegListBegin),
+            "SEG_LIST_END" => return Ok(KeywordRef::SegListEnd),
+            "VAR_LIST_BEGIN" => return Ok(KeywordRef::VarListBegin),
+            "VAR_LIST_END" => return Ok(KeywordRef::VarListEnd),
+            "BEGIN" => return Ok(KeywordRef::Begin),
+            "END" => return Ok(KeywordRef::End),
+            _ => (),
+        }
+
+        // Data pairs make up most of a record and can start with any
+        // character, so they are tried before dispatching on the first byte.
+        if let Some((real, imag)) = lexer::data_pair(line) {
+            return Ok(KeywordRef::DataPair {
+                real: parse_number(real, line)?,
+                imag: parse_number(imag, line)?,
+            });
+        }
+
+        let keyword = match line.as_bytes().first() {
+            Some(b'#') => {
+                lexer::device(line).map(|(name, value)| KeywordRef::Device { name, value })
             }
-            _ if RE_NAME.is_match(line) => {
-                let cap = RE_NAME.captures(line).ok_or(ParseError::BadRegex)?;
-                Ok(Keyword::Name(String::from(
-                    cap.name("Name")
-                        .map(|m| m.as_str())
-                        .ok_or(ParseError::BadRegex)?,
-                )))
-            }
-            _ if RE_CONSTANT.is_match(line) => {
-                let cap = RE_CONSTANT.captures(line).ok_or(ParseError::BadRegex)?;
-                Ok(Keyword::Constant {
-                    name: String::from(
-                        cap.name("Name")
-                            .map(|m| m.as_str())
-                            .ok_or(ParseError::BadRegex)?,
-                    ),
-                    value: String::from(
-                        cap.name("Value")
-                            .map(|m| m.as_str())
-                            .ok_or(ParseError::BadRegex)?,
-                    ),
-                })
+            Some(b'!') => lexer::comment(line).map(KeywordRef::Comment),
+            Some(b'+') | Some(b'-') | Some(b'0'..=b'9') => match lexer::is_number(line) {
+                true => Some(KeywordRef::VarListItem(parse_number(line, line)?)),
+                false => None,
+            },
+            Some(b'S') => match lexer::seg_item(line) {
+                Some((first, last, number)) => Some(KeywordRef::SegItem {
+                    first: parse_number(first, line)?,
+                    last: parse_number(last, line)?,
+                    number: parse_number(number, line)?,
+                }),
+                None => None,
+            },
+            Some(b'D') => lexer::data(line).map(|(name, format)| KeywordRef::Data { name, format }),
+            Some(b'V') => match lexer::var(line) {
+                Some((name, format, length)) => Some(KeywordRef::Var {
+                    name,
+                    format,
+                    length: parse_number(length, line)?,
+                }),
+                None => None,
+            },
+            Some(b'C') => match lexer::citifile(line) {
+                Some(version) => Some(KeywordRef::CitiFile { version }),
+                None => {
+                    lexer::constant(line).map(|(name, value)| KeywordRef::Constant { name, value })
+                }
+            },
+            Some(b'N') => lexer::name(line).map(KeywordRef::Name),
+            _ => None,
+        };
+
+        keyword.ok_or_else(|| ParseError::BadKeyword(String::from(line)))
+    }
+}
+
+impl From<KeywordRef<'_>> for Keyword {
+    fn from(keyword: KeywordRef) -> Self {
+        match keyword {
+            KeywordRef::CitiFile { version } => Keyword::CitiFile {
+                version: String::from(version),
+            },
+            KeywordRef::Name(name) => Keyword::Name(String::from(name)),
+            KeywordRef::Var {
+                name,
+                format,
+                length,
+            } => Keyword::Var {
+                name: String::from(name),
+                format: String::from(format),
+                length,
+            },
+            KeywordRef::Constant { name, value } => Keyword::Constant {
+                name: String::from(name),
+                value: String::from(value),
+            },
+            KeywordRef::Device { name, value } => Keyword::Device {
+                name: String::from(name),
+                value: String::from(value),
+            },
+            KeywordRef::SegListBegin => Keyword::SegListBegin,
+            KeywordRef::SegItem {
+                first,
+                last,
+                number,
+            } => Keyword::SegItem {
+                first,
+                last,
+                number,
+            },
+            KeywordRef::SegListEnd => Keyword::SegListEnd,
+            KeywordRef::VarListBegin => Keyword::VarListBegin,
+            KeywordRef::VarListItem(value) => Keyword::VarListItem(value),
+            KeywordRef::VarListEnd => Keyword::VarListEnd,
+            KeywordRef::Data { name, format } => Keyword::Data {
+                name: String::from(name),
+                format: String::from(format),
+            },
+            KeywordRef::DataPair { real, imag } => Keyword::DataPair { real, imag },
+            KeywordRef::Begin => Keyword::Begin,
+            KeywordRef::End => Keyword::End,
+            KeywordRef::Comment(comment) => Keyword::Comment(String::from(comment)),
+        }
+    }
+}
+
+impl<'a> From<&'a Keyword> for KeywordRef<'a> {
+    fn from(keyword: &'a Keyword) -> Self {
+        match keyword {
+            Keyword::CitiFile { version } => KeywordRef::CitiFile { version },
+            Keyword::Name(name) => KeywordRef::Name(name),
+            Keyword::Var {
+                name,
+                format,
+                length,
+            } => KeywordRef::Var {
+                name,
+                format,
+                length: *length,
+            },
+            Keyword::Constant { name, value } => KeywordRef::Constant { name, value },
+            Keyword::Device { name, value } => KeywordRef::Device { name, value },
+            Keyword::SegListBegin => KeywordRef::SegListBegin,
+            Keyword::SegItem {
+                first,
+                last,
+                number,
+            } => KeywordRef::SegItem {
+                first: *first,
+                last: *last,
+                number: *number,
+            },
+            Keyword::SegListEnd => KeywordRef::SegListEnd,
+            Keyword::VarListBegin => KeywordRef::VarListBegin,
+            Keyword::VarListItem(value) => KeywordRef::VarListItem(*value),
+            Keyword::VarListEnd => KeywordRef::VarListEnd,
+            Keyword::Data { name, format } => KeywordRef::Data { name, format },
+            Keyword::DataPair { real, imag } => KeywordRef::DataPair {
+                real: *real,
+                imag: *imag,
+            },
+            Keyword::Begin => KeywordRef::Begin,
+            Keyword::End => KeywordRef::End,
+            Keyword::Comment(comment) => KeywordRef::Comment(comment),
+        }
+    }
+}
+
+/// Parse a captured value, reporting the whole line on failure
+fn parse_number<T: FromStr>(value: &str, line: &str) -> std::result::Result<T, ParseError> {
+    value
+        .parse::<T>()
+        .map_err(|_| ParseError::NumberParseError(String::from(line)))
+}
+
+#[cfg(test)]
+mod test_keyword_ref {
+    use super::*;
+
+    #[test]
+    fn round_trip() {
+        let keywords = vec![
+            Keyword::CitiFile {
+                version: String::from("A.01.00"),
+            },
+            Keyword::Name(String::from("CAL_SET")),
+            Keyword::Var {
+                name: String::from("FREQ"),
+                format: String::from("MAG"),
+                length: 201,
+            },
+            Keyword::Constant {
+                name: String::from("A"),
+                value: String::from("B"),
+            },
+            Keyword::Device {
+                name: String::from("NA"),
+                value: String::from("REGISTER 1"),
+            },
+            Keyword::SegListBegin,
+            Keyword::SegItem {
+                first: 1.,
+                last: 2.,
+                number: 3,
+            },
+            Keyword::SegListEnd,
+            Keyword::VarListBegin,
+            Keyword::VarListItem(1.),
+            Keyword::VarListEnd,
+            Keyword::Data {
+                name: String::from("S[1,1]"),
+                format: String::from("RI"),
+            },
+            Keyword::DataPair { real: 1., imag: 2. },
+            Keyword::Begin,
+            Keyword::End,
+            Keyword::Comment(String::from("A comment")),
+        ];
+        for keyword in keywords.iter() {
+            assert_eq!(&Keyword::from(KeywordRef::from(keyword)), keyword);
+        }
+    }
+
+    #[test]
+    fn borrows_from_line() {
+        let line = String::from("#NA REGISTER 1");
+        match KeywordRef::try_from(&line[..]) {
+            Ok(KeywordRef::Device { name, value }) => {
+                assert_eq!(name, "NA");
+                assert_eq!(value, "REGISTER 1");
             }
-            _ => Err(ParseError::BadKeyword(String::from(line))),
+            e => panic!("{:?}", e),
         }
     }
 }
 
 impl fmt::Display for Keyword {
+    fn fmt(&self, f: &mut fmt::Formatter) -> fmt::Result {
+        KeywordRef::from(self).fmt(f)
+    }
+}
+
+impl fmt::Display for KeywordRef<'_> {
     fn fmt(&self, f: &mut fmt::Formatter) -> fmt::Result {
         match self {
-            Keyword::CitiFile { version } => write!(f, "CITIFILE {}", version),
-            Keyword::Name(name) => write!(f, "NAME {}", name),
-            Keyword::Var {
+            KeywordRef::CitiFile { version } => write!(f, "CITIFILE {}", version),
+            KeywordRef::Name(name) => write!(f, "NAME {}", name),
+            KeywordRef::Var {
                 name,
                 format,
                 length,
             } => write!(f, "VAR {} {} {}", name, format, length),
-            Keyword::Constant { name, value } => write!(f, "CONSTANT {} {}", name, value),
-            Keyword::Device { name, value } => write!(f, "#{} {}", name, value),
-            Keyword::SegListBegin => write!(f, "SEG_LIST_BEGIN"),
-            Keyword::SegItem {
+            KeywordRef::Constant { name, value } => write!(f, "CONSTANT {} {}", name, value),
+            KeywordRef::Device { name, value } => write!(f, "#{} {}", name, value),
+            KeywordRef::SegListBegin => write!(f, "SEG_LIST_BEGIN"),
+            KeywordRef::SegItem {
                 first,
                 last,
                 number,
             } => write!(f, "SEG {} {} {}", first, last, number),
-            Keyword::SegListEnd => write!(f, "SEG_LIST_END"),
-            Keyword::VarListBegin => write!(f, "VAR_LIST_BEGIN"),
-            Keyword::VarListItem(n) => write!(f, "{}", n),
-            Keyword::VarListEnd => write!(f, "VAR_LIST_END"),
-            Keyword::Data { name, format } => write!(f, "DATA {} {}", name, format),
-            Keyword::DataPair { real, imag } => write!(f, "{:E},{:E}", real, imag),
-            Keyword::Begin => write!(f, "BEGIN"),
-            Keyword::End => write!(f, "END"),
-            Keyword::Comment(comment) => write!(f, "!{}", comment),
+            KeywordRef::SegListEnd => write!(f, "SEG_LIST_END"),
+            KeywordRef::VarListBegin => write!(f, "VAR_LIST_BEGIN"),
+            KeywordRef::VarListItem(n) => write!(f, "{}", n),
+            KeywordRef::VarListEnd => write!(f, "VAR_LIST_END"),
+            KeywordRef::Data { name, format } => write!(f, "DATA {} {}", name, format),
+            KeywordRef::DataPair { real, imag } => write!(f, "{:E},{:E}", real, imag),
+            KeywordRef::Begin => write!(f, "BEGIN"),
+            KeywordRef::End => write!(f, "END"),
+            KeywordRef::Comment(comment) => write!(f, "!{}", comment),
         }
     }
 }
@@ -1284,45 +1463,184 @@ mod test_device {
     }
 }
 
+/// A `SEG first last number` sweep of the independent variable
+///
+/// The values are `number` evenly spaced points from `first` to `last`.
+#[derive(Debug, PartialEq, Clone, Copy)]
+pub struct Segment {
+    pub first: f64,
+    pub last: f64,
+    pub number: usize,
+}
+
+impl Segment {
+    pub fn new(first: f64, last: f64, number: usize) -> Segment {
+        Segment {
+            first,
+            last,
+            number,
+        }
+    }
+
+    /// Values of the sweep, computed as they are iterated
+    pub fn values(&self) -> impl Iterator<Item = f64> {
+        let Segment {
+            first,
+            last,
+            number,
+        } = *self;
+        let delta = match number {
+            0 | 1 => 0.,
+            _ => (last - first) / ((number - 1) as f64),
+        };
+        (0..number).map(move |i| first + (i as f64) * delta)
+    }
+}
+
 /// The independent variable
-#[derive(Debug, PartialEq, Clone)]
+///
+/// Values read from a `SEG_LIST` are expanded into `data`, and the `SEG`
+/// lines they came from are kept alongside (see [`Var::segments`]). They are
+/// written back as the same `SEG_LIST` while they still give every value.
+/// Otherwise a `SEG_LIST` is only written when [`WriteOptions::segments`]
+/// asks for it and [`Var::sweep`] finds the values to be one linear sweep.
+///
+/// Equality compares the name, format and values, so a variable read from a
+/// `SEG_LIST` equals the same values read from a `VAR_LIST`.
+#[derive(Debug, Clone)]
 pub struct Var {
     pub name: String,
     pub format: String,
     pub data: Vec<f64>,
+    /// `SEG` lines that `data` was expanded from, if it was
+    segments: Option<Vec<Segment>>,
+}
+
+impl PartialEq for Var {
+    fn eq(&self, other: &Var) -> bool {
+        self.name == other.name && self.format == other.format && self.data == other.data
+    }
 }
 
 impl Var {
     fn blank() -> Var {
-        Var {
-            name: String::new(),
-            format: String::new(),
-            data: vec![],
-        }
+        Var::with_data("", "", vec![])
     }
 
     pub fn new(name: &str, format: &str) -> Var {
+        Var::with_data(name, format, vec![])
+    }
+
+    pub fn with_data(name: &str, format: &str, data: Vec<f64>) -> Var {
         Var {
             name: String::from(name),
             format: String::from(format),
-            data: vec![],
+            data,
+            segments: None,
+        }
+    }
+
+    pub fn len(&self) -> usize {
+        self.data.len()
+    }
+
+    pub fn is_empty(&self) -> bool {
+        self.data.is_empty()
+    }
+
+    pub fn iter(&self) -> impl Iterator<Item = f64> + '_ {
+        self.data.iter().copied()
+    }
+
+    /// The `SEG` lines the values were read from
+    ///
+    /// This is `None` once a value has been added by [`Var::push`] or the
+    /// values have been replaced by [`Var::set_data`] or [`Var::clear`].
+    /// Changing `data` directly does not drop them, but they are only
+    /// written while they still give back every value bit for bit.
+    pub fn segments(&self) -> Option<&[Segment]> {
+        self.segments.as_deref()
+    }
+
+    /// The single `SEG` line that gives back every value bit for bit
+    ///
+    /// This is `None` when there are no values, when the first or last is
+    /// not finite, or when the values are not exactly what [`Segment::values`]
+    /// computes from the first, the last and their number.
+    pub fn sweep(&self) -> Option<Segment> {
+        let (&first, &last) = (self.data.first()?, self.data.last()?);
+        if !first.is_finite() || !last.is_finite() {
+            return None;
+        }
+        let segment = Segment::new(first, last, self.data.len());
+        let matches = segment
+            .values()
+            .map(f64::to_bits)
+            .eq(self.data.iter().map(|v| v.to_bits()));
+        match matches {
+            true => Some(segment),
+            false => None,
+        }
+    }
+
+    /// Segments to write the values as, or `None` for a `VAR_LIST`
+    ///
+    /// The kept [`Var::segments`] are checked against the values, which
+    /// costs far less than formatting each value. Otherwise, with `sweep`,
+    /// this is the single [`Var::sweep`].
+    fn written_segments(&self, sweep: bool) -> Option<Vec<Segment>> {
+        if self.data.is_empty() {
+            return None;
+        }
+        if let Some(segments) = &self.segments {
+            let matches = segments
+                .iter()
+                .flat_map(|segment| segment.values())
+                .map(f64::to_bits)
+                .eq(self.data.iter().map(|v| v.to_bits()));
+            if matches {
+                return Some(segments.clone());
+            }
+        }
+        match sweep {
+            true => self.sweep().map(|segment| vec![segment]),
+            false => None,
         }
     }
 
     pub fn push(&mut self, value: f64) {
+        self.segments = None;
         self.data.push(value);
     }
 
+    /// Replace the values, dropping any kept [`Var::segments`]
+    pub fn set_data(&mut self, data: Vec<f64>) {
+        self.segments = None;
+        self.data = data;
+    }
+
+    /// Remove every value, keeping the allocation
+    pub fn clear(&mut self) {
+        self.segments = None;
+        self.data.clear();
+    }
+
+    /// Append the values of a `SEG` line
+    ///
+    /// The segment is kept in [`Var::segments`] when every value so far came
+    /// from one. The number of values comes from the file, so the
+    /// reservation is clamped like the one for a `VAR` length and longer
+    /// segments grow as they are pushed.
     pub fn seq(&mut self, first: f64, last: f64, number: usize) {
-        match number {
-            0 => (),
-            1 => self.push(first),
-            _ => {
-                let delta = (last - first) / ((number - 1) as f64);
-                for i in 0..number {
-                    self.push(first + (i as f64) * delta);
-                }
-            }
+        let segment = Segment::new(first, last, number);
+        match &mut self.segments {
+            Some(segments) => segments.push(segment),
+            None if self.data.is_empty() => self.segments = Some(vec![segment]),
+            None => (),
+        }
+        self.data.reserve(number.min(MAX_RESERVED_SAMPLES));
+        for value in segment.values() {
+            self.data.push(value);
         }
     }
 }
@@ -1334,58 +1652,112 @@ mod test_var {
     #[test]
     fn test_blank() {
         let result = Var::blank();
-        let expected = Var {
-            name: String::new(),
-            format: String::new(),
-            data: vec![],
-        };
-        assert_eq!(result, expected);
+        assert_eq!(result.name, "");
+        assert_eq!(result.format, "");
+        assert!(result.data.is_empty());
+        assert_eq!(result.segments(), None);
     }
 
     #[test]
     fn test_new() {
         let result = Var::new("Name", "Format");
-        let expected = Var {
-            name: String::from("Name"),
-            format: String::from("Format"),
-            data: vec![],
-        };
-        assert_eq!(result, expected);
+        assert_eq!(result.name, "Name");
+        assert_eq!(result.format, "Format");
+        assert!(result.data.is_empty());
+        assert_eq!(result.segments(), None);
     }
 
-    mod test_push {
+    mod test_segments {
         use super::*;
 
         #[test]
-        fn empty() {
-            let mut var = Var {
-                name: String::new(),
-                format: String::new(),
-                data: vec![],
-            };
-            var.push(1.);
-            assert_eq!(vec![1.], var.data);
+        fn seq_keeps_segments() {
+            let mut var = Var::new("Name", "Format");
+            var.seq(1., 2., 2);
+            var.seq(5., 6., 2);
+            assert_eq!(var.data, vec![1., 2., 5., 6.]);
+            assert_eq!(
+                var.segments(),
+                Some(
+                    &[
+                        Segment {
+                            first: 1.,
+                            last: 2.,
+                            number: 2
+                        },
+                        Segment {
+                            first: 5.,
+                            last: 6.,
+                            number: 2
+                        }
+                    ][..]
+                )
+            );
         }
 
         #[test]
-        fn double() {
-            let mut var = Var {
-                name: String::new(),
-                format: String::new(),
-                data: vec![],
-            };
-            var.push(1.);
-            var.push(2.);
-            assert_eq!(vec![1., 2.], var.data);
+        fn seq_after_values() {
+            let mut var = Var::with_data("Name", "Format", vec![0.]);
+            var.seq(1., 2., 2);
+            assert_eq!(var.data, vec![0., 1., 2.]);
+            assert_eq!(var.segments(), None);
         }
 
         #[test]
-        fn existing() {
-            let mut var = Var {
-                name: String::new(),
-                format: String::new(),
-                data: vec![1.],
-            };
+        fn push_drops_segments() {
+            let mut var = Var::new("Name", "Format");
+            var.seq(1., 2., 2);
+            var.push(3.);
+            assert_eq!(var.segments(), None);
+        }
+
+        #[test]
+        fn set_data_drops_segments() {
+            let mut var = Var::new("Name", "Format");
+            var.seq(1., 2., 2);
+            var.set_data(vec![1., 2.]);
+            assert_eq!(var.data, vec![1., 2.]);
+            assert_eq!(var.segments(), None);
+        }
+
+        #[test]
+        fn clear_drops_segments() {
+            let mut var = Var::new("Name", "Format");
+            var.seq(1., 2., 2);
+            var.clear();
+            assert!(var.data.is_empty());
+            assert_eq!(var.segments(), None);
+        }
+
+        #[test]
+        fn eq_ignores_segments() {
+            let mut var = Var::new("Name", "Format");
+            var.seq(1., 2., 2);
+            assert_eq!(var, Var::with_data("Name", "Format", vec![1., 2.]));
+        }
+    }
+
+    mod test_push {
+        use super::*;
+
+        #[test]
+        fn empty() {
+            let mut var = Var::with_data("", "", vec![]);
+            var.push(1.);
+            assert_eq!(vec![1.], var.data);
+        }
+
+        #[test]
+        fn double() {
+            let mut var = Var::with_data("", "", vec![]);
+            var.push(1.);
+            var.push(2.);
+            assert_eq!(vec![1., 2.], var.data);
+        }
+
+        #[test]
+        fn existing() {
+            let mut var = Var::with_data("", "", vec![1.]);
             var.push(2.);
             assert_eq!(vec![1., 2.], var.data);
         }
@@ -1396,58 +1768,96 @@ mod test_var {
 
         #[test]
         fn number_zero() {
-            let mut var = Var {
-                name: String::new(),
-                format: String::new(),
-                data: vec![],
-            };
+            let mut var = Var::with_data("", "", vec![]);
             var.seq(1., 2., 0);
             assert_eq!(Vec::<f64>::new(), var.data);
         }
 
         #[test]
         fn number_one() {
-            let mut var = Var {
-                name: String::new(),
-                format: String::new(),
-                data: vec![],
-            };
+            let mut var = Var::with_data("", "", vec![]);
             var.seq(10., 20., 1);
             assert_eq!(vec![10.], var.data);
         }
 
         #[test]
         fn simple() {
-            let mut var = Var {
-                name: String::new(),
-                format: String::new(),
-                data: vec![],
-            };
+            let mut var = Var::with_data("", "", vec![]);
             var.seq(1., 2., 2);
             assert_eq!(vec![1., 2.], var.data);
         }
 
         #[test]
         fn triple() {
-            let mut var = Var {
-                name: String::new(),
-                format: String::new(),
-                data: vec![],
-            };
+            let mut var = Var::with_data("", "", vec![]);
             var.seq(2000000000., 3000000000., 3);
             assert_eq!(vec![2000000000., 2500000000., 3000000000.], var.data);
         }
 
         #[test]
         fn reversed() {
-            let mut var = Var {
-                name: String::new(),
-                format: String::new(),
-                data: vec![],
-            };
+            let mut var = Var::with_data("", "", vec![]);
             var.seq(3000000000., 2000000000., 3);
             assert_eq!(vec![3000000000., 2500000000., 2000000000.], var.data);
         }
+
+        #[test]
+        fn after_values() {
+            let mut var = Var::new("", "");
+            var.push(0.5);
+            var.seq(1., 2., 2);
+            assert_eq!(vec![0.5, 1., 2.], var.data);
+        }
+    }
+
+    mod test_sweep {
+        use super::*;
+
+        #[test]
+        fn none() {
+            let var = Var::new("", "");
+            assert_eq!(var.sweep(), None);
+        }
+
+        #[test]
+        fn one_value() {
+            let mut var = Var::new("", "");
+            var.push(1.);
+            assert_eq!(var.sweep(), Some(Segment::new(1., 1., 1)));
+        }
+
+        #[test]
+        fn seq() {
+            let mut var = Var::new("", "");
+            var.seq(1e9, 4e9, 10);
+            assert_eq!(var.sweep(), Some(Segment::new(1e9, 4e9, 10)));
+        }
+
+        #[test]
+        fn modified() {
+            let mut var = Var::new("", "");
+            var.seq(1e9, 4e9, 10);
+            var.data[3] += 1.;
+            assert_eq!(var.sweep(), None);
+            var.data[3] -= 1.;
+            var.push(5e9);
+            assert_eq!(var.sweep(), None);
+        }
+
+        #[test]
+        fn two_segments() {
+            let mut var = Var::new("", "");
+            var.seq(1., 2., 2);
+            var.seq(4., 5., 2);
+            assert_eq!(var.sweep(), None);
+        }
+
+        #[test]
+        fn not_finite() {
+            let mut var = Var::new("", "");
+            var.push(f64::INFINITY);
+            assert_eq!(var.sweep(), None);
+        }
     }
 }
 
@@ -1531,11 +1941,19 @@ impl Header {
         }
     }
 
+    /// Add an entry to the device called `device_name`, creating the device
+    /// if needed
+    ///
+    /// Finding the device scans the names, as [`Header::index_device`] does.
     pub fn add_device(&mut self, device_name: &str, value: &str) {
-        self.create_device(device_name);
-        if let Some(i) = self.index_device(device_name) {
-            self.devices[i].entries.push(String::from(value));
-        }
+        let i = match self.index_device(device_name) {
+            Some(i) => i,
+            None => {
+                self.devices.push(Device::new(device_name));
+                self.devices.len() - 1
+            }
+        };
+        self.devices[i].entries.push(String::from(value));
     }
 
     /// If the device already exists, nothing happens
@@ -1549,9 +1967,17 @@ impl Header {
         self.devices.iter().find(|&x| x.name == device_name)
     }
 
+    /// Index of the first device called `device_name`
+    ///
+    /// This scans the names; [`Record::name_index`] answers many lookups
+    /// without scanning.
     pub fn index_device(&self, device_name: &str) -> Option<usize> {
         self.devices.iter().position(|x| x.name == device_name)
     }
+
+    pub fn get_constant_by_name(&self, constant_name: &str) -> Option<&Constant> {
+        self.constants.iter().find(|&x| x.name == constant_name)
+    }
 }
 
 #[cfg(test)]
@@ -1565,11 +1991,7 @@ mod test_header {
             name: String::new(),
             comments: vec![],
             devices: vec![],
-            independent_variable: Var {
-                name: String::new(),
-                format: String::new(),
-                data: vec![],
-            },
+            independent_variable: Var::with_data("", "", vec![]),
             constants: vec![],
         };
         let result = Header::default();
@@ -1583,11 +2005,7 @@ mod test_header {
             name: String::from("A_NAME"),
             comments: vec![],
             devices: vec![],
-            independent_variable: Var {
-                name: String::new(),
-                format: String::new(),
-                data: vec![],
-            },
+            independent_variable: Var::with_data("", "", vec![]),
             constants: vec![],
         };
         let result = Header::new("A.01.01", "A_NAME");
@@ -1748,13 +2166,131 @@ mod test_header {
                 );
             }
         }
+
+        #[cfg(test)]
+        mod test_get_constant_by_name {
+            use super::*;
+
+            #[test]
+            fn empty() {
+                let header = Header::new("A.01.01", "A_NAME");
+                assert_eq!(header.get_constant_by_name(""), None);
+            }
+
+            #[test]
+            fn constant_found() {
+                let mut header = Header::new("A.01.01", "A_NAME");
+                header.constants.push(Constant::new("A", "B"));
+                header.constants.push(Constant::new("C", "D"));
+                assert_eq!(
+                    header.get_constant_by_name("C"),
+                    Some(&Constant::new("C", "D"))
+                );
+            }
+        }
+    }
+}
+
+/// Error from converting data arrays
+#[derive(Error, Debug)]
+pub enum ConvertError {
+    #[error("Format `{0}` cannot be converted")]
+    UnsupportedFormat(String),
+}
+
+/// Error from exporting records with [`columnar`]
+#[derive(Error, Debug)]
+pub enum ColumnarError {
+    #[error("Exporting records needs the `columnar` feature")]
+    Unsupported,
+    #[error("No records to export")]
+    NoRecords,
+    #[error("Record {0} does not have the columns of the first record")]
+    SchemaMismatch(usize),
+    #[error(
+        "Data array {1} of record {0} does not have one sample per independent variable value"
+    )]
+    RaggedDataArray(usize, usize),
+    #[cfg(feature = "columnar")]
+    #[error("Arrow error: {0}")]
+    Arrow(arrow::error::ArrowError),
+    #[cfg(feature = "columnar")]
+    #[error("Parquet error: {0}")]
+    Parquet(parquet::errors::ParquetError),
+}
+
+/// Formats of a data array that the samples can be converted between
+///
+/// Angles are in degrees.
+#[derive(Debug, PartialEq, Eq, Clone, Copy)]
+pub enum DataFormat {
+    /// `RI`: real and imaginary part
+    RealImaginary,
+    /// `MA`: magnitude and angle
+    MagnitudeAngle,
+    /// `DB`: magnitude in decibels, `20 log10(magnitude)`, and angle
+    DecibelAngle,
+}
+
+impl DataFormat {
+    /// Name of the format in a `DATA` keyword
+    pub fn as_str(&self) -> &'static str {
+        match self {
+            DataFormat::RealImaginary => "RI",
+            DataFormat::MagnitudeAngle => "MA",
+            DataFormat::DecibelAngle => "DB",
+        }
+    }
+}
+
+impl FromStr for DataFormat {
+    type Err = ConvertError;
+
+    fn from_str(s: &str) -> std::result::Result<Self, Self::Err> {
+        match s {
+            "RI" => Ok(DataFormat::RealImaginary),
+            "MA" => Ok(DataFormat::MagnitudeAngle),
+            "DB" => Ok(DataFormat::DecibelAngle),
+            _ => Err(ConvertError::UnsupportedFormat(String::from(s))),
+        }
+    }
+}
+
+#[cfg(test)]
+mod test_data_format {
+    use super::*;
+
+    #[test]
+    fn round_trips_names() {
+        for &format in &[
+            DataFormat::RealImaginary,
+            DataFormat::MagnitudeAngle,
+            DataFormat::DecibelAngle,
+        ] {
+            assert_eq!(format.as_str().parse::<DataFormat>().unwrap(), format);
+        }
+    }
+
+    #[test]
+    fn unsupported() {
+        match "ri".parse::<DataFormat>() {
+            Err(ConvertError::UnsupportedFormat(format)) => assert_eq!(format, "ri"),
+            e => panic!("{:?}", e),
+        }
+    }
+
+    #[test]
+    fn display_unsupported() {
+        let error = ConvertError::UnsupportedFormat(String::from("XY"));
+        assert_eq!(format!("{}", error), "Format `XY` cannot be converted");
     }
 }
 
 /// A named, formatted, data array
 ///
 /// Consistency of the format with the variable `samples` is not
-/// guaranteed and should be enforced by users of this code.
+/// guaranteed and should be enforced by users of this code, or the samples
+/// can be converted along with it by [`DataArray::convert_to`].
 #[derive(Debug, PartialEq, Clone)]
 pub struct DataArray {
     pub name: String,
@@ -1783,6 +2319,33 @@ impl DataArray {
     pub fn add_sample(&mut self, real: f64, imag: f64) {
         self.samples.push(Complex::<f64>::new(real, imag));
     }
+
+    /// Convert the samples in place and set the format to match
+    ///
+    /// The current format has to be one of [`DataFormat`], otherwise
+    /// nothing is changed.
+    ///
+    /// Example usage:
+    /// ```
+    /// use citi::{DataArray, DataFormat};
+    ///
+    /// let mut data_array = DataArray::new("S", "RI");
+    /// data_array.add_sample(0., 10.);
+    /// data_array.convert_to(DataFormat::DecibelAngle).unwrap();
+    /// assert_eq!(data_array.format, "DB");
+    /// assert_eq!(data_array.samples[0].re, 20.);
+    /// assert_eq!(data_array.samples[0].im, 90.);
+    /// ```
+    pub fn convert_to(&mut self, format: DataFormat) -> Result<()> {
+        let from = self.format.parse::<DataFormat>()?;
+        self.convert_from(from, format);
+        Ok(())
+    }
+
+    fn convert_from(&mut self, from: DataFormat, to: DataFormat) {
+        convert::convert(&mut self.samples, from, to);
+        self.format = String::from(to.as_str());
+    }
 }
 
 #[cfg(test)]
@@ -1855,6 +2418,34 @@ mod test_data_array {
             );
         }
     }
+
+    mod test_convert_to {
+        use super::*;
+
+        #[test]
+        fn sets_format() {
+            let mut result = DataArray::new("S", "RI");
+            result.add_sample(3., 4.);
+            result.convert_to(DataFormat::MagnitudeAngle).unwrap();
+            assert_eq!(result.format, "MA");
+            approx::assert_relative_eq!(result.samples[0].re, 5.);
+            approx::assert_relative_eq!(result.samples[0].im, 4f64.atan2(3.).to_degrees());
+        }
+
+        #[test]
+        fn unsupported_format_is_unchanged() {
+            let mut result = DataArray::new("S", "XY");
+            result.add_sample(3., 4.);
+            match result.convert_to(DataFormat::MagnitudeAngle) {
+                Err(Error::ConvertError(ConvertError::UnsupportedFormat(format))) => {
+                    assert_eq!(format, "XY")
+                }
+                e => panic!("{:?}", e),
+            }
+            assert_eq!(result.format, "XY");
+            assert_eq!(result.samples, vec![Complex { re: 3., im: 4. }]);
+        }
+    }
 }
 
 /// Representation of a file
@@ -1873,1235 +2464,6125 @@ impl Default for Record {
     }
 }
 
-/// Error during writing
-#[derive(Error, Debug)]
-pub enum WriteError {
-    #[error("Version is not defined")]
-    NoVersion,
-    #[error("Name is not defined")]
-    NoName,
-    #[error("Data array {0} has no name")]
-    NoDataName(usize),
-    #[error("Data array {0} has no format")]
-    NoDataFormat(usize),
-    #[error("Writing error occured: {0}")]
-    WrittingError(std::io::Error),
+/// Compression of a record file
+///
+/// The readers built on [`Record::from_reader`] detect it from the first
+/// bytes of the file, so compressed and plain files are read alike. Writers
+/// compress according to [`WriteOptions::compression`], which
+/// [`Compression::from_path`] picks from the file name.
+///
+/// Gzip needs the `gzip` cargo feature and zstd the `zstd` one; without them
+/// such files fail with [`ReadError::UnsupportedCompression`] and
+/// [`WriteError::UnsupportedCompression`].
+///
+/// Example usage:
+/// ```no_run
+/// use citi::{Compression, Record, WriteOptions};
+/// use std::fs::File;
+///
+/// let record = Record::from_path_mmap("file.cti.gz").unwrap();
+/// let options = WriteOptions {
+///     compression: Compression::from_path("file.cti.zst"),
+///     ..WriteOptions::default()
+/// };
+/// let mut file = File::create("file.cti.zst").unwrap();
+/// record.to_writer_with_options(&mut file, &options).unwrap();
+/// ```
+#[derive(Debug, PartialEq, Eq, Clone, Copy)]
+pub enum Compression {
+    None,
+    Gzip,
+    Zstd,
 }
-type WriteResult<T> = std::result::Result<T, WriteError>;
 
-#[cfg(test)]
-mod test_write_result {
-    use super::*;
-
-    mod test_display {
-        use super::*;
-
-        #[test]
-        fn no_version() {
-            let error = WriteError::NoVersion;
-            assert_eq!(format!("{}", error), "Version is not defined");
+impl Compression {
+    /// From the magic number at the start of a file
+    pub fn from_magic(bytes: &[u8]) -> Compression {
+        if bytes.starts_with(&[0x1F, 0x8B]) {
+            Compression::Gzip
+        } else if bytes.starts_with(&[0x28, 0xB5, 0x2F, 0xFD]) {
+            Compression::Zstd
+        } else {
+            Compression::None
         }
+    }
 
-        #[test]
-        fn no_name() {
-            let error = WriteError::NoName;
-            assert_eq!(format!("{}", error), "Name is not defined");
+    /// From the extension of a file name, `.gz` or `.zst`
+    pub fn from_path<P: AsRef<Path>>(path: P) -> Compression {
+        match path.as_ref().extension().and_then(|e| e.to_str()) {
+            Some("gz") => Compression::Gzip,
+            Some("zst") => Compression::Zstd,
+            _ => Compression::None,
         }
+    }
 
-        #[test]
-        fn no_data_name() {
-            let error = WriteError::NoDataName(1);
-            assert_eq!(format!("{}", error), "Data array 1 has no name");
+    pub fn as_str(&self) -> &'static str {
+        match self {
+            Compression::None => "none",
+            Compression::Gzip => "gzip",
+            Compression::Zstd => "zstd",
         }
+    }
+}
 
-        #[test]
-        fn no_data_name_second() {
-            let error = WriteError::NoDataName(2);
-            assert_eq!(format!("{}", error), "Data array 2 has no name");
-        }
+impl fmt::Display for Compression {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        f.write_str(self.as_str())
+    }
+}
 
-        #[test]
-        fn no_data_format() {
-            let error = WriteError::NoDataFormat(1);
-            assert_eq!(format!("{}", error), "Data array 1 has no format");
-        }
+#[cfg(test)]
+mod test_compression {
+    use super::*;
 
-        #[test]
-        fn no_data_format_second() {
-            let error = WriteError::NoDataFormat(2);
-            assert_eq!(format!("{}", error), "Data array 2 has no format");
-        }
+    #[test]
+    fn from_magic() {
+        assert_eq!(Compression::from_magic(b"\x1F\x8B\x08"), Compression::Gzip);
+        assert_eq!(
+            Compression::from_magic(b"\x28\xB5\x2F\xFD"),
+            Compression::Zstd
+        );
+        assert_eq!(Compression::from_magic(b"CITIFILE"), Compression::None);
+        assert_eq!(Compression::from_magic(b"\x1F"), Compression::None);
+        assert_eq!(Compression::from_magic(b""), Compression::None);
+    }
 
-        #[test]
-        fn writting_error() {
-            let error = WriteError::WrittingError(std::io::ErrorKind::NotFound.into());
-            assert_eq!(
-                format!("{}", error),
-                "Writing error occured: entity not found"
-            );
-        }
+    #[test]
+    fn from_path() {
+        assert_eq!(Compression::from_path("a/file.cti.gz"), Compression::Gzip);
+        assert_eq!(Compression::from_path("file.cti.zst"), Compression::Zstd);
+        assert_eq!(Compression::from_path("file.cti"), Compression::None);
+        assert_eq!(Compression::from_path("gz"), Compression::None);
     }
-}
 
-impl Record {
-    pub fn new(version: &str, name: &str) -> Record {
-        Record {
-            header: Header::new(version, name),
-            data: vec![],
-        }
+    #[test]
+    fn display() {
+        assert_eq!(format!("{}", Compression::Zstd), "zstd");
     }
 
-    /// Read record
-    ///
-    /// Example usage:
-    /// ```no_run
-    /// use citi::Record;
-    /// use std::fs::File;
-    ///
-    /// let mut file = File::open("file.cti").unwrap();
-    /// let record = Record::from_reader(&mut file);
-    /// ```
-    pub fn from_reader<R: std::io::Read>(reader: &mut R) -> Result<Record> {
-        let mut state = RecordReaderState::new();
+    const CONTENTS: &str = "CITIFILE A.01.00\nNAME MEMORY\nVAR FREQ MAG 2\nDATA S RI\nBEGIN\n-3.54545E-2,-1.38601E-3\n0.23491E-3,-1.39883E-3\nEND\n";
 
-        let buf_reader = std::io::BufReader::new(reader);
-        for (i, line) in buf_reader.lines().enumerate() {
-            let this_line = line.map_err(ReadError::ReadingError)?;
-            // Filter out new lines
-            if !this_line.trim().is_empty() {
-                let keyword =
-                    Keyword::from_str(&this_line).map_err(|e| ReadError::LineError(i, e))?;
-                state = state.process_keyword(keyword)?;
-            }
-        }
+    fn written(compression: Compression) -> Result<Vec<u8>> {
+        let record = Record::from_reader(&mut CONTENTS.as_bytes()).unwrap();
+        let options = WriteOptions {
+            compression,
+            ..WriteOptions::default()
+        };
+        let mut bytes = vec![];
+        record.to_writer_with_options(&mut bytes, &options)?;
+        Ok(bytes)
+    }
 
-        Ok(state.validate_record()?.record)
+    #[cfg(feature = "gzip")]
+    fn assert_reads_compressed(compression: Compression) {
+        let expected = Record::from_reader(&mut CONTENTS.as_bytes()).unwrap();
+        let bytes = written(compression).unwrap();
+        assert_eq!(Compression::from_magic(&bytes), compression);
+        assert_eq!(Record::from_reader(&mut &bytes[..]).unwrap(), expected);
+        assert_eq!(Record::from_slice_parallel(&bytes, 2).unwrap(), expected);
+
+        let mut record = Record::default();
+        record.read_into(&mut &bytes[..]).unwrap();
+        assert_eq!(record, expected);
     }
 
-    /// Write record
+    #[cfg(feature = "gzip")]
+    #[test]
+    fn gzip() {
+        assert_reads_compressed(Compression::Gzip);
+    }
+
+    #[cfg(all(feature = "gzip", feature = "zstd"))]
+    #[test]
+    fn zstd() {
+        assert_reads_compressed(Compression::Zstd);
+    }
+
+    #[cfg(not(feature = "gzip"))]
+    #[test]
+    fn gzip_unsupported() {
+        match written(Compression::Gzip) {
+            Err(Error::WriteError(WriteError::UnsupportedCompression(Compression::Gzip))) => (),
+            e => panic!("{:?}", e),
+        }
+        match Record::from_reader(&mut &b"\x1F\x8B\x08\x00"[..]) {
+            Err(Error::ReadError(ReadError::UnsupportedCompression(Compression::Gzip))) => (),
+            e => panic!("{:?}", e),
+        }
+    }
+}
+
+/// Options for [`Record::from_reader_with_options`]
+///
+/// The default reads everything, the same as [`Record::from_reader`].
+#[derive(Debug, PartialEq, Clone, Default)]
+pub struct ReadOptions {
+    /// Stop reading at the first `BEGIN`
     ///
-    /// Example usage:
-    /// ```no_run
-    /// use citi::Record;
-    /// use std::fs::File;
+    /// The data arrays keep their name and format but have no samples.
+    pub header_only: bool,
+    /// Names of the data arrays to keep, or `None` to keep every array
     ///
-    /// let record = Record::default();
-    /// let mut file = File::create("file.cti").unwrap();
-    /// record.to_writer(&mut file);
-    /// ```
-    pub fn to_writer<W: std::io::Write>(&self, writer: &mut W) -> Result<()> {
-        let keywords = self.get_keywords()?;
+    /// The `BEGIN`…`END` blocks of the other arrays are skipped by scanning
+    /// for `END` without parsing their lines, and the arrays are left out of
+    /// [`Record::data`].
+    pub data_arrays: Option<Vec<String>>,
+}
 
-        for keyword in keywords.iter() {
-            writeln!(writer, "{}", keyword).map_err(WriteError::WrittingError)?;
+impl ReadOptions {
+    /// Whether the data array called `name` is kept
+    fn selects(&self, name: &str) -> bool {
+        match &self.data_arrays {
+            Some(names) => names.iter().any(|n| n == name),
+            None => true,
         }
-
-        Ok(())
     }
+}
 
-    #[allow(clippy::unnecessary_wraps)]
-    fn get_data_keywords(&self) -> WriteResult<Vec<Keyword>> {
-        let mut keywords: Vec<Keyword> = vec![];
+/// Notation for the data pairs written by [`Record::to_writer_with_options`]
+#[derive(Debug, PartialEq, Clone, Copy)]
+pub enum FloatFormat {
+    /// Shortest digits that read back to the same value, e.g. `-1.31189E-3`
+    RoundTrip,
+    /// Fixed number of significant digits in E notation, e.g. `7.80120E-1`
+    SignificantDigits(usize),
+}
 
-        // Add each array
-        for array in self.data.iter() {
-            keywords.push(Keyword::Begin);
+/// Options for [`Record::to_writer_with_options`]
+#[derive(Debug, PartialEq, Clone, Copy)]
+pub struct WriteOptions {
+    /// Notation for the data pairs
+    pub data_format: FloatFormat,
+    /// Compression of the whole record, which [`RecordWriter`] rejects
+    pub compression: Compression,
+    /// Workers formatting the data pairs, where 0 uses one per available core
+    ///
+    /// The default of 1 formats them on the calling thread. Otherwise the
+    /// data arrays are cut into chunks that are formatted on a pool of
+    /// threads and written in order, so the bytes are the same either way.
+    /// [`RecordWriter`] always formats on the calling thread.
+    pub threads: usize,
+    /// Also write the independent variable as a `SEG_LIST` when it is one
+    /// linear sweep, see [`Var::sweep`]
+    ///
+    /// A variable that keeps the segments it was read from (see
+    /// [`Var::segments`]) is written as that `SEG_LIST` either way. This
+    /// only decides whether other values are checked for a sweep, which is
+    /// off by default.
+    pub segments: bool,
+}
 
-            for Complex { re: real, im: imag } in array.samples.iter() {
-                keywords.push(Keyword::DataPair {
-                    real: *real,
-                    imag: *imag,
-                });
-            }
-            keywords.push(Keyword::End);
+impl Default for WriteOptions {
+    fn default() -> Self {
+        WriteOptions {
+            data_format: FloatFormat::RoundTrip,
+            compression: Compression::None,
+            threads: 1,
+            segments: false,
         }
-
-        Ok(keywords)
     }
+}
 
-    fn get_data_defines_keywords(&self) -> WriteResult<Vec<Keyword>> {
-        let mut keywords: Vec<Keyword> = vec![];
+/// Number of keywords of each kind in [`ReadStats`] and [`WriteStats`]
+///
+/// Data pairs are counted as samples instead.
+#[repr(C)]
+#[derive(Debug, PartialEq, Eq, Clone, Copy, Default)]
+pub struct KeywordCounts {
+    pub citifile: u64,
+    pub name: u64,
+    pub var: u64,
+    pub constant: u64,
+    pub device: u64,
+    pub comment: u64,
+    pub data: u64,
+    pub seg_list_begin: u64,
+    pub seg_item: u64,
+    pub seg_list_end: u64,
+    pub var_list_begin: u64,
+    pub var_list_item: u64,
+    pub var_list_end: u64,
+    pub begin: u64,
+    pub end: u64,
+}
 
-        for (i, array) in self.data.iter().enumerate() {
-            match (array.name.is_empty(), array.format.is_empty()) {
-                (true, _) => return Err(WriteError::NoDataName(i)),
-                (_, true) => return Err(WriteError::NoDataFormat(i)),
-                (_, _) => keywords.push(Keyword::Data {
-                    name: array.name.clone(),
-                    format: array.format.clone(),
-                }),
-            }
-        }
-        Ok(keywords)
+impl KeywordCounts {
+    /// Count `keyword`, adding a data pair to `samples`
+    fn count(&mut self, keyword: &KeywordRef, samples: &mut u64) {
+        let counter = match keyword {
+            KeywordRef::CitiFile { .. } => &mut self.citifile,
+            KeywordRef::Name(_) => &mut self.name,
+            KeywordRef::Var { .. } => &mut self.var,
+            KeywordRef::Constant { .. } => &mut self.constant,
+            KeywordRef::Device { .. } => &mut self.device,
+            KeywordRef::Comment(_) => &mut self.comment,
+            KeywordRef::Data { .. } => &mut self.data,
+            KeywordRef::SegListBegin => &mut self.seg_list_begin,
+            KeywordRef::SegItem { .. } => &mut self.seg_item,
+            KeywordRef::SegListEnd => &mut self.seg_list_end,
+            KeywordRef::VarListBegin => &mut self.var_list_begin,
+            KeywordRef::VarListItem(_) => &mut self.var_list_item,
+            KeywordRef::VarListEnd => &mut self.var_list_end,
+            KeywordRef::Begin => &mut self.begin,
+            KeywordRef::End => &mut self.end,
+            KeywordRef::DataPair { .. } => samples,
+        };
+        *counter += 1;
     }
+}
 
-    fn get_version_keywords(&self) -> WriteResult<Vec<Keyword>> {
-        match !self.header.version.is_empty() {
-            true => Ok(vec![Keyword::CitiFile {
-                version: self.header.version.clone(),
-            }]),
-            false => Err(WriteError::NoVersion),
+/// Counts and wall clock times filled in by [`Record::from_reader_with_stats`]
+///
+/// Every read adds to the values already there, so a single `ReadStats` can
+/// sum up a whole batch. Times are in nanoseconds. Allocations are not
+/// counted, since that takes a global allocator, which is up to the
+/// application.
+///
+/// The layout is fixed so that the ffi can hand out the same struct.
+#[repr(C)]
+#[derive(Debug, PartialEq, Eq, Clone, Copy, Default)]
+pub struct ReadStats {
+    /// Bytes taken from the reader
+    pub bytes: u64,
+    /// Lines, including blank lines and the lines of skipped data arrays
+    pub lines: u64,
+    pub keywords: KeywordCounts,
+    /// Data pairs parsed
+    pub samples: u64,
+    /// Waiting on the reader
+    pub read_nanoseconds: u64,
+    /// Splitting lines into keywords, including parsing their numbers
+    pub lex_nanoseconds: u64,
+    /// Adding the keywords to the record
+    pub process_nanoseconds: u64,
+    /// Checking the finished record
+    pub validate_nanoseconds: u64,
+    /// Whole read, including all of the above
+    pub total_nanoseconds: u64,
+}
+
+/// Counts and wall clock times filled in by [`Record::to_writer_with_stats`]
+///
+/// As with [`ReadStats`], every write adds to the values already there.
+#[repr(C)]
+#[derive(Debug, PartialEq, Eq, Clone, Copy, Default)]
+pub struct WriteStats {
+    /// Bytes handed to the writer
+    pub bytes: u64,
+    pub lines: u64,
+    pub keywords: KeywordCounts,
+    /// Data pairs written
+    pub samples: u64,
+    /// Checking the record and formatting its lines
+    pub format_nanoseconds: u64,
+    /// Waiting on the writer, including the final flush
+    pub write_nanoseconds: u64,
+    /// Whole write, including all of the above
+    pub total_nanoseconds: u64,
+}
+
+/// Saturates after 584 years
+fn nanoseconds(duration: Duration) -> u64 {
+    u64::try_from(duration.as_nanos()).unwrap_or(u64::MAX)
+}
+
+/// Adds up the bytes read and the time spent reading them
+struct TimedReader<'a, R> {
+    inner: &'a mut R,
+    bytes: u64,
+    nanoseconds: u64,
+}
+
+impl<R: Read> Read for TimedReader<'_, R> {
+    fn read(&mut self, buf: &mut [u8]) -> std::io::Result<usize> {
+        let start = Instant::now();
+        let result = self.inner.read(buf);
+        self.nanoseconds += nanoseconds(start.elapsed());
+        if let Ok(n) = result {
+            self.bytes += n as u64;
         }
+        result
     }
+}
 
-    fn get_name_keywords(&self) -> WriteResult<Vec<Keyword>> {
-        match !self.header.name.is_empty() {
-            true => Ok(vec![Keyword::Name(self.header.name.clone())]),
-            false => Err(WriteError::NoName),
+/// Adds up the bytes written and the time spent writing them
+struct TimedWriter<'a, W> {
+    inner: &'a mut W,
+    bytes: u64,
+    nanoseconds: u64,
+}
+
+impl<W: Write> Write for TimedWriter<'_, W> {
+    fn write(&mut self, buf: &[u8]) -> std::io::Result<usize> {
+        let start = Instant::now();
+        let result = self.inner.write(buf);
+        self.nanoseconds += nanoseconds(start.elapsed());
+        if let Ok(n) = result {
+            self.bytes += n as u64;
         }
+        result
     }
 
-    #[allow(clippy::unnecessary_wraps)]
-    fn get_comments_keywords(&self) -> WriteResult<Vec<Keyword>> {
-        Ok(self
-            .header
-            .comments
-            .iter()
-            .map(|s| Keyword::Comment(s.clone()))
-            .collect())
+    fn flush(&mut self) -> std::io::Result<()> {
+        let start = Instant::now();
+        let result = self.inner.flush();
+        self.nanoseconds += nanoseconds(start.elapsed());
+        result
     }
+}
 
-    #[allow(clippy::unnecessary_wraps)]
-    fn get_devices_keywords(&self) -> WriteResult<Vec<Keyword>> {
-        let mut keywords: Vec<Keyword> = vec![];
+/// Error during writing
+#[derive(Error, Debug)]
+pub enum WriteError {
+    #[error("Version is not defined")]
+    NoVersion,
+    #[error("Name is not defined")]
+    NoName,
+    #[error("Data array {0} has no name")]
+    NoDataName(usize),
+    #[error("Data array {0} has no format")]
+    NoDataFormat(usize),
+    #[error("Writing error occured: {0}")]
+    WrittingError(std::io::Error),
+    #[error("{0} called out of order")]
+    OutOfOrder(&'static str),
+    #[error("Data array {0} does not match its declaration")]
+    UndeclaredDataArray(usize),
+    #[error("Data array {0} was declared but not written")]
+    MissingDataArray(usize),
+    #[error("Writing {0} compressed records needs the `{0}` feature")]
+    UnsupportedCompression(Compression),
+}
+type WriteResult<T> = std::result::Result<T, WriteError>;
 
-        for device in self.header.devices.iter() {
-            for entry in device.entries.iter() {
-                keywords.push(Keyword::Device {
-                    name: device.name.clone(),
-                    value: entry.clone(),
-                });
-            }
+#[cfg(test)]
+mod test_write_result {
+    use super::*;
+
+    mod test_display {
+        use super::*;
+
+        #[test]
+        fn no_version() {
+            let error = WriteError::NoVersion;
+            assert_eq!(format!("{}", error), "Version is not defined");
         }
 
-        Ok(keywords)
-    }
+        #[test]
+        fn no_name() {
+            let error = WriteError::NoName;
+            assert_eq!(format!("{}", error), "Name is not defined");
+        }
 
-    #[allow(clippy::unnecessary_wraps)]
-    fn get_independent_variable_keywords(&self) -> WriteResult<Vec<Keyword>> {
-        Ok(vec![Keyword::Var {
-            name: self.header.independent_variable.name.clone(),
-            format: self.header.independent_variable.format.clone(),
-            length: self.header.independent_variable.data.len(),
-        }])
-    }
+        #[test]
+        fn no_data_name() {
+            let error = WriteError::NoDataName(1);
+            assert_eq!(format!("{}", error), "Data array 1 has no name");
+        }
 
-    #[allow(clippy::unnecessary_wraps)]
-    fn get_var_keywords(&self) -> WriteResult<Vec<Keyword>> {
-        let mut keywords: Vec<Keyword> = vec![];
+        #[test]
+        fn no_data_name_second() {
+            let error = WriteError::NoDataName(2);
+            assert_eq!(format!("{}", error), "Data array 2 has no name");
+        }
 
-        // Do not set if length == 0
-        if !self.header.independent_variable.data.is_empty() {
-            keywords.push(Keyword::VarListBegin);
-            for &v in self.header.independent_variable.data.iter() {
-                keywords.push(Keyword::VarListItem(v));
-            }
-            keywords.push(Keyword::VarListEnd);
+        #[test]
+        fn no_data_format() {
+            let error = WriteError::NoDataFormat(1);
+            assert_eq!(format!("{}", error), "Data array 1 has no format");
         }
 
-        Ok(keywords)
-    }
+        #[test]
+        fn no_data_format_second() {
+            let error = WriteError::NoDataFormat(2);
+            assert_eq!(format!("{}", error), "Data array 2 has no format");
+        }
 
-    #[allow(clippy::unnecessary_wraps)]
-    fn get_constants_keywords(&self) -> WriteResult<Vec<Keyword>> {
-        Ok(self
-            .header
-            .constants
-            .iter()
-            .map(|c| Keyword::Constant {
-                name: c.name.clone(),
-                value: c.value.clone(),
-            })
-            .collect())
-    }
+        #[test]
+        fn writting_error() {
+            let error = WriteError::WrittingError(std::io::ErrorKind::NotFound.into());
+            assert_eq!(
+                format!("{}", error),
+                "Writing error occured: entity not found"
+            );
+        }
 
-    fn get_keywords(&self) -> WriteResult<Vec<Keyword>> {
-        let mut keywords: Vec<Keyword> = vec![];
+        #[test]
+        fn out_of_order() {
+            let error = WriteError::OutOfOrder("end_array");
+            assert_eq!(format!("{}", error), "end_array called out of order");
+        }
 
-        keywords.append(&mut self.get_version_keywords()?);
-        keywords.append(&mut self.get_name_keywords()?);
-        keywords.append(&mut self.get_independent_variable_keywords()?);
-        keywords.append(&mut self.get_var_keywords()?);
-        keywords.append(&mut self.get_constants_keywords()?);
-        keywords.append(&mut self.get_comments_keywords()?);
-        keywords.append(&mut self.get_devices_keywords()?);
-        keywords.append(&mut self.get_data_defines_keywords()?);
-        keywords.append(&mut self.get_data_keywords()?);
+        #[test]
+        fn undeclared_data_array() {
+            let error = WriteError::UndeclaredDataArray(1);
+            assert_eq!(
+                format!("{}", error),
+                "Data array 1 does not match its declaration"
+            );
+        }
 
-        Ok(keywords)
-    }
+        #[test]
+        fn missing_data_array() {
+            let error = WriteError::MissingDataArray(1);
+            assert_eq!(
+                format!("{}", error),
+                "Data array 1 was declared but not written"
+            );
+        }
 
-    #[cfg(test)]
-    fn blank() -> Record {
-        Record {
-            header: Header::blank(),
-            data: vec![],
+        #[test]
+        fn unsupported_compression() {
+            let error = WriteError::UnsupportedCompression(Compression::Gzip);
+            assert_eq!(
+                format!("{}", error),
+                "Writing gzip compressed records needs the `gzip` feature"
+            );
         }
     }
 }
 
-#[cfg(test)]
-mod test_record {
-    use super::*;
-    use tempfile::tempdir;
+/// Capacity of the buffer [`Record::to_writer`] formats into
+const WRITE_BUFFER_CAPACITY: usize = 1 << 16;
 
-    #[test]
-    fn write_gives_error_on_bad_file() {
-        let record = Record::default();
-        let mut file = std::fs::File::create(tempdir().unwrap().path().join("temp.cti")).unwrap();
-        match record.to_writer(&mut file) {
-            Err(Error::WriteError(WriteError::NoName)) => (),
-            e => panic!("{:?}", e),
+/// Data pairs formatted at once by a worker of [`WriteOptions::threads`]
+const WRITE_CHUNK_SAMPLES: usize = 1 << 15;
+
+/// Chunks formatted but not yet written by [`WriteOptions::threads`], however
+/// many workers there are
+const WRITE_BUFFERS_IN_FLIGHT: usize = 16;
+
+/// Size of the reads [`Record::from_async_reader`] asks for
+#[cfg(feature = "async")]
+const READ_CHUNK_CAPACITY: usize = 1 << 16;
+
+/// Bytes [`Record::from_async_reader`] needs for [`Compression::from_magic`]
+#[cfg(feature = "async")]
+const MAGIC_LENGTH: usize = 4;
+
+/// Append a `real,imag` line
+fn push_data_pair(real: f64, imag: f64, format: FloatFormat, line: &mut Vec<u8>) {
+    match format {
+        FloatFormat::RoundTrip => {
+            formatter::push_round_trip(real, line);
+            line.push(b',');
+            formatter::push_round_trip(imag, line);
+        }
+        FloatFormat::SignificantDigits(digits) => {
+            formatter::push_significant(real, digits, line);
+            line.push(b',');
+            formatter::push_significant(imag, digits, line);
         }
     }
+    line.push(b'\n');
+}
 
-    mod test_write {
-        use super::*;
+/// Append a `SEG first last number` line
+///
+/// The bounds are always written in E notation, since the lexer does not
+/// take a single digit such as `1` for a number.
+fn push_seg_item(first: f64, last: f64, number: usize, line: &mut Vec<u8>) {
+    line.extend_from_slice(b"SEG ");
+    formatter::push_round_trip(first, line);
+    line.push(b' ');
+    formatter::push_round_trip(last, line);
+    writeln!(line, " {}", number).unwrap();
+}
 
-        #[test]
-        fn get_keywords() {
-            let mut record = Record::default();
-            record.header.constants.push(Constant {
-                name: String::from("Const Name"),
-                value: String::from("Value"),
-            });
-            record.header.independent_variable = Var {
-                name: String::from("Var Name"),
-                format: String::from("Format"),
-                data: vec![1.],
-            };
-            record.header.devices.push(Device {
-                name: String::from("Name A"),
-                entries: vec![String::from("entry 1"), String::from("entry 2")],
-            });
-            record.header.comments.push(String::from("A Comment"));
-            record.header.name = String::from("Name");
-            record.header.version = String::from("A.01.00");
-            record.data.push(DataArray {
-                name: String::from("Data Name A"),
-                format: String::from("Format A"),
-                samples: vec![Complex { re: 1., im: 2. }],
-            });
-            record.data.push(DataArray {
-                name: String::from("Data Name B"),
-                format: String::from("Format B"),
-                samples: vec![Complex { re: 3., im: 5. }, Complex { re: 4., im: 6. }],
-            });
+/// Append the line of any keyword
+fn push_keyword(keyword: KeywordRef, format: FloatFormat, line: &mut Vec<u8>) {
+    match keyword {
+        KeywordRef::DataPair { real, imag } => push_data_pair(real, imag, format, line),
+        KeywordRef::SegItem {
+            first,
+            last,
+            number,
+        } => push_seg_item(first, last, number, line),
+        keyword => writeln!(line, "{}", keyword).unwrap(),
+    }
+}
 
-            match record.get_keywords() {
-                Ok(v) => assert_eq!(
-                    v,
-                    vec![
-                        Keyword::CitiFile {
-                            version: String::from("A.01.00")
-                        },
-                        Keyword::Name(String::from("Name")),
-                        Keyword::Var {
-                            name: String::from("Var Name"),
-                            format: String::from("Format"),
-                            length: 1
-                        },
-                        Keyword::VarListBegin,
-                        Keyword::VarListItem(1.),
-                        Keyword::VarListEnd,
-                        Keyword::Constant {
-                            name: String::from("Const Name"),
-                            value: String::from("Value")
-                        },
-                        Keyword::Comment(String::from("A Comment")),
-                        Keyword::Device {
-                            name: String::from("Name A"),
-                            value: String::from("entry 1")
-                        },
-                        Keyword::Device {
-                            name: String::from("Name A"),
-                            value: String::from("entry 2")
-                        },
-                        Keyword::Data {
-                            name: String::from("Data Name A"),
-                            format: String::from("Format A")
-                        },
-                        Keyword::Data {
-                            name: String::from("Data Name B"),
-                            format: String::from("Format B")
-                        },
-                        Keyword::Begin,
-                        Keyword::DataPair { real: 1., imag: 2. },
-                        Keyword::End,
-                        Keyword::Begin,
-                        Keyword::DataPair { real: 3., imag: 5. },
-                        Keyword::DataPair { real: 4., imag: 6. },
-                        Keyword::End,
-                    ]
-                ),
-                e => panic!("{:?}", e),
-            }
-        }
+/// `BEGIN`, the data pairs and `END` of one array
+fn array_keywords(array: &DataArray) -> impl Iterator<Item = KeywordRef<'_>> {
+    std::iter::once(KeywordRef::Begin)
+        .chain(
+            array
+                .samples
+                .iter()
+                .map(|&Complex { re: real, im: imag }| KeywordRef::DataPair { real, imag }),
+        )
+        .chain(std::iter::once(KeywordRef::End))
+}
 
-        mod test_get_var_keywords {
-            use super::*;
+/// Run of data pairs of one data array, with the `BEGIN` of the array when
+/// the run starts it and the `END` when the run finishes it
+struct DataChunk<'a> {
+    samples: &'a [Complex<f64>],
+    begin: bool,
+    end: bool,
+}
 
-            #[test]
-            fn empty() {
-                let record = Record::default();
-                match record.get_var_keywords() {
-                    Ok(v) => assert_eq!(v, vec![]),
-                    e => panic!("{:?}", e),
-                }
-            }
+impl DataChunk<'_> {
+    /// Append the same lines as [`array_keywords`] does for the run
+    fn push(&self, format: FloatFormat, line: &mut Vec<u8>) {
+        if self.begin {
+            push_keyword(KeywordRef::Begin, format, line);
+        }
+        for &Complex { re: real, im: imag } in self.samples.iter() {
+            push_data_pair(real, imag, format, line);
+        }
+        if self.end {
+            push_keyword(KeywordRef::End, format, line);
+        }
+    }
+}
 
-            #[test]
-            fn one() {
-                let mut record = Record::default();
-                record.header.independent_variable.data.push(1.);
-                match record.get_var_keywords() {
-                    Ok(v) => assert_eq!(
-                        v,
-                        vec![
-                            Keyword::VarListBegin,
-                            Keyword::VarListItem(1.),
-                            Keyword::VarListEnd
-                        ]
-                    ),
-                    e => panic!("{:?}", e),
+/// Every data array cut into chunks of at most [`WRITE_CHUNK_SAMPLES`]
+fn data_chunks(data: &[DataArray]) -> Vec<DataChunk<'_>> {
+    let mut chunks = vec![];
+    for array in data.iter() {
+        let mut runs: Vec<&[Complex<f64>]> = array.samples.chunks(WRITE_CHUNK_SAMPLES).collect();
+        // An empty array still has its `BEGIN` and `END`
+        if runs.is_empty() {
+            runs.push(&[]);
+        }
+        let last = runs.len() - 1;
+        chunks.extend(runs.into_iter().enumerate().map(|(i, samples)| DataChunk {
+            samples,
+            begin: i == 0,
+            end: i == last,
+        }));
+    }
+    chunks
+}
+
+/// Format `chunks` on a pool of scoped threads and write them in order
+///
+/// The calling thread hands out the chunks and writes each buffer once the
+/// ones before it are written, while the workers format the next chunks. A
+/// written buffer is handed out again, so at most [`WRITE_BUFFERS_IN_FLIGHT`]
+/// are held in memory.
+fn write_data_chunks<W: std::io::Write + ?Sized>(
+    chunks: &[DataChunk],
+    format: FloatFormat,
+    threads: usize,
+    writer: &mut W,
+) -> std::io::Result<()> {
+    use std::collections::BTreeMap;
+    use std::sync::mpsc;
+
+    let (job_sender, jobs) = mpsc::channel::<(usize, Vec<u8>)>();
+    let (result_sender, results) = mpsc::channel::<(usize, Vec<u8>)>();
+    let jobs = &std::sync::Mutex::new(jobs);
+    // The senders are moved in, so that returning early stops the workers
+    std::thread::scope(move |scope| {
+        for _ in 0..threads.min(WRITE_BUFFERS_IN_FLIGHT).min(chunks.len()) {
+            let result_sender = result_sender.clone();
+            scope.spawn(move || loop {
+                let job = jobs.lock().unwrap_or_else(|e| e.into_inner()).recv();
+                match job {
+                    Ok((i, mut buffer)) => {
+                        buffer.clear();
+                        chunks[i].push(format, &mut buffer);
+                        if result_sender.send((i, buffer)).is_err() {
+                            return;
+                        }
+                    }
+                    Err(_) => return,
                 }
-            }
+            });
+        }
+        drop(result_sender);
 
-            #[test]
-            fn multiple() {
-                let mut record = Record::default();
-                record.header.independent_variable.data.push(1.);
-                record.header.independent_variable.data.push(2.);
-                record.header.independent_variable.data.push(3.);
-                match record.get_var_keywords() {
-                    Ok(v) => assert_eq!(
-                        v,
-                        vec![
-                            Keyword::VarListBegin,
-                            Keyword::VarListItem(1.),
-                            Keyword::VarListItem(2.),
-                            Keyword::VarListItem(3.),
-                            Keyword::VarListEnd
-                        ]
-                    ),
-                    e => panic!("{:?}", e),
+        let mut unsent = 0..chunks.len();
+        for i in unsent.by_ref().take(WRITE_BUFFERS_IN_FLIGHT) {
+            job_sender.send((i, vec![])).ok();
+        }
+        let mut formatted = BTreeMap::new();
+        for next in 0..chunks.len() {
+            let buffer = loop {
+                if let Some(buffer) = formatted.remove(&next) {
+                    break buffer;
                 }
+                match results.recv() {
+                    Ok((i, buffer)) => formatted.insert(i, buffer),
+                    // Every worker is gone, which only a panic does and the
+                    // scope passes on
+                    Err(_) => return Ok(()),
+                };
+            };
+            writer.write_all(&buffer)?;
+            if let Some(i) = unsent.next() {
+                job_sender.send((i, buffer)).ok();
             }
         }
+        Ok(())
+    })
+}
 
-        mod test_get_constants_keywords {
-            use super::*;
+/// Check everything a header can be rejected for when it is written, in the
+/// same order the keywords are written
+fn validate_header_for_write<'a, D>(header: &Header, data_arrays: D) -> WriteResult<()>
+where
+    D: IntoIterator<Item = (&'a str, &'a str)>,
+{
+    if header.version.is_empty() {
+        return Err(WriteError::NoVersion);
+    }
+    if header.name.is_empty() {
+        return Err(WriteError::NoName);
+    }
+    for (i, (name, format)) in data_arrays.into_iter().enumerate() {
+        match (name.is_empty(), format.is_empty()) {
+            (true, _) => return Err(WriteError::NoDataName(i)),
+            (_, true) => return Err(WriteError::NoDataFormat(i)),
+            (_, _) => (),
+        }
+    }
+    Ok(())
+}
 
-            #[test]
-            fn empty() {
-                let record = Record::default();
-                match record.get_constants_keywords() {
-                    Ok(v) => assert_eq!(v, vec![]),
-                    e => panic!("{:?}", e),
-                }
-            }
+/// The header keywords in output order, declaring `data_arrays` last
+///
+/// The independent variable is a `SEG_LIST` when it keeps the segments it was
+/// read from or, with `segments`, when it is one [`Var::sweep`]. Otherwise it
+/// is a `VAR_LIST`.
+fn header_keywords<'a, D>(
+    header: &'a Header,
+    data_arrays: D,
+    segments: bool,
+) -> impl Iterator<Item = KeywordRef<'a>>
+where
+    D: IntoIterator<Item = (&'a str, &'a str)>,
+{
+    use std::iter::once;
+
+    let independent_variable = &header.independent_variable;
+    let written_segments = independent_variable.written_segments(segments);
+
+    // Do not set if length == 0
+    let values = match written_segments {
+        None if !independent_variable.is_empty() => Some(&independent_variable.data),
+        _ => None,
+    };
+    let seg_list = written_segments.into_iter().flat_map(|segments| {
+        once(KeywordRef::SegListBegin)
+            .chain(segments.into_iter().map(
+                |Segment {
+                     first,
+                     last,
+                     number,
+                 }| KeywordRef::SegItem {
+                    first,
+                    last,
+                    number,
+                },
+            ))
+            .chain(once(KeywordRef::SegListEnd))
+    });
+    let var_list = values.into_iter().flat_map(|values| {
+        once(KeywordRef::VarListBegin)
+            .chain(values.iter().map(|&v| KeywordRef::VarListItem(v)))
+            .chain(once(KeywordRef::VarListEnd))
+    });
+
+    once(KeywordRef::CitiFile {
+        version: &header.version,
+    })
+    .chain(once(KeywordRef::Name(&header.name)))
+    .chain(once(KeywordRef::Var {
+        name: &independent_variable.name,
+        format: &independent_variable.format,
+        length: independent_variable.len(),
+    }))
+    .chain(seg_list)
+    .chain(var_list)
+    .chain(
+        header
+            .constants
+            .iter()
+            .map(|constant| KeywordRef::Constant {
+                name: &constant.name,
+                value: &constant.value,
+            }),
+    )
+    .chain(
+        header
+            .comments
+            .iter()
+            .map(|comment| KeywordRef::Comment(comment)),
+    )
+    .chain(header.devices.iter().flat_map(|device| {
+        device.entries.iter().map(move |entry| KeywordRef::Device {
+            name: &device.name,
+            value: entry,
+        })
+    }))
+    .chain(
+        data_arrays
+            .into_iter()
+            .map(|(name, format)| KeywordRef::Data { name, format }),
+    )
+}
 
-            #[test]
-            fn one() {
-                let mut record = Record::default();
-                record.header.constants.push(Constant {
-                    name: String::from("Name"),
-                    value: String::from("Value"),
-                });
-                match record.get_constants_keywords() {
-                    Ok(v) => assert_eq!(
-                        v,
-                        vec![Keyword::Constant {
-                            name: String::from("Name"),
-                            value: String::from("Value")
-                        }]
-                    ),
-                    e => panic!("{:?}", e),
-                }
-            }
+/// Visit the keywords of [`header_keywords`], stopping at the first error
+fn for_each_header_keyword<'a, D, E, F>(
+    header: &'a Header,
+    data_arrays: D,
+    segments: bool,
+    f: F,
+) -> std::result::Result<(), E>
+where
+    D: IntoIterator<Item = (&'a str, &'a str)>,
+    F: FnMut(KeywordRef<'a>) -> std::result::Result<(), E>,
+{
+    header_keywords(header, data_arrays, segments).try_for_each(f)
+}
 
-            #[test]
-            fn two() {
-                let mut record = Record::default();
-                record.header.constants.push(Constant {
-                    name: String::from("Name A"),
-                    value: String::from("Value A"),
-                });
-                record.header.constants.push(Constant {
-                    name: String::from("Name B"),
-                    value: String::from("Value B"),
-                });
-                match record.get_constants_keywords() {
-                    Ok(v) => assert_eq!(
-                        v,
-                        vec![
-                            Keyword::Constant {
-                                name: String::from("Name A"),
-                                value: String::from("Value A")
-                            },
-                            Keyword::Constant {
-                                name: String::from("Name B"),
-                                value: String::from("Value B")
-                            }
-                        ]
-                    ),
-                    e => panic!("{:?}", e),
-                }
-            }
+impl Record {
+    pub fn new(version: &str, name: &str) -> Record {
+        Record {
+            header: Header::new(version, name),
+            data: vec![],
         }
+    }
 
-        mod test_get_independent_variable_keywords {
-            use super::*;
+    /// First data array called `name`
+    pub fn get_data_array_by_name(&self, name: &str) -> Option<&DataArray> {
+        self.data.iter().find(|&x| x.name == name)
+    }
 
-            #[test]
-            fn no_format() {
-                let mut record = Record::default();
-                record.header.independent_variable.name = String::from("Name");
-                match record.get_independent_variable_keywords() {
-                    Ok(v) => assert_eq!(
-                        v,
-                        vec![Keyword::Var {
-                            name: String::from("Name"),
-                            format: String::new(),
-                            length: 0
-                        }]
-                    ),
-                    e => panic!("{:?}", e),
-                }
-            }
+    /// Index of the first data array called `name`
+    ///
+    /// This scans the names; [`Record::name_index`] answers many lookups
+    /// without scanning.
+    pub fn index_data_array(&self, name: &str) -> Option<usize> {
+        self.data.iter().position(|x| x.name == name)
+    }
 
-            #[test]
-            fn format() {
-                let mut record = Record::default();
-                record.header.independent_variable.name = String::from("Name");
-                record.header.independent_variable.format = String::from("Format");
-                match record.get_independent_variable_keywords() {
-                    Ok(v) => assert_eq!(
-                        v,
-                        vec![Keyword::Var {
-                            name: String::from("Name"),
-                            format: String::from("Format"),
-                            length: 0
-                        }]
-                    ),
-                    e => panic!("{:?}", e),
-                }
-            }
-
-            #[test]
-            fn length() {
-                let mut record = Record::default();
-                record.header.independent_variable.name = String::from("Name");
-                record.header.independent_variable.format = String::from("Format");
-                record.header.independent_variable.data = vec![0.; 10];
-                match record.get_independent_variable_keywords() {
-                    Ok(v) => assert_eq!(
-                        v,
-                        vec![Keyword::Var {
-                            name: String::from("Name"),
-                            format: String::from("Format"),
-                            length: 10
-                        }]
-                    ),
-                    e => panic!("{:?}", e),
-                }
-            }
-        }
+    /// Hash index of the devices, constants and data arrays by name
+    ///
+    /// Building it is a single pass over the record, after which every
+    /// lookup is a hash rather than a scan. The index borrows the record, so
+    /// it cannot go stale.
+    ///
+    /// Example usage:
+    /// ```no_run
+    /// use citi::Record;
+    ///
+    /// let record = Record::from_path_mmap("file.cti").unwrap();
+    /// let index = record.name_index();
+    /// let s21 = index.data_array("S[2,1]").unwrap();
+    /// ```
+    pub fn name_index(&self) -> NameIndex<'_> {
+        NameIndex::new(self)
+    }
 
-        mod test_get_devices_keywords {
-            use super::*;
+    /// Convert the samples of every data array to `format`
+    ///
+    /// Each array is converted as with [`DataArray::convert_to`], which also
+    /// changes the formats declared in the header. Every current format is
+    /// checked first, so either all arrays are converted or none is.
+    ///
+    /// The arrays are spread over up to `threads` workers, which take the
+    /// next array as soon as they are done with the last. Pass `0` to use
+    /// one thread per available core, or `1` to convert on this thread.
+    ///
+    /// Example usage:
+    /// ```no_run
+    /// use citi::{DataFormat, Record};
+    ///
+    /// let mut record = Record::from_path_mmap("file.cti").unwrap();
+    /// record.convert_data_to(DataFormat::DecibelAngle, 0).unwrap();
+    /// ```
+    pub fn convert_data_to(&mut self, format: DataFormat, threads: usize) -> Result<()> {
+        let formats = self
+            .data
+            .iter()
+            .map(|data_array| data_array.format.parse::<DataFormat>())
+            .collect::<std::result::Result<Vec<_>, _>>()?;
 
-            #[test]
-            fn empty() {
-                let record = Record::default();
-                match record.get_devices_keywords() {
-                    Ok(v) => assert_eq!(v, vec![]),
-                    e => panic!("{:?}", e),
-                }
+        let threads = worker_count(threads, self.data.len());
+        if threads <= 1 {
+            for (data_array, from) in self.data.iter_mut().zip(formats) {
+                data_array.convert_from(from, format);
             }
+            return Ok(());
+        }
 
-            #[test]
-            fn one_device_no_entry() {
-                let mut record = Record::default();
-                record.header.devices.push(Device {
-                    name: String::from(""),
-                    entries: vec![],
+        let queue = std::sync::Mutex::new(self.data.iter_mut().zip(formats));
+        std::thread::scope(|scope| {
+            for _ in 0..threads {
+                scope.spawn(|| loop {
+                    let job = queue.lock().unwrap_or_else(|e| e.into_inner()).next();
+                    match job {
+                        Some((data_array, from)) => data_array.convert_from(from, format),
+                        None => return,
+                    }
                 });
-                match record.get_devices_keywords() {
-                    Ok(v) => assert_eq!(v, vec![]),
-                    e => panic!("{:?}", e),
-                }
             }
+        });
+        Ok(())
+    }
 
-            #[test]
-            fn one_device() {
-                let mut record = Record::default();
-                record.header.devices.push(Device {
-                    name: String::from("Name"),
-                    entries: vec![String::from("entry")],
-                });
-                match record.get_devices_keywords() {
-                    Ok(v) => assert_eq!(
-                        v,
-                        vec![Keyword::Device {
-                            name: String::from("Name"),
-                            value: String::from("entry")
-                        }]
-                    ),
-                    e => panic!("{:?}", e),
-                }
-            }
+    /// Read record
+    ///
+    /// Example usage:
+    /// ```no_run
+    /// use citi::Record;
+    /// use std::fs::File;
+    ///
+    /// let mut file = File::open("file.cti").unwrap();
+    /// let record = Record::from_reader(&mut file);
+    /// ```
+    pub fn from_reader<R: std::io::Read>(reader: &mut R) -> Result<Record> {
+        Record::from_reader_with_options(reader, &ReadOptions::default())
+    }
 
-            #[test]
-            fn one_device_multiple_entries() {
-                let mut record = Record::default();
-                record.header.devices.push(Device {
-                    name: String::from("Name"),
-                    entries: vec![String::from("entry 1"), String::from("entry 2")],
-                });
-                match record.get_devices_keywords() {
-                    Ok(v) => assert_eq!(
-                        v,
-                        vec![
-                            Keyword::Device {
-                                name: String::from("Name"),
-                                value: String::from("entry 1")
-                            },
-                            Keyword::Device {
-                                name: String::from("Name"),
-                                value: String::from("entry 2")
-                            }
-                        ]
-                    ),
-                    e => panic!("{:?}", e),
-                }
-            }
+    /// Read only part of a record
+    ///
+    /// Example usage:
+    /// ```no_run
+    /// use citi::{ReadOptions, Record};
+    /// use std::fs::File;
+    ///
+    /// let options = ReadOptions {
+    ///     data_arrays: Some(vec![String::from("S[2,1]")]),
+    ///     ..ReadOptions::default()
+    /// };
+    /// let mut file = File::open("file.cti").unwrap();
+    /// let record = Record::from_reader_with_options(&mut file, &options);
+    /// ```
+    pub fn from_reader_with_options<R: std::io::Read>(
+        reader: &mut R,
+        options: &ReadOptions,
+    ) -> Result<Record> {
+        let buf_reader = std::io::BufReader::new(reader);
+        Record::from_decompressed_buf_reader(RecordReaderState::new(), buf_reader, options, None)
+    }
 
-            #[test]
-            fn multiple_devices() {
-                let mut record = Record::default();
-                record.header.devices.push(Device {
-                    name: String::from("Name A"),
-                    entries: vec![String::from("entry 1")],
-                });
-                record.header.devices.push(Device {
-                    name: String::from("Name B"),
-                    entries: vec![String::from("entry 2")],
-                });
-                match record.get_devices_keywords() {
-                    Ok(v) => assert_eq!(
-                        v,
-                        vec![
-                            Keyword::Device {
-                                name: String::from("Name A"),
-                                value: String::from("entry 1")
-                            },
-                            Keyword::Device {
-                                name: String::from("Name B"),
-                                value: String::from("entry 2")
-                            }
-                        ]
-                    ),
-                    e => panic!("{:?}", e),
-                }
-            }
+    /// Read record into this one, reusing its buffers
+    ///
+    /// The result is the same as [`Record::from_reader`], but the strings,
+    /// vectors and sample arrays already held by `self` are cleared and
+    /// filled again instead of being freed and allocated anew. Reading files
+    /// of the same shape over and over therefore allocates next to nothing
+    /// once the buffers have grown to fit.
+    ///
+    /// If the read fails, `self` is left blank and its buffers are freed.
+    ///
+    /// Example usage:
+    /// ```no_run
+    /// use citi::Record;
+    /// use std::fs::File;
+    ///
+    /// let mut record = Record::default();
+    /// for _ in 0..1000 {
+    ///     let mut file = File::open("file.cti").unwrap();
+    ///     record.read_into(&mut file).unwrap();
+    /// }
+    /// ```
+    pub fn read_into<R: std::io::Read>(&mut self, reader: &mut R) -> Result<()> {
+        let state = RecordReaderState::recycling(std::mem::replace(self, Record::blank()));
+        let buf_reader = std::io::BufReader::new(reader);
+        *self =
+            Record::from_decompressed_buf_reader(state, buf_reader, &ReadOptions::default(), None)?;
+        Ok(())
+    }
+
+    /// Read record while counting and timing what the reader does
+    ///
+    /// This is [`Record::from_reader_with_options`] that also adds to
+    /// `stats`, including for a read that fails. Reading the clock around
+    /// every line makes this a little slower; the other readers collect
+    /// nothing.
+    ///
+    /// Example usage:
+    /// ```no_run
+    /// use citi::{ReadOptions, ReadStats, Record};
+    /// use std::fs::File;
+    ///
+    /// let mut stats = ReadStats::default();
+    /// let mut file = File::open("file.cti").unwrap();
+    /// let record = Record::from_reader_with_stats(&mut file, &ReadOptions::default(), &mut stats);
+    /// println!("{} samples in {} ns", stats.samples, stats.total_nanoseconds);
+    /// ```
+    pub fn from_reader_with_stats<R: std::io::Read>(
+        reader: &mut R,
+        options: &ReadOptions,
+        stats: &mut ReadStats,
+    ) -> Result<Record> {
+        let start = Instant::now();
+        let mut timed_reader = TimedReader {
+            inner: reader,
+            bytes: 0,
+            nanoseconds: 0,
+        };
+        let buf_reader = std::io::BufReader::new(&mut timed_reader);
+        let result = Record::from_decompressed_buf_reader(
+            RecordReaderState::new(),
+            buf_reader,
+            options,
+            Some(stats),
+        );
+
+        stats.bytes += timed_reader.bytes;
+        stats.read_nanoseconds += timed_reader.nanoseconds;
+        stats.total_nanoseconds += nanoseconds(start.elapsed());
+        result
+    }
+
+    /// Read record from a memory mapped file
+    ///
+    /// Regular files are mapped and parsed directly from the mapped bytes,
+    /// skipping the copies into the [`std::io::BufReader`] used by
+    /// [`Record::from_reader`]. Anything that cannot be mapped, such as a
+    /// pipe or an empty file, falls back to a buffered read.
+    ///
+    /// The file must not be modified by another process while it is read.
+    ///
+    /// Example usage:
+    /// ```no_run
+    /// use citi::Record;
+    ///
+    /// let record = Record::from_path_mmap("file.cti");
+    /// ```
+    pub fn from_path_mmap<P: AsRef<Path>>(path: P) -> Result<Record> {
+        let mut file = File::open(path).map_err(ReadError::ReadingError)?;
+        Record::from_file_mmap(&mut file)
+    }
+
+    /// Read record from an open file by memory mapping it
+    ///
+    /// See [`Record::from_path_mmap`].
+    pub fn from_file_mmap(file: &mut File) -> Result<Record> {
+        match map_file(file) {
+            Some(map) => Record::from_decompressed_buf_reader(
+                RecordReaderState::new(),
+                &map[..],
+                &ReadOptions::default(),
+                None,
+            ),
+            None => Record::from_reader(file),
         }
+    }
 
-        mod test_get_comments_keywords {
-            use super::*;
+    /// Read record, parsing the data arrays on several threads
+    ///
+    /// The header is read on the calling thread while the `BEGIN`…`END`
+    /// blocks are only located by scanning for their `END` line. The data
+    /// pairs of each block are then parsed on up to `threads` threads
+    /// directly into their [`DataArray`]. Pass `0` to use one thread per
+    /// available core.
+    ///
+    /// The result, including any error, is the same as
+    /// [`Record::from_reader`]: when several lines are invalid, the one
+    /// closest to the start of the record is reported.
+    ///
+    /// Example usage:
+    /// ```no_run
+    /// use citi::Record;
+    ///
+    /// let record = Record::from_path_parallel("file.cti", 0);
+    /// ```
+    pub fn from_path_parallel<P: AsRef<Path>>(path: P, threads: usize) -> Result<Record> {
+        let mut file = File::open(path).map_err(ReadError::ReadingError)?;
+        Record::from_file_parallel(&mut file, threads)
+    }
 
-            #[test]
-            fn empty() {
-                let record = Record::default();
-                match record.get_comments_keywords() {
-                    Ok(v) => assert_eq!(v, vec![]),
-                    e => panic!("{:?}", e),
+    /// Read record from an open file, parsing the data arrays on several threads
+    ///
+    /// The file is memory mapped when possible and read into memory otherwise.
+    /// See [`Record::from_path_parallel`].
+    pub fn from_file_parallel(file: &mut File, threads: usize) -> Result<Record> {
+        if let Some(map) = map_file(file) {
+            return Record::from_slice_parallel(&map, threads);
+        }
+
+        let mut bytes = vec![];
+        file.read_to_end(&mut bytes)
+            .map_err(ReadError::ReadingError)?;
+        Record::from_slice_parallel(&bytes, threads)
+    }
+
+    /// Read record from memory, parsing the data arrays on several threads
+    ///
+    /// See [`Record::from_path_parallel`].
+    pub fn from_slice_parallel(bytes: &[u8], threads: usize) -> Result<Record> {
+        if let compression @ (Compression::Gzip | Compression::Zstd) =
+            Compression::from_magic(bytes)
+        {
+            let mut decompressed = vec![];
+            compression::decoder(compression, bytes)?
+                .read_to_end(&mut decompressed)
+                .map_err(ReadError::ReadingError)?;
+            return Record::from_slice_parallel(&decompressed, threads);
+        }
+
+        let SplitRecord {
+            mut state,
+            blocks,
+            header_error,
+            ..
+        } = split_blocks(bytes, true)?;
+
+        let data = state.record.data.iter_mut().map(Some);
+        let jobs = blocks
+            .iter()
+            .zip(data.chain(std::iter::repeat_with(|| None)))
+            .collect();
+
+        // Every block starts before the header error, so any block error comes first
+        if let Some(e) = parse_data_blocks(jobs, threads) {
+            return Err(e.into());
+        }
+        if let Some(e) = header_error {
+            return Err(e.into());
+        }
+
+        Ok(state.validate_record()?.record)
+    }
+
+    /// [`Record::from_buf_reader`] on the decompressed bytes of `reader`
+    ///
+    /// Plain records skip the boxed decoder and are parsed straight from
+    /// `reader`.
+    fn from_decompressed_buf_reader<R: BufRead>(
+        state: RecordReaderState,
+        mut reader: R,
+        options: &ReadOptions,
+        stats: Option<&mut ReadStats>,
+    ) -> Result<Record> {
+        let magic = reader.fill_buf().map_err(ReadError::ReadingError)?;
+        match Compression::from_magic(magic) {
+            Compression::None => Record::from_buf_reader(state, &mut reader, options, stats),
+            compression => Record::from_buf_reader(
+                state,
+                &mut compression::decoder(compression, reader)?,
+                options,
+                stats,
+            ),
+        }
+    }
+
+    /// Only reads the clock when there are `stats` to add to
+    fn from_buf_reader<R: BufRead>(
+        mut state: RecordReaderState,
+        reader: &mut R,
+        options: &ReadOptions,
+        mut stats: Option<&mut ReadStats>,
+    ) -> Result<Record> {
+        let mut skipping = false;
+
+        for_each_line(reader, |i, this_line| {
+            if let Some(stats) = stats.as_deref_mut() {
+                stats.lines += 1;
+            }
+            if skipping {
+                if this_line == "END" {
+                    skipping = false;
+                    if let Some(stats) = stats.as_deref_mut() {
+                        stats.keywords.end += 1;
+                    }
+                    state.process(KeywordRef::End)?;
                 }
+                return Ok(ControlFlow::Continue(()));
             }
 
-            #[test]
-            fn one() {
-                let mut record = Record::default();
-                record.header.comments.push(String::from("A Comment"));
-                match record.get_comments_keywords() {
-                    Ok(v) => assert_eq!(v, vec![Keyword::Comment(String::from("A Comment"))]),
-                    e => panic!("{:?}", e),
+            // Filter out new lines
+            if !this_line.trim().is_empty() {
+                let start = stats.as_ref().map(|_| Instant::now());
+                let keyword =
+                    KeywordRef::try_from(this_line).map_err(|e| ReadError::LineError(i, e))?;
+                let lexed = match (stats.as_deref_mut(), start) {
+                    (Some(stats), Some(start)) => {
+                        let now = Instant::now();
+                        stats.lex_nanoseconds += nanoseconds(now - start);
+                        stats.keywords.count(&keyword, &mut stats.samples);
+                        Some(now)
+                    }
+                    _ => None,
+                };
+                if matches!(keyword, KeywordRef::Begin) && state.state == RecordReaderStates::Header
+                {
+                    if options.header_only {
+                        return Ok(ControlFlow::Break(()));
+                    }
+                    // A block without a `DATA` is still parsed to report the error
+                    let data_array = state.record.data.get(state.data_array_counter);
+                    if data_array.map_or(false, |data_array| !options.selects(&data_array.name)) {
+                        skipping = true;
+                        state.skip_block();
+                        return Ok(ControlFlow::Continue(()));
+                    }
+                }
+                state.process(keyword)?;
+                if let (Some(stats), Some(lexed)) = (stats.as_deref_mut(), lexed) {
+                    stats.process_nanoseconds += nanoseconds(lexed.elapsed());
                 }
             }
+            Ok(ControlFlow::Continue(()))
+        })?;
 
-            #[test]
-            fn multiple() {
-                let mut record = Record::default();
-                record.header.comments.push(String::from("A Comment"));
-                record.header.comments.push(String::from("B Comment"));
-                match record.get_comments_keywords() {
-                    Ok(v) => assert_eq!(
-                        v,
-                        vec![
-                            Keyword::Comment(String::from("A Comment")),
-                            Keyword::Comment(String::from("B Comment"))
-                        ]
-                    ),
-                    e => panic!("{:?}", e),
-                }
-            }
+        let start = stats.as_ref().map(|_| Instant::now());
+        let result = state.validate_selected(options);
+        if let (Some(stats), Some(start)) = (stats, start) {
+            stats.validate_nanoseconds += nanoseconds(start.elapsed());
         }
+        Ok(result?.record)
+    }
 
-        mod test_get_name_keywords {
-            use super::*;
+    /// Write record
+    ///
+    /// Example usage:
+    /// ```no_run
+    /// use citi::Record;
+    /// use std::fs::File;
+    ///
+    /// let record = Record::default();
+    /// let mut file = File::create("file.cti").unwrap();
+    /// record.to_writer(&mut file);
+    /// ```
+    pub fn to_writer<W: std::io::Write>(&self, writer: &mut W) -> Result<()> {
+        self.to_writer_with_options(writer, &WriteOptions::default())
+    }
 
-            #[test]
-            fn none() {
-                let mut record = Record::default();
-                record.header.name = String::new();
-                match record.get_name_keywords() {
-                    Err(WriteError::NoName) => (),
-                    e => panic!("{:?}", e),
-                }
-            }
+    /// Write record with control over how the data pairs are formatted
+    ///
+    /// Example usage:
+    /// ```no_run
+    /// use citi::{FloatFormat, Record, WriteOptions};
+    /// use std::fs::File;
+    ///
+    /// let record = Record::default();
+    /// let mut file = File::create("file.cti").unwrap();
+    /// let options = WriteOptions {
+    ///     data_format: FloatFormat::SignificantDigits(6),
+    ///     ..WriteOptions::default()
+    /// };
+    /// record.to_writer_with_options(&mut file, &options);
+    /// ```
+    pub fn to_writer_with_options<W: std::io::Write>(
+        &self,
+        writer: &mut W,
+        options: &WriteOptions,
+    ) -> Result<()> {
+        self.write_keywords(writer, options, None)
+    }
 
-            #[test]
-            fn some() {
-                let mut record = Record::default();
-                record.header.name = String::from("A.01.00");
-                match record.get_name_keywords() {
-                    Ok(v) => assert_eq!(v, vec![Keyword::Name(String::from("A.01.00"))]),
-                    e => panic!("{:?}", e),
-                }
-            }
+    /// Write record while counting and timing what the writer does
+    ///
+    /// This is [`Record::to_writer_with_options`] that also adds to `stats`,
+    /// including for a write that fails.
+    ///
+    /// Example usage:
+    /// ```no_run
+    /// use citi::{Record, WriteOptions, WriteStats};
+    /// use std::fs::File;
+    ///
+    /// let record = Record::default();
+    /// let mut stats = WriteStats::default();
+    /// let mut file = File::create("file.cti").unwrap();
+    /// record.to_writer_with_stats(&mut file, &WriteOptions::default(), &mut stats);
+    /// println!("{} bytes in {} ns", stats.bytes, stats.total_nanoseconds);
+    /// ```
+    pub fn to_writer_with_stats<W: std::io::Write>(
+        &self,
+        writer: &mut W,
+        options: &WriteOptions,
+        stats: &mut WriteStats,
+    ) -> Result<()> {
+        let start = Instant::now();
+        let mut timed_writer = TimedWriter {
+            inner: writer,
+            bytes: 0,
+            nanoseconds: 0,
+        };
+        let result = self.write_keywords(&mut timed_writer, options, Some(stats));
+
+        let total = nanoseconds(start.elapsed());
+        stats.bytes += timed_writer.bytes;
+        stats.write_nanoseconds += timed_writer.nanoseconds;
+        stats.format_nanoseconds += total.saturating_sub(timed_writer.nanoseconds);
+        stats.total_nanoseconds += total;
+        result
+    }
+
+    fn write_keywords<W: std::io::Write>(
+        &self,
+        writer: &mut W,
+        options: &WriteOptions,
+        mut stats: Option<&mut WriteStats>,
+    ) -> Result<()> {
+        // Nothing is written unless the whole record can be
+        self.validate_for_write()?;
+
+        compression::encode(options.compression, writer, |writer| {
+            self.write_plain_keywords(writer, options, stats.as_deref_mut())
+        })
+    }
+
+    fn write_plain_keywords<W: std::io::Write + ?Sized>(
+        &self,
+        writer: &mut W,
+        options: &WriteOptions,
+        mut stats: Option<&mut WriteStats>,
+    ) -> Result<()> {
+        let chunks = match options.threads {
+            1 => vec![],
+            _ => data_chunks(&self.data),
+        };
+        let threads = worker_count(options.threads, chunks.len());
+
+        let mut buffer = std::io::BufWriter::with_capacity(WRITE_BUFFER_CAPACITY, writer);
+        let mut line: Vec<u8> = vec![];
+        let write_keyword = |keyword: KeywordRef| {
+            if let Some(stats) = stats.as_deref_mut() {
+                stats.lines += 1;
+                stats.keywords.count(&keyword, &mut stats.samples);
+            }
+            line.clear();
+            push_keyword(keyword, options.data_format, &mut line);
+            buffer.write_all(&line)
+        };
+        match threads {
+            0 | 1 => self.for_each_keyword(options.segments, write_keyword),
+            _ => self
+                .for_each_header_keyword(options.segments, write_keyword)
+                .and_then(|_| {
+                    if let Some(stats) = stats {
+                        for array in self.data.iter() {
+                            let samples = array.samples.len() as u64;
+                            stats.lines += samples + 2;
+                            stats.keywords.begin += 1;
+                            stats.keywords.end += 1;
+                            stats.samples += samples;
+                        }
+                    }
+                    write_data_chunks(&chunks, options.data_format, threads, &mut buffer)
+                }),
         }
+        .and_then(|_| buffer.flush())
+        .map_err(WriteError::WrittingError)?;
 
-        mod test_get_version_keywords {
-            use super::*;
+        Ok(())
+    }
 
-            #[test]
-            fn none() {
-                let mut record = Record::default();
-                record.header.version = String::new();
-                match record.get_version_keywords() {
-                    Err(WriteError::NoVersion) => (),
-                    e => panic!("{:?}", e),
+    /// Read record from an asynchronous reader
+    ///
+    /// The bytes are parsed by a [`RecordParser`] as they arrive, so the task
+    /// only waits on the reader and never blocks a thread. The result is the
+    /// same as [`Record::from_reader`] for an uncompressed record.
+    ///
+    /// Compression is not supported: a stream that starts with the magic
+    /// number of a [`Compression`] is rejected with
+    /// [`ReadError::UnsupportedCompression`].
+    ///
+    /// The reader is a [`futures_util::io::AsyncRead`]. A Tokio reader can be
+    /// adapted with `tokio_util::compat`.
+    ///
+    /// Example usage:
+    /// ```
+    /// use citi::Record;
+    ///
+    /// # futures_executor::block_on(async {
+    /// let mut bytes: &[u8] = b"CITIFILE A.01.00\nNAME DATA\nVAR FREQ MAG 1\n\
+    ///     DATA S RI\nVAR_LIST_BEGIN\n10\nVAR_LIST_END\nBEGIN\n1E0,2E0\nEND\n";
+    /// let record = Record::from_async_reader(&mut bytes).await.unwrap();
+    /// assert_eq!(record.data[0].name, "S");
+    /// # });
+    /// ```
+    #[cfg(feature = "async")]
+    pub async fn from_async_reader<R>(reader: &mut R) -> Result<Record>
+    where
+        R: futures_util::io::AsyncRead + Unpin,
+    {
+        use futures_util::io::AsyncReadExt;
+
+        let mut parser = RecordParser::new();
+        let mut chunk = vec![0; READ_CHUNK_CAPACITY];
+        // The first bytes are held back until the magic number is known
+        let mut head = Some(Vec::with_capacity(MAGIC_LENGTH));
+        loop {
+            let n = match reader.read(&mut chunk).await {
+                Ok(n) => n,
+                Err(e) if e.kind() == std::io::ErrorKind::Interrupted => continue,
+                Err(e) => return Err(ReadError::ReadingError(e).into()),
+            };
+            match head.as_mut() {
+                Some(bytes) => {
+                    bytes.extend_from_slice(&chunk[..n]);
+                    if bytes.len() < MAGIC_LENGTH && n != 0 {
+                        continue;
+                    }
+                    match Compression::from_magic(bytes) {
+                        Compression::None => parser.feed(bytes)?,
+                        compression => {
+                            return Err(ReadError::UnsupportedCompression(compression).into())
+                        }
+                    }
+                    head = None;
                 }
+                None => parser.feed(&chunk[..n])?,
             }
-
-            #[test]
-            fn some() {
-                let mut record = Record::default();
-                record.header.version = String::from("A.01.00");
-                match record.get_version_keywords() {
-                    Ok(v) => assert_eq!(
-                        v,
-                        vec![Keyword::CitiFile {
-                            version: String::from("A.01.00")
-                        }]
-                    ),
-                    e => panic!("{:?}", e),
-                }
+            if n == 0 {
+                return parser.finish();
             }
         }
+    }
 
-        mod test_get_data_keywords {
-            use super::*;
+    /// Write record to an asynchronous writer
+    ///
+    /// See [`Record::to_async_writer_with_options`].
+    #[cfg(feature = "async")]
+    pub async fn to_async_writer<W>(&self, writer: &mut W) -> Result<()>
+    where
+        W: futures_util::io::AsyncWrite + Unpin,
+    {
+        self.to_async_writer_with_options(writer, &WriteOptions::default())
+            .await
+    }
 
-            #[test]
-            fn many_values() {
-                let mut record = Record::default();
-                record.data.push(DataArray {
-                    name: String::new(),
-                    format: String::new(),
-                    samples: vec![
-                        Complex { re: 1., im: 4. },
-                        Complex { re: 2., im: 1e-6 },
-                        Complex { re: -3., im: 0. },
-                    ],
-                });
-                match record.get_data_keywords() {
-                    Ok(v) => assert_eq!(
-                        v,
-                        vec![
-                            Keyword::Begin,
-                            Keyword::DataPair { real: 1., imag: 4. },
-                            Keyword::DataPair {
-                                real: 2.,
-                                imag: 1e-6
-                            },
-                            Keyword::DataPair {
-                                real: -3.,
-                                imag: 0.
-                            },
-                            Keyword::End
-                        ]
-                    ),
-                    e => panic!("{:?}", e),
-                }
-            }
+    /// Write record to an asynchronous writer with control over how the data
+    /// pairs are formatted
+    ///
+    /// The bytes are the same as [`Record::to_writer_with_options`] for an
+    /// uncompressed record. They are formatted into a buffer that is handed
+    /// to the writer each time it fills, so the task only waits on the
+    /// writer. The writer is flushed but not closed.
+    ///
+    /// Compression is not supported: anything but [`Compression::None`] is
+    /// rejected with [`WriteError::UnsupportedCompression`] before anything
+    /// is written. [`WriteOptions::threads`] is ignored, since the data pairs
+    /// are always formatted on the calling task.
+    ///
+    /// The writer is a [`futures_util::io::AsyncWrite`]. A Tokio writer can
+    /// be adapted with `tokio_util::compat`.
+    ///
+    /// Example usage:
+    /// ```
+    /// use citi::Record;
+    ///
+    /// # futures_executor::block_on(async {
+    /// let record = Record::new("A.01.00", "DATA");
+    /// let mut bytes: Vec<u8> = vec![];
+    /// record.to_async_writer(&mut bytes).await.unwrap();
+    /// assert!(bytes.starts_with(b"CITIFILE A.01.00\n"));
+    /// # });
+    /// ```
+    #[cfg(feature = "async")]
+    pub async fn to_async_writer_with_options<W>(
+        &self,
+        writer: &mut W,
+        options: &WriteOptions,
+    ) -> Result<()>
+    where
+        W: futures_util::io::AsyncWrite + Unpin,
+    {
+        use futures_util::io::AsyncWriteExt;
+
+        // Nothing is written unless the whole record can be
+        self.validate_for_write()?;
+        if options.compression != Compression::None {
+            return Err(WriteError::UnsupportedCompression(options.compression).into());
+        }
+
+        let keywords = header_keywords(&self.header, self.data_declarations(), options.segments)
+            .chain(self.data.iter().flat_map(array_keywords));
+        let mut buffer: Vec<u8> = Vec::with_capacity(WRITE_BUFFER_CAPACITY);
+        for keyword in keywords {
+            push_keyword(keyword, options.data_format, &mut buffer);
+            if buffer.len() >= WRITE_BUFFER_CAPACITY {
+                writer
+                    .write_all(&buffer)
+                    .await
+                    .map_err(WriteError::WrittingError)?;
+                buffer.clear();
+            }
+        }
+
+        writer
+            .write_all(&buffer)
+            .await
+            .map_err(WriteError::WrittingError)?;
+        writer.flush().await.map_err(WriteError::WrittingError)?;
 
-            #[test]
-            fn one_array_gives_correct_result() {
-                let mut record = Record::default();
-                record.data.push(DataArray {
-                    name: String::new(),
-                    format: String::new(),
-                    samples: vec![Complex { re: 1., im: 2. }],
-                });
-                match record.get_data_keywords() {
-                    Ok(v) => assert_eq!(
-                        v,
-                        vec![
-                            Keyword::Begin,
-                            Keyword::DataPair { real: 1., imag: 2. },
-                            Keyword::End
-                        ]
-                    ),
-                    e => panic!("{:?}", e),
-                }
-            }
+        Ok(())
+    }
 
-            #[test]
-            fn multiple_array_gives_correct_result() {
-                let mut record = Record::default();
-                record.data.push(DataArray {
-                    name: String::new(),
-                    format: String::new(),
-                    samples: vec![Complex { re: 1., im: 2. }],
-                });
-                record.data.push(DataArray {
-                    name: String::new(),
-                    format: String::new(),
-                    samples: vec![Complex { re: 3., im: 4. }],
-                });
-                match record.get_data_keywords() {
-                    Ok(v) => assert_eq!(
-                        v,
-                        vec![
-                            Keyword::Begin,
-                            Keyword::DataPair { real: 1., imag: 2. },
-                            Keyword::End,
-                            Keyword::Begin,
-                            Keyword::DataPair { real: 3., imag: 4. },
-                            Keyword::End
-                        ]
-                    ),
-                    e => panic!("{:?}", e),
-                }
-            }
+    /// Write record in the binary format
+    ///
+    /// The binary format holds exactly the same record, with every float
+    /// stored as its little-endian bits, so reading it back parses nothing
+    /// (see [`Record::from_binary_reader`]). The layout is versioned and ends
+    /// with a checksum. Unlike [`Record::to_writer`], any record can be
+    /// written.
+    ///
+    /// Example usage:
+    /// ```no_run
+    /// use citi::Record;
+    /// use std::fs::File;
+    ///
+    /// let record = Record::from_path_mmap("file.cti").unwrap();
+    /// let mut file = File::create("file.cti.bin").unwrap();
+    /// record.to_binary_writer(&mut file);
+    /// ```
+    pub fn to_binary_writer<W: std::io::Write>(&self, writer: &mut W) -> Result<()> {
+        writer
+            .write_all(&binary::encode(self, None))
+            .map_err(WriteError::WrittingError)?;
+        Ok(())
+    }
 
-            #[test]
-            fn no_arrays_gives_empty() {
-                let record = Record::default();
-                match record.get_data_keywords() {
-                    Ok(v) => assert_eq!(v, vec![]),
-                    e => panic!("{:?}", e),
+    /// Read record written by [`Record::to_binary_writer`]
+    ///
+    /// Example usage:
+    /// ```no_run
+    /// use citi::Record;
+    /// use std::fs::File;
+    ///
+    /// let mut file = File::open("file.cti.bin").unwrap();
+    /// let record = Record::from_binary_reader(&mut file);
+    /// ```
+    pub fn from_binary_reader<R: std::io::Read>(reader: &mut R) -> Result<Record> {
+        let mut bytes = vec![];
+        reader
+            .read_to_end(&mut bytes)
+            .map_err(ReadError::ReadingError)?;
+        Record::from_binary_slice(&bytes)
+    }
+
+    /// Read record written by [`Record::to_binary_writer`] from memory
+    pub fn from_binary_slice(bytes: &[u8]) -> Result<Record> {
+        let decoded = binary::decode(bytes).map_err(ReadError::InvalidBinary)?;
+        Ok(decoded.to_record())
+    }
+
+    /// Read record written by [`Record::to_binary_writer`] by memory mapping it
+    pub fn from_path_binary<P: AsRef<Path>>(path: P) -> Result<Record> {
+        let mut file = File::open(path).map_err(ReadError::ReadingError)?;
+        match map_file(&file) {
+            Some(map) => Record::from_binary_slice(&map),
+            None => Record::from_binary_reader(&mut file),
+        }
+    }
+
+    /// Where [`Record::from_path_cached`] keeps the binary copy of `path`
+    ///
+    /// This is `path` with `.bin` appended, e.g. `file.cti.bin`.
+    pub fn cache_path<P: AsRef<Path>>(path: P) -> PathBuf {
+        let mut cache_path = path.as_ref().as_os_str().to_owned();
+        cache_path.push(".bin");
+        PathBuf::from(cache_path)
+    }
+
+    /// Read record, keeping a binary copy next to the file for the next read
+    ///
+    /// The copy at [`Record::cache_path`] is used when it was made from a file
+    /// with the same size and modification time. Otherwise the file is read
+    /// with [`Record::from_path_mmap`] and the copy is replaced. Like any
+    /// modification time check, a change that keeps the size within the
+    /// resolution of the file system clock is not noticed.
+    ///
+    /// The copy is only an optimization: one that cannot be read is ignored,
+    /// and one that cannot be written is skipped. It is written to a
+    /// temporary file and renamed, so concurrent readers see either the old
+    /// or the new copy.
+    ///
+    /// Example usage:
+    /// ```no_run
+    /// use citi::Record;
+    ///
+    /// let record = Record::from_path_cached("file.cti");
+    /// ```
+    pub fn from_path_cached<P: AsRef<Path>>(path: P) -> Result<Record> {
+        let path = path.as_ref();
+        let mut file = File::open(path).map_err(ReadError::ReadingError)?;
+        let source = BlockIndex::stamp(&file)?;
+        let cache_path = Record::cache_path(path);
+
+        // Without a modification time there is nothing to key the copy on
+        if source.1.is_some() {
+            let cache = File::open(&cache_path).ok();
+            if let Some(map) = cache.as_ref().and_then(map_file) {
+                if let Ok(decoded) = binary::decode(&map) {
+                    if decoded.source == Some(source) {
+                        return Ok(decoded.to_record());
+                    }
                 }
             }
         }
 
-        mod test_get_data_defines_keywords {
-            use super::*;
+        let record = Record::from_file_mmap(&mut file)?;
+        if source.1.is_some() {
+            let _ = write_cache(&record, source, &cache_path);
+        }
+        Ok(record)
+    }
 
-            #[test]
-            fn one_entry() {
-                let mut record = Record::default();
-                record.data.push(DataArray {
-                    name: String::from("Name"),
-                    format: String::from("Format"),
-                    samples: vec![],
-                });
-                match record.get_data_defines_keywords() {
-                    Ok(v) => assert_eq!(
-                        v,
-                        vec![Keyword::Data {
-                            name: String::from("Name"),
-                            format: String::from("Format")
-                        }]
-                    ),
-                    e => panic!("{:?}", e),
-                }
+    /// Check everything [`Record::to_writer`] can reject, in the same order
+    /// the keywords are written
+    fn validate_for_write(&self) -> WriteResult<()> {
+        validate_header_for_write(&self.header, self.data_declarations())
+    }
+
+    /// Name and format of every data array, as declared in the header
+    fn data_declarations(&self) -> impl Iterator<Item = (&str, &str)> + '_ {
+        self.data
+            .iter()
+            .map(|array| (array.name.as_str(), array.format.as_str()))
+    }
+
+    /// Visit every keyword of the record in output order
+    ///
+    /// The keywords borrow from the record, so nothing is cloned or collected.
+    /// The record is assumed to have passed [`Record::validate_for_write`].
+    /// `segments` is [`WriteOptions::segments`].
+    fn for_each_keyword<E, F>(&self, segments: bool, mut f: F) -> std::result::Result<(), E>
+    where
+        F: FnMut(KeywordRef) -> std::result::Result<(), E>,
+    {
+        self.for_each_header_keyword(segments, &mut f)?;
+
+        // Add each array
+        for array in self.data.iter() {
+            for keyword in array_keywords(array) {
+                f(keyword)?;
             }
+        }
 
-            #[test]
-            fn multiple() {
-                let mut record = Record::default();
-                record.data.push(DataArray {
-                    name: String::from("Name A"),
-                    format: String::from("Format A"),
-                    samples: vec![],
-                });
-                record.data.push(DataArray {
-                    name: String::from("Name B"),
-                    format: String::from("Format B"),
-                    samples: vec![],
+        Ok(())
+    }
+
+    /// Visit the keywords of [`Record::for_each_keyword`] up to the first
+    /// `BEGIN`
+    fn for_each_header_keyword<E, F>(&self, segments: bool, f: F) -> std::result::Result<(), E>
+    where
+        F: FnMut(KeywordRef) -> std::result::Result<(), E>,
+    {
+        for_each_header_keyword(&self.header, self.data_declarations(), segments, f)
+    }
+
+    #[cfg(test)]
+    #[allow(clippy::unnecessary_wraps)]
+    fn get_data_keywords(&self) -> WriteResult<Vec<Keyword>> {
+        let mut keywords: Vec<Keyword> = vec![];
+
+        // Add each array
+        for array in self.data.iter() {
+            keywords.push(Keyword::Begin);
+
+            for Complex { re: real, im: imag } in array.samples.iter() {
+                keywords.push(Keyword::DataPair {
+                    real: *real,
+                    imag: *imag,
                 });
-                match record.get_data_defines_keywords() {
-                    Ok(v) => {
-                        assert_eq!(
-                            v,
-                            vec![
-                                Keyword::Data {
-                                    name: String::from("Name A"),
-                                    format: String::from("Format A")
-                                },
-                                Keyword::Data {
-                                    name: String::from("Name B"),
-                                    format: String::from("Format B")
-                                }
-                            ]
-                        );
-                    }
-                    e => panic!("{:?}", e),
-                }
             }
+            keywords.push(Keyword::End);
+        }
 
-            #[test]
-            fn no_name() {
-                let mut record = Record::default();
-                record.data.push(DataArray {
-                    name: String::new(),
-                    format: String::from("Format"),
-                    samples: vec![],
+        Ok(keywords)
+    }
+
+    #[cfg(test)]
+    fn get_data_defines_keywords(&self) -> WriteResult<Vec<Keyword>> {
+        let mut keywords: Vec<Keyword> = vec![];
+
+        for (i, array) in self.data.iter().enumerate() {
+            match (array.name.is_empty(), array.format.is_empty()) {
+                (true, _) => return Err(WriteError::NoDataName(i)),
+                (_, true) => return Err(WriteError::NoDataFormat(i)),
+                (_, _) => keywords.push(Keyword::Data {
+                    name: array.name.clone(),
+                    format: array.format.clone(),
+                }),
+            }
+        }
+        Ok(keywords)
+    }
+
+    #[cfg(test)]
+    fn get_version_keywords(&self) -> WriteResult<Vec<Keyword>> {
+        match !self.header.version.is_empty() {
+            true => Ok(vec![Keyword::CitiFile {
+                version: self.header.version.clone(),
+            }]),
+            false => Err(WriteError::NoVersion),
+        }
+    }
+
+    #[cfg(test)]
+    fn get_name_keywords(&self) -> WriteResult<Vec<Keyword>> {
+        match !self.header.name.is_empty() {
+            true => Ok(vec![Keyword::Name(self.header.name.clone())]),
+            false => Err(WriteError::NoName),
+        }
+    }
+
+    #[cfg(test)]
+    #[allow(clippy::unnecessary_wraps)]
+    fn get_comments_keywords(&self) -> WriteResult<Vec<Keyword>> {
+        Ok(self
+            .header
+            .comments
+            .iter()
+            .map(|s| Keyword::Comment(s.clone()))
+            .collect())
+    }
+
+    #[cfg(test)]
+    #[allow(clippy::unnecessary_wraps)]
+    fn get_devices_keywords(&self) -> WriteResult<Vec<Keyword>> {
+        let mut keywords: Vec<Keyword> = vec![];
+
+        for device in self.header.devices.iter() {
+            for entry in device.entries.iter() {
+                keywords.push(Keyword::Device {
+                    name: device.name.clone(),
+                    value: entry.clone(),
                 });
-                match record.get_data_defines_keywords() {
-                    Err(WriteError::NoDataName(0)) => (),
-                    e => panic!("{:?}", e),
-                }
             }
+        }
+
+        Ok(keywords)
+    }
+
+    #[cfg(test)]
+    #[allow(clippy::unnecessary_wraps)]
+    fn get_independent_variable_keywords(&self) -> WriteResult<Vec<Keyword>> {
+        Ok(vec![Keyword::Var {
+            name: self.header.independent_variable.name.clone(),
+            format: self.header.independent_variable.format.clone(),
+            length: self.header.independent_variable.len(),
+        }])
+    }
+
+    #[cfg(test)]
+    #[allow(clippy::unnecessary_wraps)]
+    fn get_var_keywords(&self) -> WriteResult<Vec<Keyword>> {
+        let mut keywords: Vec<Keyword> = vec![];
+
+        // Do not set if length == 0
+        if !self.header.independent_variable.is_empty() {
+            keywords.push(Keyword::VarListBegin);
+            for v in self.header.independent_variable.iter() {
+                keywords.push(Keyword::VarListItem(v));
+            }
+            keywords.push(Keyword::VarListEnd);
+        }
+
+        Ok(keywords)
+    }
+
+    #[cfg(test)]
+    #[allow(clippy::unnecessary_wraps)]
+    fn get_constants_keywords(&self) -> WriteResult<Vec<Keyword>> {
+        Ok(self
+            .header
+            .constants
+            .iter()
+            .map(|c| Keyword::Constant {
+                name: c.name.clone(),
+                value: c.value.clone(),
+            })
+            .collect())
+    }
+
+    /// Every keyword of the record, collected
+    ///
+    /// This is the reference [`Record::for_each_keyword`] is tested against.
+    #[cfg(test)]
+    fn get_keywords(&self) -> WriteResult<Vec<Keyword>> {
+        let mut keywords: Vec<Keyword> = vec![];
+
+        keywords.append(&mut self.get_version_keywords()?);
+        keywords.append(&mut self.get_name_keywords()?);
+        keywords.append(&mut self.get_independent_variable_keywords()?);
+        keywords.append(&mut self.get_var_keywords()?);
+        keywords.append(&mut self.get_constants_keywords()?);
+        keywords.append(&mut self.get_comments_keywords()?);
+        keywords.append(&mut self.get_devices_keywords()?);
+        keywords.append(&mut self.get_data_defines_keywords()?);
+        keywords.append(&mut self.get_data_keywords()?);
+
+        Ok(keywords)
+    }
+
+    fn blank() -> Record {
+        Record {
+            header: Header::blank(),
+            data: vec![],
+        }
+    }
+}
+
+/// Lookup of a [`Record`] by name, see [`Record::name_index`]
+///
+/// When names repeat, the first one wins as with the linear lookups such
+/// as [`Header::get_device_by_name`].
+#[derive(Debug, Clone)]
+pub struct NameIndex<'a> {
+    record: &'a Record,
+    devices: HashMap<&'a str, usize>,
+    constants: HashMap<&'a str, usize>,
+    data: HashMap<&'a str, usize>,
+}
+
+impl<'a> NameIndex<'a> {
+    fn new(record: &'a Record) -> NameIndex<'a> {
+        fn positions<'a, I: Iterator<Item = &'a str>>(names: I) -> HashMap<&'a str, usize> {
+            let mut map = HashMap::with_capacity(names.size_hint().0);
+            for (i, name) in names.enumerate() {
+                map.entry(name).or_insert(i);
+            }
+            map
+        }
+
+        let header = &record.header;
+        NameIndex {
+            record,
+            devices: positions(header.devices.iter().map(|x| x.name.as_str())),
+            constants: positions(header.constants.iter().map(|x| x.name.as_str())),
+            data: positions(record.data.iter().map(|x| x.name.as_str())),
+        }
+    }
+
+    pub fn index_device(&self, name: &str) -> Option<usize> {
+        self.devices.get(name).copied()
+    }
+
+    pub fn device(&self, name: &str) -> Option<&'a Device> {
+        Some(&self.record.header.devices[self.index_device(name)?])
+    }
+
+    pub fn index_constant(&self, name: &str) -> Option<usize> {
+        self.constants.get(name).copied()
+    }
+
+    pub fn constant(&self, name: &str) -> Option<&'a Constant> {
+        Some(&self.record.header.constants[self.index_constant(name)?])
+    }
+
+    pub fn index_data_array(&self, name: &str) -> Option<usize> {
+        self.data.get(name).copied()
+    }
+
+    pub fn data_array(&self, name: &str) -> Option<&'a DataArray> {
+        Some(&self.record.data[self.index_data_array(name)?])
+    }
+}
+
+#[cfg(test)]
+mod test_name_index {
+    use super::*;
+
+    fn record() -> Record {
+        let mut record = Record::new("A.01.00", "Name");
+        record.header.add_device("NA", "VERSION HP8510B.05.00");
+        record.header.add_device("WVI", "REGISTER 1");
+        record.header.constants.push(Constant::new("A", "B"));
+        for name in ["S[1,1]", "S[2,1]", "S[1,1]"].iter() {
+            record.data.push(DataArray::new(name, "RI"));
+        }
+        record.data[2].format = String::from("MA");
+        record
+    }
+
+    #[test]
+    fn same_as_linear_lookups() {
+        let record = record();
+        let index = record.name_index();
+        for name in ["NA", "WVI", "A", "S[1,1]", "S[2,1]", "missing"].iter() {
+            assert_eq!(index.index_device(name), record.header.index_device(name));
+            assert_eq!(index.device(name), record.header.get_device_by_name(name));
+            assert_eq!(
+                index.constant(name),
+                record.header.get_constant_by_name(name)
+            );
+            assert_eq!(index.index_data_array(name), record.index_data_array(name));
+            assert_eq!(index.data_array(name), record.get_data_array_by_name(name));
+        }
+    }
+
+    #[test]
+    fn first_name_wins() {
+        let record = record();
+        assert_eq!(record.name_index().index_data_array("S[1,1]"), Some(0));
+        assert_eq!(
+            record.name_index().data_array("S[1,1]").unwrap().format,
+            "RI"
+        );
+    }
+
+    #[test]
+    fn empty() {
+        let record = Record::default();
+        let index = record.name_index();
+        assert_eq!(index.device(""), None);
+        assert_eq!(index.constant(""), None);
+        assert_eq!(index.data_array(""), None);
+    }
+}
+
+#[cfg(test)]
+mod test_record {
+    use super::*;
+    use tempfile::tempdir;
+
+    #[test]
+    fn write_gives_error_on_bad_file() {
+        let record = Record::default();
+        let mut file = std::fs::File::create(tempdir().unwrap().path().join("temp.cti")).unwrap();
+        match record.to_writer(&mut file) {
+            Err(Error::WriteError(WriteError::NoName)) => (),
+            e => panic!("{:?}", e),
+        }
+    }
+
+    mod test_write {
+        use super::*;
+
+        fn full_record() -> Record {
+            let mut record = Record::default();
+            record.header.constants.push(Constant {
+                name: String::from("Const Name"),
+                value: String::from("Value"),
+            });
+            record.header.independent_variable = Var::with_data("Var Name", "Format", vec![1.]);
+            record.header.devices.push(Device {
+                name: String::from("Name A"),
+                entries: vec![String::from("entry 1"), String::from("entry 2")],
+            });
+            record.header.comments.push(String::from("A Comment"));
+            record.header.name = String::from("Name");
+            record.header.version = String::from("A.01.00");
+            record.data.push(DataArray {
+                name: String::from("Data Name A"),
+                format: String::from("Format A"),
+                samples: vec![Complex { re: 1., im: 2. }],
+            });
+            record.data.push(DataArray {
+                name: String::from("Data Name B"),
+                format: String::from("Format B"),
+                samples: vec![Complex { re: 3., im: 5. }, Complex { re: 4., im: 6. }],
+            });
+
+            record
+        }
+
+        #[test]
+        fn get_keywords() {
+            let record = full_record();
+
+            match record.get_keywords() {
+                Ok(v) => assert_eq!(
+                    v,
+                    vec![
+                        Keyword::CitiFile {
+                            version: String::from("A.01.00")
+                        },
+                        Keyword::Name(String::from("Name")),
+                        Keyword::Var {
+                            name: String::from("Var Name"),
+                            format: String::from("Format"),
+                            length: 1
+                        },
+                        Keyword::VarListBegin,
+                        Keyword::VarListItem(1.),
+                        Keyword::VarListEnd,
+                        Keyword::Constant {
+                            name: String::from("Const Name"),
+                            value: String::from("Value")
+                        },
+                        Keyword::Comment(String::from("A Comment")),
+                        Keyword::Device {
+                            name: String::from("Name A"),
+                            value: String::from("entry 1")
+                        },
+                        Keyword::Device {
+                            name: String::from("Name A"),
+                            value: String::from("entry 2")
+                        },
+                        Keyword::Data {
+                            name: String::from("Data Name A"),
+                            format: String::from("Format A")
+                        },
+                        Keyword::Data {
+                            name: String::from("Data Name B"),
+                            format: String::from("Format B")
+                        },
+                        Keyword::Begin,
+                        Keyword::DataPair { real: 1., imag: 2. },
+                        Keyword::End,
+                        Keyword::Begin,
+                        Keyword::DataPair { real: 3., imag: 5. },
+                        Keyword::DataPair { real: 4., imag: 6. },
+                        Keyword::End,
+                    ]
+                ),
+                e => panic!("{:?}", e),
+            }
+        }
+
+        #[test]
+        fn for_each_keyword_matches_get_keywords() {
+            let record = full_record();
+            let mut keywords = vec![];
+            record
+                .for_each_keyword(false, |keyword| -> std::result::Result<(), ()> {
+                    keywords.push(Keyword::from(keyword));
+                    Ok(())
+                })
+                .unwrap();
+            assert_eq!(keywords, record.get_keywords().unwrap());
+        }
+
+        #[test]
+        fn for_each_keyword_stops_on_error() {
+            let record = full_record();
+            let mut count = 0;
+            let result = record.for_each_keyword(false, |_| {
+                count += 1;
+                match count {
+                    3 => Err(count),
+                    _ => Ok(()),
+                }
+            });
+            assert_eq!(result, Err(3));
+        }
+
+        #[test]
+        fn for_each_keyword_segments() {
+            let mut record = full_record();
+            record.header.independent_variable.data.clear();
+            record.header.independent_variable.seq(1e9, 4e9, 10);
+            record.data.truncate(0);
+            let mut keywords: Vec<Keyword> = vec![];
+            record
+                .for_each_keyword(true, |keyword| -> std::result::Result<(), ()> {
+                    keywords.push(keyword.into());
+                    Ok(())
+                })
+                .unwrap();
+            assert_eq!(
+                keywords[2..6],
+                [
+                    Keyword::Var {
+                        name: String::from("Var Name"),
+                        format: String::from("Format"),
+                        length: 10
+                    },
+                    Keyword::SegListBegin,
+                    Keyword::SegItem {
+                        first: 1e9,
+                        last: 4e9,
+                        number: 10
+                    },
+                    Keyword::SegListEnd,
+                ]
+            );
+        }
+
+        fn segments_record() -> Record {
+            let mut record = Record::new("A.01.00", "Name");
+            record.header.independent_variable = Var::new("FREQ", "MAG");
+            record.header.independent_variable.seq(1., 2., 2);
+            record.data.push(DataArray::new("S", "RI"));
+            record.data[0].samples = vec![Complex { re: 1., im: 2. }, Complex { re: 3., im: 4. }];
+            record
+        }
+
+        fn write_segments(record: &Record) -> String {
+            let options = WriteOptions {
+                segments: true,
+                ..WriteOptions::default()
+            };
+            let mut written: Vec<u8> = vec![];
+            record
+                .to_writer_with_options(&mut written, &options)
+                .unwrap();
+            String::from_utf8(written).unwrap()
+        }
+
+        #[test]
+        fn to_writer_segments_read_back() {
+            let record = segments_record();
+            let text = write_segments(&record);
+            assert!(text.contains("\nSEG_LIST_BEGIN\nSEG 1E0 2E0 2\nSEG_LIST_END\n"));
+
+            let read = Record::from_reader(&mut text.as_bytes()).unwrap();
+            assert_eq!(read.header.independent_variable.data, vec![1., 2.]);
+            assert_eq!(read, record);
+        }
+
+        #[test]
+        fn to_writer_segments_by_default() {
+            let mut written: Vec<u8> = vec![];
+            segments_record().to_writer(&mut written).unwrap();
+            let text = String::from_utf8(written).unwrap();
+            assert!(text.contains("\nSEG_LIST_BEGIN\nSEG 1E0 2E0 2\nSEG_LIST_END\n"));
+            assert!(!text.contains("VAR_LIST_BEGIN"));
+        }
+
+        #[test]
+        fn to_writer_pushed_sweep_by_default() {
+            let mut record = segments_record();
+            record.header.independent_variable.set_data(vec![1., 2.]);
+            let mut written: Vec<u8> = vec![];
+            record.to_writer(&mut written).unwrap();
+            let text = String::from_utf8(written).unwrap();
+            assert!(!text.contains("SEG"));
+            assert!(text.contains("VAR_LIST_BEGIN"));
+
+            assert!(write_segments(&record).contains("\nSEG 1E0 2E0 2\n"));
+        }
+
+        #[test]
+        fn to_writer_several_segments_read_back() {
+            let mut record = segments_record();
+            record.header.independent_variable.seq(5., 6., 2);
+            record.data[0].samples.push(Complex { re: 5., im: 6. });
+            record.data[0].samples.push(Complex { re: 7., im: 8. });
+
+            let mut written: Vec<u8> = vec![];
+            record.to_writer(&mut written).unwrap();
+            let text = String::from_utf8(written).unwrap();
+            assert!(text.contains("\nSEG_LIST_BEGIN\nSEG 1E0 2E0 2\nSEG 5E0 6E0 2\nSEG_LIST_END\n"));
+
+            let read = Record::from_reader(&mut text.as_bytes()).unwrap();
+            assert_eq!(read.header.independent_variable.data, vec![1., 2., 5., 6.]);
+            assert_eq!(
+                read.header.independent_variable.segments(),
+                record.header.independent_variable.segments()
+            );
+        }
+
+        #[test]
+        fn to_writer_data_changed_in_place() {
+            let mut record = segments_record();
+            record.header.independent_variable.data[1] = 3.;
+
+            let mut written: Vec<u8> = vec![];
+            record.to_writer(&mut written).unwrap();
+            let text = String::from_utf8(written).unwrap();
+            assert!(!text.contains("SEG"));
+            assert!(text.contains("VAR_LIST_BEGIN"));
+        }
+
+        #[test]
+        fn to_writer_modified_segments() {
+            let mut record = segments_record();
+            record.header.independent_variable.data[1] = 3.;
+            record.header.independent_variable.push(4.);
+            record.data[0].samples.push(Complex { re: 5., im: 6. });
+
+            let text = write_segments(&record);
+            assert!(!text.contains("SEG"));
+            assert!(text.contains("VAR_LIST_BEGIN"));
+        }
+
+        #[test]
+        fn to_writer_matches_keywords() {
+            let record = full_record();
+            let mut expected = String::new();
+            for keyword in record.get_keywords().unwrap().iter() {
+                expected.push_str(&format!("{}\n", keyword));
+            }
+
+            let mut written: Vec<u8> = vec![];
+            record.to_writer(&mut written).unwrap();
+            assert_eq!(String::from_utf8(written).unwrap(), expected);
+        }
+
+        #[test]
+        fn to_writer_with_significant_digits() {
+            let record = full_record();
+            let options = WriteOptions {
+                data_format: FloatFormat::SignificantDigits(3),
+                ..WriteOptions::default()
+            };
+
+            let mut written: Vec<u8> = vec![];
+            record
+                .to_writer_with_options(&mut written, &options)
+                .unwrap();
+            let written = String::from_utf8(written).unwrap();
+            assert!(written.ends_with(
+                "BEGIN\n1.00E0,2.00E0\nEND\nBEGIN\n3.00E0,5.00E0\n4.00E0,6.00E0\nEND\n"
+            ));
+            assert!(written.contains("VAR_LIST_BEGIN\n1\nVAR_LIST_END\n"));
+        }
+
+        fn large_record() -> Record {
+            let mut record = full_record();
+            record.data.push(DataArray::new("Empty", "RI"));
+            let mut large = DataArray::new("Large", "MA");
+            for i in 0..2 * WRITE_CHUNK_SAMPLES + 5 {
+                large.add_sample(i as f64 / 7., -(i as f64) * 1e-3);
+            }
+            record.data.push(large);
+            record
+        }
+
+        #[test]
+        fn to_writer_in_parallel_matches_sequential() {
+            let record = large_record();
+            for &data_format in [FloatFormat::RoundTrip, FloatFormat::SignificantDigits(6)].iter() {
+                let sequential = WriteOptions {
+                    data_format,
+                    ..WriteOptions::default()
+                };
+                let mut expected: Vec<u8> = vec![];
+                record
+                    .to_writer_with_options(&mut expected, &sequential)
+                    .unwrap();
+
+                for &threads in [0, 2, 3].iter() {
+                    let options = WriteOptions {
+                        threads,
+                        ..sequential
+                    };
+                    let mut written: Vec<u8> = vec![];
+                    record
+                        .to_writer_with_options(&mut written, &options)
+                        .unwrap();
+                    assert!(written == expected, "{} threads", threads);
+                }
+            }
+        }
+
+        #[test]
+        fn to_writer_in_parallel_counts_the_same() {
+            let record = large_record();
+            let mut expected = WriteStats::default();
+            record
+                .to_writer_with_stats(&mut vec![], &WriteOptions::default(), &mut expected)
+                .unwrap();
+
+            let options = WriteOptions {
+                threads: 2,
+                ..WriteOptions::default()
+            };
+            let mut stats = WriteStats::default();
+            record
+                .to_writer_with_stats(&mut vec![], &options, &mut stats)
+                .unwrap();
+            assert_eq!(stats.bytes, expected.bytes);
+            assert_eq!(stats.lines, expected.lines);
+            assert_eq!(stats.keywords, expected.keywords);
+            assert_eq!(stats.samples, expected.samples);
+        }
+
+        #[test]
+        fn write_data_chunks_beyond_buffers_in_flight() {
+            let mut record = full_record();
+            for i in 0..3 * WRITE_BUFFERS_IN_FLIGHT {
+                let mut array = DataArray::new(&format!("A{}", i), "RI");
+                array.add_sample(i as f64, 1.);
+                record.data.push(array);
+            }
+            let chunks = data_chunks(&record.data);
+            let mut expected: Vec<u8> = vec![];
+            for chunk in chunks.iter() {
+                chunk.push(FloatFormat::RoundTrip, &mut expected);
+            }
+
+            for &threads in [2, WRITE_BUFFERS_IN_FLIGHT + 1].iter() {
+                let mut written: Vec<u8> = vec![];
+                write_data_chunks(&chunks, FloatFormat::RoundTrip, threads, &mut written).unwrap();
+                assert!(written == expected, "{} threads", threads);
+            }
+        }
+
+        #[test]
+        fn write_data_chunks_stops_on_error() {
+            /// Fails once `0` writes are done
+            struct FailAfter(usize);
+
+            impl std::io::Write for FailAfter {
+                fn write(&mut self, buf: &[u8]) -> std::io::Result<usize> {
+                    match self.0 {
+                        0 => Err(std::io::Error::new(std::io::ErrorKind::Other, "full")),
+                        _ => {
+                            self.0 -= 1;
+                            Ok(buf.len())
+                        }
+                    }
+                }
+
+                fn flush(&mut self) -> std::io::Result<()> {
+                    Ok(())
+                }
+            }
+
+            let record = large_record();
+            let chunks = data_chunks(&record.data);
+            let mut writer = FailAfter(2);
+            match write_data_chunks(&chunks, FloatFormat::RoundTrip, 2, &mut writer) {
+                Err(e) => assert_eq!(e.kind(), std::io::ErrorKind::Other),
+                Ok(_) => panic!("written"),
+            }
+        }
+
+        #[test]
+        fn data_chunks_split_large_arrays() {
+            let record = large_record();
+            let chunks = data_chunks(&record.data);
+            let lengths: Vec<(usize, bool, bool)> = chunks
+                .iter()
+                .map(|chunk| (chunk.samples.len(), chunk.begin, chunk.end))
+                .collect();
+            assert_eq!(
+                lengths,
+                [
+                    (1, true, true),
+                    (2, true, true),
+                    (0, true, true),
+                    (WRITE_CHUNK_SAMPLES, true, false),
+                    (WRITE_CHUNK_SAMPLES, false, false),
+                    (5, false, true),
+                ]
+            );
+        }
+
+        #[test]
+        fn to_writer_writes_nothing_on_error() {
+            let mut record = full_record();
+            record.data[1].format = String::new();
+
+            let mut written: Vec<u8> = vec![];
+            match record.to_writer(&mut written) {
+                Err(Error::WriteError(WriteError::NoDataFormat(1))) => assert!(written.is_empty()),
+                e => panic!("{:?}", e),
+            }
+        }
+
+        #[test]
+        fn validate_for_write_version_first() {
+            let mut record = full_record();
+            record.header.version = String::new();
+            record.header.name = String::new();
+            record.data[0].name = String::new();
+            match record.validate_for_write() {
+                Err(WriteError::NoVersion) => (),
+                e => panic!("{:?}", e),
+            }
+        }
+
+        #[test]
+        fn validate_for_write_name_before_data() {
+            let mut record = full_record();
+            record.header.name = String::new();
+            record.data[0].name = String::new();
+            match record.validate_for_write() {
+                Err(WriteError::NoName) => (),
+                e => panic!("{:?}", e),
+            }
+        }
+
+        #[test]
+        fn validate_for_write_first_bad_array() {
+            let mut record = full_record();
+            record.data[1].name = String::new();
+            record.data[1].format = String::new();
+            match record.validate_for_write() {
+                Err(WriteError::NoDataName(1)) => (),
+                e => panic!("{:?}", e),
+            }
+        }
+
+        mod test_get_var_keywords {
+            use super::*;
+
+            #[test]
+            fn empty() {
+                let record = Record::default();
+                match record.get_var_keywords() {
+                    Ok(v) => assert_eq!(v, vec![]),
+                    e => panic!("{:?}", e),
+                }
+            }
+
+            #[test]
+            fn one() {
+                let mut record = Record::default();
+                record.header.independent_variable.data.push(1.);
+                match record.get_var_keywords() {
+                    Ok(v) => assert_eq!(
+                        v,
+                        vec![
+                            Keyword::VarListBegin,
+                            Keyword::VarListItem(1.),
+                            Keyword::VarListEnd
+                        ]
+                    ),
+                    e => panic!("{:?}", e),
+                }
+            }
+
+            #[test]
+            fn multiple() {
+                let mut record = Record::default();
+                record.header.independent_variable.data.push(1.);
+                record.header.independent_variable.data.push(2.);
+                record.header.independent_variable.data.push(3.);
+                match record.get_var_keywords() {
+                    Ok(v) => assert_eq!(
+                        v,
+                        vec![
+                            Keyword::VarListBegin,
+                            Keyword::VarListItem(1.),
+                            Keyword::VarListItem(2.),
+                            Keyword::VarListItem(3.),
+                            Keyword::VarListEnd
+                        ]
+                    ),
+                    e => panic!("{:?}", e),
+                }
+            }
+        }
+
+        mod test_get_constants_keywords {
+            use super::*;
+
+            #[test]
+            fn empty() {
+                let record = Record::default();
+                match record.get_constants_keywords() {
+                    Ok(v) => assert_eq!(v, vec![]),
+                    e => panic!("{:?}", e),
+                }
+            }
+
+            #[test]
+            fn one() {
+                let mut record = Record::default();
+                record.header.constants.push(Constant {
+                    name: String::from("Name"),
+                    value: String::from("Value"),
+                });
+                match record.get_constants_keywords() {
+                    Ok(v) => assert_eq!(
+                        v,
+                        vec![Keyword::Constant {
+                            name: String::from("Name"),
+                            value: String::from("Value")
+                        }]
+                    ),
+                    e => panic!("{:?}", e),
+                }
+            }
+
+            #[test]
+            fn two() {
+                let mut record = Record::default();
+                record.header.constants.push(Constant {
+                    name: String::from("Name A"),
+                    value: String::from("Value A"),
+                });
+                record.header.constants.push(Constant {
+                    name: String::from("Name B"),
+                    value: String::from("Value B"),
+                });
+                match record.get_constants_keywords() {
+                    Ok(v) => assert_eq!(
+                        v,
+                        vec![
+                            Keyword::Constant {
+                                name: String::from("Name A"),
+                                value: String::from("Value A")
+                            },
+                            Keyword::Constant {
+                                name: String::from("Name B"),
+                                value: String::from("Value B")
+                            }
+                        ]
+                    ),
+                    e => panic!("{:?}", e),
+                }
+            }
+        }
+
+        mod test_get_independent_variable_keywords {
+            use super::*;
+
+            #[test]
+            fn no_format() {
+                let mut record = Record::default();
+                record.header.independent_variable.name = String::from("Name");
+                match record.get_independent_variable_keywords() {
+                    Ok(v) => assert_eq!(
+                        v,
+                        vec![Keyword::Var {
+                            name: String::from("Name"),
+                            format: String::new(),
+                            length: 0
+                        }]
+                    ),
+                    e => panic!("{:?}", e),
+                }
+            }
+
+            #[test]
+            fn format() {
+                let mut record = Record::default();
+                record.header.independent_variable.name = String::from("Name");
+                record.header.independent_variable.format = String::from("Format");
+                match record.get_independent_variable_keywords() {
+                    Ok(v) => assert_eq!(
+                        v,
+                        vec![Keyword::Var {
+                            name: String::from("Name"),
+                            format: String::from("Format"),
+                            length: 0
+                        }]
+                    ),
+                    e => panic!("{:?}", e),
+                }
+            }
+
+            #[test]
+            fn length() {
+                let mut record = Record::default();
+                record.header.independent_variable.name = String::from("Name");
+                record.header.independent_variable.format = String::from("Format");
+                record.header.independent_variable.data = vec![0.; 10];
+                match record.get_independent_variable_keywords() {
+                    Ok(v) => assert_eq!(
+                        v,
+                        vec![Keyword::Var {
+                            name: String::from("Name"),
+                            format: String::from("Format"),
+                            length: 10
+                        }]
+                    ),
+                    e => panic!("{:?}", e),
+                }
+            }
+        }
+
+        mod test_get_devices_keywords {
+            use super::*;
+
+            #[test]
+            fn empty() {
+                let record = Record::default();
+                match record.get_devices_keywords() {
+                    Ok(v) => assert_eq!(v, vec![]),
+                    e => panic!("{:?}", e),
+                }
+            }
+
+            #[test]
+            fn one_device_no_entry() {
+                let mut record = Record::default();
+                record.header.devices.push(Device {
+                    name: String::from(""),
+                    entries: vec![],
+                });
+                match record.get_devices_keywords() {
+                    Ok(v) => assert_eq!(v, vec![]),
+                    e => panic!("{:?}", e),
+                }
+            }
+
+            #[test]
+            fn one_device() {
+                let mut record = Record::default();
+                record.header.devices.push(Device {
+                    name: String::from("Name"),
+                    entries: vec![String::from("entry")],
+                });
+                match record.get_devices_keywords() {
+                    Ok(v) => assert_eq!(
+                        v,
+                        vec![Keyword::Device {
+                            name: String::from("Name"),
+                            value: String::from("entry")
+                        }]
+                    ),
+                    e => panic!("{:?}", e),
+                }
+            }
+
+            #[test]
+            fn one_device_multiple_entries() {
+                let mut record = Record::default();
+                record.header.devices.push(Device {
+                    name: String::from("Name"),
+                    entries: vec![String::from("entry 1"), String::from("entry 2")],
+                });
+                match record.get_devices_keywords() {
+                    Ok(v) => assert_eq!(
+                        v,
+                        vec![
+                            Keyword::Device {
+                                name: String::from("Name"),
+                                value: String::from("entry 1")
+                            },
+                            Keyword::Device {
+                                name: String::from("Name"),
+                                value: String::from("entry 2")
+                            }
+                        ]
+                    ),
+                    e => panic!("{:?}", e),
+                }
+            }
+
+            #[test]
+            fn multiple_devices() {
+                let mut record = Record::default();
+                record.header.devices.push(Device {
+                    name: String::from("Name A"),
+                    entries: vec![String::from("entry 1")],
+                });
+                record.header.devices.push(Device {
+                    name: String::from("Name B"),
+                    entries: vec![String::from("entry 2")],
+                });
+                match record.get_devices_keywords() {
+                    Ok(v) => assert_eq!(
+                        v,
+                        vec![
+                            Keyword::Device {
+                                name: String::from("Name A"),
+                                value: String::from("entry 1")
+                            },
+                            Keyword::Device {
+                                name: String::from("Name B"),
+                                value: String::from("entry 2")
+                            }
+                        ]
+                    ),
+                    e => panic!("{:?}", e),
+                }
+            }
+        }
+
+        mod test_get_comments_keywords {
+            use super::*;
+
+            #[test]
+            fn empty() {
+                let record = Record::default();
+                match record.get_comments_keywords() {
+                    Ok(v) => assert_eq!(v, vec![]),
+                    e => panic!("{:?}", e),
+                }
+            }
+
+            #[test]
+            fn one() {
+                let mut record = Record::default();
+                record.header.comments.push(String::from("A Comment"));
+                match record.get_comments_keywords() {
+                    Ok(v) => assert_eq!(v, vec![Keyword::Comment(String::from("A Comment"))]),
+                    e => panic!("{:?}", e),
+                }
+            }
+
+            #[test]
+            fn multiple() {
+                let mut record = Record::default();
+                record.header.comments.push(String::from("A Comment"));
+                record.header.comments.push(String::from("B Comment"));
+                match record.get_comments_keywords() {
+                    Ok(v) => assert_eq!(
+                        v,
+                        vec![
+                            Keyword::Comment(String::from("A Comment")),
+                            Keyword::Comment(String::from("B Comment"))
+                        ]
+                    ),
+                    e => panic!("{:?}", e),
+                }
+            }
+        }
+
+        mod test_get_name_keywords {
+            use super::*;
+
+            #[test]
+            fn none() {
+                let mut record = Record::default();
+                record.header.name = String::new();
+                match record.get_name_keywords() {
+                    Err(WriteError::NoName) => (),
+                    e => panic!("{:?}", e),
+                }
+            }
+
+            #[test]
+            fn some() {
+                let mut record = Record::default();
+                record.header.name = String::from("A.01.00");
+                match record.get_name_keywords() {
+                    Ok(v) => assert_eq!(v, vec![Keyword::Name(String::from("A.01.00"))]),
+                    e => panic!("{:?}", e),
+                }
+            }
+        }
+
+        mod test_get_version_keywords {
+            use super::*;
+
+            #[test]
+            fn none() {
+                let mut record = Record::default();
+                record.header.version = String::new();
+                match record.get_version_keywords() {
+                    Err(WriteError::NoVersion) => (),
+                    e => panic!("{:?}", e),
+                }
+            }
+
+            #[test]
+            fn some() {
+                let mut record = Record::default();
+                record.header.version = String::from("A.01.00");
+                match record.get_version_keywords() {
+                    Ok(v) => assert_eq!(
+                        v,
+                        vec![Keyword::CitiFile {
+                            version: String::from("A.01.00")
+                        }]
+                    ),
+                    e => panic!("{:?}", e),
+                }
+            }
+        }
+
+        mod test_get_data_keywords {
+            use super::*;
+
+            #[test]
+            fn many_values() {
+                let mut record = Record::default();
+                record.data.push(DataArray {
+                    name: String::new(),
+                    format: String::new(),
+                    samples: vec![
+                        Complex { re: 1., im: 4. },
+                        Complex { re: 2., im: 1e-6 },
+                        Complex { re: -3., im: 0. },
+                    ],
+                });
+                match record.get_data_keywords() {
+                    Ok(v) => assert_eq!(
+                        v,
+                        vec![
+                            Keyword::Begin,
+                            Keyword::DataPair { real: 1., imag: 4. },
+                            Keyword::DataPair {
+                                real: 2.,
+                                imag: 1e-6
+                            },
+                            Keyword::DataPair {
+                                real: -3.,
+                                imag: 0.
+                            },
+                            Keyword::End
+                        ]
+                    ),
+                    e => panic!("{:?}", e),
+                }
+            }
+
+            #[test]
+            fn one_array_gives_correct_result() {
+                let mut record = Record::default();
+                record.data.push(DataArray {
+                    name: String::new(),
+                    format: String::new(),
+                    samples: vec![Complex { re: 1., im: 2. }],
+                });
+                match record.get_data_keywords() {
+                    Ok(v) => assert_eq!(
+                        v,
+                        vec![
+                            Keyword::Begin,
+                            Keyword::DataPair { real: 1., imag: 2. },
+                            Keyword::End
+                        ]
+                    ),
+                    e => panic!("{:?}", e),
+                }
+            }
+
+            #[test]
+            fn multiple_array_gives_correct_result() {
+                let mut record = Record::default();
+                record.data.push(DataArray {
+                    name: String::new(),
+                    format: String::new(),
+                    samples: vec![Complex { re: 1., im: 2. }],
+                });
+                record.data.push(DataArray {
+                    name: String::new(),
+                    format: String::new(),
+                    samples: vec![Complex { re: 3., im: 4. }],
+                });
+                match record.get_data_keywords() {
+                    Ok(v) => assert_eq!(
+                        v,
+                        vec![
+                            Keyword::Begin,
+                            Keyword::DataPair { real: 1., imag: 2. },
+                            Keyword::End,
+                            Keyword::Begin,
+                            Keyword::DataPair { real: 3., imag: 4. },
+                            Keyword::End
+                        ]
+                    ),
+                    e => panic!("{:?}", e),
+                }
+            }
+
+            #[test]
+            fn no_arrays_gives_empty() {
+                let record = Record::default();
+                match record.get_data_keywords() {
+                    Ok(v) => assert_eq!(v, vec![]),
+                    e => panic!("{:?}", e),
+                }
+            }
+        }
+
+        mod test_get_data_defines_keywords {
+            use super::*;
+
+            #[test]
+            fn one_entry() {
+                let mut record = Record::default();
+                record.data.push(DataArray {
+                    name: String::from("Name"),
+                    format: String::from("Format"),
+                    samples: vec![],
+                });
+                match record.get_data_defines_keywords() {
+                    Ok(v) => assert_eq!(
+                        v,
+                        vec![Keyword::Data {
+                            name: String::from("Name"),
+                            format: String::from("Format")
+                        }]
+                    ),
+                    e => panic!("{:?}", e),
+                }
+            }
+
+            #[test]
+            fn multiple() {
+                let mut record = Record::default();
+                record.data.push(DataArray {
+                    name: String::from("Name A"),
+                    format: String::from("Format A"),
+                    samples: vec![],
+                });
+                record.data.push(DataArray {
+                    name: String::from("Name B"),
+                    format: String::from("Format B"),
+                    samples: vec![],
+                });
+                match record.get_data_defines_keywords() {
+                    Ok(v) => {
+                        assert_eq!(
+                            v,
+                            vec![
+                                Keyword::Data {
+                                    name: String::from("Name A"),
+                                    format: String::from("Format A")
+                                },
+                                Keyword::Data {
+                                    name: String::from("Name B"),
+                                    format: String::from("Format B")
+                                }
+                            ]
+                        );
+                    }
+                    e => panic!("{:?}", e),
+                }
+            }
+
+            #[test]
+            fn no_name() {
+                let mut record = Record::default();
+                record.data.push(DataArray {
+                    name: String::new(),
+                    format: String::from("Format"),
+                    samples: vec![],
+                });
+                match record.get_data_defines_keywords() {
+                    Err(WriteError::NoDataName(0)) => (),
+                    e => panic!("{:?}", e),
+                }
+            }
+
+            #[test]
+            fn no_format() {
+                let mut record = Record::default();
+                record.data.push(DataArray {
+                    name: String::from("Name"),
+                    format: String::new(),
+                    samples: vec![],
+                });
+                match record.get_data_defines_keywords() {
+                    Err(WriteError::NoDataFormat(0)) => (),
+                    e => panic!("{:?}", e),
+                }
+            }
+
+            #[test]
+            fn no_name_no_format() {
+                let mut record = Record::default();
+                record.data.push(DataArray {
+                    name: String::new(),
+                    format: String::new(),
+                    samples: vec![],
+                });
+                match record.get_data_defines_keywords() {
+                    Err(WriteError::NoDataName(0)) => (),
+                    e => panic!("{:?}", e),
+                }
+            }
+        }
+    }
+
+    #[cfg(test)]
+    mod test_read {
+        use super::*;
+
+        #[test]
+        fn cannot_read_empty_record() {
+            match Record::from_reader(&mut "".as_bytes()) {
+                Err(Error::ReadError(ReadError::NoName)) => (),
+                e => panic!("{:?}", e),
+            }
+        }
+
+        #[test]
+        fn succeed_on_multiple_new_lines() {
+            let contents = "CITIFILE A.01.00\nNAME MEMORY\n\n\n\n\n\n\n\n\nVAR FREQ MAG 3\nDATA S RI\nBEGIN\n-3.54545E-2,-1.38601E-3\n0.23491E-3,-1.39883E-3\n2.00382E-3,-1.40022E-3\nEND\n";
+            match Record::from_reader(&mut contents.as_bytes()) {
+                Ok(_) => (),
+                e => panic!("{:?}", e),
+            }
+        }
+
+        #[test]
+        fn succeed_on_whitespace_new_lines() {
+            let contents = "CITIFILE A.01.00\nNAME MEMORY\n      \n\n\n\n\n\n\n\nVAR FREQ MAG 3\nDATA S RI\nBEGIN\n-3.54545E-2,-1.38601E-3\n0.23491E-3,-1.39883E-3\n2.00382E-3,-1.40022E-3\nEND\n";
+            match Record::from_reader(&mut contents.as_bytes()) {
+                Ok(_) => (),
+                e => panic!("{:?}", e),
+            }
+        }
+
+        #[cfg(test)]
+        mod test_read_minimal_record {
+            use super::*;
+
+            fn setup() -> Result<Record> {
+                let contents = "CITIFILE A.01.00\nNAME MEMORY\nVAR FREQ MAG 3\nDATA S RI\nBEGIN\n-3.54545E-2,-1.38601E-3\n0.23491E-3,-1.39883E-3\n2.00382E-3,-1.40022E-3\nEND\n";
+                Record::from_reader(&mut contents.as_bytes())
+            }
+
+            #[test]
+            fn name() {
+                match setup() {
+                    Ok(record) => assert_eq!(record.header.name, "MEMORY"),
+                    e => panic!("{:?}", e),
+                }
+            }
+
+            #[test]
+            fn version() {
+                match setup() {
+                    Ok(record) => assert_eq!(record.header.version, "A.01.00"),
+                    e => panic!("{:?}", e),
+                }
+            }
+
+            #[test]
+            fn comments() {
+                match setup() {
+                    Ok(record) => assert_eq!(record.header.comments.len(), 0),
+                    e => panic!("{:?}", e),
+                }
+            }
+
+            #[test]
+            fn constants() {
+                match setup() {
+                    Ok(record) => assert_eq!(record.header.constants.len(), 0),
+                    e => panic!("{:?}", e),
+                }
+            }
+
+            #[test]
+            fn devices() {
+                match setup() {
+                    Ok(record) => assert_eq!(record.header.devices.len(), 0),
+                    e => panic!("{:?}", e),
+                }
+            }
+
+            #[test]
+            fn independent_variable() {
+                match setup() {
+                    Ok(record) => {
+                        assert_eq!(record.header.independent_variable.name, "FREQ");
+                        assert_eq!(record.header.independent_variable.format, "MAG");
+                        assert_eq!(record.header.independent_variable.data.len(), 0);
+                    }
+                    e => panic!("{:?}", e),
+                }
+            }
+
+            #[test]
+            fn data() {
+                match setup() {
+                    Ok(record) => {
+                        assert_eq!(record.data.len(), 1);
+                        assert_eq!(record.data[0].name, "S");
+                        assert_eq!(record.data[0].format, "RI");
+                        assert_eq!(record.data[0].samples.len(), 3);
+                        assert_complex_array_relative_eq!(
+                            record.data[0].samples,
+                            vec![
+                                Complex {
+                                    re: -0.0354545,
+                                    im: -0.00138601
+                                },
+                                Complex {
+                                    re: 0.00023491,
+                                    im: -0.00139883
+                                },
+                                Complex {
+                                    re: 0.00200382,
+                                    im: -0.00140022
+                                },
+                            ]
+                        );
+                    }
+                    e => panic!("{:?}", e),
+                }
+            }
+        }
+    }
+
+    mod test_read_into {
+        use super::*;
+
+        const CONTENTS: &str = "CITIFILE A.01.00\nNAME MEMORY\n#NA VERSION HP8510B.05.00\n#NA REGISTER 1\n!COMMENT\nCONSTANT A 10\nVAR FREQ MAG 3\nDATA S11 RI\nDATA S21 RI\nVAR_LIST_BEGIN\n1E9\n2E9\n3E9\nVAR_LIST_END\nBEGIN\n-3.54545E-2,-1.38601E-3\n0.23491E-3,-1.39883E-3\n2.00382E-3,-1.40022E-3\nEND\nBEGIN\n0.86303E-1,-8.98651E-1\n8.97491E-1,3.06915E-1\n-4.96887E-1,7.87323E-1\nEND\n";
+
+        #[test]
+        fn same_as_from_reader() {
+            let mut record = Record::default();
+            record.read_into(&mut CONTENTS.as_bytes()).unwrap();
+            assert_eq!(
+                record,
+                Record::from_reader(&mut CONTENTS.as_bytes()).unwrap()
+            );
+        }
+
+        #[test]
+        fn replaces_previous_record() {
+            let mut record = Record::from_reader(&mut CONTENTS.as_bytes()).unwrap();
+            let contents = "CITIFILE A.01.01\nNAME CAL\nVAR FREQ MAG 2\nDATA E RI\nBEGIN\n1E0,2E0\n3E0,4E0\nEND\n";
+            record.read_into(&mut contents.as_bytes()).unwrap();
+            assert_eq!(
+                record,
+                Record::from_reader(&mut contents.as_bytes()).unwrap()
+            );
+        }
+
+        #[test]
+        fn reuses_buffers() {
+            // Header strings come from one pool, so only where they end up is
+            // checked, not which one went where
+            fn strings(record: &Record) -> Vec<*const u8> {
+                let header = &record.header;
+                let mut strings: Vec<*const u8> =
+                    header.comments.iter().map(|s| s.as_ptr()).collect();
+                for constant in header.constants.iter() {
+                    strings.push(constant.name.as_ptr());
+                    strings.push(constant.value.as_ptr());
+                }
+                for device in header.devices.iter() {
+                    strings.extend(device.entries.iter().map(|s| s.as_ptr()));
+                }
+                strings.sort();
+                strings
+            }
+
+            let mut record = Record::from_reader(&mut CONTENTS.as_bytes()).unwrap();
+            let samples = record.data[1].samples.as_ptr();
+            let var = record.header.independent_variable.data.as_ptr();
+            let header = strings(&record);
+
+            record.read_into(&mut CONTENTS.as_bytes()).unwrap();
+            assert_eq!(record.data[1].samples.as_ptr(), samples);
+            assert_eq!(record.header.independent_variable.data.as_ptr(), var);
+            assert_eq!(strings(&record), header);
+        }
+
+        #[test]
+        fn error_leaves_blank() {
+            let mut record = Record::from_reader(&mut CONTENTS.as_bytes()).unwrap();
+            match record.read_into(&mut "CITIFILE A.01.00\n".as_bytes()) {
+                Err(Error::ReadError(ReadError::NoName)) => (),
+                e => panic!("{:?}", e),
+            }
+            assert_eq!(record, Record::blank());
+        }
+    }
+
+    #[test]
+    fn test_default() {
+        let expected = Record {
+            header: Header {
+                version: String::from("A.01.00"),
+                name: String::new(),
+                comments: vec![],
+                devices: vec![],
+                independent_variable: Var::with_data("", "", vec![]),
+                constants: vec![],
+            },
+            data: vec![],
+        };
+        let result = Record::default();
+        assert_eq!(result, expected);
+    }
+
+    #[test]
+    fn test_new() {
+        let expected = Record {
+            header: Header {
+                version: String::from("A.01.01"),
+                name: String::from("A_NAME"),
+                comments: vec![],
+                devices: vec![],
+                independent_variable: Var::with_data("", "", vec![]),
+                constants: vec![],
+            },
+            data: vec![],
+        };
+        let result = Record::new("A.01.01", "A_NAME");
+        assert_eq!(result, expected);
+    }
+
+    #[test]
+    fn test_blank() {
+        let expected = Record {
+            header: Header {
+                version: String::new(),
+                name: String::new(),
+                comments: vec![],
+                devices: vec![],
+                independent_variable: Var::with_data("", "", vec![]),
+                constants: vec![],
+            },
+            data: vec![],
+        };
+        let result = Record::blank();
+        assert_eq!(result, expected);
+    }
+}
+
+/// Error during reading
+#[derive(Error, Debug)]
+pub enum ReadError {
+    #[error("More data arrays than defined in header")]
+    DataArrayOverIndex,
+    #[error("Independent variable defined twice")]
+    IndependentVariableDefinedTwice,
+    #[error("Single use keyword `{0}` defined twice")]
+    SingleUseKeywordDefinedTwice(Keyword),
+    #[error("Keyword `{0}` is out of order in the record")]
+    OutOfOrderKeyword(Keyword),
+    #[error("Error on line {0}: {1}")]
+    LineError(usize, ParseError),
+    #[error("Reading error occured: {0}")]
+    ReadingError(std::io::Error),
+    #[error("Version is not defined")]
+    NoVersion,
+    #[error("Name is not defined")]
+    NoName,
+    #[error("Indepent variable is not defined")]
+    NoIndependentVariable,
+    #[error("Data name and format is not defined")]
+    NoData,
+    #[error("Independent variable and data array {2} are different lengths ({0} != {1})")]
+    VarAndDataDifferentLengths(usize, usize, usize),
+    #[error("Block index does not match the file")]
+    StaleIndex,
+    #[error("Invalid binary record: {0}")]
+    InvalidBinary(&'static str),
+    #[error("Parser already failed on an earlier line")]
+    ParserFailed,
+    #[error("Reading {0} compressed records needs the `{0}` feature")]
+    UnsupportedCompression(Compression),
+    #[error("Line {0} is longer than the longest line accepted")]
+    LineTooLong(usize),
+    #[error("Data array {1} has more samples than the {0} values of the independent variable")]
+    DataArrayLongerThanVar(usize, usize),
+    #[error("Segments of {0} values are longer than the longest independent variable accepted")]
+    SegmentsTooLong(usize),
+}
+type ReaderResult<T> = std::result::Result<T, ReadError>;
+
+#[cfg(test)]
+mod test_convert_data_to {
+    use super::*;
+
+    fn record() -> Record {
+        let mut record = Record::new("A.01.00", "Name");
+        for (i, format) in ["RI", "MA", "DB", "RI"].iter().enumerate() {
+            let mut data_array = DataArray::new(&format!("S{}", i), format);
+            for k in 0..100 {
+                data_array.add_sample(k as f64 + 1., -(k as f64));
+            }
+            record.data.push(data_array);
+        }
+        record
+    }
+
+    #[test]
+    fn converts_every_array() {
+        let mut expected = record();
+        for data_array in expected.data.iter_mut() {
+            data_array.convert_to(DataFormat::MagnitudeAngle).unwrap();
+        }
+
+        let mut result = record();
+        result
+            .convert_data_to(DataFormat::MagnitudeAngle, 1)
+            .unwrap();
+        assert_eq!(result, expected);
+        assert!(result
+            .data
+            .iter()
+            .all(|data_array| data_array.format == "MA"));
+    }
+
+    #[test]
+    fn parallel_matches_serial() {
+        let mut serial = record();
+        serial.convert_data_to(DataFormat::DecibelAngle, 1).unwrap();
+        for &threads in &[0, 2, 8] {
+            let mut parallel = record();
+            parallel
+                .convert_data_to(DataFormat::DecibelAngle, threads)
+                .unwrap();
+            assert_eq!(parallel, serial);
+        }
+    }
+
+    #[test]
+    fn written_header_matches() {
+        let mut result = record();
+        result.header.independent_variable = Var::new("FREQ", "MAG");
+        result.header.independent_variable.seq(1E9, 2E9, 100);
+        result
+            .convert_data_to(DataFormat::RealImaginary, 1)
+            .unwrap();
+
+        let mut written = vec![];
+        result.to_writer(&mut written).unwrap();
+        let text = String::from_utf8(written).unwrap();
+        assert!(text.contains("DATA S0 RI\nDATA S1 RI\nDATA S2 RI\nDATA S3 RI\n"));
+    }
+
+    #[test]
+    fn unsupported_format_converts_nothing() {
+        let mut result = record();
+        result.data[2].format = String::from("XY");
+        let expected = result.clone();
+        match result.convert_data_to(DataFormat::MagnitudeAngle, 0) {
+            Err(Error::ConvertError(ConvertError::UnsupportedFormat(format))) => {
+                assert_eq!(format, "XY")
+            }
+            e => panic!("{:?}", e),
+        }
+        assert_eq!(result, expected);
+    }
+}
+
+#[cfg(test)]
+mod test_reader_error {
+    use super::*;
+
+    mod test_display {
+        use super::*;
+
+        #[test]
+        fn data_array_over_index() {
+            let error = ReadError::DataArrayOverIndex;
+            assert_eq!(
+                format!("{}", error),
+                "More data arrays than defined in header"
+            );
+        }
+
+        #[test]
+        fn independent_variable_defined_twice() {
+            let error = ReadError::IndependentVariableDefinedTwice;
+            assert_eq!(format!("{}", error), "Independent variable defined twice");
+        }
+
+        #[test]
+        fn single_use_keyword_defined_twice() {
+            let error = ReadError::SingleUseKeywordDefinedTwice(Keyword::End);
+            assert_eq!(
+                format!("{}", error),
+                "Single use keyword `END` defined twice"
+            );
+        }
+
+        #[test]
+        fn out_of_order_keyword() {
+            let error = ReadError::OutOfOrderKeyword(Keyword::Begin);
+            assert_eq!(
+                format!("{}", error),
+                "Keyword `BEGIN` is out of order in the record"
+            );
+        }
+
+        #[test]
+        fn reading_error() {
+            let error = ReadError::ReadingError(std::io::ErrorKind::NotFound.into());
+            assert_eq!(
+                format!("{}", error),
+                "Reading error occured: entity not found"
+            );
+        }
+
+        #[test]
+        fn line_error() {
+            let error = ReadError::LineError(10, ParseError::BadRegex);
+            assert_eq!(
+                format!("{}", error),
+                "Error on line 10: Regex could not be parsed"
+            );
+        }
+
+        #[test]
+        fn no_version() {
+            let error = ReadError::NoVersion;
+            assert_eq!(format!("{}", error), "Version is not defined");
+        }
+
+        #[test]
+        fn no_name() {
+            let error = ReadError::NoName;
+            assert_eq!(format!("{}", error), "Name is not defined");
+        }
+
+        #[test]
+        fn no_independent_variable() {
+            let error = ReadError::NoIndependentVariable;
+            assert_eq!(format!("{}", error), "Indepent variable is not defined");
+        }
+
+        #[test]
+        fn no_data() {
+            let error = ReadError::NoData;
+            assert_eq!(format!("{}", error), "Data name and format is not defined");
+        }
+
+        #[test]
+        fn var_and_data() {
+            let error = ReadError::VarAndDataDifferentLengths(1, 2, 3);
+            assert_eq!(
+                format!("{}", error),
+                "Independent variable and data array 3 are different lengths (1 != 2)"
+            );
+        }
+
+        #[test]
+        fn stale_index() {
+            let error = ReadError::StaleIndex;
+            assert_eq!(format!("{}", error), "Block index does not match the file");
+        }
+
+        #[test]
+        fn invalid_binary() {
+            let error = ReadError::InvalidBinary("checksum mismatch");
+            assert_eq!(
+                format!("{}", error),
+                "Invalid binary record: checksum mismatch"
+            );
+        }
+
+        #[test]
+        fn parser_failed() {
+            let error = ReadError::ParserFailed;
+            assert_eq!(
+                format!("{}", error),
+                "Parser already failed on an earlier line"
+            );
+        }
+
+        #[test]
+        fn unsupported_compression() {
+            let error = ReadError::UnsupportedCompression(Compression::Zstd);
+            assert_eq!(
+                format!("{}", error),
+                "Reading zstd compressed records needs the `zstd` feature"
+            );
+        }
+    }
+}
+
+/// Call `f` with the index and contents of every line in `reader`
+///
+/// Behaves like [`BufRead::lines`]: lines end at `\n` or `\r\n` and must
+/// be valid UTF-8. Lines are borrowed straight from the reader's buffer;
+/// only a line that straddles a buffer refill is copied, into a scratch
+/// buffer that is reused for the whole read.
+///
+/// Nothing more is read once `f` breaks.
+fn for_each_line<R, F>(reader: &mut R, mut f: F) -> ReaderResult<()>
+where
+    R: BufRead,
+    F: FnMut(usize, &str) -> ReaderResult<ControlFlow<()>>,
+{
+    let mut partial: Vec<u8> = vec![];
+    let mut i = 0;
+
+    loop {
+        let available = match reader.fill_buf() {
+            Ok(available) => available,
+            Err(e) if e.kind() == std::io::ErrorKind::Interrupted => continue,
+            Err(e) => return Err(ReadError::ReadingError(e)),
+        };
+
+        if available.is_empty() {
+            if !partial.is_empty() {
+                // The last line, so there is nothing left to break out of
+                let _ = f(i, line_to_str(&partial)?)?;
+            }
+            return Ok(());
+        }
+
+        match memchr::memchr(b'\n', available) {
+            Some(end) => {
+                let flow = if partial.is_empty() {
+                    f(i, line_to_str(&available[..=end])?)?
+                } else {
+                    partial.extend_from_slice(&available[..=end]);
+                    let flow = f(i, line_to_str(&partial)?)?;
+                    partial.clear();
+                    flow
+                };
+                i += 1;
+                reader.consume(end + 1);
+                if flow.is_break() {
+                    return Ok(());
+                }
+            }
+            None => {
+                let length = available.len();
+                partial.extend_from_slice(available);
+                reader.consume(length);
+            }
+        }
+    }
+}
+
+/// Memory map a regular, non-empty file
+///
+/// `None` is returned for anything that cannot be mapped, such as a pipe.
+fn map_file(file: &File) -> Option<memmap2::Mmap> {
+    let mappable = match file.metadata() {
+        Ok(metadata) => metadata.is_file() && metadata.len() > 0,
+        Err(_) => false,
+    };
+
+    match mappable {
+        // Safety: the map is read-only and dropped before the read returns. A
+        // concurrent writer truncating the file is the documented caveat.
+        true => unsafe { memmap2::Mmap::map(file) }.ok(),
+        false => None,
+    }
+}
+
+/// Splits an in-memory record into lines the same way as [`for_each_line`]
+struct LineCursor<'a> {
+    bytes: &'a [u8],
+    position: usize,
+}
+
+impl<'a> LineCursor<'a> {
+    fn new(bytes: &'a [u8]) -> LineCursor<'a> {
+        LineCursor { bytes, position: 0 }
+    }
+
+    /// Next line, including its line ending
+    fn next_line(&mut self) -> Option<&'a [u8]> {
+        let rest = &self.bytes[self.position..];
+        let length = match memchr::memchr(b'\n', rest) {
+            Some(end) => end + 1,
+            None if rest.is_empty() => return None,
+            None => rest.len(),
+        };
+        self.position += length;
+        Some(&rest[..length])
+    }
+}
+
+/// Whether a raw line is the `END` keyword, without validating UTF-8
+fn is_end_line(line: &[u8]) -> bool {
+    let line = line.strip_suffix(b"\n").unwrap_or(line);
+    let line = line.strip_suffix(b"\r").unwrap_or(line);
+    line == b"END"
+}
+
+/// Header of an in-memory record with its `BEGIN`…`END` blocks set aside
+struct SplitRecord<'a> {
+    state: RecordReaderState,
+    blocks: Vec<DataBlock<'a>>,
+    /// Where each of `blocks` is in the record
+    locations: Vec<Block>,
+    /// First invalid line outside of the blocks, where the split stopped
+    header_error: Option<ReadError>,
+}
+
+/// Read the header of an in-memory record, only locating each `BEGIN`…`END`
+/// block by scanning for its `END` line
+///
+/// With `reserve` unset, nothing is reserved for the samples of the blocks.
+fn split_blocks(bytes: &[u8], reserve: bool) -> ReaderResult<SplitRecord<'_>> {
+    let mut state = RecordReaderState::new();
+    let mut blocks: Vec<DataBlock> = vec![];
+    let mut locations: Vec<Block> = vec![];
+    let mut header_error = None;
+
+    let mut cursor = LineCursor::new(bytes);
+    let mut i = 0;
+    while let Some(this_line) = cursor.next_line() {
+        let result = line_to_str(this_line).and_then(|this_line| {
+            // Filter out new lines
+            match this_line.trim().is_empty() {
+                true => Ok(()),
+                false => {
+                    let keyword =
+                        KeywordRef::try_from(this_line).map_err(|e| ReadError::LineError(i, e))?;
+                    match keyword {
+                        KeywordRef::Begin
+                            if !reserve && state.state == RecordReaderStates::Header =>
+                        {
+                            state.skip_block();
+                            Ok(())
+                        }
+                        keyword => state.process(keyword),
+                    }
+                }
+            }
+        });
+        if let Err(e) = result {
+            header_error = Some(e);
+            break;
+        }
+        i += 1;
+
+        if state.state == RecordReaderStates::Data {
+            let start = cursor.position;
+            let mut block = DataBlock {
+                lines: &bytes[start..],
+                first_line: i,
+                array: state.data_array_counter,
+                known_length: state.known_length(),
+            };
+            let mut location = Block {
+                begin: (start - this_line.len()) as u64,
+                end: bytes.len() as u64,
+                first_line: i - 1,
+                next_line: i,
+            };
+
+            while let Some(this_line) = cursor.next_line() {
+                i += 1;
+                if is_end_line(this_line) {
+                    block.lines = &bytes[start..cursor.position - this_line.len()];
+                    location.end = cursor.position as u64;
+                    state.process(KeywordRef::End)?;
+                    break;
+                }
+            }
+            location.next_line = i;
+            blocks.push(block);
+            locations.push(location);
+        }
+    }
+
+    Ok(SplitRecord {
+        state,
+        blocks,
+        locations,
+        header_error,
+    })
+}
+
+/// Lines of a `BEGIN`…`END` block set aside for a worker thread
+struct DataBlock<'a> {
+    /// Everything between the `BEGIN` and `END` lines
+    lines: &'a [u8],
+    /// Index of the first line in `lines`
+    first_line: usize,
+    /// Data array the block belongs to
+    array: usize,
+    /// See [`RecordReaderState::known_length`]
+    known_length: usize,
+}
+
+impl DataBlock<'_> {
+    /// Parse every data pair in the block into `data_array`
+    ///
+    /// This is what [`RecordReaderState::state_data`] does for each line.
+    fn parse(&self, mut data_array: Option<&mut DataArray>) -> ReaderResult<()> {
+        let mut cursor = LineCursor::new(self.lines);
+        let mut i = self.first_line;
+        while let Some(this_line) = cursor.next_line() {
+            let this_line = line_to_str(this_line)?;
+            // Filter out new lines
+            if !this_line.trim().is_empty() {
+                match KeywordRef::try_from(this_line).map_err(|e| ReadError::LineError(i, e))? {
+                    KeywordRef::DataPair { real, imag } => add_data_pair(
+                        data_array.as_deref_mut(),
+                        self.known_length,
+                        self.array,
+                        real,
+                        imag,
+                    )?,
+                    keyword => return Err(ReadError::OutOfOrderKeyword(keyword.into())),
+                }
+            }
+            i += 1;
+        }
+        Ok(())
+    }
+}
+
+/// Number of workers for `jobs` jobs, where a `threads` of 0 means one per
+/// available core
+fn worker_count(threads: usize, jobs: usize) -> usize {
+    match threads {
+        0 => std::thread::available_parallelism().map_or(1, |n| n.get()),
+        n => n,
+    }
+    .min(jobs)
+}
+
+/// Read many records on a pool of threads
+///
+/// Each file is read as with [`Record::from_path_mmap`] by one of up to
+/// `threads` workers, which take the next path as soon as they are done
+/// with the last, so at most `threads` files are open or mapped at once.
+/// Pass `0` to use one thread per available core.
+///
+/// The results are in the same order as `paths`, and a file that cannot
+/// be read does not stop the others from being read.
+///
+/// Example usage:
+/// ```no_run
+/// let records = citi::read_many(&["a.cti", "b.cti"], 0);
+/// for (i, record) in records.iter().enumerate() {
+///     if let Err(e) = record {
+///         println!("File {} could not be read: {}", i, e);
+///     }
+/// }
+/// ```
+pub fn read_many<P: AsRef<Path> + Sync>(paths: &[P], threads: usize) -> Vec<Result<Record>> {
+    let threads = worker_count(threads, paths.len());
+    if threads <= 1 {
+        return paths.iter().map(Record::from_path_mmap).collect();
+    }
+
+    let next = AtomicUsize::new(0);
+    let mut results: Vec<(usize, Result<Record>)> = std::thread::scope(|scope| {
+        let workers: Vec<_> = (0..threads)
+            .map(|_| {
+                scope.spawn(|| {
+                    let mut results = vec![];
+                    loop {
+                        let i = next.fetch_add(1, Ordering::Relaxed);
+                        match paths.get(i) {
+                            Some(path) => results.push((i, Record::from_path_mmap(path))),
+                            None => return results,
+                        }
+                    }
+                })
+            })
+            .collect();
+
+        workers
+            .into_iter()
+            .flat_map(|worker| worker.join().unwrap())
+            .collect()
+    });
+
+    results.sort_by_key(|&(i, _)| i);
+    results.into_iter().map(|(_, result)| result).collect()
+}
+
+/// Parse blocks on a pool of scoped threads
+///
+/// Returns the error of the first failing block in record order.
+fn parse_data_blocks(
+    jobs: Vec<(&DataBlock, Option<&mut DataArray>)>,
+    threads: usize,
+) -> Option<ReadError> {
+    let threads = worker_count(threads, jobs.len());
+
+    if threads <= 1 {
+        return jobs
+            .into_iter()
+            .find_map(|(block, data_array)| block.parse(data_array).err());
+    }
+
+    let queue = std::sync::Mutex::new(jobs.into_iter().enumerate());
+    let mut errors: Vec<(usize, ReadError)> = std::thread::scope(|scope| {
+        let workers: Vec<_> = (0..threads)
+            .map(|_| {
+                scope.spawn(|| {
+                    let mut errors = vec![];
+                    loop {
+                        let job = queue.lock().unwrap_or_else(|e| e.into_inner()).next();
+                        match job {
+                            Some((k, (block, data_array))) => {
+                                if let Err(e) = block.parse(data_array) {
+                                    errors.push((k, e));
+                                }
+                            }
+                            None => return errors,
+                        }
+                    }
+                })
+            })
+            .collect();
+
+        workers
+            .into_iter()
+            .flat_map(|worker| worker.join().unwrap())
+            .collect()
+    });
+
+    errors.sort_by_key(|&(k, _)| k);
+    errors.into_iter().next().map(|(_, e)| e)
+}
+
+/// Append a data pair, failing as soon as an array outgrows a known independent
+/// variable rather than waiting for `var_and_data_same_length`
+fn add_data_pair(
+    data_array: Option<&mut DataArray>,
+    known_length: usize,
+    index: usize,
+    real: f64,
+    imag: f64,
+) -> ReaderResult<()> {
+    match data_array {
+        Some(data_array) if known_length != 0 && data_array.samples.len() == known_length => {
+            Err(ReadError::DataArrayLongerThanVar(known_length, index))
+        }
+        Some(data_array) => {
+            data_array.add_sample(real, imag);
+            Ok(())
+        }
+        None => Err(ReadError::DataArrayOverIndex),
+    }
+}
+
+/// Strip the line ending and validate UTF-8
+fn line_to_str(line: &[u8]) -> ReaderResult<&str> {
+    let line = match line.strip_suffix(b"\n") {
+        Some(line) => line.strip_suffix(b"\r").unwrap_or(line),
+        None => line,
+    };
+
+    std::str::from_utf8(line).map_err(|_| {
+        ReadError::ReadingError(std::io::Error::new(
+            std::io::ErrorKind::InvalidData,
+            "stream did not contain valid UTF-8",
+        ))
+    })
+}
+
+#[cfg(test)]
+mod test_for_each_line {
+    use super::*;
+
+    fn collect_lines(bytes: &[u8], capacity: usize) -> ReaderResult<Vec<(usize, String)>> {
+        let mut reader = std::io::BufReader::with_capacity(capacity, bytes);
+        let mut lines = vec![];
+        for_each_line(&mut reader, |i, line| {
+            lines.push((i, String::from(line)));
+            Ok(ControlFlow::Continue(()))
+        })?;
+        Ok(lines)
+    }
+
+    fn lines_from_std(bytes: &[u8]) -> Vec<(usize, String)> {
+        bytes.lines().map(|l| l.unwrap()).enumerate().collect()
+    }
+
+    #[test]
+    fn empty() {
+        assert_eq!(collect_lines(b"", 8).unwrap(), vec![]);
+    }
+
+    #[test]
+    fn matches_std_lines() {
+        let bytes = b"CITIFILE A.01.00\r\nNAME X\n\n  \n1,2\nEND\r";
+        for capacity in 1..bytes.len() + 2 {
+            assert_eq!(
+                collect_lines(bytes, capacity).unwrap(),
+                lines_from_std(bytes)
+            );
+        }
+    }
+
+    #[test]
+    fn no_trailing_new_line() {
+        assert_eq!(
+            collect_lines(b"a\nb", 2).unwrap(),
+            vec![(0, String::from("a")), (1, String::from("b"))]
+        );
+    }
+
+    #[test]
+    fn invalid_utf8() {
+        match collect_lines(b"a\n\xFF\n", 8) {
+            Err(ReadError::ReadingError(e)) => {
+                assert_eq!(e.kind(), std::io::ErrorKind::InvalidData)
+            }
+            e => panic!("{:?}", e),
+        }
+    }
+
+    #[test]
+    fn stops_on_error() {
+        let mut reader = std::io::BufReader::with_capacity(2, &b"a\nb\nc\n"[..]);
+        let mut count = 0;
+        let result = for_each_line(&mut reader, |i, _| {
+            count += 1;
+            match i {
+                1 => Err(ReadError::NoData),
+                _ => Ok(ControlFlow::Continue(())),
+            }
+        });
+        match result {
+            Err(ReadError::NoData) => assert_eq!(count, 2),
+            e => panic!("{:?}", e),
+        }
+    }
+
+    #[test]
+    fn stops_on_break() {
+        let bytes = b"a\nb\nc\n";
+        let mut reader = std::io::BufReader::with_capacity(2, &bytes[..]);
+        let mut count = 0;
+        let result = for_each_line(&mut reader, |i, _| {
+            count += 1;
+            match i {
+                1 => Ok(ControlFlow::Break(())),
+                _ => Ok(ControlFlow::Continue(())),
+            }
+        });
+        assert!(result.is_ok());
+        assert_eq!(count, 2);
+        // Only the lines up to the break are consumed
+        let mut rest = String::new();
+        reader.read_to_string(&mut rest).unwrap();
+        assert_eq!(rest, "c\n");
+    }
+}
+
+#[cfg(test)]
+mod test_line_cursor {
+    use super::*;
+
+    fn collect_lines(bytes: &[u8]) -> Vec<&[u8]> {
+        let mut cursor = LineCursor::new(bytes);
+        let mut lines = vec![];
+        while let Some(line) = cursor.next_line() {
+            lines.push(line);
+        }
+        lines
+    }
+
+    #[test]
+    fn empty() {
+        assert!(collect_lines(b"").is_empty());
+    }
+
+    #[test]
+    fn keeps_line_endings() {
+        assert_eq!(
+            collect_lines(b"a\r\n\nb"),
+            vec![&b"a\r\n"[..], &b"\n"[..], &b"b"[..]]
+        );
+    }
+
+    #[test]
+    fn end_line() {
+        assert!(is_end_line(b"END"));
+        assert!(is_end_line(b"END\n"));
+        assert!(is_end_line(b"END\r\n"));
+        assert!(!is_end_line(b"END \n"));
+        assert!(!is_end_line(b" END"));
+        assert!(!is_end_line(b"END\n\r"));
+    }
+}
+
+#[cfg(test)]
+mod test_from_slice_parallel {
+    use super::*;
+
+    fn record_text(arrays: usize, samples: usize) -> String {
+        let mut text = String::from("CITIFILE A.01.00\nNAME DATA\n");
+        text.push_str(&format!("VAR FREQ MAG {}\n", samples));
+        for k in 0..arrays {
+            text.push_str(&format!("DATA S[{}] RI\n", k));
+        }
+        text.push_str("VAR_LIST_BEGIN\n");
+        for i in 0..samples {
+            text.push_str(&format!("{}\n", 1000000 + i));
+        }
+        text.push_str("VAR_LIST_END\n");
+        for k in 0..arrays {
+            text.push_str("BEGIN\n");
+            for i in 0..samples {
+                text.push_str(&format!("{}E-1,-{}.5\n", k, i));
+            }
+            text.push_str("END\n");
+        }
+        text
+    }
+
+    fn assert_same_as_sequential(text: &str) {
+        assert_bytes_same_as_sequential(text.as_bytes());
+    }
+
+    fn assert_bytes_same_as_sequential(bytes: &[u8]) {
+        let sequential = format!("{:?}", Record::from_reader(&mut &bytes[..]));
+        for &threads in &[0, 1, 2, 3, 16] {
+            let parallel = Record::from_slice_parallel(bytes, threads);
+            assert_eq!(format!("{:?}", parallel), sequential, "{} threads", threads);
+        }
+    }
+
+    #[test]
+    fn many_arrays() {
+        let text = record_text(16, 50);
+        assert_same_as_sequential(&text);
+        assert_eq!(
+            Record::from_slice_parallel(text.as_bytes(), 4)
+                .unwrap()
+                .data
+                .len(),
+            16
+        );
+    }
+
+    #[test]
+    fn crlf_and_blank_lines() {
+        let text = record_text(3, 5).replace('\n', "\r\n\n");
+        assert_same_as_sequential(&text);
+    }
+
+    #[test]
+    fn bad_line_in_block() {
+        let text = record_text(4, 6).replacen("2E-1,-3.5", "2E-1;-3.5", 1);
+        assert_same_as_sequential(&text);
+    }
+
+    #[test]
+    fn first_block_error_is_reported() {
+        let text = record_text(4, 6)
+            .replacen("1E-1,-3.5", "1E-1,-3.5e", 1)
+            .replacen("3E-1,-2.5", "bad", 1);
+        assert_same_as_sequential(&text);
+    }
+
+    #[test]
+    fn block_error_before_header_error() {
+        let text = record_text(2, 3).replacen("0E-1,-1.5", "oops", 1) + "NAME AGAIN\n";
+        assert_same_as_sequential(&text);
+    }
+
+    #[test]
+    fn header_error_before_block_error() {
+        let text = record_text(2, 3).replacen("NAME DATA\n", "NAME DATA\nNAME AGAIN\n", 1);
+        assert_same_as_sequential(&(text + "BEGIN\noops\nEND\n"));
+    }
+
+    #[test]
+    fn keyword_in_block() {
+        let text = record_text(2, 3).replacen("0E-1,-1.5", "!comment", 1);
+        assert_same_as_sequential(&text);
+    }
+
+    #[test]
+    fn too_many_samples() {
+        let text = record_text(2, 3).replacen("1E-1,-1.5\n", "1E-1,-1.5\n1,1\n", 1);
+        assert_same_as_sequential(&text);
+    }
+
+    #[test]
+    fn too_many_blocks() {
+        let text = record_text(2, 3) + "BEGIN\n1,1\nEND\n";
+        assert_same_as_sequential(&text);
+    }
+
+    #[test]
+    fn unterminated_block() {
+        let text = record_text(2, 3);
+        assert_same_as_sequential(text.trim_end_matches("END\n"));
+    }
+
+    #[test]
+    fn invalid_utf8_in_block() {
+        let bytes: Vec<u8> = record_text(2, 3)
+            .replacen("1E-1,-1.5", "1E-1,-1.X", 1)
+            .bytes()
+            .map(|b| if b == b'X' { 0xFF } else { b })
+            .collect();
+        assert_bytes_same_as_sequential(&bytes);
+    }
+}
+
+#[cfg(test)]
+mod test_read_options {
+    use super::*;
+
+    fn record_text(blocks: &[&str]) -> String {
+        let mut text = String::from(
+            "CITIFILE A.01.00\nNAME CAL_SET\nVAR FREQ MAG 2\nVAR_LIST_BEGIN\n10\n20\nVAR_LIST_END\n",
+        );
+        for i in 0..blocks.len() {
+            text.push_str(&format!("DATA E[{}] RI\n", i));
+        }
+        for block in blocks {
+            text.push_str("BEGIN\n");
+            text.push_str(block);
+            text.push_str("END\n");
+        }
+        text
+    }
+
+    fn read(text: &str, options: &ReadOptions) -> Result<Record> {
+        Record::from_reader_with_options(&mut text.as_bytes(), options)
+    }
+
+    fn select(names: &[&str]) -> ReadOptions {
+        ReadOptions {
+            data_arrays: Some(names.iter().map(|name| String::from(*name)).collect()),
+            ..ReadOptions::default()
+        }
+    }
+
+    #[test]
+    fn default_is_from_reader() {
+        let text = record_text(&["1,2\n3,4\n", "5,6\n7,8\n"]);
+        assert_eq!(
+            read(&text, &ReadOptions::default()).unwrap(),
+            Record::from_reader(&mut text.as_bytes()).unwrap()
+        );
+    }
+
+    #[test]
+    fn header_only_stops_at_begin() {
+        // Invalid UTF-8 after the `BEGIN` would fail any further read
+        let bytes = [record_text(&["1,2\n3,4\n"]).as_bytes(), b"\xFF\n"].concat();
+        let options = ReadOptions {
+            header_only: true,
+            ..ReadOptions::default()
+        };
+        let record = Record::from_reader_with_options(&mut &bytes[..], &options).unwrap();
+        assert_eq!(record.header.name, "CAL_SET");
+        assert_eq!(record.data, vec![DataArray::new("E[0]", "RI")]);
+        assert!(Record::from_reader(&mut &bytes[..]).is_err());
+    }
+
+    #[test]
+    fn header_only_keeps_selected_arrays() {
+        let text = record_text(&["1,2\n3,4\n", "5,6\n7,8\n"]);
+        let options = ReadOptions {
+            header_only: true,
+            ..select(&["E[1]"])
+        };
+        assert_eq!(
+            read(&text, &options).unwrap().data,
+            vec![DataArray::new("E[1]", "RI")]
+        );
+    }
+
+    #[test]
+    fn header_only_still_validates_header() {
+        let options = ReadOptions {
+            header_only: true,
+            ..ReadOptions::default()
+        };
+        match read(
+            "CITIFILE A.01.00\nVAR FREQ MAG 2\nDATA S RI\nBEGIN\n",
+            &options,
+        ) {
+            Err(Error::ReadError(ReadError::NoName)) => (),
+            e => panic!("{:?}", e),
+        }
+    }
+
+    #[test]
+    fn selected_array() {
+        let text = record_text(&["1,2\n3,4\n", "5,6\n7,8\n", "9,10\n11,12\n"]);
+        let full = Record::from_reader(&mut text.as_bytes()).unwrap();
+        let record = read(&text, &select(&["E[1]"])).unwrap();
+        assert_eq!(record.header, full.header);
+        assert_eq!(record.data, vec![full.data[1].clone()]);
+    }
+
+    #[test]
+    fn skipped_blocks_are_not_parsed() {
+        let text = record_text(&["not a data pair\n", "5,6\n7,8\n", "\r\n1,2,3,4\n"]);
+        let record = read(&text, &select(&["E[1]"])).unwrap();
+        assert_eq!(record.data.len(), 1);
+        assert_eq!(
+            record.data[0].samples,
+            vec![Complex::new(5., 6.), Complex::new(7., 8.)]
+        );
+    }
+
+    #[test]
+    fn selected_arrays_are_validated() {
+        let text = record_text(&["1,2\n3,4\n", "5,6\n"]);
+        assert!(read(&text, &select(&["E[0]"])).is_ok());
+        match read(&text, &select(&["E[1]"])) {
+            Err(Error::ReadError(ReadError::VarAndDataDifferentLengths(2, 1, 1))) => (),
+            e => panic!("{:?}", e),
+        }
+    }
+
+    #[test]
+    fn nothing_selected() {
+        let text = record_text(&["1,2\n3,4\n"]);
+        match read(&text, &select(&["S[2,1]"])) {
+            Err(Error::ReadError(ReadError::NoData)) => (),
+            e => panic!("{:?}", e),
+        }
+    }
+
+    #[test]
+    fn block_without_data_is_an_error() {
+        let text = record_text(&["1,2\n3,4\n"]) + "BEGIN\n5,6\nEND\n";
+        match read(&text, &select(&["E[0]"])) {
+            Err(Error::ReadError(ReadError::DataArrayOverIndex)) => (),
+            e => panic!("{:?}", e),
+        }
+    }
+}
+
+/// Where the parts of a record file start and end
+///
+/// An index is built by [`IndexedRecord::open`] while the file is scanned
+/// once. It can be saved next to the file with [`BlockIndex::to_writer`] and
+/// handed to [`IndexedRecord::open_with_index`] to skip that scan the next
+/// time. An index is only used while the size and modification time of the
+/// file still match the ones recorded in it.
+#[derive(Debug, PartialEq, Clone)]
+pub struct BlockIndex {
+    /// Size of the file in bytes
+    pub length: u64,
+    /// Modification time of the file, where the platform records one
+    pub modified: Option<SystemTime>,
+    /// Offset of the first `BEGIN` line, or the length of a file without one
+    pub header_end: u64,
+    /// `BEGIN`…`END` blocks in the order of the data arrays
+    pub blocks: Vec<Block>,
+}
+
+/// Location of a `BEGIN`…`END` block in a record file
+#[derive(Debug, PartialEq, Clone, Copy)]
+pub struct Block {
+    /// Offset of the `BEGIN` line
+    pub begin: u64,
+    /// Offset just past the `END` line
+    pub end: u64,
+    /// Index of the `BEGIN` line
+    pub first_line: usize,
+    /// Index of the line after `END`
+    pub next_line: usize,
+}
+
+/// First line of a saved [`BlockIndex`]
+const BLOCK_INDEX_MAGIC: &str = "CITI_BLOCK_INDEX 1";
+
+impl BlockIndex {
+    /// Size and modification time of `file`
+    fn stamp(file: &File) -> ReaderResult<(u64, Option<SystemTime>)> {
+        let metadata = file.metadata().map_err(ReadError::ReadingError)?;
+        Ok((metadata.len(), metadata.modified().ok()))
+    }
+
+    /// Whether the index still matches `file`
+    pub fn matches(&self, file: &File) -> Result<bool> {
+        Ok(BlockIndex::stamp(file)? == (self.length, self.modified))
+    }
+
+    fn check(&self, file: &File) -> ReaderResult<()> {
+        match BlockIndex::stamp(file)? == (self.length, self.modified) {
+            true => Ok(()),
+            false => Err(ReadError::StaleIndex),
+        }
+    }
+
+    /// Save the index
+    ///
+    /// The index is written as lines of text, with one `BLOCK` line giving
+    /// the offsets and lines of each block:
+    /// ```no_test
+    /// CITI_BLOCK_INDEX 1
+    /// LENGTH 4096
+    /// MODIFIED 1700000000.123456789
+    /// HEADER_END 312
+    /// BLOCK 312 2048 12 75
+    /// ```
+    /// A modification time that is not recorded, or is before the Unix epoch,
+    /// is written as `MODIFIED -`. Such an index never matches a file that
+    /// has a modification time.
+    pub fn to_writer<W: std::io::Write>(&self, writer: &mut W) -> Result<()> {
+        let modified = self
+            .modified
+            .and_then(|modified| modified.duration_since(SystemTime::UNIX_EPOCH).ok());
+
+        let mut text = vec![];
+        writeln!(text, "{}", BLOCK_INDEX_MAGIC).unwrap();
+        writeln!(text, "LENGTH {}", self.length).unwrap();
+        match modified {
+            Some(time) => writeln!(
+                text,
+                "MODIFIED {}.{:09}",
+                time.as_secs(),
+                time.subsec_nanos()
+            )
+            .unwrap(),
+            None => writeln!(text, "MODIFIED -").unwrap(),
+        }
+        writeln!(text, "HEADER_END {}", self.header_end).unwrap();
+        for block in &self.blocks {
+            writeln!(
+                text,
+                "BLOCK {} {} {} {}",
+                block.begin, block.end, block.first_line, block.next_line
+            )
+            .unwrap();
+        }
+
+        writer.write_all(&text).map_err(WriteError::WrittingError)?;
+        Ok(())
+    }
+
+    /// Load an index saved by [`BlockIndex::to_writer`]
+    pub fn from_reader<R: std::io::Read>(reader: &mut R) -> Result<BlockIndex> {
+        let mut text = String::new();
+        reader
+            .read_to_string(&mut text)
+            .map_err(ReadError::ReadingError)?;
+
+        let index = parse_block_index(&text).ok_or_else(|| {
+            ReadError::ReadingError(std::io::Error::new(
+                std::io::ErrorKind::InvalidData,
+                "invalid block index",
+            ))
+        })?;
+        Ok(index)
+    }
+}
+
+/// `None` for anything [`BlockIndex::to_writer`] does not write
+fn parse_block_index(text: &str) -> Option<BlockIndex> {
+    let mut lines = text.lines();
+    if lines.next()? != BLOCK_INDEX_MAGIC {
+        return None;
+    }
+
+    let length = lines.next()?.strip_prefix("LENGTH ")?.parse().ok()?;
+    let modified = match lines.next()?.strip_prefix("MODIFIED ")? {
+        "-" => None,
+        time => {
+            let (seconds, nanoseconds) = time.split_once('.')?;
+            if nanoseconds.len() != 9 || !nanoseconds.bytes().all(|b| b.is_ascii_digit()) {
+                return None;
+            }
+            let since_epoch = Duration::new(seconds.parse().ok()?, nanoseconds.parse().ok()?);
+            Some(SystemTime::UNIX_EPOCH.checked_add(since_epoch)?)
+        }
+    };
+    let header_end = lines.next()?.strip_prefix("HEADER_END ")?.parse().ok()?;
+
+    let blocks = lines
+        .map(|line| {
+            let mut fields = line.strip_prefix("BLOCK ")?.split(' ');
+            let block = Block {
+                begin: fields.next()?.parse().ok()?,
+                end: fields.next()?.parse().ok()?,
+                first_line: fields.next()?.parse().ok()?,
+                next_line: fields.next()?.parse().ok()?,
+            };
+            match fields.next() {
+                Some(_) => None,
+                None => Some(block),
+            }
+        })
+        .collect::<Option<Vec<Block>>>()?;
+
+    Some(BlockIndex {
+        length,
+        modified,
+        header_end,
+        blocks,
+    })
+}
+
+/// Record file whose data arrays are read on demand
+///
+/// Opening the file reads the header and locates every `BEGIN`…`END` block
+/// without parsing its data pairs (see [`BlockIndex`]). A data array is then
+/// read by seeking to its block, so any array can be reached without parsing
+/// the ones before it.
+///
+/// The file must not be modified while it is open. A change in its size or
+/// modification time is reported as [`ReadError::StaleIndex`].
+///
+/// Example usage:
+/// ```no_run
+/// use citi::IndexedRecord;
+/// use std::fs::File;
+///
+/// let mut record = IndexedRecord::open("file.cti").unwrap();
+/// let data_array = record.read_data_array(1).unwrap();
+///
+/// // Keep the index to skip scanning the file next time
+/// let mut sidecar = File::create("file.cti.index").unwrap();
+/// record.index().to_writer(&mut sidecar).unwrap();
+/// ```
+#[derive(Debug)]
+pub struct IndexedRecord {
+    file: File,
+    index: BlockIndex,
+    /// Everything but the samples
+    record: Record,
+}
+
+impl IndexedRecord {
+    /// Open a record file, building its index
+    pub fn open<P: AsRef<Path>>(path: P) -> Result<IndexedRecord> {
+        let file = File::open(path).map_err(ReadError::ReadingError)?;
+        IndexedRecord::from_file(file)
+    }
+
+    /// Open a record file with an index built for it before
+    ///
+    /// Only the lines outside of the indexed blocks are read. This fails with
+    /// [`ReadError::StaleIndex`] when the file no longer matches the index.
+    ///
+    /// Example usage:
+    /// ```no_run
+    /// use citi::{BlockIndex, IndexedRecord};
+    /// use std::fs::File;
+    ///
+    /// let mut sidecar = File::open("file.cti.index").unwrap();
+    /// let index = BlockIndex::from_reader(&mut sidecar).unwrap();
+    /// let record = IndexedRecord::open_with_index("file.cti", index);
+    /// ```
+    pub fn open_with_index<P: AsRef<Path>>(path: P, index: BlockIndex) -> Result<IndexedRecord> {
+        let file = File::open(path).map_err(ReadError::ReadingError)?;
+        IndexedRecord::from_file_with_index(file, index)
+    }
+
+    /// See [`IndexedRecord::open`]
+    ///
+    /// The file is memory mapped for the scan when possible and read into
+    /// memory otherwise.
+    pub fn from_file(mut file: File) -> Result<IndexedRecord> {
+        let (length, modified) = BlockIndex::stamp(&file)?;
+
+        let map = map_file(&file);
+        let mut buffer = vec![];
+        let bytes: &[u8] = match &map {
+            Some(map) => map,
+            None => {
+                file.read_to_end(&mut buffer)
+                    .map_err(ReadError::ReadingError)?;
+                &buffer
+            }
+        };
+
+        let SplitRecord {
+            state,
+            locations,
+            header_error,
+            ..
+        } = split_blocks(bytes, false)?;
+        if let Some(e) = header_error {
+            return Err(e.into());
+        }
+
+        let index = BlockIndex {
+            length,
+            modified,
+            header_end: locations.first().map_or(length, |block| block.begin),
+            blocks: locations,
+        };
+        Ok(IndexedRecord {
+            file,
+            index,
+            record: state.validate_header()?.record,
+        })
+    }
+
+    /// See [`IndexedRecord::open_with_index`]
+    pub fn from_file_with_index(mut file: File, index: BlockIndex) -> Result<IndexedRecord> {
+        index.check(&file)?;
+        let state = read_outside_blocks(&mut file, &index)?;
+        Ok(IndexedRecord {
+            file,
+            index,
+            record: state.validate_header()?.record,
+        })
+    }
+
+    pub fn header(&self) -> &Header {
+        &self.record.header
+    }
+
+    /// Names and formats of the data arrays, without their samples
+    pub fn data_arrays(&self) -> &[DataArray] {
+        &self.record.data
+    }
+
+    pub fn index(&self) -> &BlockIndex {
+        &self.index
+    }
+
+    /// Read the data array at `i` from its block
+    ///
+    /// Only that block is read and parsed. It is checked against the
+    /// independent variable the same way as [`Record::from_reader`] checks
+    /// every array, except that arrays are not compared with each other when
+    /// the independent variable has no values.
+    pub fn read_data_array(&mut self, i: usize) -> Result<DataArray> {
+        let declared = self
+            .record
+            .data
+            .get(i)
+            .ok_or(ReadError::DataArrayOverIndex)?;
+        let mut data_array = DataArray::new(&declared.name, &declared.format);
+        let known_length = self.record.header.independent_variable.len();
+
+        if let Some(location) = self.index.blocks.get(i) {
+            self.index.check(&self.file)?;
+            let mut bytes = vec![];
+            read_range(&mut self.file, location.begin, location.end, &mut bytes)?;
+
+            let mut cursor = LineCursor::new(&bytes);
+            let begin = cursor.next_line().unwrap_or_default();
+            if line_to_str(begin).ok() != Some("BEGIN") {
+                return Err(ReadError::StaleIndex.into());
+            }
+
+            let start = cursor.position;
+            let mut block = DataBlock {
+                lines: &bytes[start..],
+                first_line: location.first_line + 1,
+                array: i,
+                known_length,
+            };
+            while let Some(this_line) = cursor.next_line() {
+                if is_end_line(this_line) {
+                    block.lines = &bytes[start..cursor.position - this_line.len()];
+                    break;
+                }
+            }
+
+            data_array.samples.reserve_exact(known_length);
+            block.parse(Some(&mut data_array))?;
+        }
+
+        let length = data_array.samples.len();
+        if known_length != 0 && length != known_length {
+            return Err(ReadError::VarAndDataDifferentLengths(known_length, length, i).into());
+        }
+        Ok(data_array)
+    }
+}
+
+/// Read `begin..end` of `file` into `bytes`
+fn read_range(file: &mut File, begin: u64, end: u64, bytes: &mut Vec<u8>) -> ReaderResult<()> {
+    let length = end.checked_sub(begin).ok_or(ReadError::StaleIndex)?;
+    file.seek(SeekFrom::Start(begin))
+        .map_err(ReadError::ReadingError)?;
+    bytes.clear();
+    file.take(length)
+        .read_to_end(bytes)
+        .map_err(ReadError::ReadingError)?;
+
+    match bytes.len() as u64 == length {
+        true => Ok(()),
+        false => Err(ReadError::StaleIndex),
+    }
+}
+
+/// Read every line of an indexed file that is not in one of its blocks
+///
+/// The blocks themselves are only entered and left, see
+/// [`RecordReaderState::skip_block`].
+fn read_outside_blocks(file: &mut File, index: &BlockIndex) -> ReaderResult<RecordReaderState> {
+    let mut state = RecordReaderState::new();
+    let mut bytes = vec![];
+    let mut begin = 0;
+    let mut i = 0;
+
+    let blocks = index.blocks.iter().map(Some);
+    for location in blocks.chain(std::iter::once(None)) {
+        let end = location.map_or(index.length, |location| location.begin);
+        read_range(file, begin, end, &mut bytes)?;
+
+        let mut cursor = LineCursor::new(&bytes);
+        while let Some(this_line) = cursor.next_line() {
+            let this_line = line_to_str(this_line)?;
+            // Filter out new lines
+            if !this_line.trim().is_empty() {
+                let keyword =
+                    KeywordRef::try_from(this_line).map_err(|e| ReadError::LineError(i, e))?;
+                state.process(keyword)?;
+            }
+            i += 1;
+        }
+
+        if let Some(location) = location {
+            if state.state != RecordReaderStates::Header {
+                return Err(ReadError::StaleIndex);
+            }
+            state.skip_block();
+            state.process(KeywordRef::End)?;
+            begin = location.end;
+            i = location.next_line;
+        }
+    }
+
+    Ok(state)
+}
+
+#[cfg(test)]
+mod test_indexed_record {
+    use super::*;
+    use std::path::PathBuf;
+    use tempfile::TempDir;
+
+    const RECORD: &str = "CITIFILE A.01.00\nNAME CAL_SET\nVAR FREQ MAG 2\nDATA E[0] RI\nDATA E[1] RI\nVAR_LIST_BEGIN\n10\n20\nVAR_LIST_END\nBEGIN\n1,2\n3,4\nEND\nBEGIN\n5,6\n7,8\nEND\n";
+
+    fn write_file(directory: &TempDir, text: &str) -> PathBuf {
+        let path = directory.path().join("record.cti");
+        std::fs::write(&path, text).unwrap();
+        path
+    }
+
+    fn read_all(record: &mut IndexedRecord) -> Result<Vec<DataArray>> {
+        (0..record.data_arrays().len())
+            .map(|i| record.read_data_array(i))
+            .collect()
+    }
+
+    fn saved(index: &BlockIndex) -> BlockIndex {
+        let mut text = vec![];
+        index.to_writer(&mut text).unwrap();
+        BlockIndex::from_reader(&mut &text[..]).unwrap()
+    }
+
+    #[test]
+    fn same_as_from_reader() {
+        let directory = tempfile::tempdir().unwrap();
+        let path = write_file(&directory, RECORD);
+        let full = Record::from_reader(&mut RECORD.as_bytes()).unwrap();
+
+        let mut record = IndexedRecord::open(&path).unwrap();
+        assert_eq!(record.header(), &full.header);
+        assert_eq!(read_all(&mut record).unwrap(), full.data);
+    }
+
+    #[test]
+    fn arrays_have_no_samples() {
+        let directory = tempfile::tempdir().unwrap();
+        let path = write_file(&directory, RECORD);
+
+        let record = IndexedRecord::open(&path).unwrap();
+        assert_eq!(
+            record.data_arrays(),
+            &[DataArray::new("E[0]", "RI"), DataArray::new("E[1]", "RI")]
+        );
+    }
+
+    #[test]
+    fn any_order() {
+        let directory = tempfile::tempdir().unwrap();
+        let path = write_file(&directory, RECORD);
+        let full = Record::from_reader(&mut RECORD.as_bytes()).unwrap();
+
+        let mut record = IndexedRecord::open(&path).unwrap();
+        assert_eq!(record.read_data_array(1).unwrap(), full.data[1]);
+        assert_eq!(record.read_data_array(0).unwrap(), full.data[0]);
+        assert_eq!(record.read_data_array(1).unwrap(), full.data[1]);
+    }
+
+    #[test]
+    fn offsets() {
+        let directory = tempfile::tempdir().unwrap();
+        let path = write_file(&directory, RECORD);
+
+        let record = IndexedRecord::open(&path).unwrap();
+        let index = record.index();
+        let first = RECORD.find("\nBEGIN").unwrap() as u64 + 1;
+        let second = RECORD.rfind("\nBEGIN").unwrap() as u64 + 1;
+        assert_eq!(index.length, RECORD.len() as u64);
+        assert_eq!(index.header_end, first);
+        assert_eq!(
+            index.blocks,
+            vec![
+                Block {
+                    begin: first,
+                    end: second,
+                    first_line: 9,
+                    next_line: 13,
+                },
+                Block {
+                    begin: second,
+                    end: RECORD.len() as u64,
+                    first_line: 13,
+                    next_line: 17,
+                },
+            ]
+        );
+    }
+
+    #[test]
+    fn crlf() {
+        let text = RECORD.replace('\n', "\r\n");
+        let directory = tempfile::tempdir().unwrap();
+        let path = write_file(&directory, &text);
+        let full = Record::from_reader(&mut RECORD.as_bytes()).unwrap();
+
+        let mut record = IndexedRecord::open(&path).unwrap();
+        assert_eq!(read_all(&mut record).unwrap(), full.data);
+
+        let mut record = IndexedRecord::open_with_index(&path, saved(record.index())).unwrap();
+        assert_eq!(record.header(), &full.header);
+        assert_eq!(read_all(&mut record).unwrap(), full.data);
+    }
+
+    #[test]
+    fn saved_index() {
+        let directory = tempfile::tempdir().unwrap();
+        let path = write_file(&directory, RECORD);
+
+        let index = IndexedRecord::open(&path).unwrap().index().clone();
+        assert_eq!(saved(&index), index);
+    }
+
+    #[test]
+    fn open_with_index() {
+        // The independent variable after the blocks is only found outside of them
+        let text = RECORD.replace("VAR_LIST_BEGIN\n10\n20\nVAR_LIST_END\n", "")
+            + "VAR_LIST_BEGIN\n10\n20\nVAR_LIST_END\n";
+        let directory = tempfile::tempdir().unwrap();
+        let path = write_file(&directory, &text);
+        let full = Record::from_reader(&mut text.as_bytes()).unwrap();
+
+        let index = saved(IndexedRecord::open(&path).unwrap().index());
+        let mut record = IndexedRecord::open_with_index(&path, index).unwrap();
+        assert_eq!(record.header(), &full.header);
+        assert_eq!(read_all(&mut record).unwrap(), full.data);
+    }
+
+    #[test]
+    fn changed_file_is_stale() {
+        let directory = tempfile::tempdir().unwrap();
+        let path = write_file(&directory, RECORD);
+        let mut record = IndexedRecord::open(&path).unwrap();
+        let index = record.index().clone();
+
+        write_file(&directory, &(String::from(RECORD) + "!COMMENT\n"));
+        assert!(!index.matches(&File::open(&path).unwrap()).unwrap());
+        assert!(matches!(
+            record.read_data_array(0),
+            Err(Error::ReadError(ReadError::StaleIndex))
+        ));
+        assert!(matches!(
+            IndexedRecord::open_with_index(&path, index),
+            Err(Error::ReadError(ReadError::StaleIndex))
+        ));
+    }
+
+    #[test]
+    fn over_index() {
+        let directory = tempfile::tempdir().unwrap();
+        let path = write_file(&directory, RECORD);
+
+        let mut record = IndexedRecord::open(&path).unwrap();
+        assert!(matches!(
+            record.read_data_array(2),
+            Err(Error::ReadError(ReadError::DataArrayOverIndex))
+        ));
+    }
+
+    #[test]
+    fn block_errors_match_from_reader() {
+        let text = RECORD.replace("7,8\n", "7,8\n9,10\n");
+        let directory = tempfile::tempdir().unwrap();
+        let path = write_file(&directory, &text);
+
+        let mut record = IndexedRecord::open(&path).unwrap();
+        assert!(record.read_data_array(0).is_ok());
+        assert!(matches!(
+            record.read_data_array(1),
+            Err(Error::ReadError(ReadError::DataArrayLongerThanVar(2, 1)))
+        ));
+
+        let text = RECORD.replace("7,8\n", "7;8\n");
+        let path = write_file(&directory, &text);
+        let mut record = IndexedRecord::open(&path).unwrap();
+        assert!(matches!(
+            record.read_data_array(1),
+            Err(Error::ReadError(ReadError::LineError(15, _)))
+        ));
+        assert!(matches!(
+            Record::from_reader(&mut text.as_bytes()),
+            Err(Error::ReadError(ReadError::LineError(15, _)))
+        ));
+    }
+
+    #[test]
+    fn header_is_validated() {
+        let directory = tempfile::tempdir().unwrap();
+        let path = write_file(&directory, &RECORD.replace("NAME CAL_SET\n", ""));
+
+        assert!(matches!(
+            IndexedRecord::open(&path),
+            Err(Error::ReadError(ReadError::NoName))
+        ));
+    }
+
+    #[test]
+    fn invalid_saved_index() {
+        for text in &[
+            "",
+            "CITI_BLOCK_INDEX 2\n",
+            "CITI_BLOCK_INDEX 1\nLENGTH 10\nMODIFIED -\n",
+            "CITI_BLOCK_INDEX 1\nLENGTH 10\nMODIFIED -\nHEADER_END 0\nBLOCK 0 10 0\n",
+            "CITI_BLOCK_INDEX 1\nLENGTH 10\nMODIFIED 18446744073709551615.1000000000\nHEADER_END 0\n",
+            "CITI_BLOCK_INDEX 1\nLENGTH 10\nMODIFIED 18446744073709551615.999999999\nHEADER_END 0\n",
+            "CITI_BLOCK_INDEX 1\nLENGTH 10\nMODIFIED 1700000000.5\nHEADER_END 0\n",
+            "CITI_BLOCK_INDEX 1\nLENGTH 10\nMODIFIED 1700000000.+12345678\nHEADER_END 0\n",
+        ] {
+            assert!(matches!(
+                BlockIndex::from_reader(&mut text.as_bytes()),
+                Err(Error::ReadError(ReadError::ReadingError(_)))
+            ));
+        }
+    }
+}
+
+/// Replace the binary copy kept by [`Record::from_path_cached`]
+fn write_cache(record: &Record, source: binary::Source, cache_path: &Path) -> std::io::Result<()> {
+    // Unique within the process too, for threads caching the same file
+    static WRITES: AtomicUsize = AtomicUsize::new(0);
+    let mut temporary = cache_path.as_os_str().to_owned();
+    temporary.push(format!(
+        ".{}.{}.tmp",
+        std::process::id(),
+        WRITES.fetch_add(1, Ordering::Relaxed)
+    ));
+
+    let result = std::fs::write(&temporary, binary::encode(record, Some(source)))
+        .and_then(|_| std::fs::rename(&temporary, cache_path));
+    if result.is_err() {
+        let _ = std::fs::remove_file(&temporary);
+    }
+    result
+}
+
+/// Record borrowed from its binary encoding
+///
+/// The floats are used in place, so only the header is copied out of the
+/// encoding. This needs a little-endian target and an encoding that is
+/// aligned to 8 bytes, which a memory map always is.
+///
+/// Example usage:
+/// ```no_run
+/// use citi::RecordView;
+/// use std::fs::File;
+///
+/// let file = File::open("file.cti.bin").unwrap();
+/// let map = unsafe { memmap2::Mmap::map(&file) }.unwrap();
+/// let view = RecordView::from_binary_slice(&map).unwrap();
+/// let samples = view.data[0].samples;
+/// ```
+#[derive(Debug, PartialEq, Clone)]
+pub struct RecordView<'a> {
+    /// Header, with the values of the independent variable left out
+    pub header: Header,
+    pub independent_variable: &'a [f64],
+    pub data: Vec<DataArrayView<'a>>,
+}
+
+/// Data array borrowed by a [`RecordView`]
+#[derive(Debug, PartialEq, Clone, Copy)]
+pub struct DataArrayView<'a> {
+    pub name: &'a str,
+    pub format: &'a str,
+    pub samples: &'a [Complex<f64>],
+}
+
+impl<'a> RecordView<'a> {
+    /// Borrow a record written by [`Record::to_binary_writer`]
+    ///
+    /// The checksum is verified before anything is borrowed.
+    pub fn from_binary_slice(bytes: &'a [u8]) -> Result<RecordView<'a>> {
+        let unaligned = ReadError::InvalidBinary("floats cannot be borrowed in place");
+        let decoded = binary::decode(bytes).map_err(ReadError::InvalidBinary)?;
+
+        let independent_variable = match binary::borrow_f64s(decoded.independent_variable) {
+            Some(values) => values,
+            None => return Err(unaligned.into()),
+        };
+        let mut data = Vec::with_capacity(decoded.data.len());
+        for &(name, format, samples) in &decoded.data {
+            match binary::borrow_complex(samples) {
+                Some(samples) => data.push(DataArrayView {
+                    name,
+                    format,
+                    samples,
+                }),
+                None => return Err(unaligned.into()),
+            }
+        }
+
+        Ok(RecordView {
+            header: decoded.header,
+            independent_variable,
+            data,
+        })
+    }
+
+    /// Copy the view into a [`Record`]
+    pub fn to_record(&self) -> Record {
+        let mut header = self.header.clone();
+        header.independent_variable.data = self.independent_variable.to_vec();
+        Record {
+            header,
+            data: self
+                .data
+                .iter()
+                .map(|data_array| DataArray {
+                    samples: data_array.samples.to_vec(),
+                    ..DataArray::new(data_array.name, data_array.format)
+                })
+                .collect(),
+        }
+    }
+}
+
+#[cfg(test)]
+mod test_binary_record {
+    use super::*;
+    use std::convert::TryInto;
+    use tempfile::TempDir;
+
+    const RECORD: &str = "CITIFILE A.01.00\nNAME CAL_SET\n#NA VERSION HP8510B.05.00\n!A comment\nVAR FREQ MAG 2\nDATA E[0] RI\nDATA E[1] RI\nVAR_LIST_BEGIN\n10\n20\nVAR_LIST_END\nBEGIN\n1,2\n3,4\nEND\nBEGIN\n5,6\n7,8\nEND\n";
+
+    fn record() -> Record {
+        Record::from_reader(&mut RECORD.as_bytes()).unwrap()
+    }
+
+    fn encoded(record: &Record) -> Vec<u8> {
+        let mut bytes = vec![];
+        record.to_binary_writer(&mut bytes).unwrap();
+        bytes
+    }
+
+    fn write_file(directory: &TempDir, text: &str) -> PathBuf {
+        let path = directory.path().join("record.cti");
+        std::fs::write(&path, text).unwrap();
+        path
+    }
+
+    /// 8 byte aligned copy of `bytes`
+    fn aligned(bytes: &[u8]) -> Vec<u64> {
+        bytes
+            .chunks_exact(8)
+            .map(|word| u64::from_ne_bytes(word.try_into().unwrap()))
+            .collect()
+    }
+
+    fn as_bytes(words: &[u64]) -> &[u8] {
+        unsafe { std::slice::from_raw_parts(words.as_ptr() as *const u8, words.len() * 8) }
+    }
+
+    #[test]
+    fn round_trip() {
+        let record = record();
+        assert_eq!(
+            Record::from_binary_reader(&mut &encoded(&record)[..]).unwrap(),
+            record
+        );
+    }
+
+    #[test]
+    fn unwritable_text_record() {
+        // No name, which `to_writer` rejects
+        let record = Record::default();
+        assert_eq!(
+            Record::from_binary_slice(&encoded(&record)).unwrap(),
+            record
+        );
+    }
+
+    #[test]
+    fn invalid() {
+        let mut bytes = encoded(&record());
+        let last = bytes.len() - 1;
+        bytes[last] ^= 1;
+        assert!(matches!(
+            Record::from_binary_slice(&bytes),
+            Err(Error::ReadError(ReadError::InvalidBinary(
+                "checksum mismatch"
+            )))
+        ));
+        assert!(matches!(
+            Record::from_binary_slice(RECORD.as_bytes()),
+            Err(Error::ReadError(ReadError::InvalidBinary(_)))
+        ));
+    }
+
+    #[test]
+    fn from_path_binary() {
+        let directory = tempfile::tempdir().unwrap();
+        let path = directory.path().join("record.bin");
+        std::fs::write(&path, encoded(&record())).unwrap();
+        assert_eq!(Record::from_path_binary(&path).unwrap(), record());
+    }
+
+    #[test]
+    fn view() {
+        let record = record();
+        let words = aligned(&encoded(&record));
+        let view = RecordView::from_binary_slice(as_bytes(&words)).unwrap();
+
+        assert_eq!(view.header.name, "CAL_SET");
+        assert!(view.header.independent_variable.data.is_empty());
+        assert_eq!(view.independent_variable, &[10., 20.]);
+        assert_eq!(view.data[1].name, "E[1]");
+        assert_eq!(view.data[1].samples, &record.data[1].samples[..]);
+        assert_eq!(view.to_record(), record);
+    }
+
+    #[test]
+    fn view_borrows() {
+        let words = aligned(&encoded(&record()));
+        let bytes = as_bytes(&words);
+        let view = RecordView::from_binary_slice(bytes).unwrap();
+
+        let samples = view.data[0].samples.as_ptr() as usize;
+        let start = bytes.as_ptr() as usize;
+        assert!(samples > start && samples < start + bytes.len());
+    }
+
+    #[test]
+    fn unaligned_view() {
+        let words = aligned(&[vec![0; 8], encoded(&record())].concat());
+        let bytes = &as_bytes(&words)[1..];
+        assert!(matches!(
+            RecordView::from_binary_slice(&bytes[..bytes.len() - 7]),
+            Err(Error::ReadError(ReadError::InvalidBinary(_)))
+        ));
+    }
+
+    #[test]
+    fn cache_path() {
+        assert_eq!(
+            Record::cache_path("dir/file.cti"),
+            PathBuf::from("dir/file.cti.bin")
+        );
+    }
+
+    #[test]
+    fn cached() {
+        let directory = tempfile::tempdir().unwrap();
+        let path = write_file(&directory, RECORD);
+
+        assert_eq!(Record::from_path_cached(&path).unwrap(), record());
+        let cache = std::fs::read(Record::cache_path(&path)).unwrap();
+        assert_eq!(Record::from_binary_slice(&cache).unwrap(), record());
+        assert_eq!(Record::from_path_cached(&path).unwrap(), record());
+    }
+
+    #[test]
+    fn cache_is_used() {
+        let directory = tempfile::tempdir().unwrap();
+        let path = write_file(&directory, RECORD);
+        Record::from_path_cached(&path).unwrap();
+
+        // A copy with a different record but the same source is trusted
+        let cache_path = Record::cache_path(&path);
+        let mut decoded_record =
+            Record::from_binary_slice(&std::fs::read(&cache_path).unwrap()).unwrap();
+        decoded_record.header.name = String::from("FROM_CACHE");
+        let source = BlockIndex::stamp(&File::open(&path).unwrap()).unwrap();
+        std::fs::write(&cache_path, binary::encode(&decoded_record, Some(source))).unwrap();
+
+        assert_eq!(
+            Record::from_path_cached(&path).unwrap().header.name,
+            "FROM_CACHE"
+        );
+    }
+
+    #[test]
+    fn stale_cache_is_replaced() {
+        let directory = tempfile::tempdir().unwrap();
+        let path = write_file(&directory, RECORD);
+        Record::from_path_cached(&path).unwrap();
+
+        let changed = RECORD.replace("CAL_SET", "CHANGED_SET");
+        write_file(&directory, &changed);
+        let expected = Record::from_reader(&mut changed.as_bytes()).unwrap();
+        assert_eq!(Record::from_path_cached(&path).unwrap(), expected);
+
+        let cache = std::fs::read(Record::cache_path(&path)).unwrap();
+        assert_eq!(Record::from_binary_slice(&cache).unwrap(), expected);
+    }
+
+    #[test]
+    fn corrupt_cache_is_replaced() {
+        let directory = tempfile::tempdir().unwrap();
+        let path = write_file(&directory, RECORD);
+        std::fs::write(Record::cache_path(&path), b"not a cache").unwrap();
+
+        assert_eq!(Record::from_path_cached(&path).unwrap(), record());
+        let cache = std::fs::read(Record::cache_path(&path)).unwrap();
+        assert_eq!(Record::from_binary_slice(&cache).unwrap(), record());
+    }
+
+    #[test]
+    fn cached_read_errors() {
+        let directory = tempfile::tempdir().unwrap();
+        let path = write_file(&directory, &RECORD.replace("NAME CAL_SET\n", ""));
+
+        assert!(matches!(
+            Record::from_path_cached(&path),
+            Err(Error::ReadError(ReadError::NoName))
+        ));
+        assert!(!Record::cache_path(&path).exists());
+    }
+}
+
+/// Push parser for a record that arrives in pieces
+///
+/// Bytes are handed over with [`RecordParser::feed`] in chunks of any size,
+/// such as whatever a socket returned, and every complete line is parsed
+/// straight away. A line split across chunks is held back until the rest of
+/// it arrives. Once the stream ends, [`RecordParser::finish`] parses any last
+/// line without a line ending and validates the record as
+/// [`Record::from_reader`] would.
+///
+/// Each data array is available from [`RecordParser::data_arrays`] as soon
+/// as its `END` has been parsed, while later arrays are still arriving.
+///
+/// A line longer than 1 MiB is rejected with
+/// [`ReadError::LineTooLong`], so a stream that never sends a line ending
+/// cannot grow the held back bytes without bound.
+///
+/// Example usage:
+/// ```
+/// use citi::RecordParser;
+///
+/// let mut parser = RecordParser::new();
+/// parser.feed(b"CITIFILE A.01.00\nNAME DATA\nVAR FREQ MAG 1\nDA").unwrap();
+/// parser.feed(b"TA S RI\nVAR_LIST_BEGIN\n10\nVAR_LIST_END\n").unwrap();
+/// parser.feed(b"BEGIN\n1E0,2E0\nEND\n").unwrap();
+/// assert_eq!(parser.data_arrays().len(), 1);
+///
+/// let record = parser.finish().unwrap();
+/// assert_eq!(record.data[0].name, "S");
+/// ```
+#[derive(Debug)]
+pub struct RecordParser {
+    state: RecordReaderState,
+    /// Start of a line whose end has not arrived yet
+    partial: Vec<u8>,
+    /// Index of the next line
+    line: usize,
+    failed: bool,
+}
+
+impl Default for RecordParser {
+    fn default() -> Self {
+        RecordParser::new()
+    }
+}
+
+impl RecordParser {
+    pub fn new() -> RecordParser {
+        RecordParser {
+            state: RecordReaderState::new(),
+            partial: vec![],
+            line: 0,
+            failed: false,
+        }
+    }
+
+    /// Parse every line completed by `bytes`
+    ///
+    /// The first invalid line is reported with the same error as
+    /// [`Record::from_reader`]. The parser cannot go on from there: any
+    /// later call returns [`ReadError::ParserFailed`].
+    pub fn feed(&mut self, bytes: &[u8]) -> Result<()> {
+        if self.failed {
+            return Err(ReadError::ParserFailed.into());
+        }
+        let result = self.feed_lines(bytes);
+        self.failed = result.is_err();
+        Ok(result?)
+    }
+
+    fn feed_lines(&mut self, mut bytes: &[u8]) -> ReaderResult<()> {
+        while let Some(end) = memchr::memchr(b'\n', bytes) {
+            if self.partial.is_empty() {
+                self.parse_line(&bytes[..=end])?;
+            } else {
+                self.check_line_length(end + 1)?;
+                let mut line = std::mem::take(&mut self.partial);
+                line.extend_from_slice(&bytes[..=end]);
+                self.parse_line(&line)?;
+                // Keep the allocation for the next split line
+                line.clear();
+                self.partial = line;
+            }
+            bytes = &bytes[end + 1..];
+        }
+        self.check_line_length(bytes.len())?;
+        self.partial.extend_from_slice(bytes);
+        Ok(())
+    }
+
+    /// Whether the held back line can take `length` more bytes
+    fn check_line_length(&self, length: usize) -> ReaderResult<()> {
+        match self.partial.len().saturating_add(length) > MAX_LINE_LENGTH {
+            true => Err(ReadError::LineTooLong(self.line)),
+            false => Ok(()),
+        }
+    }
+
+    fn parse_line(&mut self, line: &[u8]) -> ReaderResult<()> {
+        let i = self.line;
+        self.line += 1;
+
+        let line = line_to_str(line)?;
+        // Filter out new lines
+        if line.trim().is_empty() {
+            return Ok(());
+        }
+        let keyword = KeywordRef::try_from(line).map_err(|e| ReadError::LineError(i, e))?;
+        self.state.process(keyword)
+    }
+
+    /// Header parsed so far
+    pub fn header(&self) -> &Header {
+        &self.state.record.header
+    }
+
+    /// Data arrays whose `END` has been parsed, in record order
+    pub fn data_arrays(&self) -> &[DataArray] {
+        let data = &self.state.record.data;
+        &data[..self.state.data_array_counter.min(data.len())]
+    }
+
+    /// End of the stream: parse the last line and validate the record
+    pub fn finish(mut self) -> Result<Record> {
+        if self.failed {
+            return Err(ReadError::ParserFailed.into());
+        }
+        if !self.partial.is_empty() {
+            let line = std::mem::take(&mut self.partial);
+            self.parse_line(&line)?;
+        }
+        Ok(self.state.validate_record()?.record)
+    }
+}
+
+#[cfg(test)]
+mod test_record_parser {
+    use super::*;
+
+    const RECORD: &str = "CITIFILE A.01.00\r\nNAME DATA\nVAR FREQ MAG 2\nDATA S RI\nDATA E RI\n\
+        VAR_LIST_BEGIN\n10\n20\nVAR_LIST_END\nBEGIN\n1E0,2E0\n3E0,4E0\nEND\n\
+        BEGIN\n5E0,6E0\n7E0,8E0\nEND";
+
+    fn parse_in_chunks(bytes: &[u8], size: usize) -> Result<Record> {
+        let mut parser = RecordParser::new();
+        for chunk in bytes.chunks(size) {
+            parser.feed(chunk)?;
+        }
+        parser.finish()
+    }
+
+    #[test]
+    fn any_chunk_size() {
+        let expected = Record::from_reader(&mut RECORD.as_bytes()).unwrap();
+        for size in 1..RECORD.len() + 1 {
+            assert_eq!(
+                parse_in_chunks(RECORD.as_bytes(), size).unwrap(),
+                expected,
+                "{}",
+                size
+            );
+        }
+    }
+
+    #[test]
+    fn data_arrays_as_they_end() {
+        let mut parser = RecordParser::new();
+        let second = RECORD.rfind("BEGIN").unwrap();
+        parser.feed(RECORD[..second].as_bytes()).unwrap();
+        assert_eq!(parser.header().name, "DATA");
+        assert_eq!(parser.data_arrays().len(), 1);
+        assert_eq!(parser.data_arrays()[0].name, "S");
+        assert_eq!(parser.data_arrays()[0].samples.len(), 2);
+
+        // The last `END` has no line ending, so it waits for the stream to end
+        parser.feed(RECORD[second..].as_bytes()).unwrap();
+        assert_eq!(parser.data_arrays().len(), 1);
+        assert_eq!(parser.finish().unwrap().data[1].name, "E");
+    }
+
+    #[test]
+    fn same_error_as_from_reader() {
+        let text = RECORD.replace("3E0,4E0", "3E0;4E0");
+        let expected = format!("{:?}", Record::from_reader(&mut text.as_bytes()));
+        for &size in &[1, 7, text.len()] {
+            assert_eq!(
+                format!("{:?}", parse_in_chunks(text.as_bytes(), size)),
+                expected
+            );
+        }
+    }
+
+    #[test]
+    fn invalid_record() {
+        let text = RECORD.replace("NAME DATA\n", "");
+        match parse_in_chunks(text.as_bytes(), 16) {
+            Err(Error::ReadError(ReadError::NoName)) => (),
+            e => panic!("{:?}", e),
+        }
+    }
+
+    #[test]
+    fn failed() {
+        let mut parser = RecordParser::new();
+        assert!(parser.feed(b"NOT A KEYWORD\n").is_err());
+        match parser.feed(b"CITIFILE A.01.00\n") {
+            Err(Error::ReadError(ReadError::ParserFailed)) => (),
+            e => panic!("{:?}", e),
+        }
+        match parser.finish() {
+            Err(Error::ReadError(ReadError::ParserFailed)) => (),
+            e => panic!("{:?}", e),
+        }
+    }
+
+    #[test]
+    fn line_too_long() {
+        let mut parser = RecordParser::new();
+        parser.feed(b"CITIFILE A.01.00\n!").unwrap();
+        let chunk = vec![b'a'; MAX_LINE_LENGTH / 2];
+        parser.feed(&chunk).unwrap();
+        match parser.feed(&chunk) {
+            Err(Error::ReadError(ReadError::LineTooLong(1))) => (),
+            e => panic!("{:?}", e),
+        }
+        match parser.feed(b"\n") {
+            Err(Error::ReadError(ReadError::ParserFailed)) => (),
+            e => panic!("{:?}", e),
+        }
+    }
+
+    #[test]
+    fn line_too_long_with_its_end() {
+        let mut parser = RecordParser::new();
+        parser.feed(b"!").unwrap();
+        let mut chunk = vec![b'a'; MAX_LINE_LENGTH];
+        chunk.push(b'\n');
+        match parser.feed(&chunk) {
+            Err(Error::ReadError(ReadError::LineTooLong(0))) => (),
+            e => panic!("{:?}", e),
+        }
+    }
+
+    #[test]
+    fn longest_line() {
+        let mut parser = RecordParser::new();
+        parser.feed(b"CITIFILE A.01.00\n!").unwrap();
+        parser.feed(&vec![b'a'; MAX_LINE_LENGTH - 2]).unwrap();
+        parser.feed(b"\nNAME DATA\n").unwrap();
+        assert_eq!(parser.header().name, "DATA");
+    }
+
+    #[test]
+    fn empty() {
+        match RecordParser::new().finish() {
+            Err(Error::ReadError(ReadError::NoName)) => (),
+            e => panic!("{:?}", e),
+        }
+    }
+}
+
+#[cfg(all(test, feature = "async"))]
+mod test_async {
+    use super::*;
+    use futures_executor::block_on;
+    use std::pin::Pin;
+    use std::task::{Context, Poll};
+
+    const RECORD: &str = "CITIFILE A.01.00\nNAME DATA\nVAR FREQ MAG 2\nDATA S RI\n\
+        VAR_LIST_BEGIN\n10\n20\nVAR_LIST_END\nBEGIN\n1E0,2E0\n3E0,4E0\nEND\n";
+
+    /// Hands out a few bytes per read, interrupted every other time
+    struct Trickle<'a> {
+        bytes: &'a [u8],
+        interrupt: bool,
+    }
+
+    impl futures_util::io::AsyncRead for Trickle<'_> {
+        fn poll_read(
+            mut self: Pin<&mut Self>,
+            _: &mut Context<'_>,
+            buf: &mut [u8],
+        ) -> Poll<std::io::Result<usize>> {
+            self.interrupt = !self.interrupt;
+            if self.interrupt {
+                return Poll::Ready(Err(std::io::ErrorKind::Interrupted.into()));
+            }
+            let n = self.bytes.len().min(buf.len()).min(7);
+            buf[..n].copy_from_slice(&self.bytes[..n]);
+            self.bytes = &self.bytes[n..];
+            Poll::Ready(Ok(n))
+        }
+    }
+
+    struct Broken;
+
+    impl futures_util::io::AsyncRead for Broken {
+        fn poll_read(
+            self: Pin<&mut Self>,
+            _: &mut Context<'_>,
+            _: &mut [u8],
+        ) -> Poll<std::io::Result<usize>> {
+            Poll::Ready(Err(std::io::ErrorKind::BrokenPipe.into()))
+        }
+    }
+
+    fn large_record() -> Record {
+        let mut record = Record::new("A.01.00", "DATA");
+        record.header.independent_variable = Var::new("FREQ", "MAG");
+        for i in 0..5000 {
+            record
+                .header
+                .independent_variable
+                .push(1E9 + i as f64 * 1E6);
+        }
+        let mut array = DataArray::new("S", "RI");
+        for i in 0..5000 {
+            array.add_sample(i as f64 / 3., -(i as f64));
+        }
+        record.data.push(array);
+        record
+    }
+
+    #[test]
+    fn read_matches_from_reader() {
+        let mut reader = Trickle {
+            bytes: RECORD.as_bytes(),
+            interrupt: false,
+        };
+        let record = block_on(Record::from_async_reader(&mut reader)).unwrap();
+        assert_eq!(record, Record::from_reader(&mut RECORD.as_bytes()).unwrap());
+    }
+
+    #[test]
+    fn read_line_error() {
+        let bytes = RECORD.replace("3E0,4E0", "3E0;4E0").into_bytes();
+        let result = block_on(Record::from_async_reader(&mut bytes.as_slice()));
+        let expected = Record::from_reader(&mut bytes.as_slice());
+        assert_eq!(format!("{:?}", result), format!("{:?}", expected));
+        assert!(matches!(
+            result,
+            Err(Error::ReadError(ReadError::LineError(10, _)))
+        ));
+    }
+
+    #[test]
+    fn read_compressed() {
+        for (magic, compression) in &[
+            (&[0x1F, 0x8B][..], Compression::Gzip),
+            (&[0x28, 0xB5, 0x2F, 0xFD][..], Compression::Zstd),
+        ] {
+            let mut bytes = magic.to_vec();
+            bytes.extend_from_slice(RECORD.as_bytes());
+            let mut reader = Trickle {
+                bytes: &bytes,
+                interrupt: false,
+            };
+            match block_on(Record::from_async_reader(&mut reader)) {
+                Err(Error::ReadError(ReadError::UnsupportedCompression(c))) => {
+                    assert_eq!(c, *compression)
+                }
+                e => panic!("{:?}", e),
+            }
+        }
+    }
+
+    #[test]
+    fn read_first_chunk_shorter_than_magic() {
+        use futures_util::io::AsyncReadExt;
+
+        let (first, rest) = RECORD.as_bytes().split_at(2);
+        let mut reader = first.chain(rest);
+        let record = block_on(Record::from_async_reader(&mut reader)).unwrap();
+        assert_eq!(record, Record::from_reader(&mut RECORD.as_bytes()).unwrap());
+    }
+
+    #[test]
+    fn read_io_error() {
+        assert!(matches!(
+            block_on(Record::from_async_reader(&mut Broken)),
+            Err(Error::ReadError(ReadError::ReadingError(_)))
+        ));
+    }
+
+    #[test]
+    fn write_matches_to_writer() {
+        let record = large_record();
+        let mut expected: Vec<u8> = vec![];
+        record.to_writer(&mut expected).unwrap();
+        assert!(expected.len() > WRITE_BUFFER_CAPACITY);
+
+        let mut bytes: Vec<u8> = vec![];
+        block_on(record.to_async_writer(&mut bytes)).unwrap();
+        assert_eq!(bytes, expected);
+    }
+
+    /// Keeps the size of every write
+    #[derive(Default)]
+    struct Writes {
+        bytes: Vec<u8>,
+        sizes: Vec<usize>,
+    }
+
+    impl futures_util::io::AsyncWrite for Writes {
+        fn poll_write(
+            mut self: Pin<&mut Self>,
+            _: &mut Context<'_>,
+            buf: &[u8],
+        ) -> Poll<std::io::Result<usize>> {
+            self.bytes.extend_from_slice(buf);
+            self.sizes.push(buf.len());
+            Poll::Ready(Ok(buf.len()))
+        }
+
+        fn poll_flush(self: Pin<&mut Self>, _: &mut Context<'_>) -> Poll<std::io::Result<()>> {
+            Poll::Ready(Ok(()))
+        }
+
+        fn poll_close(self: Pin<&mut Self>, _: &mut Context<'_>) -> Poll<std::io::Result<()>> {
+            Poll::Ready(Ok(()))
+        }
+    }
+
+    #[test]
+    fn write_header_in_bounded_chunks() {
+        let mut record = Record::new("A.01.00", "DATA");
+        record.header.independent_variable = Var::new("FREQ", "MAG");
+        let mut array = DataArray::new("S", "RI");
+        for i in 0..20_000 {
+            record
+                .header
+                .independent_variable
+                .push(1E9 + i as f64 * 1E6);
+            array.add_sample(0., 0.);
+        }
+        record.data.push(array);
+        let mut expected: Vec<u8> = vec![];
+        record.to_writer(&mut expected).unwrap();
+
+        let mut writes = Writes::default();
+        block_on(record.to_async_writer(&mut writes)).unwrap();
+        assert_eq!(writes.bytes, expected);
+        assert!(writes.sizes.len() > 1);
+        assert!(writes
+            .sizes
+            .iter()
+            .all(|&size| size < 2 * WRITE_BUFFER_CAPACITY));
+    }
+
+    #[test]
+    fn write_with_options() {
+        let mut record = Record::new("A.01.00", "DATA");
+        let mut array = DataArray::new("S", "RI");
+        array.add_sample(0.78012, -8.98651E-1);
+        record.data.push(array);
+        let options = WriteOptions {
+            data_format: FloatFormat::SignificantDigits(6),
+            ..WriteOptions::default()
+        };
+
+        let mut expected: Vec<u8> = vec![];
+        record
+            .to_writer_with_options(&mut expected, &options)
+            .unwrap();
+        let mut bytes: Vec<u8> = vec![];
+        block_on(record.to_async_writer_with_options(&mut bytes, &options)).unwrap();
+        assert_eq!(bytes, expected);
+    }
+
+    #[test]
+    fn write_compressed_is_unsupported() {
+        let record = large_record();
+        let options = WriteOptions {
+            compression: Compression::Gzip,
+            ..WriteOptions::default()
+        };
+        let mut bytes: Vec<u8> = vec![];
+        match block_on(record.to_async_writer_with_options(&mut bytes, &options)) {
+            Err(Error::WriteError(WriteError::UnsupportedCompression(Compression::Gzip))) => (),
+            e => panic!("{:?}", e),
+        }
+        assert!(bytes.is_empty());
+    }
+
+    #[test]
+    fn write_with_threads() {
+        let record = large_record();
+        let options = WriteOptions {
+            threads: 0,
+            ..WriteOptions::default()
+        };
+        let mut expected: Vec<u8> = vec![];
+        record.to_writer(&mut expected).unwrap();
+        let mut bytes: Vec<u8> = vec![];
+        block_on(record.to_async_writer_with_options(&mut bytes, &options)).unwrap();
+        assert_eq!(bytes, expected);
+    }
+
+    #[test]
+    fn write_round_trip() {
+        let record = large_record();
+        let mut bytes: Vec<u8> = vec![];
+        block_on(record.to_async_writer(&mut bytes)).unwrap();
+        let mut reader = bytes.as_slice();
+        assert_eq!(
+            block_on(Record::from_async_reader(&mut reader)).unwrap(),
+            record
+        );
+    }
+
+    #[test]
+    fn write_nothing_on_error() {
+        let record = Record::new("A.01.00", "");
+        let mut bytes: Vec<u8> = vec![];
+        assert!(matches!(
+            block_on(record.to_async_writer(&mut bytes)),
+            Err(Error::WriteError(WriteError::NoName))
+        ));
+        assert!(bytes.is_empty());
+    }
+}
+
+#[cfg(test)]
+mod test_stats {
+    use super::*;
+
+    const RECORD: &str = "CITIFILE A.01.00\nNAME DATA\nVAR FREQ MAG 2\nDATA S RI\nDATA E RI\n\
+        !Comment\n\nVAR_LIST_BEGIN\n10\n20\nVAR_LIST_END\nBEGIN\n1E0,2E0\n3E0,4E0\nEND\n\
+        BEGIN\n5E0,6E0\n7E0,8E0\nEND\n";
+
+    fn read(record: &str, options: &ReadOptions, stats: &mut ReadStats) -> Result<Record> {
+        Record::from_reader_with_stats(&mut record.as_bytes(), options, stats)
+    }
+
+    #[test]
+    fn read_same_record() {
+        let mut stats = ReadStats::default();
+        assert_eq!(
+            read(RECORD, &ReadOptions::default(), &mut stats).unwrap(),
+            Record::from_reader(&mut RECORD.as_bytes()).unwrap()
+        );
+    }
+
+    #[test]
+    fn read_counts() {
+        let mut stats = ReadStats::default();
+        read(RECORD, &ReadOptions::default(), &mut stats).unwrap();
+
+        assert_eq!(stats.bytes, RECORD.len() as u64);
+        assert_eq!(stats.lines, 19);
+        assert_eq!(stats.samples, 4);
+        assert_eq!(
+            stats.keywords,
+            KeywordCounts {
+                citifile: 1,
+                name: 1,
+                var: 1,
+                comment: 1,
+                data: 2,
+                var_list_begin: 1,
+                var_list_item: 2,
+                var_list_end: 1,
+                begin: 2,
+                end: 2,
+                ..KeywordCounts::default()
+            }
+        );
+    }
+
+    #[test]
+    fn read_times() {
+        let mut stats = ReadStats::default();
+        read(RECORD, &ReadOptions::default(), &mut stats).unwrap();
+
+        // Each line is lexed in tens of nanoseconds, which a coarse clock
+        // can round to nothing, so only the sum of the phases is checked
+        assert!(stats.lines > 0);
+        assert_eq!(stats.keywords.begin, 2);
+        assert!(
+            stats.total_nanoseconds
+                >= stats.read_nanoseconds
+                    + stats.lex_nanoseconds
+                    + stats.process_nanoseconds
+                    + stats.validate_nanoseconds
+        );
+    }
+
+    #[test]
+    fn read_adds_up() {
+        let mut once = ReadStats::default();
+        read(RECORD, &ReadOptions::default(), &mut once).unwrap();
+        let mut twice = ReadStats::default();
+        read(RECORD, &ReadOptions::default(), &mut twice).unwrap();
+        read(RECORD, &ReadOptions::default(), &mut twice).unwrap();
+
+        assert_eq!(twice.bytes, 2 * once.bytes);
+        assert_eq!(twice.samples, 2 * once.samples);
+        assert_eq!(twice.keywords.begin, 2 * once.keywords.begin);
+    }
+
+    #[test]
+    fn read_skipped_lines() {
+        let options = ReadOptions {
+            data_arrays: Some(vec![String::from("E")]),
+            ..ReadOptions::default()
+        };
+        let mut stats = ReadStats::default();
+        read(RECORD, &options, &mut stats).unwrap();
+
+        // Only the `BEGIN` and `END` of `S` are counted
+        assert_eq!(stats.lines, 19);
+        assert_eq!(stats.samples, 2);
+        assert_eq!(stats.keywords.begin, 2);
+        assert_eq!(stats.keywords.end, 2);
+    }
+
+    #[test]
+    fn read_error_counts() {
+        let mut stats = ReadStats::default();
+        let record = RECORD.replace("3E0,4E0", "3E0;4E0");
+        assert!(matches!(
+            read(&record, &ReadOptions::default(), &mut stats),
+            Err(Error::ReadError(ReadError::LineError(13, _)))
+        ));
+        assert_eq!(stats.lines, 14);
+        assert_eq!(stats.samples, 1);
+        assert_eq!(stats.validate_nanoseconds, 0);
+    }
+
+    #[test]
+    fn write_counts() {
+        let record = Record::from_reader(&mut RECORD.as_bytes()).unwrap();
+        let mut expected: Vec<u8> = vec![];
+        record.to_writer(&mut expected).unwrap();
+
+        let mut bytes: Vec<u8> = vec![];
+        let mut stats = WriteStats::default();
+        record
+            .to_writer_with_stats(&mut bytes, &WriteOptions::default(), &mut stats)
+            .unwrap();
+
+        assert_eq!(bytes, expected);
+        assert_eq!(stats.bytes, bytes.len() as u64);
+        assert_eq!(
+            stats.lines,
+            bytes.iter().filter(|&&b| b == b'\n').count() as u64
+        );
+        assert_eq!(stats.samples, 4);
+        assert_eq!(stats.keywords.var_list_item, 2);
+        assert_eq!(
+            stats.total_nanoseconds,
+            stats.format_nanoseconds + stats.write_nanoseconds
+        );
+    }
+
+    #[test]
+    fn write_error_writes_nothing() {
+        let record = Record::new("A.01.00", "");
+        let mut bytes: Vec<u8> = vec![];
+        let mut stats = WriteStats::default();
+        assert!(matches!(
+            record.to_writer_with_stats(&mut bytes, &WriteOptions::default(), &mut stats),
+            Err(Error::WriteError(WriteError::NoName))
+        ));
+        assert_eq!(stats.bytes, 0);
+        assert_eq!(stats.lines, 0);
+    }
+}
+
+/// Where a [`RecordWriter`] is in the record
+#[derive(Debug, PartialEq, Eq, Clone, Copy)]
+enum RecordWriterState {
+    Header,
+    BetweenArrays,
+    InArray,
+    /// The inner writer failed, so what it holds is unknown
+    Failed,
+}
 
-            #[test]
-            fn no_format() {
-                let mut record = Record::default();
-                record.data.push(DataArray {
-                    name: String::from("Name"),
-                    format: String::new(),
-                    samples: vec![],
-                });
-                match record.get_data_defines_keywords() {
-                    Err(WriteError::NoDataFormat(0)) => (),
-                    e => panic!("{:?}", e),
-                }
-            }
+/// Streaming writer for a record whose samples arrive over time
+///
+/// The header goes out with [`RecordWriter::begin`], then each data array is
+/// written between [`RecordWriter::begin_array`] and
+/// [`RecordWriter::end_array`], with samples added in batches of any size by
+/// [`RecordWriter::push_samples`]. Nothing has to be held in memory besides
+/// the write buffer, so an acquisition can be written as it is taken.
+///
+/// The output is the same as [`Record::to_writer`] for the same record. Since
+/// every `DATA` line comes before the first `BEGIN`, the arrays are declared
+/// up front and must then be written in that order. A call out of order is
+/// rejected with a [`WriteError`] and writes nothing.
+///
+/// Once the inner writer fails, part of a line may have been written, so
+/// every later call is rejected with [`WriteError::OutOfOrder`]. A failed
+/// [`RecordWriter::begin`] cannot be retried into a second header.
+///
+/// Compression is not supported: [`RecordWriter::begin`] rejects anything
+/// but [`Compression::None`] with [`WriteError::UnsupportedCompression`]
+/// before anything is written.
+///
+/// Example usage:
+/// ```
+/// use citi::{Header, RecordWriter};
+/// use num_complex::Complex;
+///
+/// let mut header = Header::new("A.01.00", "Name");
+/// header.independent_variable.push(1E9);
+///
+/// let mut writer = RecordWriter::new(vec![]);
+/// writer.begin(&header, &[("S", "RI")]).unwrap();
+/// writer.begin_array("S", "RI").unwrap();
+/// writer.push_samples(&[Complex::new(1., 2.)]).unwrap();
+/// writer.end_array().unwrap();
+/// let written = writer.finish().unwrap();
+/// assert!(written.ends_with(b"BEGIN\n1E0,2E0\nEND\n"));
+/// ```
+#[derive(Debug)]
+pub struct RecordWriter<W: Write> {
+    buffer: std::io::BufWriter<W>,
+    options: WriteOptions,
+    /// Name and format of every data array, from [`RecordWriter::begin`]
+    declared: Vec<(String, String)>,
+    /// Index of the array being written, or the next one
+    array: usize,
+    state: RecordWriterState,
+    line: Vec<u8>,
+}
 
-            #[test]
-            fn no_name_no_format() {
-                let mut record = Record::default();
-                record.data.push(DataArray {
-                    name: String::new(),
-                    format: String::new(),
-                    samples: vec![],
-                });
-                match record.get_data_defines_keywords() {
-                    Err(WriteError::NoDataName(0)) => (),
-                    e => panic!("{:?}", e),
-                }
-            }
+impl<W: Write> RecordWriter<W> {
+    pub fn new(writer: W) -> RecordWriter<W> {
+        RecordWriter::with_options(writer, WriteOptions::default())
+    }
+
+    pub fn with_options(writer: W, options: WriteOptions) -> RecordWriter<W> {
+        RecordWriter {
+            buffer: std::io::BufWriter::with_capacity(WRITE_BUFFER_CAPACITY, writer),
+            options,
+            declared: vec![],
+            array: 0,
+            state: RecordWriterState::Header,
+            line: vec![],
         }
     }
 
-    #[cfg(test)]
-    mod test_read {
-        use super::*;
+    /// Write the header, declaring the name and format of every data array
+    ///
+    /// The header is checked as in [`Record::to_writer`] before anything is
+    /// written.
+    pub fn begin(&mut self, header: &Header, data_arrays: &[(&str, &str)]) -> Result<()> {
+        self.expect(RecordWriterState::Header, "begin")?;
+        if self.options.compression != Compression::None {
+            return Err(WriteError::UnsupportedCompression(self.options.compression).into());
+        }
+        validate_header_for_write(header, data_arrays.iter().copied())?;
+
+        let (buffer, line, format) = (&mut self.buffer, &mut self.line, self.options.data_format);
+        let segments = self.options.segments;
+        let result =
+            for_each_header_keyword(header, data_arrays.iter().copied(), segments, |keyword| {
+                line.clear();
+                push_keyword(keyword, format, line);
+                buffer.write_all(line)
+            });
+        self.check(result)?;
 
-        #[test]
-        fn cannot_read_empty_record() {
-            match Record::from_reader(&mut "".as_bytes()) {
-                Err(Error::ReadError(ReadError::NoName)) => (),
-                e => panic!("{:?}", e),
-            }
-        }
+        self.declared = data_arrays
+            .iter()
+            .map(|&(name, format)| (String::from(name), String::from(format)))
+            .collect();
+        self.state = RecordWriterState::BetweenArrays;
+        Ok(())
+    }
 
-        #[test]
-        fn succeed_on_multiple_new_lines() {
-            let contents = "CITIFILE A.01.00\nNAME MEMORY\n\n\n\n\n\n\n\n\nVAR FREQ MAG 3\nDATA S RI\nBEGIN\n-3.54545E-2,-1.38601E-3\n0.23491E-3,-1.39883E-3\n2.00382E-3,-1.40022E-3\nEND\n";
-            match Record::from_reader(&mut contents.as_bytes()) {
-                Ok(_) => (),
-                e => panic!("{:?}", e),
-            }
+    /// Start the next declared data array
+    pub fn begin_array(&mut self, name: &str, format: &str) -> Result<()> {
+        self.expect(RecordWriterState::BetweenArrays, "begin_array")?;
+        match self.declared.get(self.array) {
+            Some((n, f)) if n == name && f == format => (),
+            _ => return Err(WriteError::UndeclaredDataArray(self.array).into()),
         }
 
-        #[test]
-        fn succeed_on_whitespace_new_lines() {
-            let contents = "CITIFILE A.01.00\nNAME MEMORY\n      \n\n\n\n\n\n\n\nVAR FREQ MAG 3\nDATA S RI\nBEGIN\n-3.54545E-2,-1.38601E-3\n0.23491E-3,-1.39883E-3\n2.00382E-3,-1.40022E-3\nEND\n";
-            match Record::from_reader(&mut contents.as_bytes()) {
-                Ok(_) => (),
-                e => panic!("{:?}", e),
-            }
+        self.write_keyword(KeywordRef::Begin)?;
+        self.state = RecordWriterState::InArray;
+        Ok(())
+    }
+
+    /// Append samples to the current data array
+    pub fn push_samples(&mut self, samples: &[Complex<f64>]) -> Result<()> {
+        self.expect(RecordWriterState::InArray, "push_samples")?;
+        for &Complex { re: real, im: imag } in samples {
+            self.line.clear();
+            push_data_pair(real, imag, self.options.data_format, &mut self.line);
+            let result = self.buffer.write_all(&self.line);
+            self.check(result)?;
         }
+        Ok(())
+    }
 
-        #[cfg(test)]
-        mod test_read_minimal_record {
-            use super::*;
+    /// Close the current data array
+    pub fn end_array(&mut self) -> Result<()> {
+        self.expect(RecordWriterState::InArray, "end_array")?;
+        self.write_keyword(KeywordRef::End)?;
+        self.array += 1;
+        self.state = RecordWriterState::BetweenArrays;
+        Ok(())
+    }
 
-            fn setup() -> Result<Record> {
-                let contents = "CITIFILE A.01.00\nNAME MEMORY\nVAR FREQ MAG 3\nDATA S RI\nBEGIN\n-3.54545E-2,-1.38601E-3\n0.23491E-3,-1.39883E-3\n2.00382E-3,-1.40022E-3\nEND\n";
-                Record::from_reader(&mut contents.as_bytes())
-            }
+    /// Flush everything once every declared array has been written
+    ///
+    /// The inner writer is handed back.
+    pub fn finish(mut self) -> Result<W> {
+        self.expect(RecordWriterState::BetweenArrays, "finish")?;
+        if self.array < self.declared.len() {
+            return Err(WriteError::MissingDataArray(self.array).into());
+        }
 
-            #[test]
-            fn name() {
-                match setup() {
-                    Ok(record) => assert_eq!(record.header.name, "MEMORY"),
-                    e => panic!("{:?}", e),
-                }
-            }
+        self.buffer.flush().map_err(WriteError::WrittingError)?;
+        Ok(self
+            .buffer
+            .into_inner()
+            .map_err(|e| WriteError::WrittingError(e.into_error()))?)
+    }
 
-            #[test]
-            fn version() {
-                match setup() {
-                    Ok(record) => assert_eq!(record.header.version, "A.01.00"),
-                    e => panic!("{:?}", e),
-                }
-            }
+    fn expect(&self, state: RecordWriterState, call: &'static str) -> WriteResult<()> {
+        match self.state == state {
+            true => Ok(()),
+            false => Err(WriteError::OutOfOrder(call)),
+        }
+    }
 
-            #[test]
-            fn comments() {
-                match setup() {
-                    Ok(record) => assert_eq!(record.header.comments.len(), 0),
-                    e => panic!("{:?}", e),
-                }
-            }
+    fn write_keyword(&mut self, keyword: KeywordRef) -> WriteResult<()> {
+        self.line.clear();
+        push_keyword(keyword, self.options.data_format, &mut self.line);
+        let result = self.buffer.write_all(&self.line);
+        self.check(result)
+    }
 
-            #[test]
-            fn constants() {
-                match setup() {
-                    Ok(record) => assert_eq!(record.header.constants.len(), 0),
-                    e => panic!("{:?}", e),
-                }
-            }
+    /// Move to [`RecordWriterState::Failed`] if the inner writer failed
+    fn check(&mut self, result: std::io::Result<()>) -> WriteResult<()> {
+        if result.is_err() {
+            self.state = RecordWriterState::Failed;
+        }
+        result.map_err(WriteError::WrittingError)
+    }
+}
 
-            #[test]
-            fn devices() {
-                match setup() {
-                    Ok(record) => assert_eq!(record.header.devices.len(), 0),
-                    e => panic!("{:?}", e),
-                }
-            }
+#[cfg(test)]
+mod test_record_writer {
+    use super::*;
 
-            #[test]
-            fn independent_variable() {
-                match setup() {
-                    Ok(record) => {
-                        assert_eq!(record.header.independent_variable.name, "FREQ");
-                        assert_eq!(record.header.independent_variable.format, "MAG");
-                        assert_eq!(record.header.independent_variable.data.len(), 0);
-                    }
-                    e => panic!("{:?}", e),
-                }
-            }
+    const RECORD: &str = "CITIFILE A.01.00\nNAME DATA\nVAR FREQ MAG 2\nDATA S RI\nDATA E RI\n\
+        !Comment\nVAR_LIST_BEGIN\n10\n20\nVAR_LIST_END\nBEGIN\n1E0,2E0\n3E0,4E0\nEND\n\
+        BEGIN\n5E0,6E0\n7E0,8E0\nEND\n";
 
-            #[test]
-            fn data() {
-                match setup() {
-                    Ok(record) => {
-                        assert_eq!(record.data.len(), 1);
-                        assert_eq!(record.data[0].name, "S");
-                        assert_eq!(record.data[0].format, "RI");
-                        assert_eq!(record.data[0].samples.len(), 3);
-                        assert_complex_array_relative_eq!(
-                            record.data[0].samples,
-                            vec![
-                                Complex {
-                                    re: -0.0354545,
-                                    im: -0.00138601
-                                },
-                                Complex {
-                                    re: 0.00023491,
-                                    im: -0.00139883
-                                },
-                                Complex {
-                                    re: 0.00200382,
-                                    im: -0.00140022
-                                },
-                            ]
-                        );
-                    }
-                    e => panic!("{:?}", e),
-                }
+    fn declarations(record: &Record) -> Vec<(&str, &str)> {
+        record.data_declarations().collect()
+    }
+
+    fn stream(record: &Record, options: WriteOptions, batch: usize) -> Result<Vec<u8>> {
+        let mut writer = RecordWriter::with_options(vec![], options);
+        writer.begin(&record.header, &declarations(record))?;
+        for array in record.data.iter() {
+            writer.begin_array(&array.name, &array.format)?;
+            for samples in array.samples.chunks(batch) {
+                writer.push_samples(samples)?;
             }
+            writer.end_array()?;
         }
+        writer.finish()
     }
 
-    #[test]
-    fn test_default() {
-        let expected = Record {
-            header: Header {
-                version: String::from("A.01.00"),
-                name: String::new(),
-                comments: vec![],
-                devices: vec![],
-                independent_variable: Var {
-                    name: String::new(),
-                    format: String::new(),
-                    data: vec![],
-                },
-                constants: vec![],
-            },
-            data: vec![],
-        };
-        let result = Record::default();
-        assert_eq!(result, expected);
+    fn to_writer(record: &Record, options: WriteOptions) -> Vec<u8> {
+        let mut written = vec![];
+        record
+            .to_writer_with_options(&mut written, &options)
+            .unwrap();
+        written
+    }
+
+    fn begun(record: &Record) -> RecordWriter<Vec<u8>> {
+        let mut writer = RecordWriter::new(vec![]);
+        writer.begin(&record.header, &declarations(record)).unwrap();
+        writer
     }
 
     #[test]
-    fn test_new() {
-        let expected = Record {
-            header: Header {
-                version: String::from("A.01.01"),
-                name: String::from("A_NAME"),
-                comments: vec![],
-                devices: vec![],
-                independent_variable: Var {
-                    name: String::new(),
-                    format: String::new(),
-                    data: vec![],
-                },
-                constants: vec![],
-            },
-            data: vec![],
-        };
-        let result = Record::new("A.01.01", "A_NAME");
-        assert_eq!(result, expected);
+    fn matches_to_writer() {
+        let record = Record::from_reader(&mut RECORD.as_bytes()).unwrap();
+        for &batch in &[1, 2, 3] {
+            assert_eq!(
+                stream(&record, WriteOptions::default(), batch).unwrap(),
+                to_writer(&record, WriteOptions::default())
+            );
+        }
     }
 
     #[test]
-    fn test_blank() {
-        let expected = Record {
-            header: Header {
-                version: String::new(),
-                name: String::new(),
-                comments: vec![],
-                devices: vec![],
-                independent_variable: Var {
-                    name: String::new(),
-                    format: String::new(),
-                    data: vec![],
-                },
-                constants: vec![],
-            },
-            data: vec![],
+    fn matches_to_writer_with_options() {
+        let record = Record::from_reader(&mut RECORD.as_bytes()).unwrap();
+        let options = WriteOptions {
+            data_format: FloatFormat::SignificantDigits(3),
+            ..WriteOptions::default()
         };
-        let result = Record::blank();
-        assert_eq!(result, expected);
+        assert_eq!(
+            stream(&record, options, 1).unwrap(),
+            to_writer(&record, options)
+        );
     }
-}
-
-/// Error during reading
-#[derive(Error, Debug)]
-pub enum ReadError {
-    #[error("More data arrays than defined in header")]
-    DataArrayOverIndex,
-    #[error("Independent variable defined twice")]
-    IndependentVariableDefinedTwice,
-    #[error("Single use keyword `{0}` defined twice")]
-    SingleUseKeywordDefinedTwice(Keyword),
-    #[error("Keyword `{0}` is out of order in the record")]
-    OutOfOrderKeyword(Keyword),
-    #[error("Error on line {0}: {1}")]
-    LineError(usize, ParseError),
-    #[error("Reading error occured: {0}")]
-    ReadingError(std::io::Error),
-    #[error("Version is not defined")]
-    NoVersion,
-    #[error("Name is not defined")]
-    NoName,
-    #[error("Indepent variable is not defined")]
-    NoIndependentVariable,
-    #[error("Data name and format is not defined")]
-    NoData,
-    #[error("Independent variable and data array {2} are different lengths ({0} != {1})")]
-    VarAndDataDifferentLengths(usize, usize, usize),
-}
-type ReaderResult<T> = std::result::Result<T, ReadError>;
 
-#[cfg(test)]
-mod test_reader_error {
-    use super::*;
+    #[test]
+    fn reads_back() {
+        let mut record = Record::new("A.01.00", "Name");
+        record.header.independent_variable = Var::new("FREQ", "MAG");
+        record.header.independent_variable.seq(1E9, 2E9, 1000);
+        record.data.push(DataArray::new("S", "RI"));
+        record.data[0].samples = (0..1000).map(|i| Complex::new(i as f64, -1.)).collect();
+
+        let written = stream(&record, WriteOptions::default(), 128).unwrap();
+        assert!(written.len() > 2 * 1000);
+        assert_eq!(
+            Record::from_reader(&mut written.as_slice()).unwrap(),
+            record
+        );
+    }
 
-    mod test_display {
-        use super::*;
+    #[test]
+    fn begin_validates_header() {
+        let mut writer = RecordWriter::new(vec![]);
+        match writer.begin(&Header::new("A.01.00", ""), &[]) {
+            Err(Error::WriteError(WriteError::NoName)) => (),
+            e => panic!("{:?}", e),
+        }
+        match writer.begin(&Header::new("A.01.00", "Name"), &[("S", "")]) {
+            Err(Error::WriteError(WriteError::NoDataFormat(0))) => (),
+            e => panic!("{:?}", e),
+        }
+        writer.begin(&Header::new("A.01.00", "Name"), &[]).unwrap();
+    }
 
-        #[test]
-        fn data_array_over_index() {
-            let error = ReadError::DataArrayOverIndex;
-            assert_eq!(
-                format!("{}", error),
-                "More data arrays than defined in header"
-            );
+    #[test]
+    fn begin_rejects_compression() {
+        let options = WriteOptions {
+            compression: Compression::Gzip,
+            ..WriteOptions::default()
+        };
+        let mut writer = RecordWriter::with_options(vec![], options);
+        match writer.begin(&Header::new("A.01.00", "Name"), &[]) {
+            Err(Error::WriteError(WriteError::UnsupportedCompression(Compression::Gzip))) => (),
+            e => panic!("{:?}", e),
         }
+        assert!(writer.buffer.get_ref().is_empty());
+        assert_eq!(writer.buffer.buffer().len(), 0);
+    }
 
-        #[test]
-        fn independent_variable_defined_twice() {
-            let error = ReadError::IndependentVariableDefinedTwice;
-            assert_eq!(format!("{}", error), "Independent variable defined twice");
+    /// Fails every write
+    struct Broken;
+
+    impl Write for Broken {
+        fn write(&mut self, _: &[u8]) -> std::io::Result<usize> {
+            Err(std::io::ErrorKind::BrokenPipe.into())
         }
 
-        #[test]
-        fn single_use_keyword_defined_twice() {
-            let error = ReadError::SingleUseKeywordDefinedTwice(Keyword::End);
-            assert_eq!(
-                format!("{}", error),
-                "Single use keyword `END` defined twice"
-            );
+        fn flush(&mut self) -> std::io::Result<()> {
+            Ok(())
         }
+    }
 
-        #[test]
-        fn out_of_order_keyword() {
-            let error = ReadError::OutOfOrderKeyword(Keyword::Begin);
-            assert_eq!(
-                format!("{}", error),
-                "Keyword `BEGIN` is out of order in the record"
-            );
+    #[test]
+    fn nothing_after_a_failed_begin() {
+        let mut header = Header::new("A.01.00", "Name");
+        for i in 0..10_000 {
+            header.comments.push(format!("Comment number {}", i));
+        }
+        let mut writer = RecordWriter::new(Broken);
+        match writer.begin(&header, &[("S", "RI")]) {
+            Err(Error::WriteError(WriteError::WrittingError(_))) => (),
+            e => panic!("{:?}", e),
+        }
+        match writer.begin(&header, &[("S", "RI")]) {
+            Err(Error::WriteError(WriteError::OutOfOrder("begin"))) => (),
+            e => panic!("{:?}", e),
+        }
+        match writer.begin_array("S", "RI") {
+            Err(Error::WriteError(WriteError::OutOfOrder("begin_array"))) => (),
+            e => panic!("{:?}", e),
         }
+    }
 
-        #[test]
-        fn reading_error() {
-            let error = ReadError::ReadingError(std::io::ErrorKind::NotFound.into());
-            assert_eq!(
-                format!("{}", error),
-                "Reading error occured: entity not found"
-            );
+    #[test]
+    fn begin_twice() {
+        let record = Record::from_reader(&mut RECORD.as_bytes()).unwrap();
+        let mut writer = begun(&record);
+        match writer.begin(&record.header, &[]) {
+            Err(Error::WriteError(WriteError::OutOfOrder("begin"))) => (),
+            e => panic!("{:?}", e),
         }
+    }
 
-        #[test]
-        fn line_error() {
-            let error = ReadError::LineError(10, ParseError::BadRegex);
-            assert_eq!(
-                format!("{}", error),
-                "Error on line 10: Regex could not be parsed"
-            );
+    #[test]
+    fn nothing_before_begin() {
+        let mut writer = RecordWriter::new(vec![]);
+        match writer.begin_array("S", "RI") {
+            Err(Error::WriteError(WriteError::OutOfOrder("begin_array"))) => (),
+            e => panic!("{:?}", e),
+        }
+        match writer.push_samples(&[]) {
+            Err(Error::WriteError(WriteError::OutOfOrder("push_samples"))) => (),
+            e => panic!("{:?}", e),
+        }
+        match writer.end_array() {
+            Err(Error::WriteError(WriteError::OutOfOrder("end_array"))) => (),
+            e => panic!("{:?}", e),
+        }
+        match writer.finish() {
+            Err(Error::WriteError(WriteError::OutOfOrder("finish"))) => (),
+            e => panic!("{:?}", e),
         }
+    }
 
-        #[test]
-        fn no_version() {
-            let error = ReadError::NoVersion;
-            assert_eq!(format!("{}", error), "Version is not defined");
+    #[test]
+    fn push_samples_outside_array() {
+        let record = Record::from_reader(&mut RECORD.as_bytes()).unwrap();
+        let mut writer = begun(&record);
+        match writer.push_samples(&[Complex::new(1., 2.)]) {
+            Err(Error::WriteError(WriteError::OutOfOrder("push_samples"))) => (),
+            e => panic!("{:?}", e),
         }
+    }
 
-        #[test]
-        fn no_name() {
-            let error = ReadError::NoName;
-            assert_eq!(format!("{}", error), "Name is not defined");
+    #[test]
+    fn finish_inside_array() {
+        let record = Record::from_reader(&mut RECORD.as_bytes()).unwrap();
+        let mut writer = begun(&record);
+        writer.begin_array("S", "RI").unwrap();
+        match writer.finish() {
+            Err(Error::WriteError(WriteError::OutOfOrder("finish"))) => (),
+            e => panic!("{:?}", e),
         }
+    }
 
-        #[test]
-        fn no_independent_variable() {
-            let error = ReadError::NoIndependentVariable;
-            assert_eq!(format!("{}", error), "Indepent variable is not defined");
+    #[test]
+    fn arrays_in_declared_order() {
+        let record = Record::from_reader(&mut RECORD.as_bytes()).unwrap();
+        let mut writer = begun(&record);
+        match writer.begin_array("E", "RI") {
+            Err(Error::WriteError(WriteError::UndeclaredDataArray(0))) => (),
+            e => panic!("{:?}", e),
         }
+        match writer.begin_array("S", "MA") {
+            Err(Error::WriteError(WriteError::UndeclaredDataArray(0))) => (),
+            e => panic!("{:?}", e),
+        }
+        writer.begin_array("S", "RI").unwrap();
+    }
 
-        #[test]
-        fn no_data() {
-            let error = ReadError::NoData;
-            assert_eq!(format!("{}", error), "Data name and format is not defined");
+    #[test]
+    fn array_beyond_declarations() {
+        let record = Record::from_reader(&mut RECORD.as_bytes()).unwrap();
+        let mut writer = begun(&record);
+        for array in record.data.iter() {
+            writer.begin_array(&array.name, &array.format).unwrap();
+            writer.end_array().unwrap();
+        }
+        match writer.begin_array("S", "RI") {
+            Err(Error::WriteError(WriteError::UndeclaredDataArray(2))) => (),
+            e => panic!("{:?}", e),
         }
+    }
 
-        #[test]
-        fn var_and_data() {
-            let error = ReadError::VarAndDataDifferentLengths(1, 2, 3);
-            assert_eq!(
-                format!("{}", error),
-                "Independent variable and data array 3 are different lengths (1 != 2)"
-            );
+    #[test]
+    fn finish_with_missing_array() {
+        let record = Record::from_reader(&mut RECORD.as_bytes()).unwrap();
+        let mut writer = begun(&record);
+        writer.begin_array("S", "RI").unwrap();
+        writer.end_array().unwrap();
+        match writer.finish() {
+            Err(Error::WriteError(WriteError::MissingDataArray(1))) => (),
+            e => panic!("{:?}", e),
         }
     }
+
+    #[test]
+    fn rejected_call_writes_nothing() {
+        let record = Record::from_reader(&mut RECORD.as_bytes()).unwrap();
+        let mut writer = begun(&record);
+        writer.begin_array("E", "RI").unwrap_err();
+        writer.end_array().unwrap_err();
+        for array in record.data.iter() {
+            writer.begin_array(&array.name, &array.format).unwrap();
+            writer.push_samples(&array.samples).unwrap();
+            writer.end_array().unwrap();
+        }
+        assert_eq!(
+            writer.finish().unwrap(),
+            to_writer(&record, WriteOptions::default())
+        );
+    }
 }
 
 /// States in the reader FSM
@@ -3113,183 +8594,359 @@ enum RecordReaderStates {
     SeqList,
 }
 
+/// Upper bound on the capacity reserved from a `VAR` length
+///
+/// The declared length is only a hint taken from the file, so it is clamped
+/// to keep a bad header from reserving an arbitrarily large allocation.
+/// Arrays longer than this still read correctly; they grow as needed.
+const MAX_RESERVED_SAMPLES: usize = 1 << 20;
+
+/// Most values the `SEG` lines of a record may expand to
+///
+/// A `SEG` line of a few bytes can ask for any number of values, so a bad
+/// header is rejected instead of expanded until memory runs out.
+const MAX_SEGMENT_VALUES: usize = 1 << 27;
+
+/// Longest line [`RecordParser`] holds back while waiting for its end
+///
+/// Lines of a record are short, so anything longer is taken to be a stream
+/// that is not a record rather than buffered without bound.
+const MAX_LINE_LENGTH: usize = 1 << 20;
+
+/// Buffers taken from a record by [`RecordReaderState::recycling`]
+///
+/// They are handed out again in the order they were taken, so a record of
+/// the same shape gets back the buffers that already fit it.
+#[derive(Debug, Default, PartialEq, Clone)]
+struct Spare {
+    strings: Vec<String>,
+    /// Without entries
+    devices: Vec<Device>,
+    /// Without samples
+    data: Vec<DataArray>,
+}
+
+impl Spare {
+    /// Clear `record` down to empty strings and vectors that keep their
+    /// capacity, keeping everything else that was allocated
+    fn take(record: &mut Record) -> Spare {
+        let header = &mut record.header;
+        header.version.clear();
+        header.name.clear();
+        header.independent_variable.name.clear();
+        header.independent_variable.format.clear();
+        header.independent_variable.clear();
+
+        let mut strings: Vec<String> = header.comments.drain(..).collect();
+        for constant in header.constants.drain(..) {
+            strings.push(constant.name);
+            strings.push(constant.value);
+        }
+        let mut devices: Vec<Device> = header.devices.drain(..).collect();
+        for device in devices.iter_mut() {
+            strings.append(&mut device.entries);
+        }
+        let mut data: Vec<DataArray> = record.data.drain(..).collect();
+        for data_array in data.iter_mut() {
+            data_array.samples.clear();
+        }
+
+        // Popped from the back
+        strings.reverse();
+        devices.reverse();
+        data.reverse();
+        Spare {
+            strings,
+            devices,
+            data,
+        }
+    }
+
+    fn string(&mut self, value: &str) -> String {
+        match self.strings.pop() {
+            Some(mut string) => {
+                string.clear();
+                string.push_str(value);
+                string
+            }
+            None => String::from(value),
+        }
+    }
+
+    fn device(&mut self, name: &str) -> Device {
+        match self.devices.pop() {
+            Some(mut device) => {
+                device.name.clear();
+                device.name.push_str(name);
+                device
+            }
+            None => Device::new(name),
+        }
+    }
+
+    fn data_array(&mut self, name: &str, format: &str) -> DataArray {
+        match self.data.pop() {
+            Some(mut data_array) => {
+                data_array.name.clear();
+                data_array.name.push_str(name);
+                data_array.format.clear();
+                data_array.format.push_str(format);
+                data_array
+            }
+            None => DataArray::new(name, format),
+        }
+    }
+}
+
 /// Represents state in a CITI record reader FSM
 #[derive(Debug, PartialEq, Clone)]
 struct RecordReaderState {
     record: Record,
+    /// Buffers of an earlier record to fill before allocating new ones
+    spare: Spare,
+    /// Position of each device by name, so device lines are not a scan each
+    devices: HashMap<String, usize>,
     state: RecordReaderStates,
     data_array_counter: usize,
     independent_variable_already_read: bool,
     version_aready_read: bool,
     name_already_read: bool,
     var_already_read: bool,
+    declared_length: usize,
 }
 
 impl RecordReaderState {
     pub fn new() -> RecordReaderState {
+        RecordReaderState::recycling(Record::blank())
+    }
+
+    /// Read into the buffers of `record`, which is cleared first
+    fn recycling(mut record: Record) -> RecordReaderState {
+        let spare = Spare::take(&mut record);
         RecordReaderState {
-            record: Record {
-                header: Header::blank(),
-                data: vec![],
-            },
+            record,
+            spare,
+            devices: HashMap::new(),
             state: RecordReaderStates::Header,
             data_array_counter: 0,
             independent_variable_already_read: false,
             version_aready_read: false,
             name_already_read: false,
             var_already_read: false,
+            declared_length: 0,
+        }
+    }
+
+    /// Number of samples to reserve for the next array
+    ///
+    /// An independent variable that has already been read is exact, otherwise
+    /// the clamped `VAR` length is used.
+    fn reserved_length(&self) -> usize {
+        match self.record.header.independent_variable.len() {
+            0 => self.declared_length.min(MAX_RESERVED_SAMPLES),
+            n => n,
         }
     }
 
-    pub fn process_keyword(self, keyword: Keyword) -> ReaderResult<Self> {
+    /// Length of the independent variable once it has been read, otherwise 0
+    fn known_length(&self) -> usize {
+        match self.independent_variable_already_read {
+            true => self.record.header.independent_variable.len(),
+            false => 0,
+        }
+    }
+
+    /// Enter a `BEGIN`…`END` block whose data pairs are not read
+    ///
+    /// Nothing is reserved for the block. The caller skips to its `END`.
+    fn skip_block(&mut self) {
+        self.state = RecordReaderStates::Data;
+    }
+
+    /// Owned-keyword form of [`RecordReaderState::process`]
+    #[cfg(test)]
+    pub fn process_keyword(mut self, keyword: Keyword) -> ReaderResult<Self> {
+        self.process(KeywordRef::from(&keyword))?;
+        Ok(self)
+    }
+
+    /// Advance the FSM by one keyword, updating the record in place
+    fn process(&mut self, keyword: KeywordRef) -> ReaderResult<()> {
         match self.state {
-            RecordReaderStates::Header => RecordReaderState::state_header(self, keyword),
-            RecordReaderStates::Data => RecordReaderState::state_data(self, keyword),
-            RecordReaderStates::VarList => RecordReaderState::state_var_list(self, keyword),
-            RecordReaderStates::SeqList => RecordReaderState::state_seq_list(self, keyword),
+            RecordReaderStates::Header => self.state_header(keyword),
+            RecordReaderStates::Data => self.state_data(keyword),
+            RecordReaderStates::VarList => self.state_var_list(keyword),
+            RecordReaderStates::SeqList => self.state_seq_list(keyword),
         }
     }
 
-    fn state_header(mut self, keyword: Keyword) -> ReaderResult<Self> {
+    fn state_header(&mut self, keyword: KeywordRef) -> ReaderResult<()> {
         match keyword {
-            Keyword::CitiFile { version } => match self.version_aready_read {
-                true => Err(ReadError::SingleUseKeywordDefinedTwice(Keyword::CitiFile {
-                    version,
-                })),
+            KeywordRef::CitiFile { version } => match self.version_aready_read {
+                true => Err(ReadError::SingleUseKeywordDefinedTwice(keyword.into())),
                 false => {
                     self.version_aready_read = true;
-                    self.record.header.version = version;
-                    Ok(self)
+                    self.record.header.version.push_str(version);
+                    Ok(())
                 }
             },
-            Keyword::Name(name) => match self.name_already_read {
-                true => Err(ReadError::SingleUseKeywordDefinedTwice(Keyword::Name(name))),
+            KeywordRef::Name(name) => match self.name_already_read {
+                true => Err(ReadError::SingleUseKeywordDefinedTwice(keyword.into())),
                 false => {
                     self.name_already_read = true;
-                    self.record.header.name = name;
-                    Ok(self)
+                    self.record.header.name.push_str(name);
+                    Ok(())
                 }
             },
-            Keyword::Device { name, value } => {
-                self.record.header.add_device(&name, &value);
-                Ok(self)
+            KeywordRef::Device { name, value } => {
+                let devices = &mut self.record.header.devices;
+                let i = match self.devices.get(name) {
+                    Some(&i) => i,
+                    None => {
+                        devices.push(self.spare.device(name));
+                        self.devices.insert(String::from(name), devices.len() - 1);
+                        devices.len() - 1
+                    }
+                };
+                devices[i].entries.push(self.spare.string(value));
+                Ok(())
             }
-            Keyword::Comment(comment) => {
+            KeywordRef::Comment(comment) => {
+                let comment = self.spare.string(comment);
                 self.record.header.comments.push(comment);
-                Ok(self)
+                Ok(())
             }
-            Keyword::Constant { name, value } => {
-                self.record
-                    .header
-                    .constants
-                    .push(Constant::new(&name, &value));
-                Ok(self)
+            KeywordRef::Constant { name, value } => {
+                let constant = Constant {
+                    name: self.spare.string(name),
+                    value: self.spare.string(value),
+                };
+                self.record.header.constants.push(constant);
+                Ok(())
             }
-            Keyword::Var {
+            KeywordRef::Var {
                 name,
                 format,
                 length,
             } => match self.var_already_read {
-                true => Err(ReadError::SingleUseKeywordDefinedTwice(Keyword::Var {
-                    name,
-                    format,
-                    length,
-                })),
+                true => Err(ReadError::SingleUseKeywordDefinedTwice(keyword.into())),
                 false => {
                     self.var_already_read = true;
-                    self.record.header.independent_variable.name = name;
-                    self.record.header.independent_variable.format = format;
-                    Ok(self)
+                    self.declared_length = length;
+                    self.record.header.independent_variable.name.push_str(name);
+                    self.record
+                        .header
+                        .independent_variable
+                        .format
+                        .push_str(format);
+                    Ok(())
                 }
             },
-            Keyword::VarListBegin => match self.independent_variable_already_read {
+            KeywordRef::VarListBegin => match self.independent_variable_already_read {
                 false => {
+                    let length = self.reserved_length();
+                    self.record
+                        .header
+                        .independent_variable
+                        .data
+                        .reserve_exact(length);
                     self.state = RecordReaderStates::VarList;
-                    Ok(self)
+                    Ok(())
                 }
                 true => Err(ReadError::IndependentVariableDefinedTwice),
             },
-            Keyword::SegListBegin => match self.independent_variable_already_read {
+            KeywordRef::SegListBegin => match self.independent_variable_already_read {
                 false => {
                     self.state = RecordReaderStates::SeqList;
-                    Ok(self)
+                    Ok(())
                 }
                 true => Err(ReadError::IndependentVariableDefinedTwice),
             },
-            Keyword::Begin => {
+            KeywordRef::Begin => {
+                let length = self.reserved_length();
+                if let Some(data_array) = self.record.data.get_mut(self.data_array_counter) {
+                    data_array.samples.reserve_exact(length);
+                }
                 self.state = RecordReaderStates::Data;
-                Ok(self)
+                Ok(())
             }
-            Keyword::Data { name, format } => {
-                self.record.data.push(DataArray::new(&name, &format));
-                Ok(self)
+            KeywordRef::Data { name, format } => {
+                let data_array = self.spare.data_array(name, format);
+                self.record.data.push(data_array);
+                Ok(())
             }
-            _ => Err(ReadError::OutOfOrderKeyword(keyword)),
+            _ => Err(ReadError::OutOfOrderKeyword(keyword.into())),
         }
     }
 
-    fn state_data(mut self, keyword: Keyword) -> ReaderResult<Self> {
+    fn state_data(&mut self, keyword: KeywordRef) -> ReaderResult<()> {
         match keyword {
-            Keyword::DataPair { real, imag } => {
-                if self.data_array_counter < self.record.data.len() {
-                    self.record.data[self.data_array_counter].add_sample(real, imag);
-                    Ok(self)
-                } else {
-                    Err(ReadError::DataArrayOverIndex)
-                }
-            }
-            Keyword::End => {
+            KeywordRef::DataPair { real, imag } => {
+                let known_length = self.known_length();
+                add_data_pair(
+                    self.record.data.get_mut(self.data_array_counter),
+                    known_length,
+                    self.data_array_counter,
+                    real,
+                    imag,
+                )
+            }
+            KeywordRef::End => {
                 self.state = RecordReaderStates::Header;
                 self.data_array_counter += 1;
-                Ok(self)
+                Ok(())
             }
-            _ => Err(ReadError::OutOfOrderKeyword(keyword)),
+            _ => Err(ReadError::OutOfOrderKeyword(keyword.into())),
         }
     }
 
-    fn state_var_list(mut self, keyword: Keyword) -> ReaderResult<Self> {
+    fn state_var_list(&mut self, keyword: KeywordRef) -> ReaderResult<()> {
         match keyword {
-            Keyword::VarListItem(value) => {
+            KeywordRef::VarListItem(value) => {
                 self.record.header.independent_variable.push(value);
-                Ok(self)
+                Ok(())
             }
-            Keyword::VarListEnd => {
+            KeywordRef::VarListEnd => {
                 self.independent_variable_already_read = true;
                 self.state = RecordReaderStates::Header;
-                Ok(self)
+                Ok(())
             }
-            _ => Err(ReadError::OutOfOrderKeyword(keyword)),
+            _ => Err(ReadError::OutOfOrderKeyword(keyword.into())),
         }
     }
 
-    fn state_seq_list(mut self, keyword: Keyword) -> ReaderResult<Self> {
+    fn state_seq_list(&mut self, keyword: KeywordRef) -> ReaderResult<()> {
         match keyword {
-            Keyword::SegItem {
+            KeywordRef::SegItem {
                 first,
                 last,
                 number,
             } => {
-                self.record
-                    .header
-                    .independent_variable
-                    .seq(first, last, number);
-                Ok(self)
+                let independent_variable = &mut self.record.header.independent_variable;
+                let length = independent_variable.len().saturating_add(number);
+                if length > MAX_SEGMENT_VALUES {
+                    return Err(ReadError::SegmentsTooLong(length));
+                }
+                independent_variable.seq(first, last, number);
+                Ok(())
             }
-            Keyword::SegListEnd => {
+            KeywordRef::SegListEnd => {
                 self.independent_variable_already_read = true;
                 self.state = RecordReaderStates::Header;
-                Ok(self)
+                Ok(())
             }
-            _ => Err(ReadError::OutOfOrderKeyword(keyword)),
+            _ => Err(ReadError::OutOfOrderKeyword(keyword.into())),
         }
     }
 
     pub fn validate_record(self) -> ReaderResult<Self> {
-        self.has_name()?
-            .has_version()?
-            .has_var()?
-            .has_data()?
-            .var_and_data_same_length()
+        self.validate_header()?.var_and_data_same_length()
+    }
+
+    /// Everything in [`RecordReaderState::validate_record`] that does not
+    /// look at the samples
+    fn validate_header(self) -> ReaderResult<Self> {
+        self.has_name()?.has_version()?.has_var()?.has_data()
     }
 
     fn has_version(self) -> ReaderResult<Self> {
@@ -3320,16 +8977,43 @@ impl RecordReaderState {
         }
     }
 
+    /// Keep the data arrays that `options` selects and validate the record
+    ///
+    /// A data array of the wrong length is reported at its index in the
+    /// file, not in the selection.
+    fn validate_selected(mut self, options: &ReadOptions) -> ReaderResult<Self> {
+        let mut indices = vec![];
+        let mut i = 0;
+        self.record.data.retain(|data_array| {
+            let selected = options.selects(&data_array.name);
+            if selected {
+                indices.push(i);
+            }
+            i += 1;
+            selected
+        });
+        match options.header_only {
+            true => self.validate_header(),
+            false => self.validate_header()?.data_at_same_length(|i| indices[i]),
+        }
+    }
+
     /// Zero length var with variable length data allowed
     fn var_and_data_same_length(self) -> ReaderResult<Self> {
-        let mut n = self.record.header.independent_variable.data.len();
+        self.data_at_same_length(|i| i)
+    }
+
+    /// [`RecordReaderState::var_and_data_same_length`], with the data array
+    /// `i` reported as `index(i)`
+    fn data_at_same_length<F: Fn(usize) -> usize>(self, index: F) -> ReaderResult<Self> {
+        let mut n = self.record.header.independent_variable.len();
 
         for (i, data_array) in self.record.data.iter().enumerate() {
             let k = data_array.samples.len();
             if n == 0 {
                 n = k
             } else if n != k {
-                return Err(ReadError::VarAndDataDifferentLengths(n, k, i));
+                return Err(ReadError::VarAndDataDifferentLengths(n, k, index(i)));
             }
         }
         Ok(self)
@@ -3350,21 +9034,20 @@ mod test_record_reader_state {
                     name: String::new(),
                     comments: vec![],
                     devices: vec![],
-                    independent_variable: Var {
-                        name: String::new(),
-                        format: String::new(),
-                        data: vec![],
-                    },
+                    independent_variable: Var::with_data("", "", vec![]),
                     constants: vec![],
                 },
                 data: vec![],
             },
+            spare: Spare::default(),
+            devices: HashMap::new(),
             state: RecordReaderStates::Header,
             data_array_counter: 0,
             independent_variable_already_read: false,
             version_aready_read: false,
             name_already_read: false,
             var_already_read: false,
+            declared_length: 0,
         };
         let result = RecordReaderState::new();
         assert_eq!(result, expected);
@@ -3455,6 +9138,7 @@ mod test_record_reader_state {
                         assert_eq!(s.record.header.independent_variable.format, "MAG");
                         assert_eq!(s.state, RecordReaderStates::Header);
                         assert_eq!(s.var_already_read, true);
+                        assert_eq!(s.declared_length, 102);
                     }
                     Err(e) => panic!("{:?}", e),
                 }
@@ -3753,6 +9437,50 @@ mod test_record_reader_state {
                 }
             }
 
+            #[test]
+            fn begin_reserves_declared_length() {
+                let mut state = initialize_state();
+                state.declared_length = 201;
+                state.record.data.push(DataArray::blank());
+                match state.process_keyword(Keyword::Begin) {
+                    Ok(s) => assert!(s.record.data[0].samples.capacity() >= 201),
+                    Err(e) => panic!("{:?}", e),
+                }
+            }
+
+            #[test]
+            fn begin_reserves_independent_variable_length() {
+                let mut state = initialize_state();
+                state.declared_length = 201;
+                state.record.header.independent_variable.data = vec![1., 2., 3.];
+                state.record.data.push(DataArray::blank());
+                match state.process_keyword(Keyword::Begin) {
+                    Ok(s) => assert_eq!(s.record.data[0].samples.capacity(), 3),
+                    Err(e) => panic!("{:?}", e),
+                }
+            }
+
+            #[test]
+            fn begin_clamps_declared_length() {
+                let mut state = initialize_state();
+                state.declared_length = usize::MAX;
+                state.record.data.push(DataArray::blank());
+                match state.process_keyword(Keyword::Begin) {
+                    Ok(s) => assert_eq!(s.record.data[0].samples.capacity(), MAX_RESERVED_SAMPLES),
+                    Err(e) => panic!("{:?}", e),
+                }
+            }
+
+            #[test]
+            fn var_list_begin_reserves_declared_length() {
+                let mut state = initialize_state();
+                state.declared_length = 201;
+                match state.process_keyword(Keyword::VarListBegin) {
+                    Ok(s) => assert!(s.record.header.independent_variable.data.capacity() >= 201),
+                    Err(e) => panic!("{:?}", e),
+                }
+            }
+
             #[test]
             fn end() {
                 let keyword = Keyword::End;
@@ -4044,6 +9772,19 @@ mod test_record_reader_state {
                 }
             }
 
+            #[test]
+            fn data_pair_past_independent_variable() {
+                let keyword = Keyword::DataPair { real: 1., imag: 2. };
+                let mut state = initialize_state();
+                state.independent_variable_already_read = true;
+                state.record.header.independent_variable.data = vec![1.];
+                state.record.data[0].add_sample(1., 2.);
+                match state.process_keyword(keyword) {
+                    Err(ReadError::DataArrayLongerThanVar(1, 0)) => (),
+                    e => panic!("{:?}", e),
+                }
+            }
+
             #[test]
             fn begin() {
                 let keyword = Keyword::Begin;
@@ -4476,6 +10217,57 @@ mod test_record_reader_state {
                 }
             }
 
+            #[test]
+            fn seg_item_clamps_reserved_length() {
+                let number = MAX_RESERVED_SAMPLES + 1;
+                let keyword = Keyword::SegItem {
+                    first: 10.,
+                    last: 20.,
+                    number,
+                };
+                let state = initialize_state();
+                match state.process_keyword(keyword) {
+                    Ok(s) => {
+                        let data = &s.record.header.independent_variable.data;
+                        assert_eq!(data.len(), number);
+                        assert_eq!(data[0], 10.);
+                        assert_relative_eq!(data[number - 1], 20.);
+                    }
+                    Err(e) => panic!("{:?}", e),
+                }
+            }
+
+            #[test]
+            fn seg_item_too_long() {
+                let keyword = Keyword::SegItem {
+                    first: 0.,
+                    last: 1.,
+                    number: 1_000_000_000_000_000_000,
+                };
+                let state = initialize_state();
+                match state.process_keyword(keyword) {
+                    Err(ReadError::SegmentsTooLong(1_000_000_000_000_000_000)) => (),
+                    e => panic!("{:?}", e),
+                }
+            }
+
+            #[test]
+            fn seg_items_too_long_together() {
+                let mut state = initialize_state();
+                state.record.header.independent_variable.data = vec![0.; 2];
+                let keyword = Keyword::SegItem {
+                    first: 0.,
+                    last: 1.,
+                    number: MAX_SEGMENT_VALUES - 1,
+                };
+                match state.process_keyword(keyword) {
+                    Err(ReadError::SegmentsTooLong(length)) => {
+                        assert_eq!(length, MAX_SEGMENT_VALUES + 1)
+                    }
+                    e => panic!("{:?}", e),
+                }
+            }
+
             #[test]
             fn seg_item_triple() {
                 let keyword = Keyword::SegItem {
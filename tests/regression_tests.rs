@@ -1,6 +1,6 @@
 use citi::{
-    assert_array_relative_eq, assert_complex_array_relative_eq, assert_files_equal, DataArray,
-    Device, Record, Result, Var,
+    assert_array_relative_eq, assert_complex_array_relative_eq, assert_files_equal, BlockIndex,
+    DataArray, Device, IndexedRecord, ReadOptions, Record, Result, Var,
 };
 use num_complex::Complex;
 use std::fs::File;
@@ -569,6 +569,361 @@ mod cti_read_regression_tests {
     }
 }
 
+#[cfg(test)]
+mod cti_mmap_read_regression_tests {
+    use super::*;
+
+    fn filename(name: &str) -> PathBuf {
+        let mut path_buf = PathBuf::from(env!("CARGO_MANIFEST_DIR"));
+        path_buf.push("tests");
+        path_buf.push("regression_files");
+        path_buf.push(name);
+        path_buf
+    }
+
+    fn assert_same_as_buffered(name: &str) {
+        let mut file = File::open(filename(name)).unwrap();
+        let buffered = Record::from_reader(&mut file).unwrap();
+        match Record::from_path_mmap(filename(name)) {
+            Ok(mapped) => assert_eq!(mapped, buffered),
+            e => panic!("{:?}", e),
+        }
+    }
+
+    #[test]
+    fn display_memory() {
+        assert_same_as_buffered("display_memory.cti");
+    }
+
+    #[test]
+    fn data_file() {
+        assert_same_as_buffered("data_file.cti");
+    }
+
+    #[test]
+    fn wvi_file() {
+        assert_same_as_buffered("wvi_file.cti");
+    }
+
+    #[test]
+    fn list_cal_set() {
+        assert_same_as_buffered("list_cal_set.cti");
+    }
+
+    #[test]
+    fn file_not_found() {
+        match Record::from_path_mmap(filename("does_not_exist.cti")) {
+            Err(citi::Error::ReadError(citi::ReadError::ReadingError(e))) => {
+                assert_eq!(e.kind(), std::io::ErrorKind::NotFound)
+            }
+            e => panic!("{:?}", e),
+        }
+    }
+}
+
+#[cfg(test)]
+mod cti_parallel_read_regression_tests {
+    use super::*;
+
+    fn filename(name: &str) -> PathBuf {
+        let mut path_buf = PathBuf::from(env!("CARGO_MANIFEST_DIR"));
+        path_buf.push("tests");
+        path_buf.push("regression_files");
+        path_buf.push(name);
+        path_buf
+    }
+
+    fn assert_same_as_buffered(name: &str) {
+        let mut file = File::open(filename(name)).unwrap();
+        let buffered = Record::from_reader(&mut file).unwrap();
+        for &threads in &[0, 1, 4] {
+            match Record::from_path_parallel(filename(name), threads) {
+                Ok(parallel) => assert_eq!(parallel, buffered),
+                e => panic!("{:?}", e),
+            }
+        }
+    }
+
+    #[test]
+    fn display_memory() {
+        assert_same_as_buffered("display_memory.cti");
+    }
+
+    #[test]
+    fn data_file() {
+        assert_same_as_buffered("data_file.cti");
+    }
+
+    #[test]
+    fn wvi_file() {
+        assert_same_as_buffered("wvi_file.cti");
+    }
+
+    #[test]
+    fn list_cal_set() {
+        assert_same_as_buffered("list_cal_set.cti");
+    }
+}
+
+#[cfg(test)]
+mod cti_read_many_regression_tests {
+    use super::*;
+
+    fn filename(name: &str) -> PathBuf {
+        let mut path_buf = PathBuf::from(env!("CARGO_MANIFEST_DIR"));
+        path_buf.push("tests");
+        path_buf.push("regression_files");
+        path_buf.push(name);
+        path_buf
+    }
+
+    const NAMES: [&str; 5] = [
+        "display_memory.cti",
+        "data_file.cti",
+        "missing_file.cti",
+        "wvi_file.cti",
+        "list_cal_set.cti",
+    ];
+
+    #[test]
+    fn same_as_buffered() {
+        let paths: Vec<PathBuf> = NAMES.iter().map(|name| filename(name)).collect();
+        for &threads in &[0, 1, 2, 16] {
+            let records = citi::read_many(&paths, threads);
+            assert_eq!(records.len(), paths.len());
+            for (path, record) in paths.iter().zip(records.iter()) {
+                match File::open(path) {
+                    Ok(mut file) => {
+                        let buffered = Record::from_reader(&mut file).unwrap();
+                        assert_eq!(record.as_ref().unwrap(), &buffered, "{:?}", path);
+                    }
+                    Err(_) => match record {
+                        Err(citi::Error::ReadError(citi::ReadError::ReadingError(_))) => (),
+                        e => panic!("{:?}", e),
+                    },
+                }
+            }
+        }
+    }
+
+    #[test]
+    fn empty() {
+        let paths: Vec<PathBuf> = vec![];
+        assert!(citi::read_many(&paths, 0).is_empty());
+    }
+}
+
+#[cfg(test)]
+mod cti_parser_regression_tests {
+    use super::*;
+    use citi::RecordParser;
+
+    fn filename(name: &str) -> PathBuf {
+        let mut path_buf = PathBuf::from(env!("CARGO_MANIFEST_DIR"));
+        path_buf.push("tests");
+        path_buf.push("regression_files");
+        path_buf.push(name);
+        path_buf
+    }
+
+    fn assert_same_as_buffered(name: &str) {
+        let bytes = std::fs::read(filename(name)).unwrap();
+        let buffered = Record::from_reader(&mut &bytes[..]).unwrap();
+        for &size in &[1, 13, 4096] {
+            let mut parser = RecordParser::new();
+            for chunk in bytes.chunks(size) {
+                parser.feed(chunk).unwrap();
+            }
+            assert_eq!(parser.finish().unwrap(), buffered, "{}", size);
+        }
+    }
+
+    #[test]
+    fn display_memory() {
+        assert_same_as_buffered("display_memory.cti");
+    }
+
+    #[test]
+    fn data_file() {
+        assert_same_as_buffered("data_file.cti");
+    }
+
+    #[test]
+    fn wvi_file() {
+        assert_same_as_buffered("wvi_file.cti");
+    }
+
+    #[test]
+    fn list_cal_set() {
+        assert_same_as_buffered("list_cal_set.cti");
+    }
+}
+
+#[cfg(test)]
+mod cti_read_options_regression_tests {
+    use super::*;
+
+    fn filename(name: &str) -> PathBuf {
+        let mut path_buf = PathBuf::from(env!("CARGO_MANIFEST_DIR"));
+        path_buf.push("tests");
+        path_buf.push("regression_files");
+        path_buf.push(name);
+        path_buf
+    }
+
+    fn read(name: &str, options: &ReadOptions) -> Record {
+        let mut file = File::open(filename(name)).unwrap();
+        Record::from_reader_with_options(&mut file, options).unwrap()
+    }
+
+    #[test]
+    fn default_reads_everything() {
+        for name in &[
+            "display_memory.cti",
+            "data_file.cti",
+            "wvi_file.cti",
+            "list_cal_set.cti",
+        ] {
+            let mut file = File::open(filename(name)).unwrap();
+            assert_eq!(
+                read(name, &ReadOptions::default()),
+                Record::from_reader(&mut file).unwrap()
+            );
+        }
+    }
+
+    #[test]
+    fn header_only() {
+        let options = ReadOptions {
+            header_only: true,
+            ..ReadOptions::default()
+        };
+        let mut file = File::open(filename("list_cal_set.cti")).unwrap();
+        let full = Record::from_reader(&mut file).unwrap();
+        let record = read("list_cal_set.cti", &options);
+
+        assert_eq!(record.header, full.header);
+        assert_eq!(record.data.len(), 3);
+        for (data_array, full_array) in record.data.iter().zip(full.data.iter()) {
+            assert_eq!(data_array.name, full_array.name);
+            assert_eq!(data_array.format, full_array.format);
+            assert!(data_array.samples.is_empty());
+        }
+    }
+
+    #[test]
+    fn one_array() {
+        let options = ReadOptions {
+            data_arrays: Some(vec![String::from("E[2]")]),
+            ..ReadOptions::default()
+        };
+        let mut file = File::open(filename("list_cal_set.cti")).unwrap();
+        let full = Record::from_reader(&mut file).unwrap();
+        let record = read("list_cal_set.cti", &options);
+
+        assert_eq!(record.header, full.header);
+        assert_eq!(record.data, vec![full.data[1].clone()]);
+    }
+}
+
+#[cfg(test)]
+mod cti_indexed_read_regression_tests {
+    use super::*;
+
+    const NAMES: &[&str] = &[
+        "display_memory.cti",
+        "data_file.cti",
+        "wvi_file.cti",
+        "list_cal_set.cti",
+    ];
+
+    fn filename(name: &str) -> PathBuf {
+        let mut path_buf = PathBuf::from(env!("CARGO_MANIFEST_DIR"));
+        path_buf.push("tests");
+        path_buf.push("regression_files");
+        path_buf.push(name);
+        path_buf
+    }
+
+    fn assert_same_as_from_reader(name: &str, record: &mut IndexedRecord) {
+        let mut file = File::open(filename(name)).unwrap();
+        let expected = Record::from_reader(&mut file).unwrap();
+
+        assert_eq!(record.header(), &expected.header);
+        for (i, data_array) in expected.data.iter().enumerate().rev() {
+            assert_eq!(&record.read_data_array(i).unwrap(), data_array);
+        }
+    }
+
+    #[test]
+    fn open() {
+        for name in NAMES {
+            let mut record = IndexedRecord::open(filename(name)).unwrap();
+            assert_same_as_from_reader(name, &mut record);
+        }
+    }
+
+    #[test]
+    fn open_with_saved_index() {
+        for name in NAMES {
+            let mut saved = vec![];
+            let record = IndexedRecord::open(filename(name)).unwrap();
+            record.index().to_writer(&mut saved).unwrap();
+
+            let index = BlockIndex::from_reader(&mut &saved[..]).unwrap();
+            let mut record = IndexedRecord::open_with_index(filename(name), index).unwrap();
+            assert_same_as_from_reader(name, &mut record);
+        }
+    }
+}
+
+#[cfg(test)]
+mod cti_binary_regression_tests {
+    use super::*;
+    use tempfile::tempdir;
+
+    fn filename(name: &str) -> PathBuf {
+        let mut path_buf = PathBuf::from(env!("CARGO_MANIFEST_DIR"));
+        path_buf.push("tests");
+        path_buf.push("regression_files");
+        path_buf.push(name);
+        path_buf
+    }
+
+    #[test]
+    fn round_trip() {
+        let tmp = tempdir().unwrap();
+        for name in &[
+            "display_memory.cti",
+            "data_file.cti",
+            "wvi_file.cti",
+            "list_cal_set.cti",
+        ] {
+            let record = Record::from_path_mmap(filename(name)).unwrap();
+            let path = tmp.path().join("record.bin");
+            let mut file = File::create(&path).unwrap();
+            record.to_binary_writer(&mut file).unwrap();
+
+            assert_eq!(Record::from_path_binary(&path).unwrap(), record);
+        }
+    }
+
+    #[test]
+    fn cached() {
+        let tmp = tempdir().unwrap();
+        let path = tmp.path().join("list_cal_set.cti");
+        std::fs::copy(filename("list_cal_set.cti"), &path).unwrap();
+        let record = Record::from_path_mmap(&path).unwrap();
+
+        assert_eq!(Record::from_path_cached(&path).unwrap(), record);
+        assert_eq!(Record::from_path_cached(&path).unwrap(), record);
+        assert_eq!(
+            Record::from_path_binary(Record::cache_path(&path)).unwrap(),
+            record
+        );
+    }
+}
+
 #[cfg(test)]
 mod cti_write_regression_tests {
     use super::*;
@@ -607,11 +962,8 @@ mod cti_write_regression_tests {
                 Complex::new(0.65892E-4, -9.61571E-4),
             ],
         });
-        record.header.independent_variable = Var {
-            name: String::from("FREQ"),
-            format: String::from("MAG"),
-            data: vec![0., 1., 2., 3., 4.],
-        };
+        record.header.independent_variable =
+            Var::with_data("FREQ", "MAG", vec![0., 1., 2., 3., 4.]);
 
         record
     }
@@ -626,4 +978,21 @@ mod cti_write_regression_tests {
 
         assert_files_equal!(display_memory_filename(), filename);
     }
+
+    #[test]
+    fn data_file_keeps_segments() {
+        let mut source = data_directory();
+        source.push("data_file.cti");
+        let record = Record::from_path_mmap(&source).unwrap();
+
+        let tmp = std::sync::Arc::new(tempdir().unwrap());
+        let filename = tmp.path().join("temp-data-file.cti");
+        let mut file = File::create(filename.clone()).unwrap();
+        record.to_writer(&mut file).unwrap();
+
+        let written = std::fs::read_to_string(&filename).unwrap();
+        assert!(written.contains("\nSEG_LIST_BEGIN\nSEG 1E9 4E9 10\nSEG_LIST_END\n"));
+        assert!(!written.contains("VAR_LIST_BEGIN"));
+        assert_eq!(Record::from_path_mmap(&filename).unwrap(), record);
+    }
 }